@@ -2642,6 +2642,7 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
   u32 timeout = 0;
   u32 val = 0;
   u32 eh_val = 0;
+  u32 lc_index = 0;
   uword memory_size = 0;
   acl_main_t *am = &acl_main;
 
@@ -2658,6 +2659,23 @@ acl_set_aclplugin_fn (vlib_main_t * vm,
       am->use_hash_acl_matching = (val != 0);
       goto done;
     }
+  if (unformat (input, "lookup-context %u engine", &lc_index))
+    {
+      if (unformat (input, "hash"))
+	val = ACL_LOOKUP_ENGINE_HASH;
+      else if (unformat (input, "bitvector"))
+	val = ACL_LOOKUP_ENGINE_BITVECTOR;
+      else
+	{
+	  error = clib_error_return (0,
+				     "expecting hash or bitvector, got `%U`",
+				     format_unformat_error, input);
+	  goto done;
+	}
+      if (acl_plugin.set_lookup_engine_for_context (lc_index, val))
+	error = clib_error_return (0, "invalid lookup context %u", lc_index);
+      goto done;
+    }
   if (unformat (input, "l4-match-nonfirst-fragment %u", &val))
     {
       am->l4_match_nonfirst_fragment = (val != 0);
@@ -3507,6 +3525,8 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
   u32 reclassify_sessions;
   u32 use_tuple_merge;
   u32 tuple_merge_split_threshold;
+  u32 use_bitvector_lookup;
+  uword bitvector_max_memory;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
@@ -3546,6 +3566,14 @@ acl_plugin_config (vlib_main_t * vm, unformat_input_t * input)
 	    (input, "tuple merge split threshold %d",
 	     &tuple_merge_split_threshold))
 	am->tuple_merge_split_threshold = tuple_merge_split_threshold;
+      else if (unformat (input, "use bitvector lookup %d",
+			 &use_bitvector_lookup))
+	am->use_bitvector_lookup = use_bitvector_lookup;
+      else
+	if (unformat
+	    (input, "bitvector max memory %U", unformat_memory_size,
+	     &bitvector_max_memory))
+	am->bitvector_max_memory = bitvector_max_memory;
 
       else if (unformat (input, "reclassify sessions %d",
 			 &reclassify_sessions))
@@ -3660,6 +3688,9 @@ acl_init (vlib_main_t * vm)
   am->use_tuple_merge = 1;
   /* Set the default threshold */
   am->tuple_merge_split_threshold = TM_SPLIT_THRESHOLD;
+  /* new lookup contexts use the hash engine unless configured otherwise */
+  am->use_bitvector_lookup = 0;
+  am->bitvector_max_memory = ACL_PLUGIN_BITVECTOR_MAX_MEMORY;
 
   am->interface_acl_user_id = ~0;	/* defer till the first use */
 
@@ -31,6 +31,7 @@
 #include "types.h"
 #include "fa_node.h"
 #include "hash_lookup_types.h"
+#include "bitvector_lookup_types.h"
 #include "lookup_context.h"
 
 #define  ACL_PLUGIN_VERSION_MAJOR 1
@@ -43,6 +44,7 @@
 #define SESSION_PURGATORY_TIMEOUT_USEC 10
 
 #define ACL_PLUGIN_HASH_LOOKUP_HEAP_SIZE (2 << 25)
+#define ACL_PLUGIN_BITVECTOR_MAX_MEMORY (2 << 23)
 #define ACL_PLUGIN_HASH_LOOKUP_HASH_BUCKETS 65536
 #define ACL_PLUGIN_HASH_LOOKUP_HASH_MEMORY (2 << 25)
 
@@ -207,6 +209,14 @@ typedef struct {
   /* vec of vectors of all info of all mask types present in ACEs contained in each lc_index */
   hash_applied_mask_info_t **hash_applied_mask_info_vec_by_lc_index;
 
+  /* Do new lookup contexts use the bit-vector lookup engine */
+  int use_bitvector_lookup;
+  /* Max size of the bit-vector classifier of a context, else it uses hash */
+  uword bitvector_max_memory;
+
+  /* bit-vector classifiers of the lookup contexts using that engine */
+  acl_bv_lc_info_t *bv_lc_info_by_lc_index;
+
   /*
    * Classify tables used to grab the packets for the ACL check,
    * and serving as the 5-tuple session tables at the same time
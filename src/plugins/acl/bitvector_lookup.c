@@ -0,0 +1,304 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+/*
+ * Bit-vector lookup engine.
+ *
+ * The applied entries of a lookup context are compiled, per address family,
+ * into one table per packet field. The values of a field are cut into the
+ * elementary intervals delimited by the rules' ranges on it, and each interval
+ * carries the bitmap of the rules covering it, bit i being applied entry i.
+ * A lookup is a binary search per field and an AND of the five bitmaps,
+ * the lowest bit set being the first matching rule. The cost depends on the
+ * number of rules, not on how their masks and port ranges mix.
+ *
+ * The first candidate bits are verified against the full rule, which takes
+ * care of the lower 64 bits of IPv6 addresses and of TCP flags.
+ */
+
+#include <stddef.h>
+
+#include <vlib/vlib.h>
+#include <vnet/vnet.h>
+#include <acl/acl.h>
+
+#include "hash_lookup.h"
+#include "bitvector_lookup.h"
+
+typedef struct {
+  u64 value;
+  u32 rule;
+  u32 is_start;
+} acl_bv_event_t;
+
+static int
+acl_bv_event_cmp (void *a1, void *a2)
+{
+  acl_bv_event_t *e1 = a1;
+  acl_bv_event_t *e2 = a2;
+
+  if (e1->value != e2->value)
+    return (e1->value < e2->value) ? -1 : 1;
+  return 0;
+}
+
+static_always_inline void
+acl_bv_prefix_range(u64 addr, int width, int prefixlen, u64 *first, u64 *last)
+{
+  u64 mask;
+
+  if (prefixlen > width)
+    prefixlen = width;
+  mask = prefixlen ? (~0ULL << (64 - prefixlen)) >> (64 - width) : 0;
+  *first = addr & mask;
+  *last = *first | (mask ^ (~0ULL >> (64 - width)));
+}
+
+/* the values of a field a rule matches */
+static void
+acl_bv_rule_range(acl_rule_t *r, int field, u64 *first, u64 *last)
+{
+  switch (field) {
+  case ACL_BV_FIELD_SRC_ADDR:
+    if (r->is_ipv6)
+      acl_bv_prefix_range(clib_net_to_host_u64(r->src.ip6.as_u64[0]), 64,
+                          r->src_prefixlen, first, last);
+    else
+      acl_bv_prefix_range(clib_net_to_host_u32(r->src.ip4.as_u32), 32,
+                          r->src_prefixlen, first, last);
+    break;
+  case ACL_BV_FIELD_DST_ADDR:
+    if (r->is_ipv6)
+      acl_bv_prefix_range(clib_net_to_host_u64(r->dst.ip6.as_u64[0]), 64,
+                          r->dst_prefixlen, first, last);
+    else
+      acl_bv_prefix_range(clib_net_to_host_u32(r->dst.ip4.as_u32), 32,
+                          r->dst_prefixlen, first, last);
+    break;
+  case ACL_BV_FIELD_PROTO:
+    *first = r->proto;
+    *last = r->proto ? r->proto : 255;
+    break;
+  /* ports are only looked at if the rule has a protocol */
+  case ACL_BV_FIELD_SRC_PORT:
+    *first = r->proto ? r->src_port_or_type_first : 0;
+    *last = r->proto ? r->src_port_or_type_last : 0xffff;
+    break;
+  case ACL_BV_FIELD_DST_PORT:
+    *first = r->proto ? r->dst_port_or_code_first : 0;
+    *last = r->proto ? r->dst_port_or_code_last : 0xffff;
+    break;
+  default:
+    ASSERT(0);
+  }
+}
+
+/*
+ * Sweep the rules' ranges on a field in value order, keeping the bitmap
+ * of the rules covering the current value, and record it wherever it
+ * changes. Adjacent intervals with the same rules are merged.
+ * Gives up with -1 once the intervals would take more than *n_bytes_left.
+ */
+static int
+acl_bv_field_build(acl_bv_classifier_t *bvc, acl_rule_t **rules, int field,
+                   uword *n_bytes_left)
+{
+  uword interval_size = sizeof(u64) + bvc->n_words * sizeof(u64);
+  int rv = 0;
+  acl_bv_field_t *f = &bvc->fields[field];
+  acl_bv_event_t *events = 0, *e;
+  u64 *curr = 0, first, last, value;
+  u32 i;
+
+  for (i = 0; i < vec_len(rules); i++) {
+    acl_bv_rule_range(rules[i], field, &first, &last);
+    if (first > last)
+      continue;
+    vec_add2(events, e, 1);
+    e->value = first;
+    e->rule = i;
+    e->is_start = 1;
+    if (last != ~0ULL) {
+      vec_add2(events, e, 1);
+      e->value = last + 1;
+      e->rule = i;
+      e->is_start = 0;
+    }
+  }
+  vec_sort_with_function(events, acl_bv_event_cmp);
+
+  vec_validate(curr, bvc->n_words - 1);
+  i = 0;
+  value = 0;
+  while (1) {
+    for (; i < vec_len(events) && events[i].value == value; i++) {
+      e = vec_elt_at_index(events, i);
+      if (e->is_start)
+        curr[e->rule / 64] |= 1ULL << (e->rule % 64);
+      else
+        curr[e->rule / 64] &= ~(1ULL << (e->rule % 64));
+    }
+    if (vec_len(f->bounds) == 0 ||
+        memcmp(vec_end(f->bits) - bvc->n_words, curr,
+               bvc->n_words * sizeof(u64))) {
+      if (*n_bytes_left < interval_size) {
+        rv = -1;
+        break;
+      }
+      *n_bytes_left -= interval_size;
+      vec_add1(f->bounds, value);
+      vec_add(f->bits, curr, bvc->n_words);
+    }
+    if (i >= vec_len(events))
+      break;
+    value = events[i].value;
+  }
+
+  vec_free(curr);
+  vec_free(events);
+  return rv;
+}
+
+static void
+acl_bv_classifier_free(acl_bv_classifier_t *bvc)
+{
+  int field;
+
+  for (field = 0; field < ACL_BV_N_FIELDS; field++) {
+    vec_free(bvc->fields[field].bounds);
+    vec_free(bvc->fields[field].bits);
+  }
+  vec_free(bvc->applied_entry_index);
+  bvc->n_words = 0;
+}
+
+static int
+acl_bv_classifier_build(acl_main_t *am, acl_bv_classifier_t *bvc,
+                        applied_hash_ace_entry_t *applied_hash_aces, int is_ip6,
+                        uword *n_bytes_left)
+{
+  applied_hash_ace_entry_t *pae;
+  acl_rule_t **rules = 0;
+  int field, rv = 0;
+
+  vec_foreach(pae, applied_hash_aces) {
+    acl_rule_t *r = vec_elt_at_index(am->acls[pae->acl_index].rules, pae->ace_index);
+    if (r->is_ipv6 != is_ip6)
+      continue;
+    vec_add1(rules, r);
+    vec_add1(bvc->applied_entry_index, pae - applied_hash_aces);
+  }
+
+  /* one spare bit, so that a field table is never empty */
+  bvc->n_words = 1 + vec_len(rules) / 64;
+  for (field = 0; field < ACL_BV_N_FIELDS && rv == 0; field++)
+    rv = acl_bv_field_build(bvc, rules, field, n_bytes_left);
+
+  vec_free(rules);
+  return rv;
+}
+
+void
+acl_bv_lc_free(acl_main_t *am, u32 lc_index)
+{
+  acl_bv_lc_info_t *bvi;
+
+  if (lc_index >= vec_len(am->bv_lc_info_by_lc_index))
+    return;
+
+  void *oldheap = hash_acl_set_heap(am);
+  bvi = vec_elt_at_index(am->bv_lc_info_by_lc_index, lc_index);
+  acl_bv_classifier_free(&bvi->af[0]);
+  acl_bv_classifier_free(&bvi->af[1]);
+  clib_mem_set_heap (oldheap);
+}
+
+void
+acl_bv_lc_update(acl_main_t *am, u32 lc_index)
+{
+  acl_lookup_context_t *acontext = pool_elt_at_index(am->acl_lookup_contexts, lc_index);
+  applied_hash_ace_entry_t *applied_hash_aces = 0;
+  acl_bv_lc_info_t *bvi, new_bvi;
+  uword n_bytes_left = am->bitvector_max_memory;
+  int rv;
+
+  if (acontext->lookup_engine != ACL_LOOKUP_ENGINE_BITVECTOR) {
+    acontext->active_lookup_engine = ACL_LOOKUP_ENGINE_HASH;
+    acontext->bitvector_build_failed = 0;
+    acl_bv_lc_free(am, lc_index);
+    return;
+  }
+
+  void *oldheap = hash_acl_set_heap(am);
+  if (lc_index < vec_len(am->hash_entry_vec_by_lc_index))
+    applied_hash_aces = am->hash_entry_vec_by_lc_index[lc_index];
+
+  /*
+   * The bitmaps grow with the square of the number of rules, so the build
+   * is bounded by bitvector_max_memory rather than by the heap it is in:
+   * past it, the context keeps matching with the hash engine.
+   */
+  clib_memset(&new_bvi, 0, sizeof(new_bvi));
+  rv = acl_bv_classifier_build(am, &new_bvi.af[0], applied_hash_aces, 0, &n_bytes_left);
+  if (rv == 0)
+    rv = acl_bv_classifier_build(am, &new_bvi.af[1], applied_hash_aces, 1, &n_bytes_left);
+  if (rv) {
+    clib_warning("ACL lookup context %d: bitvector classifier of %d rules exceeds %U, using the hash engine",
+                 lc_index, vec_len(applied_hash_aces),
+                 format_memory_size, am->bitvector_max_memory);
+    acontext->active_lookup_engine = ACL_LOOKUP_ENGINE_HASH;
+    acontext->bitvector_build_failed = 1;
+    acl_bv_classifier_free(&new_bvi.af[0]);
+    acl_bv_classifier_free(&new_bvi.af[1]);
+    clib_mem_set_heap (oldheap);
+    acl_bv_lc_free(am, lc_index);
+    return;
+  }
+
+  vec_validate(am->bv_lc_info_by_lc_index, lc_index);
+  bvi = vec_elt_at_index(am->bv_lc_info_by_lc_index, lc_index);
+  acl_bv_classifier_free(&bvi->af[0]);
+  acl_bv_classifier_free(&bvi->af[1]);
+  *bvi = new_bvi;
+  acontext->active_lookup_engine = ACL_LOOKUP_ENGINE_BITVECTOR;
+  acontext->bitvector_build_failed = 0;
+  clib_mem_set_heap (oldheap);
+}
+
+void
+acl_bv_show_lc_info(vlib_main_t *vm, acl_main_t *am, u32 lc_index)
+{
+  acl_bv_lc_info_t *bvi;
+  acl_bv_classifier_t *bvc;
+  int is_ip6;
+
+  if (lc_index >= vec_len(am->bv_lc_info_by_lc_index))
+    return;
+
+  bvi = vec_elt_at_index(am->bv_lc_info_by_lc_index, lc_index);
+  for (is_ip6 = 0; is_ip6 < 2; is_ip6++) {
+    bvc = &bvi->af[is_ip6];
+    vlib_cli_output (vm,
+                     "  bitvector %s: %d rules, %d words per bitmap, intervals src %d dst %d proto %d sport %d dport %d",
+                     is_ip6 ? "ip6" : "ip4", vec_len(bvc->applied_entry_index), bvc->n_words,
+                     vec_len(bvc->fields[ACL_BV_FIELD_SRC_ADDR].bounds),
+                     vec_len(bvc->fields[ACL_BV_FIELD_DST_ADDR].bounds),
+                     vec_len(bvc->fields[ACL_BV_FIELD_PROTO].bounds),
+                     vec_len(bvc->fields[ACL_BV_FIELD_SRC_PORT].bounds),
+                     vec_len(bvc->fields[ACL_BV_FIELD_DST_PORT].bounds));
+  }
+}
@@ -0,0 +1,40 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_BITVECTOR_LOOKUP_H_
+#define _ACL_BITVECTOR_LOOKUP_H_
+
+#include "lookup_context.h"
+#include "acl.h"
+
+/*
+ * Recompile the bit-vector classifier of a lookup context from its
+ * applied entries, or free it if the context uses another engine.
+ * Call once the vector of ACLs of the context or one of them changed.
+ */
+
+void acl_bv_lc_update(acl_main_t *am, u32 lc_index);
+
+/* Release the bit-vector classifier of a lookup context */
+
+void acl_bv_lc_free(acl_main_t *am, u32 lc_index);
+
+/* Print the size of the bit-vector classifier of a lookup context */
+
+void acl_bv_show_lc_info(vlib_main_t *vm, acl_main_t *am, u32 lc_index);
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef _ACL_BITVECTOR_LOOKUP_TYPES_H_
+#define _ACL_BITVECTOR_LOOKUP_TYPES_H_
+
+#include "types.h"
+
+/* the packet fields the bit-vector classifier cuts on */
+#define foreach_acl_bv_field \
+_(SRC_ADDR, src_addr)        \
+_(DST_ADDR, dst_addr)        \
+_(PROTO, proto)              \
+_(SRC_PORT, src_port)        \
+_(DST_PORT, dst_port)
+
+typedef enum {
+#define _(N, n) ACL_BV_FIELD_##N,
+  foreach_acl_bv_field
+#undef _
+  ACL_BV_N_FIELDS,
+} acl_bv_field_type_t;
+
+typedef struct {
+  /*
+   * sorted first values of the elementary intervals of the field,
+   * the first one is always 0. IPv6 addresses are cut on their upper 64 bits.
+   */
+  u64 *bounds;
+  /* n_words of rule bits per interval, a bit is set if the rule covers it */
+  u64 *bits;
+} acl_bv_field_t;
+
+typedef struct {
+  acl_bv_field_t fields[ACL_BV_N_FIELDS];
+  /* applied entry index of each rule bit, bits are in rule priority order */
+  u32 *applied_entry_index;
+  /* number of u64 words in a rule bitmap */
+  u32 n_words;
+} acl_bv_classifier_t;
+
+typedef struct {
+  /* classifiers of the context, indexed by is_ip6 */
+  acl_bv_classifier_t af[2];
+} acl_bv_lc_info_t;
+
+#endif
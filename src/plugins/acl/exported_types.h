@@ -66,6 +66,19 @@ typedef int (*acl_plugin_set_acl_vec_for_context_fn_t) (u32 lc_index, u32 *acl_l
 typedef void (*acl_plugin_fill_5tuple_fn_t) (u32 lc_index, vlib_buffer_t * b0, int is_ip6, int is_input,
                                 int is_l2_path, fa_5tuple_opaque_t * p5tuple_pkt);
 
+/*
+ * Select the algorithm matching the packets against the ACLs of a context.
+ * The bit-vector engine trades memory for a lookup cost depending only
+ * on the number of rules. The result of a match is the same with either.
+ */
+
+typedef enum {
+  ACL_LOOKUP_ENGINE_HASH = 0,
+  ACL_LOOKUP_ENGINE_BITVECTOR,
+} acl_lookup_engine_t;
+
+typedef int (*acl_plugin_set_lookup_engine_for_context_fn_t) (u32 lc_index, u32 lookup_engine);
+
 typedef int (*acl_plugin_match_5tuple_fn_t) (u32 lc_index,
                                            fa_5tuple_opaque_t * pkt_5tuple,
                                            int is_ip6, u8 * r_action,
@@ -82,7 +95,8 @@ _(get_lookup_context_index)            \
 _(put_lookup_context_index)            \
 _(set_acl_vec_for_context)             \
 _(fill_5tuple)                         \
-_(match_5tuple)                        
+_(match_5tuple)                        \
+_(set_lookup_engine_for_context)
 
 #define _(name) acl_plugin_ ## name ## _fn_t name;
 typedef struct {
@@ -586,7 +586,7 @@ activate_applied_ace_hash_entry(acl_main_t *am,
 }
 
 
-static void *
+void *
 hash_acl_set_heap(acl_main_t *am)
 {
   if (0 == am->hash_lookup_mheap) {
@@ -44,4 +44,7 @@ void hash_acl_delete(acl_main_t *am, int acl_index);
 /* return if there is already a filled-in hash acl info */
 int hash_acl_exists(acl_main_t *am, int acl_index);
 
+/* switch to the heap holding the lookup data structures, return the old one */
+void *hash_acl_set_heap(acl_main_t *am);
+
 #endif
@@ -18,6 +18,7 @@
 #include <vlib/unix/plugin.h>
 #include <plugins/acl/public_inlines.h>
 #include "hash_lookup.h"
+#include "bitvector_lookup.h"
 #include "elog_acl_trace.h"
 
 /* check if a given ACL exists */
@@ -107,6 +108,11 @@ static int acl_plugin_get_lookup_context_index (u32 acl_user_id, u32 val1, u32 v
   acontext->context_user_id = acl_user_id;
   acontext->user_val1 = val1;
   acontext->user_val2 = val2;
+  acontext->lookup_engine = am->use_bitvector_lookup ?
+    ACL_LOOKUP_ENGINE_BITVECTOR : ACL_LOOKUP_ENGINE_HASH;
+  /* the classifier is compiled once the context has ACLs */
+  acontext->active_lookup_engine = ACL_LOOKUP_ENGINE_HASH;
+  acontext->bitvector_build_failed = 0;
 
   u32 new_context_id = acontext - am->acl_lookup_contexts;
   vec_add1(am->acl_users[acl_user_id].lookup_contexts, new_context_id);
@@ -200,6 +206,7 @@ static void acl_plugin_put_lookup_context_index (u32 lc_index)
   vec_del1(am->acl_users[acontext->context_user_id].lookup_contexts, index);
   unapply_acl_vec(lc_index, acontext->acl_indices);
   unlock_acl_vec(lc_index, acontext->acl_indices);
+  acl_bv_lc_free(am, lc_index);
   vec_free(acontext->acl_indices);
   pool_put(am->acl_lookup_contexts, acontext);
   clib_mem_set_heap (oldheap);
@@ -256,6 +263,7 @@ static int acl_plugin_set_acl_vec_for_context (u32 lc_index, u32 *acl_list)
   unlock_acl_vec(lc_index, old_acl_vector);
   lock_acl_vec(lc_index, acontext->acl_indices);
   apply_acl_vec(lc_index, acontext->acl_indices);
+  acl_bv_lc_update(am, lc_index);
 
   vec_free(old_acl_vector);
 
@@ -275,12 +283,45 @@ void acl_plugin_lookup_context_notify_acl_change(u32 acl_num)
         hash_acl_delete(am, acl_num);
     }
     hash_acl_add(am, acl_num);
+    /* recompile the contexts using the ACL */
+    if (acl_num < vec_len(am->lc_index_vec_by_acl)) {
+      u32 *lc_index;
+      vec_foreach(lc_index, am->lc_index_vec_by_acl[acl_num]) {
+        acl_bv_lc_update(am, *lc_index);
+      }
+    }
   } else {
     /* this is a deletion notification */
     hash_acl_delete(am, acl_num);
   }
 }
 
+/*
+ * Select the lookup engine of a context. The bit-vector one is compiled
+ * from the applied ACLs now and on every change to them, the context
+ * matching with the hash engine while it does not fit bitvector_max_memory.
+ */
+static int acl_plugin_set_lookup_engine_for_context (u32 lc_index, u32 lookup_engine)
+{
+  acl_main_t *am = &acl_main;
+  acl_lookup_context_t *acontext;
+
+  if (!acl_lc_index_valid(am, lc_index)) {
+    clib_warning("BUG: lc_index %d is not valid", lc_index);
+    return -1;
+  }
+  if (lookup_engine != ACL_LOOKUP_ENGINE_HASH &&
+      lookup_engine != ACL_LOOKUP_ENGINE_BITVECTOR)
+    return VNET_API_ERROR_INVALID_VALUE;
+
+  elog_acl_cond_trace_X2(am, (am->trace_acl), "LOOKUP-CONTEXT: set-lookup-engine lc_index %d engine %d", "i4i4", lc_index, lookup_engine);
+  void *oldheap = acl_plugin_set_heap ();
+  acontext = pool_elt_at_index(am->acl_lookup_contexts, lc_index);
+  acontext->lookup_engine = lookup_engine;
+  acl_bv_lc_update(am, lc_index);
+  clib_mem_set_heap (oldheap);
+  return 0;
+}
 
 /* Fill the 5-tuple from the packet */
 
@@ -338,16 +379,24 @@ acl_plugin_show_lookup_context (u32 lc_index)
     if ((lc_index == ~0) || (curr_lc_index == lc_index)) {
       if (acl_user_id_valid(am, acontext->context_user_id)) {
         acl_lookup_context_user_t *auser = pool_elt_at_index(am->acl_users, acontext->context_user_id);
-        vlib_cli_output (vm, "index %d:%s %s: %d %s: %d, acl_indices: %U",
+        vlib_cli_output (vm, "index %d:%s %s: %d %s: %d, acl_indices: %U, engine: %s%s",
                        curr_lc_index, auser->user_module_name, auser->val1_label,
                        acontext->user_val1, auser->val2_label, acontext->user_val2,
-                       format_vec32, acontext->acl_indices, "%d");
+                       format_vec32, acontext->acl_indices, "%d",
+                       acontext->lookup_engine == ACL_LOOKUP_ENGINE_BITVECTOR ? "bitvector" : "hash",
+                       acontext->bitvector_build_failed ?
+                         " (over bitvector max memory, using hash)" : "");
       } else {
-        vlib_cli_output (vm, "index %d: user_id: %d user_val1: %d user_val2: %d, acl_indices: %U",
+        vlib_cli_output (vm, "index %d: user_id: %d user_val1: %d user_val2: %d, acl_indices: %U, engine: %s%s",
                        curr_lc_index, acontext->context_user_id,
                        acontext->user_val1, acontext->user_val2,
-                       format_vec32, acontext->acl_indices, "%d");
+                       format_vec32, acontext->acl_indices, "%d",
+                       acontext->lookup_engine == ACL_LOOKUP_ENGINE_BITVECTOR ? "bitvector" : "hash",
+                       acontext->bitvector_build_failed ?
+                         " (over bitvector max memory, using hash)" : "");
       }
+      if (acontext->active_lookup_engine == ACL_LOOKUP_ENGINE_BITVECTOR)
+        acl_bv_show_lc_info(vm, am, curr_lc_index);
     }
   }));
 }
@@ -16,6 +16,8 @@
 #ifndef included_acl_lookup_context_h
 #define included_acl_lookup_context_h
 
+#include "exported_types.h"
+
 typedef struct {
   /* A name of the portion of the code using the ACL infra */
   char *user_module_name;
@@ -36,6 +38,15 @@ typedef struct {
   u32 user_val1;
   /* per-instance user value 2 */
   u32 user_val2;
+  /* acl_lookup_engine_t configured for this context */
+  u8 lookup_engine;
+  /*
+   * acl_lookup_engine_t used to match in this context, the hash one
+   * if the bit-vector classifier would exceed bitvector_max_memory
+   */
+  u8 active_lookup_engine;
+  /* the last bit-vector classifier build exceeded bitvector_max_memory */
+  u8 bitvector_build_failed;
 } acl_lookup_context_t;
 
 void acl_plugin_lookup_context_notify_acl_change(u32 acl_num);
@@ -647,6 +647,91 @@ hash_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5
   return 0;
 }
 
+/* the value of a field of the packet, as the bit-vector classifier cuts it */
+always_inline u64
+acl_bv_field_value (fa_5tuple_t * pkt_5tuple, int is_ip6, int field)
+{
+  switch (field) {
+  case ACL_BV_FIELD_SRC_ADDR:
+    return is_ip6 ? clib_net_to_host_u64(pkt_5tuple->ip6_addr[0].as_u64[0])
+                  : clib_net_to_host_u32(pkt_5tuple->ip4_addr[0].as_u32);
+  case ACL_BV_FIELD_DST_ADDR:
+    return is_ip6 ? clib_net_to_host_u64(pkt_5tuple->ip6_addr[1].as_u64[0])
+                  : clib_net_to_host_u32(pkt_5tuple->ip4_addr[1].as_u32);
+  case ACL_BV_FIELD_PROTO:
+    return pkt_5tuple->l4.proto;
+  case ACL_BV_FIELD_SRC_PORT:
+    return pkt_5tuple->l4.port[0];
+  case ACL_BV_FIELD_DST_PORT:
+    return pkt_5tuple->l4.port[1];
+  }
+  return 0;
+}
+
+/* the bitmap of the rules covering the interval a value falls in */
+always_inline u64 *
+acl_bv_field_bits (acl_bv_classifier_t *bvc, int field, u64 value)
+{
+  acl_bv_field_t *f = &bvc->fields[field];
+  u32 lo = 0, hi = vec_len(f->bounds) - 1, mid;
+
+  /* the last interval starting at or below the value, bounds[0] is 0 */
+  while (lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    if (f->bounds[mid] <= value)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+  return f->bits + lo * bvc->n_words;
+}
+
+always_inline int
+bitvector_multi_acl_match_5tuple (void *p_acl_main, u32 lc_index, fa_5tuple_t * pkt_5tuple,
+                       int is_ip6, u8 *action, u32 *acl_pos_p, u32 * acl_match_p,
+                       u32 * rule_match_p, u32 * trace_bitmap)
+{
+  acl_main_t *am = p_acl_main;
+  acl_bv_classifier_t *bvc;
+  u64 *bits[ACL_BV_N_FIELDS];
+  u64 word;
+  u32 i, bit;
+  int field;
+
+  if (PREDICT_FALSE(lc_index >= vec_len(am->bv_lc_info_by_lc_index)))
+    return 0;
+
+  bvc = &am->bv_lc_info_by_lc_index[lc_index].af[is_ip6];
+  if (PREDICT_FALSE(vec_len(bvc->applied_entry_index) == 0))
+    return 0;
+
+  applied_hash_ace_entry_t **applied_hash_aces = vec_elt_at_index(am->hash_entry_vec_by_lc_index, lc_index);
+
+  for (field = 0; field < ACL_BV_N_FIELDS; field++)
+    bits[field] = acl_bv_field_bits(bvc, field, acl_bv_field_value(pkt_5tuple, is_ip6, field));
+
+  /* the lowest bit set in all the bitmaps is the first candidate rule */
+  for (i = 0; i < bvc->n_words; i++) {
+    word = bits[ACL_BV_FIELD_SRC_ADDR][i] & bits[ACL_BV_FIELD_DST_ADDR][i] &
+           bits[ACL_BV_FIELD_PROTO][i] & bits[ACL_BV_FIELD_SRC_PORT][i] &
+           bits[ACL_BV_FIELD_DST_PORT][i];
+    while (word) {
+      bit = i * 64 + count_trailing_zeros(word);
+      applied_hash_ace_entry_t *pae = vec_elt_at_index((*applied_hash_aces), bvc->applied_entry_index[bit]);
+      acl_rule_t *r = &(am->acls[pae->acl_index].rules[pae->ace_index]);
+      if (single_rule_match_5tuple(r, is_ip6, pkt_5tuple)) {
+        pae->hitcount++;
+        *acl_pos_p = pae->acl_position;
+        *acl_match_p = pae->acl_index;
+        *rule_match_p = pae->ace_index;
+        *action = pae->action;
+        return 1;
+      }
+      word &= word - 1;
+    }
+  }
+  return 0;
+}
 
 
 always_inline int
@@ -672,6 +757,10 @@ acl_plugin_match_5tuple_inline (void *p_acl_main, u32 lc_index,
       return linear_multi_acl_match_5tuple(p_acl_main, lc_index, pkt_5tuple_internal, is_ip6, r_action,
                                  r_acl_pos_p, r_acl_match_p, r_rule_match_p, trace_bitmap);
     } else {
+      acl_lookup_context_t *acontext = pool_elt_at_index(am->acl_lookup_contexts, lc_index);
+      if (acontext->active_lookup_engine == ACL_LOOKUP_ENGINE_BITVECTOR)
+        return bitvector_multi_acl_match_5tuple(p_acl_main, lc_index, pkt_5tuple_internal, is_ip6, r_action,
+                                 r_acl_pos_p, r_acl_match_p, r_rule_match_p, trace_bitmap);
       return hash_multi_acl_match_5tuple(p_acl_main, lc_index, pkt_5tuple_internal, is_ip6, r_action,
                                  r_acl_pos_p, r_acl_match_p, r_rule_match_p, trace_bitmap);
     }
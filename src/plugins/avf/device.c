@@ -213,12 +213,47 @@ avf_cmd_rx_ctl_reg_write (vlib_main_t * vm, avf_device_t * ad, u32 reg,
   return err;
 }
 
+/*
+ * Fill an empty rx ring from the queue's buffer pool. When the queue is
+ * already enabled the tail is moved too, as the first refill would.
+ */
+static clib_error_t *
+avf_rxq_fill (vlib_main_t * vm, avf_device_t * ad, avf_rxq_t * rxq)
+{
+  avf_rx_desc_t *d = rxq->descs;
+  u32 n_alloc, i;
+
+  n_alloc = vlib_buffer_alloc_from_pool (vm, rxq->bufs, rxq->size - 8,
+					 rxq->buffer_pool_index);
+
+  if (n_alloc == 0)
+    return clib_error_return (0, "buffer allocation error");
+
+  rxq->n_enqueued = n_alloc;
+  for (i = 0; i < n_alloc; i++)
+    {
+      vlib_buffer_t *b = vlib_get_buffer (vm, rxq->bufs[i]);
+      if (ad->flags & AVF_DEVICE_F_VA_DMA)
+	d->qword[0] = vlib_buffer_get_va (b);
+      else
+	d->qword[0] = vlib_buffer_get_pa (vm, b);
+      d++;
+    }
+
+  if (ad->flags & AVF_DEVICE_F_INITIALIZED)
+    {
+      CLIB_MEMORY_STORE_BARRIER ();
+      *(rxq->qrx_tail) = n_alloc;
+    }
+
+  return 0;
+}
+
 clib_error_t *
 avf_rxq_init (vlib_main_t * vm, avf_device_t * ad, u16 qid, u16 rxq_size)
 {
   clib_error_t *err;
   avf_rxq_t *rxq;
-  u32 n_alloc, i;
 
   vec_validate_aligned (ad->rxqs, qid, CLIB_CACHE_LINE_BYTES);
   rxq = vec_elt_at_index (ad->rxqs, qid);
@@ -229,9 +264,6 @@ avf_rxq_init (vlib_main_t * vm, avf_device_t * ad, u16 qid, u16 rxq_size)
 						   2 * CLIB_CACHE_LINE_BYTES,
 						   ad->numa_node);
 
-  rxq->buffer_pool_index =
-    vlib_buffer_pool_get_default_for_numa (vm, ad->numa_node);
-
   if (rxq->descs == 0)
     return vlib_physmem_last_error (vm);
 
@@ -241,27 +273,20 @@ avf_rxq_init (vlib_main_t * vm, avf_device_t * ad, u16 qid, u16 rxq_size)
   clib_memset ((void *) rxq->descs, 0, rxq->size * sizeof (avf_rx_desc_t));
   vec_validate_aligned (rxq->bufs, rxq->size, CLIB_CACHE_LINE_BYTES);
   rxq->qrx_tail = ad->bar0 + AVF_QRX_TAIL (qid);
+  rxq->n_enqueued = 0;
+  ad->n_rx_queues = clib_min (ad->num_queue_pairs, qid + 1);
 
-  n_alloc = vlib_buffer_alloc_from_pool (vm, rxq->bufs, rxq->size - 8,
-					 rxq->buffer_pool_index);
-
-  if (n_alloc == 0)
-    return clib_error_return (0, "buffer allocation error");
+  /*
+   * without a device numa node the pool is the one of the thread polling
+   * the queue, known once the interface exists, see avf_rxq_fill ()
+   */
+  if (ad->numa_node >= VLIB_BUFFER_MAX_NUMA_NODES)
+    return 0;
 
-  rxq->n_enqueued = n_alloc;
-  avf_rx_desc_t *d = rxq->descs;
-  for (i = 0; i < n_alloc; i++)
-    {
-      vlib_buffer_t *b = vlib_get_buffer (vm, rxq->bufs[i]);
-      if (ad->flags & AVF_DEVICE_F_VA_DMA)
-	d->qword[0] = vlib_buffer_get_va (b);
-      else
-	d->qword[0] = vlib_buffer_get_pa (vm, b);
-      d++;
-    }
+  rxq->buffer_pool_index =
+    vlib_buffer_pool_get_for_rx_queue (vm, ad->numa_node, ~0);
 
-  ad->n_rx_queues = clib_min (ad->num_queue_pairs, qid + 1);
-  return 0;
+  return avf_rxq_fill (vm, ad, rxq);
 }
 
 clib_error_t *
@@ -1332,7 +1357,21 @@ avf_create_if (vlib_main_t * vm, avf_create_if_args_t * args)
 				    avf_input_node.index);
 
   for (i = 0; i < ad->n_rx_queues; i++)
-    vnet_hw_interface_assign_rx_thread (vnm, ad->hw_if_index, i, ~0);
+    {
+      avf_rxq_t *rxq = vec_elt_at_index (ad->rxqs, i);
+      u32 thread_index;
+
+      vnet_hw_interface_assign_rx_thread (vnm, ad->hw_if_index, i, ~0);
+      if (rxq->n_enqueued)
+	continue;
+
+      thread_index = vnet_get_device_input_thread_index (vnm, ad->hw_if_index,
+							 i);
+      rxq->buffer_pool_index =
+	vlib_buffer_pool_get_for_rx_queue (vm, ad->numa_node, thread_index);
+      if ((error = avf_rxq_fill (vm, ad, rxq)))
+	goto error;
+    }
 
   if (pool_elts (am->devices) == 1)
     vlib_process_signal_event (vm, avf_process_node.index,
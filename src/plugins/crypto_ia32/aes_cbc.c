@@ -0,0 +1,426 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/plugin/plugin.h>
+#include <vnet/crypto/crypto.h>
+#include <crypto_ia32/crypto_ia32.h>
+#include <crypto_ia32/aesni.h>
+
+#if __GNUC__ > 4  && !__clang__ && CLIB_DEBUG == 0
+#pragma GCC optimize ("O3")
+#endif
+
+/*
+ * CBC encryption is sequential within a buffer, so we interleave
+ * independent buffers instead: each lane carries its own key schedule,
+ * chaining value and src/dst pointers and all lanes are advanced one
+ * block per iteration. With VAES four lanes share one 512-bit register.
+ */
+#if defined(__VAES__) && defined(__AVX512F__)
+#define N_AES_LANES 8
+#else
+#define N_AES_LANES 4
+#endif
+
+STATIC_ASSERT (N_AES_LANES <= CRYPTO_IA32_MAX_AES_LANES, "too many lanes");
+
+static_always_inline crypto_ia32_aes_key_t *
+aesni_get_key (crypto_ia32_per_thread_data_t * ptd, u8 * key,
+	       aesni_key_size_t ks)
+{
+  crypto_ia32_aes_key_t *k;
+  k = ptd->aes_keys + crypto_ia32_key_cache_index (key);
+
+  /* the same key bytes may be the start of a longer key */
+  if (PREDICT_TRUE (k->is_valid && k->key_size == ks &&
+		    memcmp (k->key, key, AESNI_KEY_BYTES (ks)) == 0))
+    return k;
+
+  clib_memcpy_fast (k->key, key, AESNI_KEY_BYTES (ks));
+  k->key_size = ks;
+  aes_key_expand (k->encrypt_key, key, ks);
+  clib_memcpy_fast (k->decrypt_key, k->encrypt_key,
+		    sizeof (k->encrypt_key));
+  aes_key_enc_to_dec (k->decrypt_key, ks);
+  k->is_valid = 1;
+  return k;
+}
+
+/*
+ * IVs must be unpredictable, so they are not derived from the previous
+ * IV or cipher text: each one is the next value of a per-thread counter
+ * encrypted under a per-thread key, both read from /dev/urandom at init.
+ */
+static_always_inline __m128i
+aesni_cbc_next_iv (crypto_ia32_per_thread_data_t * ptd)
+{
+  __m128i r = ptd->cbc_iv_counter ^ ptd->cbc_iv_key[0];
+  int j;
+
+  ptd->cbc_iv_counter = _mm_add_epi64 (ptd->cbc_iv_counter,
+				       _mm_set_epi64x (0, 1));
+
+  for (j = 1; j < AESNI_KEY_ROUNDS (AESNI_KEY_128); j++)
+    r = _mm_aesenc_si128 (r, ptd->cbc_iv_key[j]);
+  return _mm_aesenclast_si128 (r, ptd->cbc_iv_key[j]);
+}
+
+#if defined(__VAES__) && defined(__AVX512F__)
+static_always_inline __m512i
+aesni_load_lanes (u8 ** p)
+{
+  __m512i r = _mm512_castsi128_si512 (_mm_loadu_si128 ((__m128i *) p[0]));
+  r = _mm512_inserti32x4 (r, _mm_loadu_si128 ((__m128i *) p[1]), 1);
+  r = _mm512_inserti32x4 (r, _mm_loadu_si128 ((__m128i *) p[2]), 2);
+  r = _mm512_inserti32x4 (r, _mm_loadu_si128 ((__m128i *) p[3]), 3);
+  return r;
+}
+
+static_always_inline void
+aesni_store_lanes (u8 ** p, __m512i r)
+{
+  _mm_storeu_si128 ((__m128i *) p[0], _mm512_castsi512_si128 (r));
+  _mm_storeu_si128 ((__m128i *) p[1], _mm512_extracti32x4_epi32 (r, 1));
+  _mm_storeu_si128 ((__m128i *) p[2], _mm512_extracti32x4_epi32 (r, 2));
+  _mm_storeu_si128 ((__m128i *) p[3], _mm512_extracti32x4_epi32 (r, 3));
+}
+#endif
+
+static_always_inline u32
+aesni_ops_enc_aes_cbc (vlib_main_t * vm, vnet_crypto_op_t * ops[],
+		       u32 n_ops, aesni_key_size_t ks)
+{
+  crypto_ia32_main_t *cm = &crypto_ia32_main;
+  crypto_ia32_per_thread_data_t *ptd = vec_elt_at_index (cm->per_thread_data,
+							 vm->thread_index);
+  int rounds = AESNI_KEY_ROUNDS (ks);
+  u8 dummy[16];
+  u32 i, j, n, count, n_left = n_ops;
+  u32 len[N_AES_LANES] = { }, inc[N_AES_LANES] = { };
+  u8 *src[N_AES_LANES], *dst[N_AES_LANES];
+  __m128i r[N_AES_LANES] = { };
+  __m128i k[15][N_AES_LANES] = { };
+
+  for (i = 0; i < N_AES_LANES; i++)
+    src[i] = dst[i] = dummy;
+
+more:
+  for (i = 0; i < N_AES_LANES; i++)
+    if (len[i] == 0)
+      {
+	crypto_ia32_aes_key_t *key;
+
+	if (n_left == 0)
+	  {
+	    /* no more work, park the lane on the dummy block */
+	    src[i] = dst[i] = dummy;
+	    inc[i] = 0;
+	    continue;
+	  }
+
+	if (ops[0]->flags & VNET_CRYPTO_OP_FLAG_INIT_IV)
+	  {
+	    r[i] = aesni_cbc_next_iv (ptd);
+	    _mm_storeu_si128 ((__m128i *) ops[0]->iv, r[i]);
+	  }
+	else
+	  r[i] = _mm_loadu_si128 ((__m128i *) ops[0]->iv);
+
+	key = aesni_get_key (ptd, ops[0]->key, ks);
+	for (j = 0; j <= rounds; j++)
+	  k[j][i] = key->encrypt_key[j];
+
+	src[i] = ops[0]->src;
+	dst[i] = ops[0]->dst;
+	len[i] = ops[0]->len;
+	inc[i] = 16;
+	ops[0]->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+	ops++;
+	n_left--;
+      }
+
+  count = ~0;
+  for (i = 0; i < N_AES_LANES; i++)
+    if (len[i] && len[i] < count)
+      count = len[i];
+
+  if (count == ~0)
+    return n_ops;
+
+#if defined(__VAES__) && defined(__AVX512F__)
+  {
+    __m512i rz[2], kz;
+
+    rz[0] = _mm512_loadu_si512 ((__m512i *) r);
+    rz[1] = _mm512_loadu_si512 ((__m512i *) (r + 4));
+
+    for (n = 0; n < count; n += 16)
+      {
+	rz[0] ^= aesni_load_lanes (src) ^ _mm512_loadu_si512 (k[0]);
+	rz[1] ^= aesni_load_lanes (src + 4) ^ _mm512_loadu_si512 (k[0] + 4);
+
+	for (j = 1; j < rounds; j++)
+	  {
+	    kz = _mm512_loadu_si512 (k[j]);
+	    rz[0] = _mm512_aesenc_epi128 (rz[0], kz);
+	    kz = _mm512_loadu_si512 (k[j] + 4);
+	    rz[1] = _mm512_aesenc_epi128 (rz[1], kz);
+	  }
+
+	rz[0] = _mm512_aesenclast_epi128 (rz[0],
+					  _mm512_loadu_si512 (k[rounds]));
+	rz[1] = _mm512_aesenclast_epi128 (rz[1],
+					  _mm512_loadu_si512 (k[rounds] + 4));
+	aesni_store_lanes (dst, rz[0]);
+	aesni_store_lanes (dst + 4, rz[1]);
+
+	for (i = 0; i < N_AES_LANES; i++)
+	  {
+	    src[i] += inc[i];
+	    dst[i] += inc[i];
+	  }
+      }
+
+    _mm512_storeu_si512 ((__m512i *) r, rz[0]);
+    _mm512_storeu_si512 ((__m512i *) (r + 4), rz[1]);
+  }
+#else
+  for (n = 0; n < count; n += 16)
+    {
+      for (i = 0; i < N_AES_LANES; i++)
+	r[i] ^= _mm_loadu_si128 ((__m128i *) src[i]) ^ k[0][i];
+
+      for (j = 1; j < rounds; j++)
+	for (i = 0; i < N_AES_LANES; i++)
+	  r[i] = _mm_aesenc_si128 (r[i], k[j][i]);
+
+      for (i = 0; i < N_AES_LANES; i++)
+	{
+	  r[i] = _mm_aesenclast_si128 (r[i], k[rounds][i]);
+	  _mm_storeu_si128 ((__m128i *) dst[i], r[i]);
+	  src[i] += inc[i];
+	  dst[i] += inc[i];
+	}
+    }
+#endif
+
+  for (i = 0; i < N_AES_LANES; i++)
+    if (len[i])
+      len[i] -= count;
+
+  goto more;
+}
+
+static_always_inline void
+aesni_cbc_dec (__m128i * k, u8 * src, u8 * dst, u8 * iv, int count,
+	       int rounds)
+{
+  __m128i r0, r1, r2, r3, c0, c1, c2, c3, f;
+  int i;
+
+  f = _mm_loadu_si128 ((__m128i *) iv);
+
+#if defined(__VAES__) && defined(__AVX512F__)
+  {
+    __m512i c[4], rz[4], kz, fz = _mm512_broadcast_i32x4 (f);
+
+    while (count >= 256)
+      {
+	kz = _mm512_broadcast_i32x4 (k[0]);
+	for (i = 0; i < 4; i++)
+	  {
+	    c[i] = _mm512_loadu_si512 ((__m512i *) (src + 64 * i));
+	    rz[i] = c[i] ^ kz;
+	  }
+
+	for (int j = 1; j < rounds; j++)
+	  {
+	    kz = _mm512_broadcast_i32x4 (k[j]);
+	    for (i = 0; i < 4; i++)
+	      rz[i] = _mm512_aesdec_epi128 (rz[i], kz);
+	  }
+
+	kz = _mm512_broadcast_i32x4 (k[rounds]);
+	for (i = 0; i < 4; i++)
+	  rz[i] = _mm512_aesdeclast_epi128 (rz[i], kz);
+
+	/* xor with the previous cipher text block of each lane */
+	rz[0] ^= _mm512_alignr_epi64 (c[0], fz, 6);
+	for (i = 1; i < 4; i++)
+	  rz[i] ^= _mm512_alignr_epi64 (c[i], c[i - 1], 6);
+
+	for (i = 0; i < 4; i++)
+	  _mm512_storeu_si512 ((__m512i *) (dst + 64 * i), rz[i]);
+
+	fz = c[3];
+	count -= 256;
+	src += 256;
+	dst += 256;
+      }
+
+    f = _mm512_extracti32x4_epi32 (fz, 3);
+  }
+#endif
+
+  while (count >= 64)
+    {
+      c0 = _mm_loadu_si128 (((__m128i *) src + 0));
+      c1 = _mm_loadu_si128 (((__m128i *) src + 1));
+      c2 = _mm_loadu_si128 (((__m128i *) src + 2));
+      c3 = _mm_loadu_si128 (((__m128i *) src + 3));
+
+      r0 = c0 ^ k[0];
+      r1 = c1 ^ k[0];
+      r2 = c2 ^ k[0];
+      r3 = c3 ^ k[0];
+
+      for (i = 1; i < rounds; i++)
+	{
+	  r0 = _mm_aesdec_si128 (r0, k[i]);
+	  r1 = _mm_aesdec_si128 (r1, k[i]);
+	  r2 = _mm_aesdec_si128 (r2, k[i]);
+	  r3 = _mm_aesdec_si128 (r3, k[i]);
+	}
+
+      r0 = _mm_aesdeclast_si128 (r0, k[i]);
+      r1 = _mm_aesdeclast_si128 (r1, k[i]);
+      r2 = _mm_aesdeclast_si128 (r2, k[i]);
+      r3 = _mm_aesdeclast_si128 (r3, k[i]);
+
+      _mm_storeu_si128 ((__m128i *) dst + 0, r0 ^ f);
+      _mm_storeu_si128 ((__m128i *) dst + 1, r1 ^ c0);
+      _mm_storeu_si128 ((__m128i *) dst + 2, r2 ^ c1);
+      _mm_storeu_si128 ((__m128i *) dst + 3, r3 ^ c2);
+
+      f = c3;
+
+      count -= 64;
+      src += 64;
+      dst += 64;
+    }
+
+  while (count > 0)
+    {
+      c0 = _mm_loadu_si128 (((__m128i *) src));
+      r0 = c0 ^ k[0];
+      for (i = 1; i < rounds; i++)
+	r0 = _mm_aesdec_si128 (r0, k[i]);
+      r0 = _mm_aesdeclast_si128 (r0, k[i]);
+      _mm_storeu_si128 ((__m128i *) dst, r0 ^ f);
+      f = c0;
+      count -= 16;
+      src += 16;
+      dst += 16;
+    }
+}
+
+static_always_inline u32
+aesni_ops_dec_aes_cbc (vlib_main_t * vm, vnet_crypto_op_t * ops[],
+		       u32 n_ops, aesni_key_size_t ks)
+{
+  crypto_ia32_main_t *cm = &crypto_ia32_main;
+  crypto_ia32_per_thread_data_t *ptd = vec_elt_at_index (cm->per_thread_data,
+							 vm->thread_index);
+  int rounds = AESNI_KEY_ROUNDS (ks);
+  u32 i;
+
+  for (i = 0; i < n_ops; i++)
+    {
+      vnet_crypto_op_t *op = ops[i];
+      crypto_ia32_aes_key_t *key = aesni_get_key (ptd, op->key, ks);
+
+      aesni_cbc_dec (key->decrypt_key, op->src, op->dst, op->iv, op->len,
+		     rounds);
+      op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+    }
+
+  return n_ops;
+}
+
+#define foreach_aesni_cbc_handler_type _(128) _(192) _(256)
+
+#define _(x) \
+static u32 aesni_ops_dec_aes_cbc_##x \
+(vlib_main_t * vm, vnet_crypto_op_t * ops[], u32 n_ops) \
+{ return aesni_ops_dec_aes_cbc (vm, ops, n_ops, AESNI_KEY_##x); } \
+static u32 aesni_ops_enc_aes_cbc_##x \
+(vlib_main_t * vm, vnet_crypto_op_t * ops[], u32 n_ops) \
+{ return aesni_ops_enc_aes_cbc (vm, ops, n_ops, AESNI_KEY_##x); } \
+
+foreach_aesni_cbc_handler_type;
+#undef _
+
+#include <fcntl.h>
+
+clib_error_t *
+#ifdef __VAES__
+crypto_ia32_aes_cbc_init_vaes (vlib_main_t * vm)
+#elif __AVX512F__
+crypto_ia32_aes_cbc_init_avx512 (vlib_main_t * vm)
+#elif __AVX2__
+crypto_ia32_aes_cbc_init_avx2 (vlib_main_t * vm)
+#else
+crypto_ia32_aes_cbc_init_sse42 (vlib_main_t * vm)
+#endif
+{
+  crypto_ia32_main_t *cm = &crypto_ia32_main;
+  crypto_ia32_per_thread_data_t *ptd;
+  clib_error_t *err = 0;
+  u8 key[16];
+  int fd;
+
+  if ((fd = open ("/dev/urandom", O_RDONLY)) < 0)
+    return clib_error_return_unix (0, "failed to open '/dev/urandom'");
+
+  /* *INDENT-OFF* */
+  vec_foreach (ptd, cm->per_thread_data)
+    {
+      if (read (fd, key, sizeof (key)) != sizeof (key) ||
+	  read (fd, &ptd->cbc_iv_counter, sizeof (ptd->cbc_iv_counter)) !=
+	  sizeof (ptd->cbc_iv_counter))
+	{
+	  err = clib_error_return_unix (0, "'/dev/urandom' read failure");
+	  goto error;
+	}
+      aes_key_expand (ptd->cbc_iv_key, key, AESNI_KEY_128);
+    }
+  /* *INDENT-ON* */
+
+#define _(x) \
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index, \
+				    VNET_CRYPTO_OP_AES_##x##_CBC_ENC, \
+				    aesni_ops_enc_aes_cbc_##x); \
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index, \
+				    VNET_CRYPTO_OP_AES_##x##_CBC_DEC, \
+				    aesni_ops_dec_aes_cbc_##x);
+  foreach_aesni_cbc_handler_type;
+#undef _
+
+error:
+  clib_memset (key, 0, sizeof (key));
+  close (fd);
+  return err;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
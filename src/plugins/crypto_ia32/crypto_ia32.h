@@ -0,0 +1,94 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef __crypto_ia32_h__
+#define __crypto_ia32_h__
+
+#include <x86intrin.h>
+
+/* number of independent buffers processed in parallel by aes-cbc encrypt */
+#define CRYPTO_IA32_MAX_AES_LANES	8
+
+/* direct-mapped per-thread caches of expanded keys */
+#define CRYPTO_IA32_KEY_CACHE_SIZE	64
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  __m128i encrypt_key[15];
+  __m128i decrypt_key[15];
+  u8 key[32];
+  u8 key_size;
+  u8 is_valid;
+} crypto_ia32_aes_key_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  __m128i ipad[2];
+  __m128i opad[2];
+  u8 key[64];
+  u8 key_len;
+  u8 is_valid;
+  u8 alg;
+} crypto_ia32_hmac_key_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  /* CBC IVs are this counter encrypted under a secret AES-128 key */
+  __m128i cbc_iv_key[11];
+  __m128i cbc_iv_counter;
+  crypto_ia32_aes_key_t aes_keys[CRYPTO_IA32_KEY_CACHE_SIZE];
+  crypto_ia32_hmac_key_t hmac_keys[CRYPTO_IA32_KEY_CACHE_SIZE];
+} crypto_ia32_per_thread_data_t;
+
+typedef struct
+{
+  u32 crypto_engine_index;
+  crypto_ia32_per_thread_data_t *per_thread_data;
+} crypto_ia32_main_t;
+
+extern crypto_ia32_main_t crypto_ia32_main;
+
+static_always_inline u32
+crypto_ia32_key_cache_index (u8 * key)
+{
+  u64 h = pointer_to_uword (key) * 0x9e3779b97f4a7c15ULL;
+  return h >> (64 - 6);
+}
+
+STATIC_ASSERT (CRYPTO_IA32_KEY_CACHE_SIZE == 64, "key cache index is 6 bits");
+
+#define foreach_crypto_ia32_march_variant _(sse42) _(avx2) _(avx512) _(vaes)
+
+#define _(v) \
+clib_error_t __clib_weak *crypto_ia32_aes_cbc_init_##v (vlib_main_t * vm); \
+clib_error_t __clib_weak *crypto_ia32_hmac_sha_init_##v (vlib_main_t * vm);
+
+foreach_crypto_ia32_march_variant;
+#undef _
+
+#endif /* __crypto_ia32_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,253 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#include <vlib/vlib.h>
+#include <vnet/plugin/plugin.h>
+#include <vnet/crypto/crypto.h>
+#include <crypto_ia32/crypto_ia32.h>
+#include <crypto_ia32/sha_ni.h>
+
+#if __GNUC__ > 4  && !__clang__ && CLIB_DEBUG == 0
+#pragma GCC optimize ("O3")
+#endif
+
+typedef enum
+{
+  SHA_NI_ALG_SHA1,
+  SHA_NI_ALG_SHA224,
+  SHA_NI_ALG_SHA256,
+} sha_ni_alg_t;
+
+static_always_inline u32
+sha_ni_digest_size (sha_ni_alg_t alg)
+{
+  if (alg == SHA_NI_ALG_SHA1)
+    return SHA1_DIGEST_SIZE;
+  if (alg == SHA_NI_ALG_SHA224)
+    return SHA224_DIGEST_SIZE;
+  return SHA256_DIGEST_SIZE;
+}
+
+static_always_inline void
+sha_ni_init (sha_ni_state_t * st, sha_ni_alg_t alg)
+{
+  if (alg == SHA_NI_ALG_SHA1)
+    sha1_ni_init (st);
+  else if (alg == SHA_NI_ALG_SHA224)
+    sha224_ni_init (st);
+  else
+    sha256_ni_init (st);
+}
+
+static_always_inline void
+sha_ni_blocks (sha_ni_state_t * st, const u8 * data, u32 n_blocks,
+	       sha_ni_alg_t alg)
+{
+  if (alg == SHA_NI_ALG_SHA1)
+    sha1_ni_blocks (st, data, n_blocks);
+  else
+    sha256_ni_blocks (st, data, n_blocks);
+}
+
+static_always_inline void
+sha_ni_digest (sha_ni_state_t * st, u8 * digest, sha_ni_alg_t alg)
+{
+  if (alg == SHA_NI_ALG_SHA1)
+    sha1_ni_digest (st, digest);
+  else
+    sha256_ni_digest (st, digest);
+}
+
+/* hash the remaining data and add the padding, total_len includes any
+   data already processed by the state */
+static_always_inline void
+sha_ni_final (sha_ni_state_t * st, const u8 * data, u32 len, u64 total_len,
+	      sha_ni_alg_t alg)
+{
+  u32 n_blocks = len / SHA_NI_BLOCK_SIZE;
+  u8 buf[2 * SHA_NI_BLOCK_SIZE];
+  u32 n_pad;
+
+  sha_ni_blocks (st, data, n_blocks, alg);
+  data += n_blocks * SHA_NI_BLOCK_SIZE;
+  len -= n_blocks * SHA_NI_BLOCK_SIZE;
+
+  n_pad = len < SHA_NI_BLOCK_SIZE - 8 ? 1 : 2;
+  clib_memcpy_fast (buf, data, len);
+  buf[len] = 0x80;
+  clib_memset (buf + len + 1, 0, n_pad * SHA_NI_BLOCK_SIZE - len - 9);
+  *(u64 *) (buf + n_pad * SHA_NI_BLOCK_SIZE - 8) =
+    clib_host_to_net_u64 (total_len << 3);
+  sha_ni_blocks (st, buf, n_pad, alg);
+}
+
+static_always_inline void
+hmac_sha_ni_key_init (crypto_ia32_hmac_key_t * k, u8 * key, u32 key_len,
+		      sha_ni_alg_t alg)
+{
+  u8 pad[SHA_NI_BLOCK_SIZE] = { };
+  sha_ni_state_t st;
+  int i;
+
+  if (key_len > SHA_NI_BLOCK_SIZE)
+    {
+      u8 digest[SHA256_DIGEST_SIZE];
+      sha_ni_init (&st, alg);
+      sha_ni_final (&st, key, key_len, key_len, alg);
+      sha_ni_digest (&st, digest, alg);
+      clib_memcpy_fast (pad, digest, sha_ni_digest_size (alg));
+    }
+  else
+    clib_memcpy_fast (pad, key, key_len);
+
+  for (i = 0; i < SHA_NI_BLOCK_SIZE; i++)
+    pad[i] ^= 0x36;
+  sha_ni_init (&st, alg);
+  sha_ni_blocks (&st, pad, 1, alg);
+  k->ipad[0] = st.s[0];
+  k->ipad[1] = st.s[1];
+
+  for (i = 0; i < SHA_NI_BLOCK_SIZE; i++)
+    pad[i] ^= 0x36 ^ 0x5c;
+  sha_ni_init (&st, alg);
+  sha_ni_blocks (&st, pad, 1, alg);
+  k->opad[0] = st.s[0];
+  k->opad[1] = st.s[1];
+}
+
+static_always_inline crypto_ia32_hmac_key_t *
+hmac_sha_ni_get_key (crypto_ia32_per_thread_data_t * ptd, u8 * key,
+		     u32 key_len, sha_ni_alg_t alg,
+		     crypto_ia32_hmac_key_t * tmp)
+{
+  crypto_ia32_hmac_key_t *k;
+
+  /* long keys are rare, don't cache them */
+  if (PREDICT_FALSE (key_len > sizeof (k->key)))
+    {
+      hmac_sha_ni_key_init (tmp, key, key_len, alg);
+      return tmp;
+    }
+
+  k = ptd->hmac_keys + crypto_ia32_key_cache_index (key);
+
+  if (PREDICT_TRUE (k->is_valid && k->alg == alg && k->key_len == key_len
+		    && memcmp (k->key, key, key_len) == 0))
+    return k;
+
+  hmac_sha_ni_key_init (k, key, key_len, alg);
+  clib_memcpy_fast (k->key, key, key_len);
+  k->key_len = key_len;
+  k->alg = alg;
+  k->is_valid = 1;
+  return k;
+}
+
+static_always_inline u32
+hmac_sha_ni_ops (vlib_main_t * vm, vnet_crypto_op_t * ops[], u32 n_ops,
+		 sha_ni_alg_t alg)
+{
+  crypto_ia32_main_t *cm = &crypto_ia32_main;
+  crypto_ia32_per_thread_data_t *ptd = vec_elt_at_index (cm->per_thread_data,
+							 vm->thread_index);
+  crypto_ia32_hmac_key_t tmp, *k;
+  u32 digest_size = sha_ni_digest_size (alg);
+  u8 digest[SHA256_DIGEST_SIZE];
+  sha_ni_state_t st;
+  u32 i, n_fail = 0;
+
+  for (i = 0; i < n_ops; i++)
+    {
+      vnet_crypto_op_t *op = ops[i];
+      u32 sz = digest_size;
+
+      if (op->hmac_trunc_len && op->hmac_trunc_len < digest_size)
+	sz = op->hmac_trunc_len;
+
+      k = hmac_sha_ni_get_key (ptd, op->key, op->key_len, alg, &tmp);
+
+      /* inner hash */
+      st.s[0] = k->ipad[0];
+      st.s[1] = k->ipad[1];
+      sha_ni_final (&st, op->src, op->len, SHA_NI_BLOCK_SIZE + op->len, alg);
+      sha_ni_digest (&st, digest, alg);
+
+      /* outer hash */
+      st.s[0] = k->opad[0];
+      st.s[1] = k->opad[1];
+      sha_ni_final (&st, digest, digest_size,
+		    SHA_NI_BLOCK_SIZE + digest_size, alg);
+      sha_ni_digest (&st, digest, alg);
+
+      if (op->flags & VNET_CRYPTO_OP_FLAG_HMAC_CHECK)
+	{
+	  if ((memcmp (op->dst, digest, sz)))
+	    {
+	      n_fail++;
+	      op->status = VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC;
+	      continue;
+	    }
+	}
+      else
+	clib_memcpy_fast (op->dst, digest, sz);
+      op->status = VNET_CRYPTO_OP_STATUS_COMPLETED;
+    }
+
+  return n_ops - n_fail;
+}
+
+#define foreach_sha_ni_handler_type \
+  _(SHA1, sha1) _(SHA224, sha224) _(SHA256, sha256)
+
+#define _(a, b) \
+static u32 hmac_sha_ni_ops_##b \
+(vlib_main_t * vm, vnet_crypto_op_t * ops[], u32 n_ops) \
+{ return hmac_sha_ni_ops (vm, ops, n_ops, SHA_NI_ALG_##a); }
+
+foreach_sha_ni_handler_type;
+#undef _
+
+clib_error_t *
+#ifdef __VAES__
+crypto_ia32_hmac_sha_init_vaes (vlib_main_t * vm)
+#elif __AVX512F__
+crypto_ia32_hmac_sha_init_avx512 (vlib_main_t * vm)
+#elif __AVX2__
+crypto_ia32_hmac_sha_init_avx2 (vlib_main_t * vm)
+#else
+crypto_ia32_hmac_sha_init_sse42 (vlib_main_t * vm)
+#endif
+{
+  crypto_ia32_main_t *cm = &crypto_ia32_main;
+
+#define _(a, b) \
+  vnet_crypto_register_ops_handler (vm, cm->crypto_engine_index, \
+				    VNET_CRYPTO_OP_##a##_HMAC, \
+				    hmac_sha_ni_ops_##b);
+  foreach_sha_ni_handler_type;
+#undef _
+
+  return 0;
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,222 @@
+/*
+ *------------------------------------------------------------------
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *------------------------------------------------------------------
+ */
+
+#ifndef __sha_ni_h__
+#define __sha_ni_h__
+
+#include <x86intrin.h>
+
+#define SHA_NI_BLOCK_SIZE	64
+#define SHA1_DIGEST_SIZE	20
+#define SHA224_DIGEST_SIZE	28
+#define SHA256_DIGEST_SIZE	32
+
+/* state is kept in the layout the sha-ni instructions expect:
+   sha1 - ABCD in s[0] (dword reversed) and E in the top dword of s[1],
+   sha256 - ABEF in s[0] and CDGH in s[1] */
+typedef struct
+{
+  __m128i s[2];
+} sha_ni_state_t;
+
+static const u32 sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static_always_inline void
+sha1_ni_init (sha_ni_state_t * st)
+{
+  st->s[0] = _mm_set_epi32 (0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476);
+  st->s[1] = _mm_set_epi32 (0xc3d2e1f0, 0, 0, 0);
+}
+
+static_always_inline void
+sha224_ni_init (sha_ni_state_t * st)
+{
+  /* ABEF, CDGH */
+  st->s[0] = _mm_set_epi32 (0xc1059ed8, 0x367cd507, 0xffc00b31, 0x68581511);
+  st->s[1] = _mm_set_epi32 (0x3070dd17, 0xf70e5939, 0x64f98fa7, 0xbefa4fa4);
+}
+
+static_always_inline void
+sha256_ni_init (sha_ni_state_t * st)
+{
+  /* ABEF, CDGH */
+  st->s[0] = _mm_set_epi32 (0x6a09e667, 0xbb67ae85, 0x510e527f, 0x9b05688c);
+  st->s[1] = _mm_set_epi32 (0x3c6ef372, 0xa54ff53a, 0x1f83d9ab, 0x5be0cd19);
+}
+
+#define sha1_ni_rounds(f, i)						\
+do {									\
+  if (i == 0)								\
+    e1 = _mm_add_epi32 (e0, w[0]);					\
+  else									\
+    e1 = _mm_sha1nexte_epu32 (prev, w[i & 3]);				\
+  prev = abcd;								\
+  abcd = _mm_sha1rnds4_epu32 (abcd, e1, f);				\
+  if (i >= 3 && i < 19)							\
+    {									\
+      w[(i + 1) & 3] = _mm_sha1msg1_epu32 (w[(i + 1) & 3], w[(i + 2) & 3]); \
+      w[(i + 1) & 3] = _mm_xor_si128 (w[(i + 1) & 3], w[(i + 3) & 3]);	\
+      w[(i + 1) & 3] = _mm_sha1msg2_epu32 (w[(i + 1) & 3], w[i & 3]);	\
+    }									\
+} while (0)
+
+static_always_inline void
+sha1_ni_blocks (sha_ni_state_t * st, const u8 * data, u32 n_blocks)
+{
+  const __m128i mask = _mm_set_epi64x (0x0001020304050607ULL,
+				       0x08090a0b0c0d0e0fULL);
+  __m128i abcd = st->s[0], e0 = st->s[1], e1, prev;
+  __m128i abcd_save, e0_save, w[4];
+
+  while (n_blocks--)
+    {
+      abcd_save = abcd;
+      e0_save = e0;
+
+      w[0] = _mm_shuffle_epi8 (_mm_loadu_si128 ((__m128i *) data), mask);
+      w[1] = _mm_shuffle_epi8 (_mm_loadu_si128 ((__m128i *) (data + 16)),
+			       mask);
+      w[2] = _mm_shuffle_epi8 (_mm_loadu_si128 ((__m128i *) (data + 32)),
+			       mask);
+      w[3] = _mm_shuffle_epi8 (_mm_loadu_si128 ((__m128i *) (data + 48)),
+			       mask);
+
+      sha1_ni_rounds (0, 0);
+      sha1_ni_rounds (0, 1);
+      sha1_ni_rounds (0, 2);
+      sha1_ni_rounds (0, 3);
+      sha1_ni_rounds (0, 4);
+      sha1_ni_rounds (1, 5);
+      sha1_ni_rounds (1, 6);
+      sha1_ni_rounds (1, 7);
+      sha1_ni_rounds (1, 8);
+      sha1_ni_rounds (1, 9);
+      sha1_ni_rounds (2, 10);
+      sha1_ni_rounds (2, 11);
+      sha1_ni_rounds (2, 12);
+      sha1_ni_rounds (2, 13);
+      sha1_ni_rounds (2, 14);
+      sha1_ni_rounds (3, 15);
+      sha1_ni_rounds (3, 16);
+      sha1_ni_rounds (3, 17);
+      sha1_ni_rounds (3, 18);
+      sha1_ni_rounds (3, 19);
+
+      e0 = _mm_sha1nexte_epu32 (prev, e0_save);
+      abcd = _mm_add_epi32 (abcd, abcd_save);
+      data += SHA_NI_BLOCK_SIZE;
+    }
+
+  st->s[0] = abcd;
+  st->s[1] = e0;
+}
+
+#undef sha1_ni_rounds
+
+static_always_inline void
+sha256_ni_blocks (sha_ni_state_t * st, const u8 * data, u32 n_blocks)
+{
+  const __m128i mask = _mm_set_epi64x (0x0c0d0e0f08090a0bULL,
+				       0x0405060700010203ULL);
+  __m128i s0 = st->s[0], s1 = st->s[1], s0_save, s1_save, w[4], m;
+  int i;
+
+  while (n_blocks--)
+    {
+      s0_save = s0;
+      s1_save = s1;
+
+      for (i = 0; i < 16; i++)
+	{
+	  if (i < 4)
+	    w[i] = _mm_shuffle_epi8 (_mm_loadu_si128 ((__m128i *)
+						      (data + 16 * i)), mask);
+	  else
+	    {
+	      m = _mm_sha256msg1_epu32 (w[i & 3], w[(i + 1) & 3]);
+	      m = _mm_add_epi32 (m, _mm_alignr_epi8 (w[(i + 3) & 3],
+						     w[(i + 2) & 3], 4));
+	      w[i & 3] = _mm_sha256msg2_epu32 (m, w[(i + 3) & 3]);
+	    }
+
+	  m = _mm_add_epi32 (w[i & 3],
+			     _mm_loadu_si128 ((__m128i *) (sha256_k + 4 * i)));
+	  s1 = _mm_sha256rnds2_epu32 (s1, s0, m);
+	  s0 = _mm_sha256rnds2_epu32 (s0, s1, _mm_shuffle_epi32 (m, 0x0e));
+	}
+
+      s0 = _mm_add_epi32 (s0, s0_save);
+      s1 = _mm_add_epi32 (s1, s1_save);
+      data += SHA_NI_BLOCK_SIZE;
+    }
+
+  st->s[0] = s0;
+  st->s[1] = s1;
+}
+
+/* store big endian digest */
+static_always_inline void
+sha1_ni_digest (sha_ni_state_t * st, u8 * digest)
+{
+  const __m128i mask = _mm_set_epi64x (0x0001020304050607ULL,
+				       0x08090a0b0c0d0e0fULL);
+  u32 e = _mm_extract_epi32 (st->s[1], 3);
+  _mm_storeu_si128 ((__m128i *) digest, _mm_shuffle_epi8 (st->s[0], mask));
+  *(u32 *) (digest + 16) = clib_host_to_net_u32 (e);
+}
+
+static_always_inline void
+sha256_ni_digest (sha_ni_state_t * st, u8 * digest)
+{
+  const __m128i mask = _mm_set_epi64x (0x0c0d0e0f08090a0bULL,
+				       0x0405060700010203ULL);
+  __m128i feba, dchg, dcba, hgfe;
+
+  feba = _mm_shuffle_epi32 (st->s[0], 0x1b);
+  dchg = _mm_shuffle_epi32 (st->s[1], 0xb1);
+  dcba = _mm_blend_epi16 (feba, dchg, 0xf0);
+  hgfe = _mm_alignr_epi8 (dchg, feba, 8);
+  _mm_storeu_si128 ((__m128i *) digest, _mm_shuffle_epi8 (dcba, mask));
+  _mm_storeu_si128 ((__m128i *) (digest + 16), _mm_shuffle_epi8 (hgfe, mask));
+}
+
+#endif /* __sha_ni_h__ */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -47,6 +47,7 @@ slow_path (dslite_main_t * dm, dslite_session_key_t * in2out_key,
 
   out2in_key.protocol = in2out_key->proto;
   out2in_key.fib_index = 0;
+  out2in_key.addr.as_u32 = 0;
 
   b4_kv.key[0] = in2out_key->softwire_id.as_u64[0];
   b4_kv.key[1] = in2out_key->softwire_id.as_u64[1];
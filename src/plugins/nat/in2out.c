@@ -281,7 +281,8 @@ slow_path (snat_main_t * sm, vlib_buffer_t * b0,
   if (snat_static_mapping_match
       (sm, *key0, &key1, 0, 0, 0, 0, 0, &identity_nat))
     {
-      /* Try to create dynamic translation */
+      /* Try to create dynamic translation, for this user */
+      key1.addr = key0->addr;
       if (snat_alloc_outside_address_and_port (sm->addresses, rx_fib_index0,
 					       thread_index, &key1,
 					       sm->port_per_thread,
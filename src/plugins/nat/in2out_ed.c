@@ -312,11 +312,10 @@ slow_path_ed (snat_main_t * sm,
   if (snat_static_mapping_match
       (sm, key0, &key1, 0, 0, 0, &lb, 0, &identity_nat))
     {
-      /* Try to create dynamic translation */
-      if (snat_alloc_outside_address_and_port (sm->addresses, rx_fib_index,
-					       thread_index, &key1,
-					       sm->port_per_thread,
-					       tsm->snat_thread_index))
+      /* Try to create dynamic translation, for this user */
+      key1.addr = key0.addr;
+      if (nat44_rss_alloc_addr_and_port (sm, rx_fib_index, thread_index,
+					 &key1, &key->r_addr, key->r_port))
 	{
 	  nat_log_notice ("addresses exhausted");
 	  b->error = node->errors[NAT_IN2OUT_ED_ERROR_OUT_OF_PORTS];
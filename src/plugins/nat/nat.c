@@ -347,6 +347,18 @@ nat_user_get_or_create (snat_main_t * sm, ip4_address_t * addr, u32 fib_index,
   return u;
 }
 
+/*
+ * A new session's protocol and state are filled in by the caller, so
+ * check it first after the shortest timeout; its timer is then restarted
+ * for whatever time the session really has left.
+ */
+static_always_inline u32
+nat44_session_first_expiry (snat_main_t * sm)
+{
+  return clib_min (sm->icmp_timeout,
+		   clib_min (sm->udp_timeout, sm->tcp_transitory_timeout));
+}
+
 snat_session_t *
 nat_session_alloc_or_recycle (snat_main_t * sm, snat_user_t * u,
 			      u32 thread_index, f64 now)
@@ -398,6 +410,7 @@ nat_session_alloc_or_recycle (snat_main_t * sm, snat_user_t * u,
     {
       pool_get (tsm->sessions, s);
       clib_memset (s, 0, sizeof (*s));
+      s->expire_timer_handle = ~0;
 
       /* Create list elts */
       pool_get (tsm->list_pool, per_user_translation_list_elt);
@@ -418,6 +431,8 @@ nat_session_alloc_or_recycle (snat_main_t * sm, snat_user_t * u,
     }
 
   s->ha_last_refreshed = now;
+  nat44_session_timer_start (sm, s, thread_index,
+			     nat44_session_first_expiry (sm));
 
   return s;
 }
@@ -477,6 +492,7 @@ nat_ed_session_alloc (snat_main_t * sm, snat_user_t * u, u32 thread_index,
 	alloc_new:
 	  pool_get (tsm->sessions, s);
 	  clib_memset (s, 0, sizeof (*s));
+	  s->expire_timer_handle = ~0;
 
 	  /* Create list elts */
 	  pool_get (tsm->list_pool, per_user_translation_list_elt);
@@ -497,6 +513,8 @@ nat_ed_session_alloc (snat_main_t * sm, snat_user_t * u, u32 thread_index,
     }
 
   s->ha_last_refreshed = now;
+  nat44_session_timer_start (sm, s, thread_index,
+			     nat44_session_first_expiry (sm));
 
   return s;
 }
@@ -563,6 +581,7 @@ snat_add_address (snat_main_t * sm, ip4_address_t * addr, u32 vrf_id,
     ap->fib_index = ~0;
 #define _(N, i, n, s) \
   clib_bitmap_alloc (ap->busy_##n##_port_bitmap, 65535); \
+  clib_bitmap_alloc (ap->busy_##n##_port_full, 65536 / BITS (uword)); \
   ap->busy_##n##_ports = 0; \
   ap->busy_##n##_ports_per_thread = 0;\
   vec_validate_init_empty (ap->busy_##n##_ports_per_thread, tm->n_vlib_mains - 1, 0);
@@ -851,7 +870,7 @@ snat_add_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
                     case SNAT_PROTOCOL_##N: \
                       if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, e_port)) \
                         return VNET_API_ERROR_INVALID_VALUE; \
-                      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, e_port, 1); \
+                      nat_port_bitmap_set (a->busy_##n##_port_bitmap, a->busy_##n##_port_full, e_port, 1); \
                       if (e_port > 1024) \
                         { \
                           a->busy_##n##_ports++; \
@@ -1033,7 +1052,7 @@ snat_add_static_mapping (ip4_address_t l_addr, ip4_address_t e_addr,
 		    {
 #define _(N, j, n, s) \
                     case SNAT_PROTOCOL_##N: \
-                      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, e_port, 0); \
+                      nat_port_bitmap_set (a->busy_##n##_port_bitmap, a->busy_##n##_port_full, e_port, 0); \
                       if (e_port > 1024) \
                         { \
                           a->busy_##n##_ports--; \
@@ -1214,7 +1233,7 @@ nat44_add_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
                     case SNAT_PROTOCOL_##N: \
                       if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, e_port)) \
                         return VNET_API_ERROR_INVALID_VALUE; \
-                      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, e_port, 1); \
+                      nat_port_bitmap_set (a->busy_##n##_port_bitmap, a->busy_##n##_port_full, e_port, 1); \
                       if (e_port > 1024) \
                         { \
                           a->busy_##n##_ports++; \
@@ -1327,7 +1346,7 @@ nat44_add_del_lb_static_mapping (ip4_address_t e_addr, u16 e_port,
 		    {
 #define _(N, j, n, s) \
                     case SNAT_PROTOCOL_##N: \
-                      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, e_port, 0); \
+                      nat_port_bitmap_set (a->busy_##n##_port_bitmap, a->busy_##n##_port_full, e_port, 0); \
                       if (e_port > 1024) \
                         { \
                           a->busy_##n##_ports--; \
@@ -1694,6 +1713,7 @@ snat_del_address (snat_main_t * sm, ip4_address_t addr, u8 delete_sm,
 
 #define _(N, i, n, s) \
   clib_bitmap_free (a->busy_##n##_port_bitmap); \
+  clib_bitmap_free (a->busy_##n##_port_full); \
   vec_free (a->busy_##n##_ports_per_thread);
   foreach_snat_protocol
 #undef _
@@ -1776,6 +1796,9 @@ snat_interface_add_del (u32 sw_if_index, u8 is_inside, int is_del)
     sm->fq_out2in_index = vlib_frame_queue_main_init (sm->out2in_node_index,
 						      NAT_FQ_NELTS);
 
+  if (sm->rss_consistent && sm->num_workers > 1)
+    nat44_rss_handoff_init (sm->vlib_main);
+
   if (!is_inside)
     {
       /* *INDENT-OFF* */
@@ -2085,6 +2108,9 @@ fq:
     sm->fq_out2in_index =
       vlib_frame_queue_main_init (sm->out2in_node_index, 0);
 
+  if (sm->rss_consistent && sm->num_workers > 1)
+    nat44_rss_handoff_init (sm->vlib_main);
+
   /* *INDENT-OFF* */
   pool_foreach (i, sm->output_feature_interfaces,
   ({
@@ -2436,7 +2462,7 @@ snat_free_outside_address_and_port (snat_address_t * addresses,
     case SNAT_PROTOCOL_##N: \
       ASSERT (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, \
         port_host_byte_order) == 1); \
-      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, \
+      nat_port_bitmap_set (a->busy_##n##_port_bitmap, a->busy_##n##_port_full, \
         port_host_byte_order, 0); \
       a->busy_##n##_ports--; \
       a->busy_##n##_ports_per_thread[thread_index]--; \
@@ -2470,7 +2496,7 @@ nat_set_outside_address_and_port (snat_address_t * addresses,
         case SNAT_PROTOCOL_##N: \
           if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, port_host_byte_order)) \
             return VNET_API_ERROR_INSTANCE_IN_USE; \
-          clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, port_host_byte_order, 1); \
+          nat_port_bitmap_set (a->busy_##n##_port_bitmap, a->busy_##n##_port_full, port_host_byte_order, 1); \
           a->busy_##n##_ports_per_thread[thread_index]++; \
           a->busy_##n##_ports++; \
           return 0;
@@ -2644,6 +2670,138 @@ snat_alloc_outside_address_and_port (snat_address_t * addresses,
 				  port_per_thread, snat_thread_index);
 }
 
+/*
+ * Ports of [lo, hi] held in word w of a port bitmap
+ */
+static_always_inline uword
+nat_port_word_mask (u32 w, u32 lo, u32 hi)
+{
+  uword mask = ~(uword) 0;
+
+  if (w == lo / BITS (uword))
+    mask &= ~pow2_mask (lo % BITS (uword));
+  if (w == hi / BITS (uword))
+    mask &= ~(uword) 0 >> (BITS (uword) - 1 - hi % BITS (uword));
+
+  return mask;
+}
+
+/*
+ * First word in [w, last_w] of a port bitmap that is not full, or ~0.
+ * With the full-word summary this looks at one summary word per 64
+ * bitmap words, so it costs at most 16 steps for the whole port space.
+ */
+static_always_inline u32
+nat_port_next_word (uword * busy, uword * full, u32 w, u32 last_w)
+{
+  uword s;
+
+  if (!full)
+    {
+      for (; w <= last_w; w++)
+	if (busy[w] != ~(uword) 0)
+	  return w;
+      return ~0;
+    }
+
+  while (w <= last_w)
+    {
+      s = ~full[w / BITS (uword)] >> (w % BITS (uword));
+      if (s)
+	{
+	  w += count_trailing_zeros (s);
+	  return w <= last_w ? w : ~0;
+	}
+      w = (w / BITS (uword) + 1) * BITS (uword);
+    }
+
+  return ~0;
+}
+
+/*
+ * One of the set bits of a non-zero word, at random
+ */
+static_always_inline u32
+nat_port_random_bit (uword free)
+{
+  u32 n = snat_random_port (0, count_set_bits (free) - 1);
+
+  while (n--)
+    free &= free - 1;
+  return count_trailing_zeros (free);
+}
+
+/*
+ * Take a free port from [lo, hi]. A few random ports are tried first, as
+ * the old allocator did, which is enough while the range is not nearly
+ * full. Then the words are scanned from a random starting port on,
+ * wrapping around, and a random free port of the first word with one is
+ * taken. Under load that is still a choice among the free ports of a
+ * word, not the first one after the start, and the cost stays bounded.
+ */
+#define NAT_PORT_ALLOC_RANDOM_PROBES 8
+
+static int
+nat_port_alloc (uword * busy, uword * full, u32 lo, u32 hi, u16 * port)
+{
+  u32 start, w, start_w, last_w, rot, i;
+  uword free;
+
+  for (i = 0; i < NAT_PORT_ALLOC_RANDOM_PROBES; i++)
+    {
+      start = snat_random_port (lo, hi);
+      if (!clib_bitmap_get_no_check (busy, start))
+	{
+	  *port = start;
+	  nat_port_bitmap_set (busy, full, *port, 1);
+	  return 0;
+	}
+    }
+
+  start_w = start / BITS (uword);
+  last_w = hi / BITS (uword);
+  rot = start % BITS (uword);
+
+  /* the starting word, from the starting port on */
+  w = start_w;
+  free = ~busy[w] & nat_port_word_mask (w, lo, hi) & ~pow2_mask (rot);
+  if (free)
+    goto found;
+
+  /* up to the end of the range, then from its start round again */
+  w = start_w + 1;
+  while ((w = nat_port_next_word (busy, full, w, last_w)) != ~0)
+    {
+      free = ~busy[w] & nat_port_word_mask (w, lo, hi);
+      if (free)
+	goto found;
+      w++;
+    }
+  w = lo / BITS (uword);
+  while ((w = nat_port_next_word (busy, full, w, start_w)) != ~0)
+    {
+      free = ~busy[w] & nat_port_word_mask (w, lo, hi);
+      if (free)
+	goto found;
+      w++;
+    }
+  return 1;
+
+found:
+  *port = w * BITS (uword) + nat_port_random_bit (free);
+  nat_port_bitmap_set (busy, full, *port, 1);
+  return 0;
+}
+
+/*
+ * The address of addresses a user's sessions go to first
+ */
+static_always_inline u32
+nat_user_addr_index (ip4_address_t user_addr, u32 n_addresses)
+{
+  return ((u64) (u32) (user_addr.as_u32 * 0x9e3779b1) * n_addresses) >> 32;
+}
+
 static int
 nat_alloc_addr_and_port_default (snat_address_t * addresses,
 				 u32 fib_index,
@@ -2651,79 +2809,82 @@ nat_alloc_addr_and_port_default (snat_address_t * addresses,
 				 snat_session_key_t * k,
 				 u16 port_per_thread, u32 snat_thread_index)
 {
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
   int i;
   snat_address_t *a, *ga = 0;
-  u32 portnum;
+  ip4_address_t user_addr = k->addr;
+  u32 lo, hi, hint;
+  u16 portnum;
 
-  for (i = 0; i < vec_len (addresses); i++)
-    {
-      a = addresses + i;
-      switch (k->protocol)
-	{
-#define _(N, j, n, s) \
-        case SNAT_PROTOCOL_##N: \
-          if (a->busy_##n##_ports_per_thread[thread_index] < port_per_thread) \
-            { \
-              if (a->fib_index == fib_index) \
-                { \
-                  while (1) \
-                    { \
-                      portnum = (port_per_thread * \
-                        snat_thread_index) + \
-                        snat_random_port(1, port_per_thread) + 1024; \
-                      if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
-                        continue; \
-                      clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
-                      a->busy_##n##_ports_per_thread[thread_index]++; \
-                      a->busy_##n##_ports++; \
-                      k->addr = a->addr; \
-                      k->port = clib_host_to_net_u16(portnum); \
-                      return 0; \
-                    } \
-                } \
-              else if (a->fib_index == ~0) \
-                { \
-                  ga = a; \
-                } \
-            } \
-          break;
-	  foreach_snat_protocol
-#undef _
-	default:
-	  nat_log_info ("unknown protocol");
-	  return 1;
-	}
+  /* this thread's slice of the port space */
+  lo = (port_per_thread * snat_thread_index) + 1 + 1024;
+  hi = (port_per_thread * snat_thread_index) + port_per_thread + 1024;
 
-    }
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
 
-  if (ga)
+  switch (k->protocol)
     {
-      a = ga;
-      switch (k->protocol)
-	{
 #define _(N, j, n, s) \
-        case SNAT_PROTOCOL_##N: \
-          while (1) \
+    case SNAT_PROTOCOL_##N: \
+      /* \
+       * Try the address the user hashes to first, so its sessions share \
+       * one. Without a user, the address this thread last allocated \
+       * from, so addresses already exhausted are not visited on every \
+       * session. \
+       */ \
+      if (user_addr.as_u32) \
+        hint = nat_user_addr_index (user_addr, vec_len (addresses)); \
+      else if (addresses == sm->addresses) \
+        hint = tsm->n##_alloc_addr_hint; \
+      else \
+        hint = ~0; \
+      if (hint < vec_len (addresses)) \
+        { \
+          a = addresses + hint; \
+          if (a->fib_index == fib_index && \
+              a->busy_##n##_ports_per_thread[thread_index] < port_per_thread && \
+              !nat_port_alloc (a->busy_##n##_port_bitmap, \
+                               a->busy_##n##_port_full, lo, hi, &portnum)) \
+            goto alloc_##n; \
+        } \
+      for (i = 0; i < vec_len (addresses); i++) \
+        { \
+          a = addresses + i; \
+          if (a->busy_##n##_ports_per_thread[thread_index] >= port_per_thread) \
+            continue; \
+          if (a->fib_index == fib_index) \
             { \
-              portnum = (port_per_thread * \
-                snat_thread_index) + \
-                snat_random_port(1, port_per_thread) + 1024; \
-              if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
-                continue; \
-              clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
-              a->busy_##n##_ports_per_thread[thread_index]++; \
-              a->busy_##n##_ports++; \
-              k->addr = a->addr; \
-              k->port = clib_host_to_net_u16(portnum); \
-              return 0; \
-            }
-	  break;
-	  foreach_snat_protocol
+              if (!nat_port_alloc (a->busy_##n##_port_bitmap, \
+                                   a->busy_##n##_port_full, lo, hi, &portnum)) \
+                goto alloc_##n; \
+            } \
+          else if (a->fib_index == ~0) \
+            { \
+              ga = a; \
+            } \
+        } \
+      if (ga) \
+        { \
+          a = ga; \
+          if (!nat_port_alloc (a->busy_##n##_port_bitmap, \
+                               a->busy_##n##_port_full, lo, hi, &portnum)) \
+            goto alloc_##n; \
+        } \
+      break; \
+    alloc_##n: \
+      if (addresses == sm->addresses) \
+        tsm->n##_alloc_addr_hint = a - addresses; \
+      a->busy_##n##_ports_per_thread[thread_index]++; \
+      a->busy_##n##_ports++; \
+      k->addr = a->addr; \
+      k->port = clib_host_to_net_u16 (portnum); \
+      return 0;
+      foreach_snat_protocol
 #undef _
-	default:
-	  nat_log_info ("unknown protocol");
-	  return 1;
-	}
+    default:
+      nat_log_info ("unknown protocol");
+      return 1;
     }
 
   /* Totally out of translations to use... */
@@ -2760,7 +2921,7 @@ nat_alloc_addr_and_port_mape (snat_address_t * addresses,
               portnum = A | (sm->psid << sm->psid_offset) | (j << (16 - m)); \
               if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
                 continue; \
-              clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
+              nat_port_bitmap_set (a->busy_##n##_port_bitmap, a->busy_##n##_port_full, portnum, 1); \
               a->busy_##n##_ports++; \
               k->addr = a->addr; \
               k->port = clib_host_to_net_u16 (portnum); \
@@ -2801,19 +2962,14 @@ nat_alloc_addr_and_port_range (snat_address_t * addresses,
     {
 #define _(N, i, n, s) \
     case SNAT_PROTOCOL_##N: \
-      if (a->busy_##n##_ports < ports) \
+      if (a->busy_##n##_ports < ports && \
+          !nat_port_alloc (a->busy_##n##_port_bitmap, a->busy_##n##_port_full, \
+                           sm->start_port, sm->end_port, &portnum)) \
         { \
-          while (1) \
-            { \
-              portnum = snat_random_port(sm->start_port, sm->end_port); \
-              if (clib_bitmap_get_no_check (a->busy_##n##_port_bitmap, portnum)) \
-                continue; \
-              clib_bitmap_set_no_check (a->busy_##n##_port_bitmap, portnum, 1); \
-              a->busy_##n##_ports++; \
-              k->addr = a->addr; \
-              k->port = clib_host_to_net_u16 (portnum); \
-              return 0; \
-            } \
+          a->busy_##n##_ports++; \
+          k->addr = a->addr; \
+          k->port = clib_host_to_net_u16 (portnum); \
+          return 0; \
         } \
       break;
       foreach_snat_protocol
@@ -2829,6 +2985,115 @@ exhausted:
   return 1;
 }
 
+/*
+ * Allocate every port of [lo, hi] with nat_port_alloc, checking each is
+ * in range and new, that the range is then exhausted and the summary
+ * agrees with the bitmap. Then free single ports, wherever they are in
+ * the range, and check the next allocation finds them.
+ */
+static int
+nat_port_alloc_test_range (vlib_main_t * vm, u32 lo, u32 hi, int use_full)
+{
+  uword *busy = 0, *full = 0, *seen = 0;
+  u32 i, n = hi - lo + 1, w, seed = 0xdeadbeef;
+  u16 port, free_port;
+  int n_failed = 0;
+
+  clib_bitmap_validate (busy, 1 << 16);
+  clib_bitmap_validate (seen, 1 << 16);
+  if (use_full)
+    clib_bitmap_validate (full, (1 << 16) / BITS (uword));
+
+  for (i = 0; i < n; i++)
+    {
+      if (nat_port_alloc (busy, full, lo, hi, &port))
+	{
+	  vlib_cli_output (vm, "[%u, %u]: exhausted after %u ports", lo, hi,
+			   i);
+	  n_failed++;
+	  goto done;
+	}
+      if (port < lo || port > hi || clib_bitmap_get (seen, port))
+	{
+	  vlib_cli_output (vm, "[%u, %u]: port %u out of range or reused",
+			   lo, hi, port);
+	  n_failed++;
+	  goto done;
+	}
+      seen = clib_bitmap_set (seen, port, 1);
+    }
+
+  if (!nat_port_alloc (busy, full, lo, hi, &port))
+    {
+      vlib_cli_output (vm, "[%u, %u]: port %u past exhaustion", lo, hi,
+		       port);
+      n_failed++;
+    }
+
+  for (w = lo / BITS (uword); use_full && w <= hi / BITS (uword); w++)
+    if (clib_bitmap_get (full, w) != (busy[w] == ~(uword) 0))
+      {
+	vlib_cli_output (vm, "[%u, %u]: summary wrong for word %u", lo, hi,
+			 w);
+	n_failed++;
+      }
+
+  /* both ends, so the search has to wrap round, and a few in between */
+  for (i = 0; i < 16; i++)
+    {
+      free_port = i == 0 ? lo : i == 1 ? hi : lo + random_u32 (&seed) % n;
+      nat_port_bitmap_set (busy, full, free_port, 0);
+      if (use_full &&
+	  clib_bitmap_get (full, free_port / BITS (uword)))
+	{
+	  vlib_cli_output (vm, "[%u, %u]: port %u free in a full word", lo,
+			   hi, free_port);
+	  n_failed++;
+	}
+      if (nat_port_alloc (busy, full, lo, hi, &port) || port != free_port)
+	{
+	  vlib_cli_output (vm, "[%u, %u]: port %u freed, %u allocated", lo,
+			   hi, free_port, port);
+	  n_failed++;
+	}
+    }
+
+done:
+  clib_bitmap_free (busy);
+  clib_bitmap_free (full);
+  clib_bitmap_free (seen);
+  return n_failed;
+}
+
+static clib_error_t *
+nat_port_alloc_test_command_fn (vlib_main_t * vm, unformat_input_t * input,
+				vlib_cli_command_t * cmd)
+{
+  int n_failed = 0;
+
+  /* a thread slice with unaligned ends, a port-range mode range within
+     one word, and the whole dynamic port space */
+  n_failed += nat_port_alloc_test_range (vm, 1025, 3000, 1);
+  n_failed += nat_port_alloc_test_range (vm, 1025, 3000, 0);
+  n_failed += nat_port_alloc_test_range (vm, 1025, 1027, 1);
+  n_failed += nat_port_alloc_test_range (vm, 1025, 65535, 1);
+
+  if (n_failed)
+    return clib_error_return (0, "NAT port allocator unit test failed");
+
+  vlib_cli_output (vm, "NAT port allocator unit test OK");
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (nat_port_alloc_test_command, static) =
+{
+  .path = "test nat port alloc",
+  .short_help = "test nat port alloc",
+  .function = nat_port_alloc_test_command_fn,
+};
+/* *INDENT-ON* */
+
 void
 nat44_add_del_address_dpo (ip4_address_t addr, u8 is_add)
 {
@@ -3508,8 +3773,12 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
   u32 nat64_st_memory_size = 256 << 20;
   u8 static_mapping_only = 0;
   u8 static_mapping_connection_tracking = 0;
+  u8 rss_consistent = 0;
+  u8 *rss_key = 0;
+  u32 rss_reta_size = 128;
   snat_main_per_thread_data_t *tsm;
   dslite_main_t *dm = &dslite_main;
+  clib_error_t *error;
 
   sm->deterministic = 0;
   sm->out2in_dpo = 0;
@@ -3561,6 +3830,12 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
 	dslite_set_ce (dm, 1);
       else if (unformat (input, "endpoint-dependent"))
 	sm->endpoint_dependent = 1;
+      else if (unformat (input, "rss-consistent"))
+	rss_consistent = 1;
+      else if (unformat (input, "rss key %U", unformat_hex_string, &rss_key))
+	;
+      else if (unformat (input, "rss reta size %d", &rss_reta_size))
+	;
       else
 	return clib_error_return (0, "unknown input '%U'",
 				  format_unformat_error, input);
@@ -3578,6 +3853,18 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
     return clib_error_return (0,
 			      "out2in dpo mode available only for simple nat");
 
+  if (rss_consistent && !sm->endpoint_dependent)
+    return clib_error_return (0,
+			      "rss-consistent mode available only for endpoint-dependent nat");
+
+  if (rss_consistent)
+    {
+      error = nat44_rss_init (rss_key, rss_reta_size);
+      vec_free (rss_key);
+      if (error)
+	return error;
+    }
+
   /* for show commands, etc. */
   sm->translation_buckets = translation_buckets;
   sm->translation_memory_size = translation_memory_size;
@@ -3677,8 +3964,11 @@ snat_config (vlib_main_t * vm, unformat_input_t * input)
                                     user_memory_size);
               clib_bihash_set_kvp_format_fn_8_8 (&tsm->user_hash,
                                                  format_user_kvp);
+
+              nat44_session_timers_init (tsm);
             }
           /* *INDENT-ON* */
+          sm->session_timers = 1;
 
 	}
       else
@@ -26,6 +26,7 @@
 #include <vppinfra/bihash_8_8.h>
 #include <vppinfra/bihash_16_8.h>
 #include <vppinfra/dlist.h>
+#include <vppinfra/tw_timer_16t_2w_512sl.h>
 #include <vppinfra/error.h>
 #include <vlibapi/api.h>
 #include <vlib/log.h>
@@ -209,6 +210,9 @@ typedef CLIB_PACKED(struct
   /* Last HA refresh */
   f64 ha_last_refreshed;
 
+  /* Expiry timer, ~0 if not running */
+  u32 expire_timer_handle;
+
   /* Counters */
   u64 total_bytes;
   u32 total_pkts;
@@ -249,12 +253,56 @@ typedef struct
 #define _(N, i, n, s) \
   u16 busy_##n##_ports; \
   u16 * busy_##n##_ports_per_thread; \
-  uword * busy_##n##_port_bitmap;
+  uword * busy_##n##_port_bitmap; \
+  uword * busy_##n##_port_full;
   foreach_snat_protocol
 #undef _
 /* *INDENT-ON* */
 } snat_address_t;
 
+/**
+ * @brief Mark a port busy or free in a port bitmap.
+ *
+ * Workers share the words at the edges of their port slices, and every
+ * summary word, so both are updated atomically. The summary bit is set
+ * again until it agrees with the word as read after setting it, in case
+ * another worker changed the word in between.
+ *
+ * @param busy   per-protocol port bitmap of the address
+ * @param full   summary with one bit per word of busy, set when every port
+ *               of the word is busy; may be NULL
+ */
+static_always_inline void
+nat_port_bitmap_set (uword * busy, uword * full, u16 port, uword is_busy)
+{
+  uword w = port / BITS (uword);
+  uword bit = (uword) 1 << (port % BITS (uword));
+  uword full_bit = (uword) 1 << (w % BITS (uword));
+  uword *fw, is_full;
+
+  if (is_busy)
+    clib_atomic_fetch_or (busy + w, bit);
+  else
+    clib_atomic_fetch_and (busy + w, ~bit);
+
+  if (!full)
+    return;
+
+  fw = full + w / BITS (uword);
+  do
+    {
+      is_full = clib_atomic_load_acq_n (busy + w) == ~(uword) 0;
+      if (is_full)
+	clib_atomic_fetch_or (fw, full_bit);
+      else
+	clib_atomic_fetch_and (fw, ~full_bit);
+    }
+  while (is_full != (clib_atomic_load_acq_n (busy + w) == ~(uword) 0));
+}
+
+/* src address, dst address, src port, dst port */
+#define NAT44_RSS_TUPLE_LEN 12
+
 typedef struct
 {
   u32 fib_index;
@@ -403,8 +451,24 @@ typedef struct
 
   /* NAT thread index */
   u32 snat_thread_index;
+
+  /* Index in snat_main.addresses last allocated from, per protocol */
+/* *INDENT-OFF* */
+#define _(N, i, n, s) \
+  u32 n##_alloc_addr_hint;
+  foreach_snat_protocol
+#undef _
+/* *INDENT-ON* */
+
+  /* Session expiry timers, one per session, 1s ticks */
+  tw_timer_wheel_16t_2w_512sl_t session_timer_wheel;
+  /* sessions whose timer fired, not yet handled by the expiry node */
+  u32 *expired_sessions;
 } snat_main_per_thread_data_t;
 
+/* Sessions deleted per thread and per run of the expiry node, at most */
+#define NAT44_SESSION_EXPIRE_BATCH 1024
+
 struct snat_main_s;
 
 /* ICMP session match function */
@@ -554,6 +618,23 @@ typedef struct snat_main_s
   u32 tcp_transitory_timeout;
   u32 icmp_timeout;
 
+  /* sessions are reclaimed by the per-thread expiry timers */
+  u8 session_timers;
+
+  /*
+   * RSS-consistent port selection: outside ports are chosen so that the
+   * NIC's Toeplitz hash of the out2in 5-tuple selects the rx queue of the
+   * worker owning the session, rx queue i being polled by workers[i]
+   */
+  u8 rss_consistent;
+  u32 rss_reta_size;
+  /* Toeplitz hash of each value of each byte of the IPv4 5-tuple */
+  u32 rss_hash_table[NAT44_RSS_TUPLE_LEN][256];
+  /* handoff next nodes for packets already on the owning worker */
+  u32 in2out_handoff_local_next;
+  u32 in2out_output_handoff_local_next;
+  u32 out2in_handoff_local_next;
+
   /* TCP MSS clamping */
   u16 mss_clamping;
   u16 mss_value_net;
@@ -1014,6 +1095,23 @@ snat_session_t *nat_session_alloc_or_recycle (snat_main_t * sm,
 snat_session_t *nat_ed_session_alloc (snat_main_t * sm, snat_user_t * u,
 				      u32 thread_index, f64 now);
 
+/**
+ * @brief Initialize the session expiry timer wheel of a thread
+ *
+ * @param tsm          per-thread data
+ */
+void nat44_session_timers_init (snat_main_per_thread_data_t * tsm);
+
+/**
+ * @brief (Re)start the expiry timer of a NAT44 session
+ *
+ * @param s            NAT session
+ * @param thread_index thread index
+ * @param interval     seconds until the session is checked for expiry
+ */
+void nat44_session_timer_start (snat_main_t * sm, snat_session_t * s,
+				u32 thread_index, u32 interval);
+
 /**
  * @brief Set address and port assignment algorithm for MAP-E CE
  *
@@ -1054,7 +1152,11 @@ void snat_free_outside_address_and_port (snat_address_t * addresses,
  * @param addresses         vector of outside addresses
  * @param fib_index         FIB table index
  * @param thread_index      thread index
- * @param k                 allocated address and port pair
+ * @param k                 allocated address and port pair; on entry
+ *                          k->addr is the inside address of the user, or 0
+ *                          if there is none. The default algorithm tries
+ *                          the outside address the user hashes to first, so
+ *                          a user's sessions share one while it has ports
  * @param port_per_thread   number of ports per threead
  * @param snat_thread_index NAT thread index
  *
@@ -1067,6 +1169,48 @@ int snat_alloc_outside_address_and_port (snat_address_t * addresses,
 					 u16 port_per_thread,
 					 u32 snat_thread_index);
 
+/**
+ * @brief Set up RSS-consistent port selection
+ *
+ * @param key       Toeplitz key programmed on the outside NICs, NULL for
+ *                  the common default key
+ * @param reta_size size of the NICs' RSS redirection table
+ *
+ * @return error if the key or table size can not be used
+ */
+clib_error_t *nat44_rss_init (u8 * key, u32 reta_size);
+
+/**
+ * @brief Add the next nodes the handoff nodes use for packets which are
+ * already on the worker owning their session
+ */
+void nat44_rss_handoff_init (vlib_main_t * vm);
+
+/**
+ * @brief Alloc outside address and port for an endpoint-dependent session
+ *
+ * With RSS-consistent port selection the port is chosen so that the
+ * out2in packets of the session are received by this thread, otherwise
+ * (and if no such port is free) this is snat_alloc_outside_address_and_port.
+ *
+ * @param fib_index    FIB table index
+ * @param thread_index thread index
+ * @param k            allocated address and port pair
+ * @param r_addr       external host address
+ * @param r_port       external host port (network byte order)
+ *
+ * @return 0 on success, non-zero value otherwise
+ */
+int nat44_rss_alloc_addr_and_port (snat_main_t * sm, u32 fib_index,
+				   u32 thread_index, snat_session_key_t * k,
+				   ip4_address_t * r_addr, u16 r_port);
+
+/**
+ * @brief Worker for in2out packets with RSS-consistent port selection:
+ * the receiving worker, unless the packet matches a static mapping.
+ */
+u32 nat44_rss_get_worker_in2out_cb (ip4_header_t * ip, u32 rx_fib_index);
+
 /**
  * @brief Match NAT44 static mapping.
  *
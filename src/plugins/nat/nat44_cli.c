@@ -355,6 +355,7 @@ nat_ha_failover_command_fn (vlib_main_t * vm, unformat_input_t * input,
   unformat_input_t _line_input, *line_input = &_line_input;
   ip4_address_t addr;
   u32 port, session_refresh_interval = 10;
+  u8 compact = 0;
   int rv;
   clib_error_t *error = 0;
 
@@ -370,6 +371,8 @@ nat_ha_failover_command_fn (vlib_main_t * vm, unformat_input_t * input,
 	if (unformat
 	    (line_input, "refresh-intervval %u", &session_refresh_interval))
 	;
+      else if (unformat (line_input, "compact"))
+	compact = 1;
       else
 	{
 	  error = clib_error_return (0, "unknown input '%U'",
@@ -378,7 +381,8 @@ nat_ha_failover_command_fn (vlib_main_t * vm, unformat_input_t * input,
 	}
     }
 
-  rv = nat_ha_set_failover (&addr, (u16) port, session_refresh_interval);
+  rv = nat_ha_set_failover (&addr, (u16) port, session_refresh_interval,
+			    compact);
   if (rv)
     error = clib_error_return (0, "set HA failover failed");
 
@@ -433,7 +437,7 @@ nat_show_ha_command_fn (vlib_main_t * vm, unformat_input_t * input,
   ip4_address_t addr;
   u16 port;
   u32 path_mtu, session_refresh_interval, resync_ack_missed;
-  u8 in_resync;
+  u8 in_resync, compact;
 
   nat_ha_get_listener (&addr, &port, &path_mtu);
   if (!port)
@@ -446,12 +450,12 @@ nat_show_ha_command_fn (vlib_main_t * vm, unformat_input_t * input,
   vlib_cli_output (vm, "  %U:%u path-mtu %u\n",
 		   format_ip4_address, &addr, port, path_mtu);
 
-  nat_ha_get_failover (&addr, &port, &session_refresh_interval);
+  nat_ha_get_failover (&addr, &port, &session_refresh_interval, &compact);
   vlib_cli_output (vm, "FAILOVER:\n");
   if (port)
-    vlib_cli_output (vm, "  %U:%u refresh-intervval %usec\n",
+    vlib_cli_output (vm, "  %U:%u refresh-intervval %usec%s\n",
 		     format_ip4_address, &addr, port,
-		     session_refresh_interval);
+		     session_refresh_interval, compact ? " compact" : "");
   else
     vlib_cli_output (vm, "  NA\n");
 
@@ -2024,7 +2028,7 @@ VLIB_CLI_COMMAND (nat_show_mss_clamping_command, static) = {
 ?*/
 VLIB_CLI_COMMAND (nat_ha_failover_command, static) = {
     .path = "nat ha failover",
-    .short_help = "nat ha failover <ip4-address>:<port> [refresh-intervval <sec>]",
+    .short_help = "nat ha failover <ip4-address>:<port> [refresh-intervval <sec>] [compact]",
     .function = nat_ha_failover_command_fn,
 };
 
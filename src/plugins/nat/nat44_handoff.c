@@ -75,10 +75,11 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b;
   u32 n_enq, n_left_from, *from;
   u16 thread_indices[VLIB_FRAME_SIZE], *ti;
-  u32 fq_index;
+  u32 fq_index, local_next;
   snat_get_worker_function_t *get_worker;
   u32 thread_index = vm->thread_index;
   u32 do_handoff = 0, same_worker = 0;
+  u32 local[VLIB_FRAME_SIZE], n_local = 0, i;
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
@@ -93,14 +94,23 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
     {
       get_worker = sm->worker_in2out_cb;
       if (is_output)
-	fq_index = sm->fq_in2out_output_index;
+	{
+	  fq_index = sm->fq_in2out_output_index;
+	  local_next = sm->in2out_output_handoff_local_next;
+	}
       else
-	fq_index = sm->fq_in2out_index;
+	{
+	  fq_index = sm->fq_in2out_index;
+	  local_next = sm->in2out_handoff_local_next;
+	}
+      if (sm->rss_consistent)
+	get_worker = nat44_rss_get_worker_in2out_cb;
     }
   else
     {
       fq_index = sm->fq_out2in_index;
       get_worker = sm->worker_out2in_cb;
+      local_next = sm->out2in_handoff_local_next;
     }
 
   while (n_left_from > 0)
@@ -133,14 +143,38 @@ nat44_worker_handoff_fn_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
       b += 1;
     }
 
-  n_enq =
-    vlib_buffer_enqueue_to_thread (vm, fq_index, from, thread_indices,
-				   frame->n_vectors, 1);
+  /*
+   * With RSS-consistent port selection most packets are already on their
+   * worker, pass those on directly instead of through the frame queue.
+   */
+  n_left_from = frame->n_vectors;
+  if (sm->rss_consistent && same_worker)
+    {
+      n_left_from = 0;
+      for (i = 0; i < frame->n_vectors; i++)
+	{
+	  if (thread_indices[i] == thread_index)
+	    local[n_local++] = from[i];
+	  else
+	    {
+	      from[n_left_from] = from[i];
+	      thread_indices[n_left_from++] = thread_indices[i];
+	    }
+	}
+      vlib_buffer_enqueue_to_single_next (vm, node, local, local_next,
+					  n_local);
+    }
+
+  n_enq = 0;
+  if (n_left_from)
+    n_enq =
+      vlib_buffer_enqueue_to_thread (vm, fq_index, from, thread_indices,
+				     n_left_from, 1);
 
-  if (n_enq < frame->n_vectors)
+  if (n_enq < n_left_from)
     vlib_node_increment_counter (vm, node->node_index,
 				 NAT44_HANDOFF_ERROR_CONGESTION_DROP,
-				 frame->n_vectors - n_enq);
+				 n_left_from - n_enq);
   vlib_node_increment_counter (vm, node->node_index,
 			       NAT44_HANDOFF_ERROR_SAME_WORKER, same_worker);
   vlib_node_increment_counter (vm, node->node_index,
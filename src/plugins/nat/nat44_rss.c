@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT44 RSS-consistent port selection
+ *
+ * Endpoint-dependent sessions are owned by the worker receiving their
+ * in2out packets. The outside port of a session is picked from the
+ * owner's port slice so that the NIC's Toeplitz hash of the out2in
+ * 5-tuple selects the rx queue polled by the owner. The handoff nodes then
+ * find nearly every packet already on its worker and pass it on directly,
+ * without going through a frame queue.
+ *
+ * The hash is computed in software with the key programmed on the outside
+ * NICs, and the NICs' redirection tables are expected to spread entries
+ * round robin over the rx queues (entry i to queue i % n_queues), rx queue
+ * i being polled by NAT worker i. Packets of sessions whose port could not
+ * be made consistent, and of static mappings, are still handed off.
+ *
+ * Users live in the per-thread data of the workers owning their sessions.
+ * A user's flows are no longer steered to a single worker, so the max
+ * translations per user limit is enforced per worker in this mode.
+ */
+
+#include <nat/nat.h>
+#include <nat/nat_inlines.h>
+
+/* the Toeplitz key most NICs and drivers use unless told otherwise */
+static u8 nat44_rss_default_key[] = {
+  0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+  0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+  0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+  0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+  0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa,
+};
+
+/* the 32 bits of the key starting at bit offset */
+static u32
+nat44_rss_key_window (u8 * key, u32 offset)
+{
+  u64 w = 0;
+  int i;
+
+  for (i = 0; i < 5; i++)
+    w = (w << 8) | key[offset / 8 + i];
+
+  return (u32) (w >> (8 - offset % 8));
+}
+
+/* per tuple byte and value, the hash of the value at that position */
+static void
+nat44_rss_build_hash_table (snat_main_t * sm, u8 * key)
+{
+  u32 pos, v, b, hash;
+
+  for (pos = 0; pos < NAT44_RSS_TUPLE_LEN; pos++)
+    for (v = 0; v < 256; v++)
+      {
+	hash = 0;
+	for (b = 0; b < 8; b++)
+	  if (v & (0x80 >> b))
+	    hash ^= nat44_rss_key_window (key, pos * 8 + b);
+	sm->rss_hash_table[pos][v] = hash;
+      }
+}
+
+clib_error_t *
+nat44_rss_init (u8 * key, u32 reta_size)
+{
+  snat_main_t *sm = &snat_main;
+  u32 key_len;
+
+  if (!key)
+    {
+      key = nat44_rss_default_key;
+      key_len = sizeof (nat44_rss_default_key);
+    }
+  else
+    key_len = vec_len (key);
+
+  if (key_len < NAT44_RSS_TUPLE_LEN + 4)
+    return clib_error_return (0, "rss key must be at least %d bytes long",
+			      NAT44_RSS_TUPLE_LEN + 4);
+
+  if (!reta_size || !is_pow2 (reta_size))
+    return clib_error_return (0, "rss reta size must be a power of 2");
+
+  nat44_rss_build_hash_table (sm, key);
+
+  sm->rss_reta_size = reta_size;
+  sm->rss_consistent = 1;
+
+  return 0;
+}
+
+void
+nat44_rss_handoff_init (vlib_main_t * vm)
+{
+  snat_main_t *sm = &snat_main;
+
+  sm->in2out_handoff_local_next =
+    vlib_node_add_next (vm, snat_in2out_worker_handoff_node.index,
+			sm->in2out_node_index);
+  sm->in2out_output_handoff_local_next =
+    vlib_node_add_next (vm, snat_in2out_output_worker_handoff_node.index,
+			sm->in2out_output_node_index);
+  sm->out2in_handoff_local_next =
+    vlib_node_add_next (vm, snat_out2in_worker_handoff_node.index,
+			sm->out2in_node_index);
+}
+
+/*
+ * Take a free port of [lo, hi] whose out2in hash selects the rx queue of
+ * NAT thread snat_thread_index, starting from a random port. About one
+ * free port in num_snat_thread qualifies; full bitmap words are skipped.
+ */
+static int
+nat44_rss_port_alloc (snat_main_t * sm, uword * busy, uword * full,
+		      u32 lo, u32 hi, u32 base, u32 snat_thread_index,
+		      u16 * port)
+{
+  u32 n = hi - lo + 1, i, p, hash;
+
+  p = lo + random_u32 (&sm->random_seed) % n;
+  for (i = 0; i < n; i++, p = p == hi ? lo : p + 1)
+    {
+      if (busy[p / BITS (uword)] == ~(uword) 0)
+	{
+	  /* rest of the word, or up to the end of the range */
+	  i += clib_min (BITS (uword) - 1 - p % BITS (uword), hi - p);
+	  p += clib_min (BITS (uword) - 1 - p % BITS (uword), hi - p);
+	  continue;
+	}
+      if (clib_bitmap_get_no_check (busy, p))
+	continue;
+
+      hash = nat44_rss_hash_dst_port (sm, base, p);
+      if (nat44_rss_snat_thread_index (sm, hash) != snat_thread_index)
+	continue;
+
+      nat_port_bitmap_set (busy, full, p, 1);
+      *port = p;
+      return 0;
+    }
+
+  return 1;
+}
+
+int
+nat44_rss_alloc_addr_and_port (snat_main_t * sm, u32 fib_index,
+			       u32 thread_index, snat_session_key_t * k,
+			       ip4_address_t * r_addr, u16 r_port)
+{
+  snat_main_per_thread_data_t *tsm;
+  snat_address_t *a, *ga = 0;
+  u32 lo, hi, base;
+  u16 portnum;
+  int i;
+
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+
+  /* other allocators do not use per-thread port slices */
+  if (!sm->rss_consistent || sm->num_workers < 2 ||
+      sm->addr_and_port_alloc_alg != NAT_ADDR_AND_PORT_ALLOC_ALG_DEFAULT)
+    goto fallback;
+
+  lo = (sm->port_per_thread * tsm->snat_thread_index) + 1 + 1024;
+  hi = (sm->port_per_thread * tsm->snat_thread_index) +
+    sm->port_per_thread + 1024;
+
+  switch (k->protocol)
+    {
+      /* the NICs hash ICMP and other protocols on addresses only */
+#define _(N, n) \
+    case SNAT_PROTOCOL_##N: \
+      for (i = 0; i < vec_len (sm->addresses); i++) \
+        { \
+          a = sm->addresses + i; \
+          if (a->busy_##n##_ports_per_thread[thread_index] >= \
+              sm->port_per_thread) \
+            continue; \
+          if (a->fib_index == fib_index) \
+            { \
+              base = nat44_rss_hash_base (sm, r_addr, &a->addr, r_port); \
+              if (!nat44_rss_port_alloc (sm, a->busy_##n##_port_bitmap, \
+                                         a->busy_##n##_port_full, lo, hi, \
+                                         base, tsm->snat_thread_index, \
+                                         &portnum)) \
+                goto alloc_##n; \
+            } \
+          else if (a->fib_index == ~0) \
+            { \
+              ga = a; \
+            } \
+        } \
+      if (ga) \
+        { \
+          a = ga; \
+          base = nat44_rss_hash_base (sm, r_addr, &a->addr, r_port); \
+          if (!nat44_rss_port_alloc (sm, a->busy_##n##_port_bitmap, \
+                                     a->busy_##n##_port_full, lo, hi, \
+                                     base, tsm->snat_thread_index, \
+                                     &portnum)) \
+            goto alloc_##n; \
+        } \
+      break; \
+    alloc_##n: \
+      a->busy_##n##_ports_per_thread[thread_index]++; \
+      a->busy_##n##_ports++; \
+      k->addr = a->addr; \
+      k->port = clib_host_to_net_u16 (portnum); \
+      return 0;
+      _(UDP, udp)
+      _(TCP, tcp)
+#undef _
+    default:
+      break;
+    }
+
+fallback:
+  return snat_alloc_outside_address_and_port (sm->addresses, fib_index,
+					      thread_index, k,
+					      sm->port_per_thread,
+					      tsm->snat_thread_index);
+}
+
+u32
+nat44_rss_get_worker_in2out_cb (ip4_header_t * ip, u32 rx_fib_index)
+{
+  snat_main_t *sm = &snat_main;
+  u32 thread_index = vlib_get_thread_index ();
+  snat_main_per_thread_data_t *tsm;
+  clib_bihash_kv_8_8_t kv, value;
+  udp_header_t *udp;
+  u32 proto;
+
+  /* the receiving thread owns the session only if it is a NAT worker */
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+  if (PREDICT_FALSE (thread_index < sm->first_worker_index ||
+		     tsm->snat_thread_index >= _vec_len (sm->workers) ||
+		     sm->first_worker_index +
+		     sm->workers[tsm->snat_thread_index] != thread_index))
+    return sm->worker_in2out_cb (ip, rx_fib_index);
+
+  /* static mappings are owned by the worker of their local address */
+  if (PREDICT_FALSE (pool_elts (sm->static_mappings)))
+    {
+      make_sm_kv (&kv, &ip->src_address, 0, rx_fib_index, 0);
+      if (!clib_bihash_search_8_8 (&sm->static_mapping_by_local, &kv, &value))
+	return sm->worker_in2out_cb (ip, rx_fib_index);
+
+      proto = ip_proto_to_snat_proto (ip->protocol);
+      if ((proto == SNAT_PROTOCOL_UDP || proto == SNAT_PROTOCOL_TCP) &&
+	  ip4_get_fragment_offset (ip) == 0)
+	{
+	  udp = ip4_next_header (ip);
+	  make_sm_kv (&kv, &ip->src_address, proto, rx_fib_index,
+		      clib_net_to_host_u16 (udp->src_port));
+	  if (!clib_bihash_search_8_8
+	      (&sm->static_mapping_by_local, &kv, &value))
+	    return sm->worker_in2out_cb (ip, rx_fib_index);
+	}
+    }
+
+  return thread_index;
+}
+
+/* the IPv4 with TCP verification suite of Microsoft's RSS specification */
+/* *INDENT-OFF* */
+static struct
+{
+  u8 src[4], dst[4];
+  u16 src_port, dst_port;
+  u32 hash;
+} nat44_rss_test_vectors[] = {
+  {{66, 9, 149, 187}, {161, 142, 100, 80}, 2794, 1766, 0x51ccc178},
+  {{199, 92, 111, 2}, {65, 69, 140, 83}, 14230, 4739, 0xc626b0ea},
+  {{24, 19, 198, 95}, {12, 22, 207, 184}, 12898, 38024, 0x5c2b394a},
+  {{38, 27, 205, 30}, {209, 142, 163, 6}, 48228, 2217, 0xafc7327f},
+  {{153, 39, 163, 191}, {202, 188, 127, 2}, 44251, 1303, 0x10e828a2},
+};
+/* *INDENT-ON* */
+
+/*
+ * Hash the test vectors with the default key, through the tables the
+ * port allocator uses. The tables configured are put back afterwards.
+ */
+static clib_error_t *
+nat44_rss_test_command_fn (vlib_main_t * vm, unformat_input_t * input,
+			   vlib_cli_command_t * cmd)
+{
+  snat_main_t *sm = &snat_main;
+  ip4_address_t src, dst;
+  u32 *saved, base, hash;
+  int i, n_failed = 0;
+
+  saved = clib_mem_alloc (sizeof (sm->rss_hash_table));
+  clib_memcpy_fast (saved, sm->rss_hash_table, sizeof (sm->rss_hash_table));
+  nat44_rss_build_hash_table (sm, nat44_rss_default_key);
+
+  for (i = 0; i < ARRAY_LEN (nat44_rss_test_vectors); i++)
+    {
+      clib_memcpy_fast (src.as_u8, nat44_rss_test_vectors[i].src, 4);
+      clib_memcpy_fast (dst.as_u8, nat44_rss_test_vectors[i].dst, 4);
+      base = nat44_rss_hash_base (sm, &src, &dst,
+				  clib_host_to_net_u16
+				  (nat44_rss_test_vectors[i].src_port));
+      hash = nat44_rss_hash_dst_port (sm, base,
+				      nat44_rss_test_vectors[i].dst_port);
+      if (hash != nat44_rss_test_vectors[i].hash)
+	{
+	  vlib_cli_output (vm, "%U:%d -> %U:%d: hash 0x%08x, expected 0x%08x",
+			   format_ip4_address, &src,
+			   nat44_rss_test_vectors[i].src_port,
+			   format_ip4_address, &dst,
+			   nat44_rss_test_vectors[i].dst_port, hash,
+			   nat44_rss_test_vectors[i].hash);
+	  n_failed++;
+	}
+    }
+
+  clib_memcpy_fast (sm->rss_hash_table, saved, sizeof (sm->rss_hash_table));
+  clib_mem_free (saved);
+
+  if (n_failed)
+    return clib_error_return (0, "NAT44 RSS hash unit test failed");
+
+  vlib_cli_output (vm, "NAT44 RSS hash unit test OK");
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (nat44_rss_test_command, static) =
+{
+  .path = "test nat44 rss hash",
+  .short_help = "test nat44 rss hash",
+  .function = nat44_rss_test_command_fn,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @file
+ * @brief NAT44 session expiry timers
+ *
+ * Every NAT44 session has a timer in the timer wheel of the thread owning
+ * it. The fast path only refreshes last_heard; the timer is not touched
+ * per packet. When a timer fires the session is deleted if it has been
+ * idle for its timeout, otherwise the timer is restarted for the time
+ * left. Timers are run once a second on each thread by the
+ * nat44-session-expire-worker node, so memory and hash slots follow the
+ * number of live flows rather than waiting for a bihash collision to
+ * recycle stale entries.
+ *
+ * The wheel hands back every timer of a slot at once, so the fired
+ * sessions are kept in a per-thread backlog and a run deletes at most
+ * NAT44_SESSION_EXPIRE_BATCH of them. While a backlog is left the node
+ * interrupts itself to continue on the next dispatch, and the wheel is
+ * only advanced again once the backlog is drained.
+ */
+
+#include <nat/nat.h>
+#include <nat/nat_inlines.h>
+
+vlib_node_registration_t nat44_session_expire_worker_node;
+
+void
+nat44_session_timers_init (snat_main_per_thread_data_t * tsm)
+{
+  /* max expirations only stops the wheel between ticks, a slot fires
+   * whole; the expiry node bounds the deletes itself */
+  tw_timer_wheel_init_16t_2w_512sl (&tsm->session_timer_wheel, 0,
+				    1.0 /* timer interval */ ,
+				    NAT44_SESSION_EXPIRE_BATCH);
+}
+
+void
+nat44_session_timer_start (snat_main_t * sm, snat_session_t * s,
+			   u32 thread_index, u32 interval)
+{
+  snat_main_per_thread_data_t *tsm =
+    vec_elt_at_index (sm->per_thread_data, thread_index);
+
+  if (!sm->session_timers)
+    return;
+
+  if (s->expire_timer_handle != ~0)
+    tw_timer_stop_16t_2w_512sl (&tsm->session_timer_wheel,
+				s->expire_timer_handle);
+
+  s->expire_timer_handle =
+    tw_timer_start_16t_2w_512sl (&tsm->session_timer_wheel,
+				 s - tsm->sessions, 0, clib_max (interval, 1));
+}
+
+/*
+ * Seconds until a session may expire. TCP sessions change timeout with
+ * their state, so never wait longer than the transitory timeout for them:
+ * a closed session is then reclaimed soon after it is due.
+ */
+static_always_inline u32
+nat44_session_expire_interval (snat_main_t * sm, snat_session_t * s, f64 now)
+{
+  f64 left;
+  u32 interval;
+
+  left = s->last_heard + (f64) nat44_session_get_timeout (sm, s) - now;
+  interval = left > 0 ? (u32) left + 1 : 1;
+
+  if (s->in2out.protocol == SNAT_PROTOCOL_TCP)
+    interval = clib_min (interval, sm->tcp_transitory_timeout);
+
+  return interval;
+}
+
+static uword
+nat44_session_expire_worker_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
+				vlib_frame_t * f)
+{
+  snat_main_t *sm = &snat_main;
+  u32 thread_index = vm->thread_index;
+  snat_main_per_thread_data_t *tsm;
+  f64 now = vlib_time_now (vm);
+  snat_session_t *s;
+  u32 *si, n_expired = 0;
+  u64 sess_timeout_time;
+  uword n_done;
+
+  if (thread_index >= vec_len (sm->per_thread_data))
+    return 0;
+
+  tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+
+  /* thread clocks differ, start the wheel on the owning thread's clock */
+  if (PREDICT_FALSE (tsm->session_timer_wheel.last_run_time == 0))
+    {
+      tsm->session_timer_wheel.last_run_time = now;
+      return 0;
+    }
+
+  if (0 == vec_len (tsm->expired_sessions))
+    {
+      tsm->expired_sessions =
+	tw_timer_expire_timers_vec_16t_2w_512sl (&tsm->session_timer_wheel,
+						 now, tsm->expired_sessions);
+
+      /*
+       * the timers are gone; mark their sessions so a delete from the
+       * data-path before their turn does not stop a freed handle
+       */
+      vec_foreach (si, tsm->expired_sessions)
+      {
+	/* timer id is always 0, the handle is the session index */
+	s = pool_elt_at_index (tsm->sessions, si[0]);
+	s->expire_timer_handle = ~0;
+      }
+    }
+
+  vec_foreach (si, tsm->expired_sessions)
+  {
+    if (n_expired >= NAT44_SESSION_EXPIRE_BATCH)
+      break;
+
+    /*
+     * deleted since it was taken from the wheel, perhaps with the
+     * index reused by a new session with a timer of its own
+     */
+    if (pool_is_free_index (tsm->sessions, si[0]))
+      continue;
+    s = pool_elt_at_index (tsm->sessions, si[0]);
+    if (s->expire_timer_handle != ~0)
+      continue;
+
+    sess_timeout_time =
+      s->last_heard + (f64) nat44_session_get_timeout (sm, s);
+    if (now >= sess_timeout_time)
+      {
+	nat_free_session_data (sm, s, thread_index, 0);
+	nat44_delete_session (sm, s, thread_index);
+	n_expired++;
+      }
+    else
+      nat44_session_timer_start (sm, s, thread_index,
+				 nat44_session_expire_interval (sm, s, now));
+  }
+
+  n_done = si - tsm->expired_sessions;
+  if (n_done < vec_len (tsm->expired_sessions))
+    {
+      vec_delete (tsm->expired_sessions, n_done, 0);
+      vlib_node_set_interrupt_pending (vm,
+				       nat44_session_expire_worker_node.index);
+    }
+  else
+    vec_reset_length (tsm->expired_sessions);
+
+  return n_expired;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat44_session_expire_worker_node) = {
+    .function = nat44_session_expire_worker_fn,
+    .type = VLIB_NODE_TYPE_INPUT,
+    .state = VLIB_NODE_STATE_INTERRUPT,
+    .name = "nat44-session-expire-worker",
+};
+/* *INDENT-ON* */
+
+/* once a second, interrupt each thread to run its session timers */
+static uword
+nat44_session_expire_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
+			      vlib_frame_t * f)
+{
+  snat_main_t *sm = &snat_main;
+  uword *event_data = 0;
+  u32 ti;
+
+  while (1)
+    {
+      vlib_process_wait_for_event_or_clock (vm, 1.0);
+      vlib_process_get_events (vm, &event_data);
+      vec_reset_length (event_data);
+
+      if (!sm->session_timers)
+	continue;
+
+      for (ti = 0; ti < vec_len (vlib_mains); ti++)
+	{
+	  if (ti >= vec_len (sm->per_thread_data))
+	    continue;
+
+	  vlib_node_set_interrupt_pending (vlib_mains[ti],
+					   nat44_session_expire_worker_node.
+					   index);
+	}
+    }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (nat44_session_expire_process_node) = {
+    .function = nat44_session_expire_process,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "nat44-session-expire-process",
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
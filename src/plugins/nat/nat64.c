@@ -560,6 +560,8 @@ nat64_alloc_out_addr_and_port (u32 fib_index, snat_protocol_t proto,
   int rv;
 
   k.protocol = proto;
+  /* users are IPv6, no pairing by user */
+  k.addr.as_u32 = 0;
 
   if (sm->num_workers > 1)
     worker_index = thread_index - sm->first_worker_index;
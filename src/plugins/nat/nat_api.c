@@ -705,7 +705,8 @@ vl_api_nat_ha_set_failover_t_handler (vl_api_nat_ha_set_failover_t * mp)
   memcpy (&addr, &mp->ip_address, sizeof (addr));
   rv =
     nat_ha_set_failover (&addr, clib_net_to_host_u16 (mp->port),
-			 clib_net_to_host_u32 (mp->session_refresh_interval));
+			 clib_net_to_host_u32 (mp->session_refresh_interval),
+			 0 /* compact */ );
 
   REPLY_MACRO (VL_API_NAT_HA_SET_FAILOVER_REPLY);
 }
@@ -723,6 +724,39 @@ vl_api_nat_ha_set_failover_t_print (vl_api_nat_ha_set_failover_t * mp,
   FINISH;
 }
 
+static void
+vl_api_nat_ha_set_failover_v2_t_handler (vl_api_nat_ha_set_failover_v2_t *
+					 mp)
+{
+  snat_main_t *sm = &snat_main;
+  vl_api_nat_ha_set_failover_v2_reply_t *rmp;
+  ip4_address_t addr;
+  int rv;
+
+  memcpy (&addr, &mp->ip_address, sizeof (addr));
+  rv =
+    nat_ha_set_failover (&addr, clib_net_to_host_u16 (mp->port),
+			 clib_net_to_host_u32 (mp->session_refresh_interval),
+			 mp->compact);
+
+  REPLY_MACRO (VL_API_NAT_HA_SET_FAILOVER_V2_REPLY);
+}
+
+static void *
+vl_api_nat_ha_set_failover_v2_t_print (vl_api_nat_ha_set_failover_v2_t * mp,
+				       void *handle)
+{
+  u8 *s;
+
+  s = format (0, "SCRIPT: nat_ha_set_failover_v2 ");
+  s = format (s, "ip_address %U ", format_ip4_address, mp->ip_address);
+  s = format (s, "port %d ", clib_net_to_host_u16 (mp->port));
+  if (mp->compact)
+    s = format (s, "compact ");
+
+  FINISH;
+}
+
 static void
 vl_api_nat_ha_get_failover_t_handler (vl_api_nat_ha_get_failover_t * mp)
 {
@@ -732,8 +766,9 @@ vl_api_nat_ha_get_failover_t_handler (vl_api_nat_ha_get_failover_t * mp)
   ip4_address_t addr;
   u16 port;
   u32 session_refresh_interval;
+  u8 compact;
 
-  nat_ha_get_failover (&addr, &port, &session_refresh_interval);
+  nat_ha_get_failover (&addr, &port, &session_refresh_interval, &compact);
 
   /* *INDENT-OFF* */
   REPLY_MACRO2 (VL_API_NAT_HA_GET_FAILOVER_REPLY,
@@ -756,6 +791,42 @@ vl_api_nat_ha_get_failover_t_print (vl_api_nat_ha_get_failover_t * mp,
   FINISH;
 }
 
+static void
+vl_api_nat_ha_get_failover_v2_t_handler (vl_api_nat_ha_get_failover_v2_t *
+					 mp)
+{
+  snat_main_t *sm = &snat_main;
+  vl_api_nat_ha_get_failover_v2_reply_t *rmp;
+  int rv = 0;
+  ip4_address_t addr;
+  u16 port;
+  u32 session_refresh_interval;
+  u8 compact;
+
+  nat_ha_get_failover (&addr, &port, &session_refresh_interval, &compact);
+
+  /* *INDENT-OFF* */
+  REPLY_MACRO2 (VL_API_NAT_HA_GET_FAILOVER_V2_REPLY,
+  ({
+    clib_memcpy (rmp->ip_address, &addr, sizeof (ip4_address_t));
+    rmp->port = clib_host_to_net_u16 (port);
+    rmp->session_refresh_interval = clib_host_to_net_u32 (session_refresh_interval);
+    rmp->compact = compact;
+  }))
+  /* *INDENT-ON* */
+}
+
+static void *
+vl_api_nat_ha_get_failover_v2_t_print (vl_api_nat_ha_get_failover_v2_t * mp,
+				       void *handle)
+{
+  u8 *s;
+
+  s = format (0, "SCRIPT: nat_ha_get_failover_v2");
+
+  FINISH;
+}
+
 static void
 vl_api_nat_ha_flush_t_handler (vl_api_nat_ha_flush_t * mp)
 {
@@ -3398,8 +3469,10 @@ _(NAT_SET_MSS_CLAMPING, nat_set_mss_clamping)                           \
 _(NAT_GET_MSS_CLAMPING, nat_get_mss_clamping)                           \
 _(NAT_HA_SET_LISTENER, nat_ha_set_listener)                             \
 _(NAT_HA_SET_FAILOVER, nat_ha_set_failover)                             \
+_(NAT_HA_SET_FAILOVER_V2, nat_ha_set_failover_v2)                       \
 _(NAT_HA_GET_LISTENER, nat_ha_get_listener)                             \
 _(NAT_HA_GET_FAILOVER, nat_ha_get_failover)                             \
+_(NAT_HA_GET_FAILOVER_V2, nat_ha_get_failover_v2)                       \
 _(NAT_HA_FLUSH, nat_ha_flush)                                           \
 _(NAT_HA_RESYNC, nat_ha_resync)                                         \
 _(NAT44_ADD_DEL_ADDRESS_RANGE, nat44_add_del_address_range)             \
@@ -17,10 +17,21 @@
 #include <vnet/udp/udp.h>
 #include <nat/nat.h>
 #include <vppinfra/atomics.h>
+#include <vppinfra/fifo.h>
+#include <vppinfra/xxhash.h>
 
 /* number of retries */
 #define NAT_HA_RETRIES 3
 
+/* seconds between retries */
+#define NAT_HA_RETRY_INTERVAL 2.0
+
+/* session pool slots visited per thread in a resync step */
+#define NAT_HA_RESYNC_BATCH 4096
+
+/* seconds between resync steps */
+#define NAT_HA_RESYNC_INTERVAL 0.01
+
 #define foreach_nat_ha_counter           \
 _(RECV_ADD, "add-event-recv", 0)         \
 _(RECV_DEL, "del-event-recv", 1)         \
@@ -31,11 +42,15 @@ _(SEND_REFRESH, "refresh-event-send", 5) \
 _(RECV_ACK, "ack-recv", 6)               \
 _(SEND_ACK, "ack-send", 7)               \
 _(RETRY_COUNT, "retry-count", 8)         \
-_(MISSED_COUNT, "missed-count", 9)
+_(MISSED_COUNT, "missed-count", 9)       \
+_(COALESCED, "coalesced-event", 10)
 
 /* NAT HA protocol version */
 #define NAT_HA_VERSION 0x01
 
+/* NAT HA protocol version with compact events */
+#define NAT_HA_VERSION_COMPACT 0x02
+
 /* NAT HA protocol flags */
 #define NAT_HA_FLAG_ACK 0x01
 
@@ -83,6 +98,53 @@ typedef struct
   u64 total_bytes;
 } __attribute__ ((packed)) nat_ha_event_t;
 
+/*
+ * Event fields, in the order the compact encoding carries them. A compact
+ * event is a nat_ha_compact_event_t followed by the fields set in its
+ * field mask: the fields of its type which differ from the last value sent
+ * in the message. The others keep the value last sent.
+ */
+#define foreach_nat_ha_event_field \
+_(protocol, 0)                     \
+_(flags, 1)                        \
+_(in_addr, 2)                      \
+_(out_addr, 3)                     \
+_(in_port, 4)                      \
+_(out_port, 5)                     \
+_(eh_addr, 6)                      \
+_(ehn_addr, 7)                     \
+_(eh_port, 8)                      \
+_(ehn_port, 9)                     \
+_(fib_index, 10)                   \
+_(total_pkts, 11)                  \
+_(total_bytes, 12)
+
+typedef enum
+{
+#define _(f, b) NAT_HA_FIELD_##f = 1 << b,
+  foreach_nat_ha_event_field
+#undef _
+} nat_ha_event_field_t;
+
+#define NAT_HA_DEL_FIELDS                                           \
+  (NAT_HA_FIELD_protocol | NAT_HA_FIELD_out_addr |                  \
+   NAT_HA_FIELD_out_port | NAT_HA_FIELD_eh_addr |                   \
+   NAT_HA_FIELD_eh_port | NAT_HA_FIELD_fib_index)
+#define NAT_HA_REFRESH_FIELDS                                       \
+  (NAT_HA_DEL_FIELDS | NAT_HA_FIELD_total_pkts | NAT_HA_FIELD_total_bytes)
+#define NAT_HA_ADD_FIELDS                                           \
+  (NAT_HA_DEL_FIELDS | NAT_HA_FIELD_flags | NAT_HA_FIELD_in_addr |  \
+   NAT_HA_FIELD_in_port | NAT_HA_FIELD_ehn_addr | NAT_HA_FIELD_ehn_port)
+
+/* NAT HA protocol compact event header */
+typedef struct
+{
+  /* event type */
+  u8 event_type;
+  /* fields which follow */
+  u16 fields;
+} __attribute__ ((packed)) nat_ha_compact_event_t;
+
 typedef enum
 {
 #define _(N, s, v) NAT_HA_COUNTER_##N = v,
@@ -109,16 +171,25 @@ typedef struct
 /* per thread data */
 typedef struct
 {
-  /* buffer under construction */
-  vlib_buffer_t *state_sync_buffer;
-  /* frame containing NAT HA buffers */
-  vlib_frame_t *state_sync_frame;
-  /* number of events */
-  u16 state_sync_count;
-  /* next event offset */
-  u32 state_sync_next_event_offset;
+  /* events waiting to be sent */
+  nat_ha_event_t *events;
+  /* last waiting event of a session, by session hash */
+  uword *event_by_session;
+  /* upper bound of the encoded size of the waiting events */
+  u32 events_size;
+  /* 1 if some waiting events are part of HA resync */
+  u8 events_is_resync;
+  /* 1 if the waiting events are sent in the compact encoding */
+  u8 events_compact;
   /* data waiting for ACK */
-  nat_ha_resend_entry_t *resend_queue;
+  nat_ha_resend_entry_t *resend_entries;
+  uword *resend_entry_by_seq;
+  /* sequence numbers of data waiting for ACK, in retry time order */
+  u32 *resend_fifo;
+  /* next session pool index to send in HA resync, ~0 if none */
+  u32 resync_next;
+  /* received message spanning several buffers */
+  u8 *recv_data;
 } nat_ha_per_thread_data_t;
 
 /* NAT HA settings */
@@ -134,6 +205,8 @@ typedef struct nat_ha_main_s
   u32 state_sync_path_mtu;
   /* number of seconds after which to send session counters refresh */
   u32 session_refresh_interval;
+  /* 1 if events are sent in the compact encoding */
+  u8 compact;
   /* counters */
   vlib_simple_counter_main_t counters[NAT_HA_N_COUNTERS];
   vlib_main_t *vlib_main;
@@ -141,6 +214,8 @@ typedef struct nat_ha_main_s
   u32 sequence_number;
   /* 1 if resync in progress */
   u8 in_resync;
+  /* number of threads still sending their sessions for resync */
+  u32 resync_threads;
   /* number of remaing ACK for resync */
   u32 resync_ack_count;
   /* number of missed ACK for resync */
@@ -166,68 +241,236 @@ vlib_node_registration_t nat_ha_worker_node;
 vlib_node_registration_t nat_ha_node;
 vlib_node_registration_t nat_ha_handoff_node;
 
+static_always_inline u16
+nat_ha_event_fields (u8 event_type)
+{
+  switch (event_type)
+    {
+    case NAT_HA_ADD:
+      return NAT_HA_ADD_FIELDS;
+    case NAT_HA_DEL:
+      return NAT_HA_DEL_FIELDS;
+    case NAT_HA_REFRESH:
+      return NAT_HA_REFRESH_FIELDS;
+    default:
+      return 0;
+    }
+}
+
+/* encoded size of an event, when no field is left out */
+static_always_inline u32
+nat_ha_event_size_max (u8 event_type, u8 compact)
+{
+  u16 fields = nat_ha_event_fields (event_type);
+  u32 size = sizeof (nat_ha_compact_event_t);
+
+  if (!compact)
+    return sizeof (nat_ha_event_t);
+
+#define _(f, b)                                       \
+  if (fields & NAT_HA_FIELD_##f)                      \
+    size += sizeof (((nat_ha_event_t *) 0)->f);
+  foreach_nat_ha_event_field
+#undef _
+
+  return size;
+}
+
+/* append an event in the compact encoding, ctx holds the last values sent */
+static void
+nat_ha_event_encode_compact (u8 ** msg, nat_ha_event_t * e,
+			     nat_ha_event_t * ctx)
+{
+  nat_ha_compact_event_t *h;
+  u16 fields = 0, valid = nat_ha_event_fields (e->event_type);
+  u32 offset = vec_len (*msg);
+  u8 *p;
+
+  vec_add2 (*msg, p, sizeof (*h));
+
+#define _(f, b)                                       \
+  if ((valid & NAT_HA_FIELD_##f) && e->f != ctx->f)   \
+    {                                                 \
+      vec_add2 (*msg, p, sizeof (e->f));              \
+      clib_memcpy_fast (p, (u8 *) e +                 \
+                        STRUCT_OFFSET_OF (nat_ha_event_t, f), \
+                        sizeof (e->f));               \
+      ctx->f = e->f;                                  \
+      fields |= NAT_HA_FIELD_##f;                     \
+    }
+  foreach_nat_ha_event_field
+#undef _
+
+  h = (nat_ha_compact_event_t *) (*msg + offset);
+  h->event_type = e->event_type;
+  h->fields = clib_host_to_net_u16 (fields);
+}
+
+/* decode a compact event into ctx, return next event or 0 if truncated */
+static_always_inline u8 *
+nat_ha_event_decode_compact (u8 * p, u8 * end, nat_ha_event_t * ctx)
+{
+  nat_ha_compact_event_t *h = (nat_ha_compact_event_t *) p;
+  u16 fields;
+
+  if (p + sizeof (*h) > end)
+    return 0;
+
+  fields = clib_net_to_host_u16 (h->fields);
+  p += sizeof (*h);
+
+#define _(f, b)                                       \
+  if (fields & NAT_HA_FIELD_##f)                      \
+    {                                                 \
+      if (p + sizeof (ctx->f) > end)                  \
+        return 0;                                     \
+      clib_memcpy_fast ((u8 *) ctx +                  \
+                        STRUCT_OFFSET_OF (nat_ha_event_t, f), \
+                        p, sizeof (ctx->f));          \
+      p += sizeof (ctx->f);                           \
+    }
+  foreach_nat_ha_event_field
+#undef _
+
+  ctx->event_type = h->event_type;
+
+  return p;
+}
+
+static_always_inline u64
+nat_ha_event_session_hash (nat_ha_event_t * e)
+{
+  u64 a, b;
+
+  a = (u64) e->out_addr << 32 | e->eh_addr;
+  b = (u64) e->fib_index << 32 | (u32) e->out_port << 16 | e->eh_port;
+
+  return clib_xxhash (a ^ clib_xxhash (b + e->protocol));
+}
+
+static_always_inline int
+nat_ha_event_same_session (nat_ha_event_t * a, nat_ha_event_t * b)
+{
+  return a->out_addr == b->out_addr && a->out_port == b->out_port &&
+    a->eh_addr == b->eh_addr && a->eh_port == b->eh_port &&
+    a->protocol == b->protocol && a->fib_index == b->fib_index;
+}
+
 static void
 nat_ha_resync_fin (void)
 {
   nat_ha_main_t *ha = &nat_ha_main;
 
-  /* if no more resync ACK remainig we are done */
-  if (ha->resync_ack_count)
+  /* if threads are still sending or ACK remainig we are not done */
+  if (ha->resync_threads || ha->resync_ack_count)
+    return;
+
+  /* ACK and the last thread may get here together */
+  if (!clib_atomic_bool_cmp_and_swap (&ha->in_resync, 1, 0))
     return;
 
-  ha->in_resync = 0;
   nat_log_info ("resync completed with result %s",
 		ha->resync_ack_missed ? "FAILED" : "SUCESS");
   if (ha->event_callback)
     ha->event_callback (ha->client_index, ha->pid, ha->resync_ack_missed);
 }
 
-/* cache HA NAT data waiting for ACK */
+/* cache HA NAT data waiting for ACK, data is owned by the cache */
 static int
-nat_ha_resend_queue_add (u32 seq, u8 * data, u8 data_len, u8 is_resync,
-			 u32 thread_index)
+nat_ha_resend_queue_add (u32 seq, u8 * data, u8 is_resync, u32 thread_index)
 {
   nat_ha_main_t *ha = &nat_ha_main;
   nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
   nat_ha_resend_entry_t *entry;
-  f64 now = vlib_time_now (ha->vlib_main);
+  f64 now = vlib_time_now (vlib_mains[thread_index]);
 
-  vec_add2 (td->resend_queue, entry, 1);
+  pool_get (td->resend_entries, entry);
   clib_memset (entry, 0, sizeof (*entry));
-  entry->retry_timer = now + 2.0;
+  entry->retry_timer = now + NAT_HA_RETRY_INTERVAL;
   entry->seq = seq;
   entry->is_resync = is_resync;
-  vec_add (entry->data, data, data_len);
+  entry->data = data;
+
+  hash_set (td->resend_entry_by_seq, seq, entry - td->resend_entries);
+  clib_fifo_add1 (td->resend_fifo, seq);
 
   return 0;
 }
 
+static void
+nat_ha_resend_entry_free (nat_ha_per_thread_data_t * td,
+			  nat_ha_resend_entry_t * entry)
+{
+  hash_unset (td->resend_entry_by_seq, entry->seq);
+  vec_free (entry->data);
+  pool_put (td->resend_entries, entry);
+}
+
 static_always_inline void
 nat_ha_ack_recv (u32 seq, u32 thread_index)
 {
   nat_ha_main_t *ha = &nat_ha_main;
   nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
-  u32 i;
+  nat_ha_resend_entry_t *entry;
+  uword *p;
 
-  vec_foreach_index (i, td->resend_queue)
-  {
-    if (td->resend_queue[i].seq != seq)
-      continue;
+  p = hash_get (td->resend_entry_by_seq, seq);
+  if (!p)
+    return;
 
-    vlib_increment_simple_counter (&ha->counters[NAT_HA_COUNTER_RECV_ACK],
-				   thread_index, 0, 1);
-    /* ACK received remove cached data */
-    if (td->resend_queue[i].is_resync)
-      {
-	clib_atomic_fetch_sub (&ha->resync_ack_count, 1);
-	nat_ha_resync_fin ();
-      }
-    vec_free (td->resend_queue[i].data);
-    vec_del1 (td->resend_queue, i);
-    nat_log_debug ("ACK for seq %d received", clib_net_to_host_u32 (seq));
+  entry = pool_elt_at_index (td->resend_entries, p[0]);
+  vlib_increment_simple_counter (&ha->counters[NAT_HA_COUNTER_RECV_ACK],
+				 thread_index, 0, 1);
+  /* ACK received remove cached data */
+  if (entry->is_resync)
+    {
+      clib_atomic_fetch_sub (&ha->resync_ack_count, 1);
+      nat_ha_resync_fin ();
+    }
+  nat_ha_resend_entry_free (td, entry);
+  nat_log_debug ("ACK for seq %d received", clib_net_to_host_u32 (seq));
+}
 
-    return;
-  }
+/* send a message, in chained buffers if it does not fit one */
+static int
+nat_ha_message_send (vlib_main_t * vm, u8 * data)
+{
+  vlib_buffer_t *b;
+  vlib_frame_t *f;
+  u32 bi, *to_next;
+
+  if (vlib_buffer_alloc (vm, &bi, 1) != 1)
+    {
+      nat_log_warn ("HA NAT state sync can't allocate buffer");
+      return 1;
+    }
+
+  b = vlib_get_buffer (vm, bi);
+  b->current_data = 0;
+  b->current_length = 0;
+  clib_memset (vnet_buffer (b), 0, sizeof (*vnet_buffer (b)));
+  VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b);
+
+  if (vlib_buffer_add_data (vm, &bi, data, vec_len (data)))
+    {
+      nat_log_warn ("HA NAT state sync can't allocate buffer");
+      vlib_buffer_free_one (vm, bi);
+      return 1;
+    }
+
+  b->flags |= VNET_BUFFER_F_LOCALLY_ORIGINATED;
+  vnet_buffer (b)->sw_if_index[VLIB_RX] = 0;
+  vnet_buffer (b)->sw_if_index[VLIB_TX] = 0;
+  /* sets VLIB_BUFFER_TOTAL_LENGTH_VALID */
+  vlib_buffer_length_in_chain (vm, b);
+
+  f = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
+  to_next = vlib_frame_vector_args (f);
+  to_next[0] = bi;
+  f->n_vectors = 1;
+  vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
+
+  return 0;
 }
 
 /* scan non-ACKed HA NAT for retry */
@@ -236,70 +479,57 @@ nat_ha_resend_scan (f64 now, u32 thread_index)
 {
   nat_ha_main_t *ha = &nat_ha_main;
   nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
-  u32 i, *del, *to_delete = 0;
-  vlib_main_t *vm = ha->vlib_main;
-  vlib_buffer_t *b = 0;
-  vlib_frame_t *f;
-  u32 bi, *to_next;
-  ip4_header_t *ip;
+  vlib_main_t *vm = vlib_mains[thread_index];
+  nat_ha_resend_entry_t *entry;
+  uword *p;
+  u32 seq;
 
-  vec_foreach_index (i, td->resend_queue)
-  {
-    if (td->resend_queue[i].retry_timer > now)
-      continue;
+  /* every retry is scheduled the same interval ahead, so the fifo is in
+     retry time order and only the due entries are looked at */
+  while (clib_fifo_elts (td->resend_fifo))
+    {
+      seq = *clib_fifo_head (td->resend_fifo);
+      p = hash_get (td->resend_entry_by_seq, seq);
+      if (!p)
+	{
+	  /* ACKed */
+	  clib_fifo_sub1 (td->resend_fifo, seq);
+	  continue;
+	}
 
-    /* maximum retry reached delete cached data */
-    if (td->resend_queue[i].retry_count >= NAT_HA_RETRIES)
-      {
-	nat_log_notice ("seq %d missed",
-			clib_net_to_host_u32 (td->resend_queue[i].seq));
-	if (td->resend_queue[i].is_resync)
-	  {
-	    clib_atomic_fetch_add (&ha->resync_ack_missed, 1);
-	    clib_atomic_fetch_sub (&ha->resync_ack_count, 1);
-	    nat_ha_resync_fin ();
-	  }
-	vec_add1 (to_delete, i);
-	vlib_increment_simple_counter (&ha->counters
-				       [NAT_HA_COUNTER_MISSED_COUNT],
-				       thread_index, 0, 1);
-	continue;
-      }
+      entry = pool_elt_at_index (td->resend_entries, p[0]);
+      if (entry->retry_timer > now)
+	break;
 
-    /* retry to send non-ACKed data */
-    nat_log_debug ("state sync seq %d resend",
-		   clib_net_to_host_u32 (td->resend_queue[i].seq));
-    td->resend_queue[i].retry_count++;
-    vlib_increment_simple_counter (&ha->counters[NAT_HA_COUNTER_RETRY_COUNT],
-				   thread_index, 0, 1);
-    if (vlib_buffer_alloc (vm, &bi, 1) != 1)
-      {
-	nat_log_warn ("HA NAT state sync can't allocate buffer");
-	return;
-      }
-    b = vlib_get_buffer (vm, bi);
-    b->current_length = vec_len (td->resend_queue[i].data);
-    b->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
-    b->flags |= VNET_BUFFER_F_LOCALLY_ORIGINATED;
-    vnet_buffer (b)->sw_if_index[VLIB_RX] = 0;
-    vnet_buffer (b)->sw_if_index[VLIB_TX] = 0;
-    ip = vlib_buffer_get_current (b);
-    clib_memcpy (ip, td->resend_queue[i].data,
-		 vec_len (td->resend_queue[i].data));
-    f = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
-    to_next = vlib_frame_vector_args (f);
-    to_next[0] = bi;
-    f->n_vectors = 1;
-    vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
-    td->resend_queue[i].retry_timer = now + 2.0;
-  }
+      clib_fifo_sub1 (td->resend_fifo, seq);
 
-  vec_foreach (del, to_delete)
-  {
-    vec_free (td->resend_queue[*del].data);
-    vec_del1 (td->resend_queue, *del);
-  }
-  vec_free (to_delete);
+      /* maximum retry reached delete cached data */
+      if (entry->retry_count >= NAT_HA_RETRIES)
+	{
+	  nat_log_notice ("seq %d missed", clib_net_to_host_u32 (seq));
+	  if (entry->is_resync)
+	    {
+	      clib_atomic_fetch_add (&ha->resync_ack_missed, 1);
+	      clib_atomic_fetch_sub (&ha->resync_ack_count, 1);
+	      nat_ha_resync_fin ();
+	    }
+	  nat_ha_resend_entry_free (td, entry);
+	  vlib_increment_simple_counter (&ha->counters
+					 [NAT_HA_COUNTER_MISSED_COUNT],
+					 thread_index, 0, 1);
+	  continue;
+	}
+
+      /* retry to send non-ACKed data */
+      nat_log_debug ("state sync seq %d resend", clib_net_to_host_u32 (seq));
+      entry->retry_count++;
+      vlib_increment_simple_counter (&ha->counters
+				     [NAT_HA_COUNTER_RETRY_COUNT],
+				     thread_index, 0, 1);
+      nat_ha_message_send (vm, entry->data);
+      entry->retry_timer = now + NAT_HA_RETRY_INTERVAL;
+      clib_fifo_add1 (td->resend_fifo, seq);
+    }
 }
 
 void
@@ -309,13 +539,16 @@ nat_ha_init (vlib_main_t * vm, nat_ha_sadd_cb_t sadd_cb,
   nat_ha_main_t *ha = &nat_ha_main;
   vlib_thread_main_t *tm = vlib_get_thread_main ();
   vlib_thread_registration_t *tr;
+  nat_ha_per_thread_data_t *td;
   uword *p;
 
   ha->src_ip_address.as_u32 = 0;
   ha->src_port = 0;
   ha->dst_ip_address.as_u32 = 0;
   ha->dst_port = 0;
+  ha->compact = 0;
   ha->in_resync = 0;
+  ha->resync_threads = 0;
   ha->resync_ack_count = 0;
   ha->resync_ack_missed = 0;
   ha->vlib_main = vm;
@@ -324,6 +557,7 @@ nat_ha_init (vlib_main_t * vm, nat_ha_sadd_cb_t sadd_cb,
   ha->sref_cb = sref_cb;
   ha->num_workers = 0;
   vec_validate (ha->per_thread_data, tm->n_vlib_mains - 1);
+  vec_foreach (td, ha->per_thread_data) td->resync_next = ~0;
   ha->fq_index = ~0;
   p = hash_get_mem (tm->thread_registrations_by_name, "workers");
   if (p)
@@ -386,13 +620,14 @@ nat_ha_get_listener (ip4_address_t * addr, u16 * port, u32 * path_mtu)
 
 int
 nat_ha_set_failover (ip4_address_t * addr, u16 port,
-		     u32 session_refresh_interval)
+		     u32 session_refresh_interval, u8 compact)
 {
   nat_ha_main_t *ha = &nat_ha_main;
 
   ha->dst_ip_address.as_u32 = addr->as_u32;
   ha->dst_port = port;
   ha->session_refresh_interval = session_refresh_interval;
+  ha->compact = compact;
 
   vlib_process_signal_event (ha->vlib_main, nat_ha_process_node.index, 1, 0);
 
@@ -401,13 +636,14 @@ nat_ha_set_failover (ip4_address_t * addr, u16 port,
 
 void
 nat_ha_get_failover (ip4_address_t * addr, u16 * port,
-		     u32 * session_refresh_interval)
+		     u32 * session_refresh_interval, u8 * compact)
 {
   nat_ha_main_t *ha = &nat_ha_main;
 
   addr->as_u32 = ha->dst_ip_address.as_u32;
   *port = ha->dst_port;
   *session_refresh_interval = ha->session_refresh_interval;
+  *compact = ha->compact;
 }
 
 static_always_inline void
@@ -494,8 +730,41 @@ nat_ha_event_process (nat_ha_event_t * event, f64 now, u32 thread_index)
     }
 }
 
-static inline void
-nat_ha_header_create (vlib_buffer_t * b, u32 * offset, u32 thread_index)
+/* process the events of a received message, up to its end */
+static_always_inline void
+nat_ha_message_process (u8 version, u8 * data, u8 * end, u16 count, f64 now,
+			u32 thread_index)
+{
+  nat_ha_event_t ctx;
+
+  clib_memset (&ctx, 0, sizeof (ctx));
+
+  while (count)
+    {
+      if (version == NAT_HA_VERSION_COMPACT)
+	{
+	  data = nat_ha_event_decode_compact (data, end, &ctx);
+	  if (!data)
+	    break;
+	  nat_ha_event_process (&ctx, now, thread_index);
+	}
+      else
+	{
+	  if (data + sizeof (nat_ha_event_t) > end)
+	    break;
+	  nat_ha_event_process ((nat_ha_event_t *) data, now, thread_index);
+	  data += sizeof (nat_ha_event_t);
+	}
+      count--;
+    }
+
+  if (count)
+    nat_log_notice ("HA message truncated, %d events lost", count);
+}
+
+/* fill in IP, UDP and NAT HA headers at the start of a message */
+static inline u32
+nat_ha_header_create (u8 * msg, u16 count, u8 compact, u32 thread_index)
 {
   nat_ha_main_t *ha = &nat_ha_main;
   nat_ha_message_header_t *h;
@@ -503,17 +772,12 @@ nat_ha_header_create (vlib_buffer_t * b, u32 * offset, u32 thread_index)
   udp_header_t *udp;
   u32 sequence_number;
 
-  b->current_data = 0;
-  b->current_length = sizeof (*ip) + sizeof (*udp) + sizeof (*h);
-  b->flags |= VLIB_BUFFER_TOTAL_LENGTH_VALID;
-  b->flags |= VNET_BUFFER_F_LOCALLY_ORIGINATED;
-  vnet_buffer (b)->sw_if_index[VLIB_RX] = 0;
-  vnet_buffer (b)->sw_if_index[VLIB_TX] = 0;
-  ip = vlib_buffer_get_current (b);
+  ip = (ip4_header_t *) msg;
   udp = (udp_header_t *) (ip + 1);
   h = (nat_ha_message_header_t *) (udp + 1);
 
   /* IP header */
+  clib_memset (ip, 0, sizeof (*ip));
   ip->ip_version_and_header_length = 0x45;
   ip->ttl = 254;
   ip->protocol = IP_PROTOCOL_UDP;
@@ -521,146 +785,173 @@ nat_ha_header_create (vlib_buffer_t * b, u32 * offset, u32 thread_index)
     clib_host_to_net_u16 (IP4_HEADER_FLAG_DONT_FRAGMENT);
   ip->src_address.as_u32 = ha->src_ip_address.as_u32;
   ip->dst_address.as_u32 = ha->dst_ip_address.as_u32;
+  ip->length = clib_host_to_net_u16 (vec_len (msg));
+  ip->checksum = ip4_header_checksum (ip);
   /* UDP header */
   udp->src_port = clib_host_to_net_u16 (ha->src_port);
   udp->dst_port = clib_host_to_net_u16 (ha->dst_port);
+  udp->length = clib_host_to_net_u16 (vec_len (msg) - sizeof (*ip));
   udp->checksum = 0;
 
   /* NAT HA protocol header */
-  h->version = NAT_HA_VERSION;
+  h->version = compact ? NAT_HA_VERSION_COMPACT : NAT_HA_VERSION;
   h->flags = 0;
-  h->count = 0;
+  h->count = clib_host_to_net_u16 (count);
   h->thread_index = clib_host_to_net_u32 (thread_index);
   sequence_number = clib_atomic_fetch_add (&ha->sequence_number, 1);
   h->sequence_number = clib_host_to_net_u32 (sequence_number);
 
-  *offset =
-    sizeof (ip4_header_t) + sizeof (udp_header_t) +
-    sizeof (nat_ha_message_header_t);
+  return h->sequence_number;
 }
 
-static inline void
-nat_ha_send (vlib_frame_t * f, vlib_buffer_t * b, u8 is_resync,
-	     u32 thread_index)
+#define NAT_HA_HEADERS_SIZE                             \
+  (sizeof (ip4_header_t) + sizeof (udp_header_t) +      \
+   sizeof (nat_ha_message_header_t))
+
+/* encode and send the events waiting on a thread */
+static void
+nat_ha_events_send (u32 thread_index)
 {
   nat_ha_main_t *ha = &nat_ha_main;
   nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
-  nat_ha_message_header_t *h;
-  ip4_header_t *ip;
-  udp_header_t *udp;
   vlib_main_t *vm = vlib_mains[thread_index];
+  nat_ha_event_t *e, ctx;
+  u8 *msg = 0, *p;
+  u32 seq;
+  u16 count = 0;
 
-  ip = vlib_buffer_get_current (b);
-  udp = ip4_next_header (ip);
-  h = (nat_ha_message_header_t *) (udp + 1);
+  if (!vec_len (td->events))
+    goto done;
 
-  h->count = clib_host_to_net_u16 (td->state_sync_count);
+  vec_validate (msg, NAT_HA_HEADERS_SIZE + td->events_size - 1);
+  _vec_len (msg) = NAT_HA_HEADERS_SIZE;
+  clib_memset (&ctx, 0, sizeof (ctx));
 
-  ip->length = clib_host_to_net_u16 (b->current_length);
-  ip->checksum = ip4_header_checksum (ip);
-  udp->length = clib_host_to_net_u16 (b->current_length - sizeof (*ip));
+  vec_foreach (e, td->events)
+  {
+    /* coalesced with a later event */
+    if (!e->event_type)
+      continue;
 
-  nat_ha_resend_queue_add (h->sequence_number, (u8 *) ip, b->current_length,
-			   is_resync, thread_index);
+    if (td->events_compact)
+      nat_ha_event_encode_compact (&msg, e, &ctx);
+    else
+      {
+	vec_add2 (msg, p, sizeof (*e));
+	clib_memcpy_fast (p, e, sizeof (*e));
+      }
+    count++;
 
-  vlib_put_frame_to_node (vm, ip4_lookup_node.index, f);
+    switch (e->event_type)
+      {
+      case NAT_HA_ADD:
+	vlib_increment_simple_counter (&ha->counters
+				       [NAT_HA_COUNTER_SEND_ADD],
+				       thread_index, 0, 1);
+	break;
+      case NAT_HA_DEL:
+	vlib_increment_simple_counter (&ha->counters
+				       [NAT_HA_COUNTER_SEND_DEL],
+				       thread_index, 0, 1);
+	break;
+      case NAT_HA_REFRESH:
+	vlib_increment_simple_counter (&ha->counters
+				       [NAT_HA_COUNTER_SEND_REFRESH],
+				       thread_index, 0, 1);
+	break;
+      default:
+	break;
+      }
+  }
+
+  if (!count)
+    {
+      vec_free (msg);
+      goto done;
+    }
+
+  seq = nat_ha_header_create (msg, count, td->events_compact, thread_index);
+  nat_ha_message_send (vm, msg);
+  nat_ha_resend_queue_add (seq, msg, td->events_is_resync, thread_index);
+  if (td->events_is_resync)
+    clib_atomic_fetch_add (&ha->resync_ack_count, 1);
+
+done:
+  vec_reset_length (td->events);
+  hash_free (td->event_by_session);
+  td->events_size = 0;
+  td->events_is_resync = 0;
 }
 
-/* add NAT HA protocol event */
+/*
+ * Add NAT HA protocol event. Events wait on their thread until the
+ * message is full or flushed; until then a refresh replaces an older
+ * refresh of the same session, and a delete cancels the add of a session
+ * the failover has not heard of yet.
+ */
 static_always_inline void
-nat_ha_event_add (nat_ha_event_t * event, u8 do_flush, u32 thread_index,
-		  u8 is_resync)
+nat_ha_event_add (nat_ha_event_t * event, u32 thread_index, u8 is_resync)
 {
   nat_ha_main_t *ha = &nat_ha_main;
   nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
-  vlib_main_t *vm = vlib_mains[thread_index];
-  vlib_buffer_t *b = 0;
-  vlib_frame_t *f;
-  u32 bi = ~0, offset;
-
-  b = td->state_sync_buffer;
-
-  if (PREDICT_FALSE (b == 0))
-    {
-      if (do_flush)
-	return;
+  nat_ha_event_t *prev = 0;
+  u64 key;
+  uword *p;
 
-      if (vlib_buffer_alloc (vm, &bi, 1) != 1)
-	{
-	  nat_log_warn ("HA NAT state sync can't allocate buffer");
-	  return;
-	}
+  /* the encoding is chosen per message */
+  if (!vec_len (td->events))
+    td->events_compact = ha->compact;
 
-      b = td->state_sync_buffer = vlib_get_buffer (vm, bi);
-      clib_memset (vnet_buffer (b), 0, sizeof (*vnet_buffer (b)));
-      VLIB_BUFFER_TRACE_TRAJECTORY_INIT (b);
-      offset = 0;
-    }
-  else
+  key = nat_ha_event_session_hash (event);
+  p = hash_get (td->event_by_session, key);
+  if (p)
     {
-      bi = vlib_get_buffer_index (vm, b);
-      offset = td->state_sync_next_event_offset;
+      prev = vec_elt_at_index (td->events, p[0]);
+      if (!nat_ha_event_same_session (prev, event))
+	prev = 0;
     }
 
-  f = td->state_sync_frame;
-  if (PREDICT_FALSE (f == 0))
+  if (prev && event->event_type == NAT_HA_REFRESH &&
+      prev->event_type == NAT_HA_REFRESH)
     {
-      u32 *to_next;
-      f = vlib_get_frame_to_node (vm, ip4_lookup_node.index);
-      td->state_sync_frame = f;
-      to_next = vlib_frame_vector_args (f);
-      to_next[0] = bi;
-      f->n_vectors = 1;
+      prev->total_pkts = event->total_pkts;
+      prev->total_bytes = event->total_bytes;
+      vlib_increment_simple_counter (&ha->counters[NAT_HA_COUNTER_COALESCED],
+				     thread_index, 0, 1);
+      return;
     }
 
-  if (PREDICT_FALSE (td->state_sync_count == 0))
-    nat_ha_header_create (b, &offset, thread_index);
-
-  if (PREDICT_TRUE (do_flush == 0))
+  if (prev && event->event_type == NAT_HA_DEL &&
+      (prev->event_type == NAT_HA_ADD || prev->event_type == NAT_HA_REFRESH))
     {
-      clib_memcpy_fast (b->data + offset, event, sizeof (*event));
-      offset += sizeof (*event);
-      td->state_sync_count++;
-      b->current_length += sizeof (*event);
-
-      switch (event->event_type)
+      td->events_size -= nat_ha_event_size_max (prev->event_type,
+						td->events_compact);
+      vlib_increment_simple_counter (&ha->counters[NAT_HA_COUNTER_COALESCED],
+				     thread_index, 0, 1);
+      if (prev->event_type == NAT_HA_ADD)
 	{
-	case NAT_HA_ADD:
+	  /* neither event needs to be sent */
+	  prev->event_type = 0;
+	  hash_unset (td->event_by_session, key);
 	  vlib_increment_simple_counter (&ha->counters
-					 [NAT_HA_COUNTER_SEND_ADD],
+					 [NAT_HA_COUNTER_COALESCED],
 					 thread_index, 0, 1);
-	  break;
-	case NAT_HA_DEL:
-	  vlib_increment_simple_counter (&ha->counters
-					 [NAT_HA_COUNTER_SEND_DEL],
-					 thread_index, 0, 1);
-	  break;
-	case NAT_HA_REFRESH:
-	  vlib_increment_simple_counter (&ha->counters
-					 [NAT_HA_COUNTER_SEND_REFRESH],
-					 thread_index, 0, 1);
-	  break;
-	default:
-	  break;
-	}
-    }
-
-  if (PREDICT_FALSE
-      (do_flush || offset + (sizeof (*event)) > ha->state_sync_path_mtu))
-    {
-      nat_ha_send (f, b, is_resync, thread_index);
-      td->state_sync_buffer = 0;
-      td->state_sync_frame = 0;
-      td->state_sync_count = 0;
-      offset = 0;
-      if (is_resync)
-	{
-	  clib_atomic_fetch_add (&ha->resync_ack_count, 1);
-	  nat_ha_resync_fin ();
+	  return;
 	}
+      prev->event_type = 0;
     }
 
-  td->state_sync_next_event_offset = offset;
+  hash_set (td->event_by_session, key, vec_len (td->events));
+  vec_add1 (td->events, *event);
+  td->events_size += nat_ha_event_size_max (event->event_type,
+					    td->events_compact);
+  td->events_is_resync |= is_resync;
+
+  /* add events are the largest */
+  if (PREDICT_FALSE (NAT_HA_HEADERS_SIZE + td->events_size +
+		     nat_ha_event_size_max (NAT_HA_ADD, td->events_compact) >
+		     ha->state_sync_path_mtu))
+    nat_ha_events_send (thread_index);
 }
 
 #define skip_if_disabled()          \
@@ -673,8 +964,12 @@ do {                                \
 void
 nat_ha_flush (u8 is_resync)
 {
+  nat_ha_main_t *ha = &nat_ha_main;
+
   skip_if_disabled ();
-  nat_ha_event_add (0, 1, 0, is_resync);
+  if (vec_len (ha->per_thread_data[0].events))
+    ha->per_thread_data[0].events_is_resync |= is_resync;
+  nat_ha_events_send (0);
 }
 
 void
@@ -700,7 +995,7 @@ nat_ha_sadd (ip4_address_t * in_addr, u16 in_port, ip4_address_t * out_addr,
   event.ehn_port = ehn_port;
   event.fib_index = clib_host_to_net_u32 (fib_index);
   event.protocol = proto;
-  nat_ha_event_add (&event, 0, thread_index, is_resync);
+  nat_ha_event_add (&event, thread_index, is_resync);
 }
 
 void
@@ -719,7 +1014,7 @@ nat_ha_sdel (ip4_address_t * out_addr, u16 out_port, ip4_address_t * eh_addr,
   event.eh_port = eh_port;
   event.fib_index = clib_host_to_net_u32 (fib_index);
   event.protocol = proto;
-  nat_ha_event_add (&event, 0, thread_index, 0);
+  nat_ha_event_add (&event, thread_index, 0);
 }
 
 void
@@ -746,7 +1041,53 @@ nat_ha_sref (ip4_address_t * out_addr, u16 out_port, ip4_address_t * eh_addr,
   event.protocol = proto;
   event.total_pkts = clib_host_to_net_u32 (total_pkts);
   event.total_bytes = clib_host_to_net_u64 (total_bytes);
-  nat_ha_event_add (&event, 0, thread_index, 0);
+  nat_ha_event_add (&event, thread_index, 0);
+}
+
+/*
+ * Send the next batch of this thread's sessions for resync. The session
+ * pool is walked by the thread owning it while it keeps forwarding, and
+ * changes to sessions keep being sent as they happen, so the failover sees
+ * a snapshot followed by the log of later changes.
+ */
+static void
+nat_ha_resync_walk (u32 thread_index)
+{
+  nat_ha_main_t *ha = &nat_ha_main;
+  nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
+  snat_main_t *sm = &snat_main;
+  snat_main_per_thread_data_t *tsm;
+  snat_session_t *ses;
+  u32 i, n;
+
+  if (thread_index < vec_len (sm->per_thread_data))
+    {
+      tsm = vec_elt_at_index (sm->per_thread_data, thread_index);
+      for (i = td->resync_next, n = 0;
+	   i < vec_len (tsm->sessions) && n < NAT_HA_RESYNC_BATCH; i++, n++)
+	{
+	  if (pool_is_free_index (tsm->sessions, i))
+	    continue;
+
+	  ses = pool_elt_at_index (tsm->sessions, i);
+	  nat_ha_sadd (&ses->in2out.addr, ses->in2out.port,
+		       &ses->out2in.addr, ses->out2in.port,
+		       &ses->ext_host_addr, ses->ext_host_port,
+		       &ses->ext_host_nat_addr, ses->ext_host_nat_port,
+		       ses->in2out.protocol, ses->in2out.fib_index,
+		       ses->flags, thread_index, 1);
+	}
+
+      td->resync_next = i;
+      if (i < vec_len (tsm->sessions))
+	return;
+    }
+
+  td->resync_next = ~0;
+  if (ha->dst_port)
+    nat_ha_events_send (thread_index);
+  clib_atomic_fetch_sub (&ha->resync_threads, 1);
+  nat_ha_resync_fin ();
 }
 
 /* per thread process waiting for interrupt */
@@ -754,9 +1095,16 @@ static uword
 nat_ha_worker_fn (vlib_main_t * vm, vlib_node_runtime_t * rt,
 		  vlib_frame_t * f)
 {
+  nat_ha_main_t *ha = &nat_ha_main;
   u32 thread_index = vm->thread_index;
+  nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
+
+  /* send the next sessions for resync */
+  if (PREDICT_FALSE (td->resync_next != ~0))
+    nat_ha_resync_walk (thread_index);
   /* flush HA NAT data under construction */
-  nat_ha_event_add (0, 1, thread_index, 0);
+  if (ha->dst_port)
+    nat_ha_events_send (thread_index);
   /* scan if we need to resend some non-ACKed data */
   nat_ha_resend_scan (vlib_time_now (vm), thread_index);
   return 0;
@@ -771,7 +1119,7 @@ VLIB_REGISTER_NODE (nat_ha_worker_node) = {
 };
 /* *INDENT-ON* */
 
-/* periodically send interrupt to each thread */
+/* periodically send interrupt to each thread, more often during resync */
 static uword
 nat_ha_process (vlib_main_t * vm, vlib_node_runtime_t * rt, vlib_frame_t * f)
 {
@@ -782,13 +1130,14 @@ nat_ha_process (vlib_main_t * vm, vlib_node_runtime_t * rt, vlib_frame_t * f)
 
   vlib_process_wait_for_event (vm);
   event_type = vlib_process_get_events (vm, &event_data);
-  if (event_type)
+  if (event_type != 1)
     nat_log_info ("nat-ha-process: bogus kickoff event received");
   vec_reset_length (event_data);
 
   while (1)
     {
-      vlib_process_wait_for_event_or_clock (vm, 1.0);
+      vlib_process_wait_for_event_or_clock (vm, ha->in_resync ?
+					    NAT_HA_RESYNC_INTERVAL : 1.0);
       event_type = vlib_process_get_events (vm, &event_data);
       vec_reset_length (event_data);
       for (ti = 0; ti < vec_len (vlib_mains); ti++)
@@ -822,39 +1171,27 @@ nat_ha_get_resync_status (u8 * in_resync, u32 * resync_ack_missed)
 }
 
 int
-nat44_ha_resync (u32 client_index, u32 pid,
-		 nat_ha_resync_event_cb_t event_callback)
+nat_ha_resync (u32 client_index, u32 pid,
+	       nat_ha_resync_event_cb_t event_callback)
 {
   nat_ha_main_t *ha = &nat_ha_main;
-  snat_main_t *sm = &snat_main;
-  snat_session_t *ses;
-  snat_main_per_thread_data_t *tsm;
+  nat_ha_per_thread_data_t *td;
 
   if (ha->in_resync)
     return VNET_API_ERROR_IN_PROGRESS;
 
-  ha->in_resync = 1;
   ha->resync_ack_count = 0;
   ha->resync_ack_missed = 0;
   ha->event_callback = event_callback;
   ha->client_index = client_index;
   ha->pid = pid;
 
-  /* *INDENT-OFF* */
-  vec_foreach (tsm, sm->per_thread_data)
-    {
-      pool_foreach (ses, tsm->sessions, ({
-        nat_ha_sadd (&ses->in2out.addr, ses->in2out.port,
-                     &ses->out2in.addr, ses->out2in.port,
-                     &ses->ext_host_addr, ses->ext_host_port,
-                     &ses->ext_host_nat_addr, ses->ext_host_nat_port,
-                     ses->in2out.protocol, ses->in2out.fib_index,
-                     ses->flags, 0, 1);
-      }));
-    }
-  /* *INDENT-ON* */
+  /* each thread sends its own sessions, see nat_ha_resync_walk */
+  ha->resync_threads = vec_len (ha->per_thread_data);
+  vec_foreach (td, ha->per_thread_data) td->resync_next = 0;
+  ha->in_resync = 1;
 
-  nat_ha_flush (1);
+  vlib_process_signal_event (ha->vlib_main, nat_ha_process_node.index, 1, 0);
 
   return 0;
 }
@@ -916,6 +1253,7 @@ nat_ha_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
   ip4_main_t *i4m = &ip4_main;
   u8 host_config_ttl = i4m->host_config.ttl;
   nat_ha_main_t *ha = &nat_ha_main;
+  nat_ha_per_thread_data_t *td = &ha->per_thread_data[thread_index];
 
   from = vlib_frame_vector_args (frame);
   n_left_from = frame->n_vectors;
@@ -932,7 +1270,7 @@ nat_ha_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 	  u32 bi0, next0, src_addr0, dst_addr0;;
 	  vlib_buffer_t *b0;
 	  nat_ha_message_header_t *h0;
-	  nat_ha_event_t *e0;
+	  u8 *data0, *end0;
 	  u16 event_count0, src_port0, dst_port0, old_len0;
 	  ip4_header_t *ip0;
 	  udp_header_t *udp0;
@@ -947,6 +1285,18 @@ nat_ha_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 
 	  b0 = vlib_get_buffer (vm, bi0);
 	  h0 = vlib_buffer_get_current (b0);
+	  data0 = (u8 *) (h0 + 1);
+	  end0 = (u8 *) h0 + b0->current_length;
+	  /* a jumbo message may not fit a single buffer */
+	  if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_NEXT_PRESENT))
+	    {
+	      vec_reset_length (td->recv_data);
+	      vec_validate (td->recv_data,
+			    vlib_buffer_length_in_chain (vm, b0) - 1);
+	      vlib_buffer_contents (vm, bi0, td->recv_data);
+	      data0 = td->recv_data + sizeof (*h0);
+	      end0 = vec_end (td->recv_data);
+	    }
 	  vlib_buffer_advance (b0, -sizeof (*udp0));
 	  udp0 = vlib_buffer_get_current (b0);
 	  vlib_buffer_advance (b0, -sizeof (*ip0));
@@ -954,7 +1304,8 @@ nat_ha_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 
 	  next0 = NAT_HA_NEXT_DROP;
 
-	  if (h0->version != NAT_HA_VERSION)
+	  if (h0->version != NAT_HA_VERSION &&
+	      h0->version != NAT_HA_VERSION_COMPACT)
 	    {
 	      b0->error = node->errors[NAT_HA_ERROR_BAD_VERSION];
 	      goto done0;
@@ -969,21 +1320,21 @@ nat_ha_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
 	      goto done0;
 	    }
 
-	  e0 = (nat_ha_event_t *) (h0 + 1);
-
 	  /* process each event */
-	  while (event_count0)
-	    {
-	      nat_ha_event_process (e0, now, thread_index);
-	      event_count0--;
-	      e0 = (nat_ha_event_t *) ((u8 *) e0 + sizeof (nat_ha_event_t));
-	    }
+	  nat_ha_message_process (h0->version, data0, end0, event_count0, now,
+				  thread_index);
 
 	  next0 = NAT_HA_NEXT_IP4_LOOKUP;
 	  pkts_processed++;
 
 	  /* reply with ACK */
 	  b0->current_length = sizeof (*ip0) + sizeof (*udp0) + sizeof (*h0);
+	  if (PREDICT_FALSE (b0->flags & VLIB_BUFFER_NEXT_PRESENT))
+	    {
+	      vlib_buffer_free_one (vm, b0->next_buffer);
+	      b0->flags &= ~(VLIB_BUFFER_NEXT_PRESENT |
+			     VLIB_BUFFER_TOTAL_LENGTH_VALID);
+	    }
 
 	  src_addr0 = ip0->src_address.data_u32;
 	  dst_addr0 = ip0->dst_address.data_u32;
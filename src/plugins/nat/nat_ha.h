@@ -67,17 +67,18 @@ void nat_ha_get_listener (ip4_address_t * addr, u16 * port, u32 * path_mtu);
  * @param port failvoer UDP port number
  * @param session_refresh_interval number of seconds after which to send
  *                                 session counters refresh
+ * @param compact 1 to send events delta-encoded, failover must support it
  *
  * @returns 0 on success, non-zero value otherwise.
  */
 int nat_ha_set_failover (ip4_address_t * addr, u16 port,
-			 u32 session_refresh_interval);
+			 u32 session_refresh_interval, u8 compact);
 
 /**
  * @brief Get HA failover/remote settings
  */
 void nat_ha_get_failover (ip4_address_t * addr, u16 * port,
-			  u32 * session_refresh_interval);
+			  u32 * session_refresh_interval, u8 * compact);
 
 /**
  * @brief Create session add HA event
@@ -147,6 +148,9 @@ typedef void (*nat_ha_resync_event_cb_t) (u32 client_index, u32 pid,
 
 /**
  * @brief Resync HA (resend existing sessions to new failover)
+ *
+ * Each thread sends its sessions in batches while it keeps forwarding;
+ * event_callback is called once all of them are ACKed or missed.
  */
 int nat_ha_resync (u32 client_index, u32 pid,
 		   nat_ha_resync_event_cb_t event_callback);
@@ -177,6 +177,10 @@ nat44_delete_session (snat_main_t * sm, snat_session_t * ses,
 
   nat_log_debug ("session deleted %U", format_snat_session, tsm, ses);
 
+  if (ses->expire_timer_handle != ~0)
+    tw_timer_stop_16t_2w_512sl (&tsm->session_timer_wheel,
+				ses->expire_timer_handle);
+
   clib_dlist_remove (tsm->list_pool, ses->per_user_index);
   pool_put_index (tsm->list_pool, ses->per_user_index);
   pool_put (tsm->sessions, ses);
@@ -469,6 +473,41 @@ snat_not_translate_fast (snat_main_t * sm, vlib_node_runtime_t * node,
   return 1;
 }
 
+/*
+ * Toeplitz hash of an IPv4 5-tuple, less the destination port. The hash
+ * is linear in its input, so the hash of the full tuple is this value
+ * xor the contribution of the destination port.
+ */
+always_inline u32
+nat44_rss_hash_base (snat_main_t * sm, ip4_address_t * src,
+		     ip4_address_t * dst, u16 src_port)
+{
+  u8 *sp = (u8 *) & src_port;
+  u32 hash = 0;
+  int i;
+
+  for (i = 0; i < 4; i++)
+    hash ^= sm->rss_hash_table[i][src->as_u8[i]] ^
+      sm->rss_hash_table[4 + i][dst->as_u8[i]];
+
+  return hash ^ sm->rss_hash_table[8][sp[0]] ^ sm->rss_hash_table[9][sp[1]];
+}
+
+/* dst_port in host byte order */
+always_inline u32
+nat44_rss_hash_dst_port (snat_main_t * sm, u32 base, u16 dst_port)
+{
+  return base ^ sm->rss_hash_table[10][dst_port >> 8] ^
+    sm->rss_hash_table[11][dst_port & 0xff];
+}
+
+/* NAT thread index (port slice) of the rx queue the hash selects */
+always_inline u32
+nat44_rss_snat_thread_index (snat_main_t * sm, u32 hash)
+{
+  return (hash & (sm->rss_reta_size - 1)) % _vec_len (sm->workers);
+}
+
 #endif /* __included_nat_inlines_h__ */
 
 /*
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+#include <pthread.h>
+
+typedef struct
+{
+  volatile u32 thread_barrier;
+  volatile u32 threads_running;
+  u32 nthreads;
+  u32 burst;
+  u32 iterations;
+  u8 buffer_pool_index;
+
+  /* a vlib_main_t per test thread, as the allocator keys off thread_index */
+  vlib_main_t *vms;
+  u64 *clocks;
+  u64 *n_short;
+
+  /* convenience */
+  vlib_main_t *vlib_main;
+} buffer_test_main_t;
+
+static buffer_test_main_t buffer_test_main;
+
+static void *
+test_buffer_thread_fn (void *arg)
+{
+  buffer_test_main_t *tm = &buffer_test_main;
+  u32 i = (uword) arg;
+  vlib_main_t *vm = tm->vms + i;
+  u32 *buffers = 0, n_alloc, j;
+  u64 t0;
+
+  vec_validate_aligned (buffers, tm->burst - 1, CLIB_CACHE_LINE_BYTES);
+
+  while (tm->thread_barrier)
+    CLIB_PAUSE ();
+
+  t0 = clib_cpu_time_now ();
+
+  for (j = 0; j < tm->iterations; j++)
+    {
+      n_alloc = vlib_buffer_alloc_from_pool (vm, buffers, tm->burst,
+					     tm->buffer_pool_index);
+      tm->n_short[i] += tm->burst - n_alloc;
+      vlib_buffer_pool_put (vm, tm->buffer_pool_index, buffers, n_alloc);
+    }
+
+  tm->clocks[i] = clib_cpu_time_now () - t0;
+
+  vec_free (buffers);
+  clib_atomic_fetch_sub (&tm->threads_running, 1);
+  return (0);
+}
+
+static clib_error_t *
+test_buffer_threads (buffer_test_main_t * tm)
+{
+  vlib_main_t *vm = tm->vlib_main;
+  vlib_buffer_pool_t *bp;
+  vlib_buffer_pool_thread_t *bpt;
+  pthread_t *handles = 0;
+  u64 clocks = 0, n_short = 0;
+  u32 i, first;
+  int rv;
+
+  bp = vlib_get_buffer_pool (vm, tm->buffer_pool_index);
+
+  /* the test threads take the thread indices after the real ones */
+  first = vec_len (vlib_mains);
+  clib_spinlock_lock (&bp->lock);
+  vec_validate_aligned (bp->threads, first + tm->nthreads - 1,
+			CLIB_CACHE_LINE_BYTES);
+  clib_spinlock_unlock (&bp->lock);
+
+  vec_validate (tm->vms, tm->nthreads - 1);
+  vec_validate (tm->clocks, tm->nthreads - 1);
+  vec_validate (tm->n_short, tm->nthreads - 1);
+  vec_validate (handles, tm->nthreads - 1);
+
+  for (i = 0; i < tm->nthreads; i++)
+    {
+      clib_memcpy_fast (tm->vms + i, vm, sizeof (*vm));
+      tm->vms[i].thread_index = first + i;
+      tm->clocks[i] = tm->n_short[i] = 0;
+
+      /* the test threads run on the main heap, so size their caches up
+         front; the allocator then never grows them */
+      bpt = vec_elt_at_index (bp->threads, first + i);
+      vec_validate_aligned (bpt->cached_buffers, tm->burst +
+			    5 * VLIB_BUFFER_MAGAZINE_SIZE,
+			    CLIB_CACHE_LINE_BYTES);
+      vec_reset_length (bpt->cached_buffers);
+    }
+
+  tm->thread_barrier = 1;
+  tm->threads_running = 0;
+
+  for (i = 0; i < tm->nthreads; i++)
+    {
+      rv = pthread_create (handles + i, NULL, test_buffer_thread_fn,
+			   (void *) (uword) i);
+      if (rv)
+	{
+	  clib_unix_warning ("pthread_create returned %d", rv);
+	  break;
+	}
+      clib_atomic_fetch_add (&tm->threads_running, 1);
+    }
+
+  CLIB_MEMORY_BARRIER ();
+  tm->thread_barrier = 0;
+
+  while (tm->threads_running > 0)
+    CLIB_PAUSE ();
+
+  for (i = 0; i < tm->nthreads; i++)
+    {
+      pthread_join (handles[i], NULL);
+      clocks += tm->clocks[i];
+      n_short += tm->n_short[i];
+
+      /* return what the test thread left in its cache to the pool */
+      bpt = vec_elt_at_index (bp->threads, first + i);
+      vlib_buffer_pool_put (vm, tm->buffer_pool_index, bpt->cached_buffers,
+			    vec_len (bpt->cached_buffers));
+      vec_reset_length (bpt->cached_buffers);
+    }
+
+  vlib_cli_output (vm, "%u threads, burst %u: %.2f clocks per buffer "
+		   "alloc+free, %llu allocation shortfalls",
+		   tm->nthreads, tm->burst,
+		   (f64) clocks / ((f64) tm->nthreads * tm->iterations *
+				   tm->burst), n_short);
+
+  vec_free (handles);
+  return 0;
+}
+
+static clib_error_t *
+test_buffer_command_fn (vlib_main_t * vm,
+			unformat_input_t * input, vlib_cli_command_t * cmd)
+{
+  buffer_test_main_t *tm = &buffer_test_main;
+
+  tm->nthreads = 1;
+  tm->burst = 4096;
+  tm->iterations = 1000;
+  tm->buffer_pool_index = vlib_buffer_pool_get_default_for_numa (vm, 0);
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "threads %u", &tm->nthreads))
+	;
+      else if (unformat (input, "burst %u", &tm->burst))
+	;
+      else if (unformat (input, "iterations %u", &tm->iterations))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (tm->nthreads == 0 || tm->burst == 0 || tm->iterations == 0)
+    return clib_error_return (0, "threads, burst and iterations must be "
+			      "non-zero");
+
+  return test_buffer_threads (tm);
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_buffer_command, static) =
+{
+  .path = "test buffer-allocator",
+  .short_help = "test buffer-allocator [threads <n>] [burst <n>] "
+                "[iterations <n>]",
+  .function = test_buffer_command_fn,
+};
+/* *INDENT-ON* */
+
+#define BUFFER_TEST_I(_cond, _comment, _args...)		\
+({								\
+  int _evald = (_cond);						\
+  if (!(_evald)) {						\
+    fformat(stderr, "FAIL:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  } else {							\
+    fformat(stderr, "PASS:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  }								\
+  _evald;							\
+})
+#define BUFFER_TEST(_cond, _comment, _args...)			\
+{								\
+  if (!BUFFER_TEST_I(_cond, _comment, ##_args)) {		\
+    return 1;							\
+  }								\
+}
+#define BUFFER_TEST_DONE(_cond, _comment, _args...)		\
+{								\
+  if (!BUFFER_TEST_I(_cond, _comment, ##_args)) {		\
+    goto done;							\
+  }								\
+}
+
+/*
+ * An rx queue takes the pool on its device's numa node, or on the node
+ * of the thread polling it when the device's is unknown.
+ */
+static int
+buffer_test_rx_queue_pool (vlib_main_t * vm)
+{
+  vlib_buffer_main_t *bm = vm->buffer_main;
+  vlib_buffer_pool_t *bp;
+  u32 ti;
+
+  for (ti = 0; ti < vec_len (vlib_mains); ti++)
+    {
+      u32 numa_node;
+
+      if (!vlib_mains[ti])
+	continue;
+
+      numa_node = vlib_mains[ti]->numa_node;
+      BUFFER_TEST (vlib_buffer_pool_get_for_rx_queue (vm, ~0, ti) ==
+		   vlib_buffer_pool_get_default_for_numa (vm, numa_node),
+		   "thread %u, unknown device node: pool of node %u",
+		   ti, numa_node);
+
+      /* *INDENT-OFF* */
+      vec_foreach (bp, bm->buffer_pools)
+	{
+	  u8 bpi;
+
+	  if (bp->n_buffers == 0)
+	    continue;
+
+	  bpi = vlib_buffer_pool_get_for_rx_queue (vm, bp->numa_node, ti);
+	  BUFFER_TEST (vlib_get_buffer_pool (vm, bpi)->numa_node ==
+		       bp->numa_node,
+		       "thread %u on node %u, device on node %u: pool "
+		       "on node %u", ti, numa_node, bp->numa_node,
+		       vlib_get_buffer_pool (vm, bpi)->numa_node);
+	}
+      /* *INDENT-ON* */
+    }
+
+  return 0;
+}
+
+/*
+ * Remote allocs and frees are counted per thread and pool, and with
+ * remote-free-batch the buffers freed to a remote pool go back to its
+ * depot. A copy of the vlib_main_t with a thread index of its own plays a
+ * thread on the pool's node, then on another one.
+ */
+static int
+buffer_test_remote_counters (vlib_main_t * vm)
+{
+  vlib_buffer_main_t *bm = vm->buffer_main;
+  u8 bpi = vlib_buffer_pool_get_default_for_numa (vm, vm->numa_node);
+  vlib_buffer_pool_t *bp = vlib_get_buffer_pool (vm, bpi);
+  u8 remote_free_batch = bm->remote_free_batch;
+  u32 ti = vec_len (vlib_mains), n_alloc, n = 2 * VLIB_BUFFER_MAGAZINE_SIZE;
+  vlib_buffer_pool_thread_t *bpt;
+  u32 *buffers = 0;
+  vlib_main_t tvm;
+  int rv = 1;
+
+  clib_spinlock_lock (&bp->lock);
+  vec_validate_aligned (bp->threads, ti, CLIB_CACHE_LINE_BYTES);
+  clib_spinlock_unlock (&bp->lock);
+  bpt = vec_elt_at_index (bp->threads, ti);
+  bpt->n_remote_allocs = bpt->n_remote_frees = 0;
+
+  vec_validate_aligned (buffers, n - 1, CLIB_CACHE_LINE_BYTES);
+  clib_memcpy_fast (&tvm, vm, sizeof (tvm));
+  tvm.thread_index = ti;
+
+  tvm.numa_node = bp->numa_node;
+  n_alloc = vlib_buffer_alloc_from_pool (&tvm, buffers, n, bpi);
+  BUFFER_TEST_DONE (n_alloc == n, "%u buffers allocated", n_alloc);
+  vlib_buffer_pool_put (&tvm, bpi, buffers, n_alloc);
+  BUFFER_TEST_DONE (bpt->n_remote_allocs == 0 && bpt->n_remote_frees == 0,
+		    "local pool: %llu remote allocs, %llu remote frees",
+		    bpt->n_remote_allocs, bpt->n_remote_frees);
+
+  tvm.numa_node = bp->numa_node + 1;
+  bm->remote_free_batch = 0;
+  n_alloc = vlib_buffer_alloc_from_pool (&tvm, buffers, n, bpi);
+  BUFFER_TEST_DONE (bpt->n_remote_allocs == n_alloc,
+		    "remote pool: %llu remote allocs", bpt->n_remote_allocs);
+  vlib_buffer_pool_put (&tvm, bpi, buffers, n_alloc);
+  BUFFER_TEST_DONE (bpt->n_remote_frees == n_alloc,
+		    "remote pool: %llu remote frees", bpt->n_remote_frees);
+  BUFFER_TEST_DONE (vec_len (bpt->cached_buffers) >=
+		    VLIB_BUFFER_MAGAZINE_SIZE,
+		    "without remote-free-batch %u buffers stay cached",
+		    vec_len (bpt->cached_buffers));
+
+  bm->remote_free_batch = 1;
+  n_alloc = vlib_buffer_alloc_from_pool (&tvm, buffers, n, bpi);
+  vlib_buffer_pool_put (&tvm, bpi, buffers, n_alloc);
+  BUFFER_TEST_DONE (bpt->n_remote_frees == 2 * n_alloc,
+		    "remote pool: %llu remote frees", bpt->n_remote_frees);
+  BUFFER_TEST_DONE (vec_len (bpt->cached_buffers) <
+		    VLIB_BUFFER_MAGAZINE_SIZE,
+		    "with remote-free-batch %u buffers stay cached",
+		    vec_len (bpt->cached_buffers));
+
+  rv = 0;
+
+done:
+  /* return what the test thread left in its cache to the pool */
+  bm->remote_free_batch = remote_free_batch;
+  vlib_buffer_pool_put (vm, bpi, bpt->cached_buffers,
+			vec_len (bpt->cached_buffers));
+  vec_reset_length (bpt->cached_buffers);
+  bpt->n_remote_allocs = bpt->n_remote_frees = 0;
+  vec_free (buffers);
+  return rv;
+}
+
+static clib_error_t *
+test_buffer_numa_command_fn (vlib_main_t * vm,
+			     unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  if (buffer_test_rx_queue_pool (vm) || buffer_test_remote_counters (vm))
+    return clib_error_return (0, "buffer numa test failed");
+
+  vlib_cli_output (vm, "buffer numa test OK");
+  return (NULL);
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_buffer_numa_command, static) =
+{
+  .path = "test buffer numa",
+  .short_help = "test buffer numa",
+  .function = test_buffer_numa_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+buffer_test_init (vlib_main_t * vm)
+{
+  buffer_test_main_t *tm = &buffer_test_main;
+
+  tm->vlib_main = vm;
+  return (0);
+}
+
+VLIB_INIT_FUNCTION (buffer_test_init);
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
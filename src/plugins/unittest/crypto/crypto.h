@@ -39,6 +39,14 @@ typedef struct unittest_crypto_test_registration
 typedef struct
 {
   int verbose;
+  u32 engine_index;
+
+  /* perf */
+  vnet_crypto_op_type_t perf_op;
+  u32 n_buffers;
+  u32 buffer_size;
+  u32 rounds;
+
   unittest_crypto_test_registration_t *test_registrations;
 } crypto_test_main_t;
 
@@ -30,6 +30,45 @@ sort_registrations (void *a0, void *a1)
   return (r0[0]->op > r1[0]->op);
 }
 
+/*
+ * Run ops through the engine selected with 'engine <name>', bypassing
+ * the active handler selection. Without an engine, use the active ones.
+ */
+static u32
+test_crypto_process_ops (vlib_main_t * vm, crypto_test_main_t * tm,
+			 vnet_crypto_op_t ops[], u32 n_ops)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  vnet_crypto_engine_t *e;
+  vnet_crypto_op_t *op_queue[VLIB_FRAME_SIZE];
+  u32 i, j, n, rv = 0;
+
+  if (tm->engine_index == ~0)
+    return vnet_crypto_process_ops (vm, ops, n_ops);
+
+  e = vec_elt_at_index (cm->engines, tm->engine_index);
+
+  for (i = 0; i < n_ops; i += n)
+    {
+      vnet_crypto_op_type_t opt = ops[i].op;
+
+      for (n = 0; i + n < n_ops && n < VLIB_FRAME_SIZE; n++)
+	{
+	  if (ops[i + n].op != opt)
+	    break;
+	  op_queue[n] = ops + i + n;
+	}
+
+      if (e->ops_handlers[opt])
+	rv += e->ops_handlers[opt] (vm, op_queue, n);
+      else
+	for (j = 0; j < n; j++)
+	  op_queue[j]->status = VNET_CRYPTO_OP_STATUS_FAIL_NO_HANDLER;
+    }
+
+  return rv;
+}
+
 static clib_error_t *
 test_crypto (vlib_main_t * vm, crypto_test_main_t * tm)
 {
@@ -76,7 +115,7 @@ test_crypto (vlib_main_t * vm, crypto_test_main_t * tm)
     }
   /* *INDENT-ON* */
 
-  vnet_crypto_process_ops (vm, ops, vec_len (ops));
+  test_crypto_process_ops (vm, tm, ops, vec_len (ops));
 
   /* *INDENT-OFF* */
   vec_foreach_index (i, rv)
@@ -85,6 +124,14 @@ test_crypto (vlib_main_t * vm, crypto_test_main_t * tm)
       r = rv[i];
       op  = ops + i;
 
+      if (op->status == VNET_CRYPTO_OP_STATUS_FAIL_NO_HANDLER)
+	{
+	  vec_reset_length (s);
+	  s = format (s, "%s (%U)", r->name, format_vnet_crypto_op, r->op);
+	  vlib_cli_output (vm, "%-60vNO HANDLER", s);
+	  continue;
+	}
+
       if (memcmp (op->dst, r->expected.data, r->expected.length) != 0)
 	fail = 1;
 
@@ -102,6 +149,45 @@ test_crypto (vlib_main_t * vm, crypto_test_main_t * tm)
     }
   /* *INDENT-ON* */
 
+  /* verify the computed digests with the engine's hmac check */
+  vec_reset_length (ops);
+  /* *INDENT-OFF* */
+  vec_foreach_index (i, rv)
+    {
+      r = rv[i];
+      if (r->op < VNET_CRYPTO_OP_MD5_HMAC)
+	continue;
+      vec_add2_aligned (ops, op, 1, CLIB_CACHE_LINE_BYTES);
+      op->op = r->op;
+      op->flags = VNET_CRYPTO_OP_FLAG_HMAC_CHECK;
+      op->key = r->key.data;
+      op->key_len = r->key.length;
+      op->src = r->data.data;
+      op->len = r->data.length;
+      op->dst = r->expected.data;
+      op->hmac_trunc_len = r->expected.length;
+      op->user_data = i;
+    }
+  /* *INDENT-ON* */
+
+  if (vec_len (ops))
+    test_crypto_process_ops (vm, tm, ops, vec_len (ops));
+
+  /* *INDENT-OFF* */
+  vec_foreach (op, ops)
+    {
+      if (op->status == VNET_CRYPTO_OP_STATUS_FAIL_NO_HANDLER)
+	continue;
+      r = rv[op->user_data];
+      vec_reset_length (s);
+      s = format (s, "%s (%U, check)", r->name,
+		  format_vnet_crypto_op, r->op);
+      vlib_cli_output (vm, "%-60v%s", s,
+		       op->status == VNET_CRYPTO_OP_STATUS_COMPLETED ?
+		       "OK" : "FAIL");
+    }
+  /* *INDENT-ON* */
+
   vec_free (computed_data);
   vec_free (ops);
   vec_free (rv);
@@ -109,21 +195,185 @@ test_crypto (vlib_main_t * vm, crypto_test_main_t * tm)
   return 0;
 }
 
+static clib_error_t *
+test_crypto_perf (vlib_main_t * vm, crypto_test_main_t * tm)
+{
+  vnet_crypto_op_type_t opt = tm->perf_op;
+  u32 n_buffers = tm->n_buffers, buffer_size = tm->buffer_size;
+  vnet_crypto_op_t *ops = 0, *op;
+  u8 *buffers = 0, key[32], iv[16], digest[64];
+  u64 t0, t1, n_cycles = 0;
+  f64 bytes, secs;
+  u32 i, j;
+
+  if (opt == VNET_CRYPTO_OP_NONE)
+    return clib_error_return (0, "please specify op type");
+
+  if (buffer_size == 0 || n_buffers == 0 || tm->rounds == 0)
+    return clib_error_return (0, "buffers, size and rounds must be non-zero");
+
+  if (opt < VNET_CRYPTO_OP_MD5_HMAC)
+    buffer_size = round_pow2 (buffer_size, 16);
+
+  vec_validate_aligned (buffers, n_buffers * buffer_size - 1,
+			CLIB_CACHE_LINE_BYTES);
+  vec_validate_aligned (ops, n_buffers - 1, CLIB_CACHE_LINE_BYTES);
+
+  for (i = 0; i < vec_len (buffers); i++)
+    buffers[i] = i;
+  for (i = 0; i < sizeof (key); i++)
+    key[i] = iv[i % sizeof (iv)] = i * 7;
+
+  /* *INDENT-OFF* */
+  vec_foreach_index (i, ops)
+    {
+      op = ops + i;
+      op->op = opt;
+      op->key = key;
+      op->key_len = sizeof (key);
+      op->iv = iv;
+      op->src = buffers + i * buffer_size;
+      op->len = buffer_size;
+      /* hmac writes a digest, ciphers run in place */
+      op->dst = opt < VNET_CRYPTO_OP_MD5_HMAC ? op->src : digest;
+    }
+  /* *INDENT-ON* */
+
+  /* warm up key caches before measuring */
+  test_crypto_process_ops (vm, tm, ops, n_buffers);
+
+  for (j = 0; j < tm->rounds; j++)
+    {
+      t0 = clib_cpu_time_now ();
+      test_crypto_process_ops (vm, tm, ops, n_buffers);
+      t1 = clib_cpu_time_now ();
+      n_cycles += t1 - t0;
+    }
+
+  if (ops[0].status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+    {
+      vec_free (buffers);
+      vec_free (ops);
+      return clib_error_return (0, "%U not supported by engine %U",
+				format_vnet_crypto_op, opt,
+				format_vnet_crypto_engine,
+				tm->engine_index == ~0 ?
+				crypto_main.opt_data[opt].active_engine_index :
+				tm->engine_index);
+    }
+
+  bytes = (f64) n_buffers * buffer_size * tm->rounds;
+  secs = n_cycles / vm->clib_time.clocks_per_second;
+
+  vlib_cli_output (vm, "%U: engine %U, %u buffers x %u bytes, %u rounds",
+		   format_vnet_crypto_op, opt, format_vnet_crypto_engine,
+		   tm->engine_index == ~0 ?
+		   crypto_main.opt_data[opt].active_engine_index :
+		   tm->engine_index, n_buffers, buffer_size, tm->rounds);
+  vlib_cli_output (vm, "  %.2f cycles/byte, %.2f cycles/op, %.3f Gbps",
+		   n_cycles / bytes, n_cycles / ((f64) n_buffers * tm->rounds),
+		   bytes * 8 / secs * 1e-9);
+
+  vec_free (buffers);
+  vec_free (ops);
+  return 0;
+}
+
+static uword
+unformat_crypto_test_op_type (unformat_input_t * input, va_list * args)
+{
+  vnet_crypto_op_type_t *opt = va_arg (*args, vnet_crypto_op_type_t *);
+  u8 *name = 0, *s = 0;
+  uword rv = 0;
+  int i;
+
+  if (!unformat (input, "%s", &name))
+    return 0;
+
+  for (i = 1; i < VNET_CRYPTO_N_OP_TYPES; i++)
+    {
+      vec_reset_length (s);
+      s = format (s, "%U", format_vnet_crypto_op, i);
+      if (vec_len (s) == vec_len (name) && !memcmp (s, name, vec_len (s)))
+	{
+	  *opt = i;
+	  rv = 1;
+	  break;
+	}
+    }
+
+  vec_free (name);
+  vec_free (s);
+  return rv;
+}
+
+static uword
+unformat_crypto_test_engine (unformat_input_t * input, va_list * args)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  u32 *engine_index = va_arg (*args, u32 *);
+  vnet_crypto_engine_t *e;
+  u8 *name = 0;
+  uword rv = 0;
+
+  if (!unformat (input, "%s", &name))
+    return 0;
+
+  vec_add1 (name, 0);
+
+  /* *INDENT-OFF* */
+  vec_foreach (e, cm->engines)
+    {
+      if (strcmp (e->name, (char *) name) == 0)
+	{
+	  *engine_index = e - cm->engines;
+	  rv = 1;
+	  break;
+	}
+    }
+  /* *INDENT-ON* */
+
+  vec_free (name);
+  return rv;
+}
+
 static clib_error_t *
 test_crypto_command_fn (vlib_main_t * vm,
 			unformat_input_t * input, vlib_cli_command_t * cmd)
 {
   crypto_test_main_t *tm = &crypto_test_main;
+  int is_perf = 0;
+
+  tm->engine_index = ~0;
+  tm->perf_op = VNET_CRYPTO_OP_NONE;
+  tm->n_buffers = 256;
+  tm->buffer_size = 1024;
+  tm->rounds = 100;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
       if (unformat (input, "verbose %d", &tm->verbose))
 	;
+      else if (unformat (input, "engine %U", unformat_crypto_test_engine,
+			 &tm->engine_index))
+	;
+      else if (unformat (input, "perf %U", unformat_crypto_test_op_type,
+			 &tm->perf_op))
+	is_perf = 1;
+      else if (unformat (input, "buffers %u", &tm->n_buffers))
+	;
+      else if (unformat (input, "size %u", &tm->buffer_size))
+	;
+      else if (unformat (input, "rounds %u", &tm->rounds))
+	;
       else
 	return clib_error_return (0, "unknown input '%U'",
 				  format_unformat_error, input);
     }
 
+  if (is_perf)
+    return test_crypto_perf (vm, tm);
+
   return test_crypto (vm, tm);
 }
 
@@ -131,7 +381,8 @@ test_crypto_command_fn (vlib_main_t * vm,
 VLIB_CLI_COMMAND (test_crypto_command, static) =
 {
   .path = "test crypto",
-  .short_help = "test crypto",
+  .short_help = "test crypto [engine <name>] [verbose <n>] "
+    "[perf <op> [buffers <n>] [size <n>] [rounds <n>]]",
   .function = test_crypto_command_fn,
 };
 /* *INDENT-ON* */
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vnet/vnet.h>
+#include <vnet/feature/feature.h>
+#include <vnet/ethernet/ethernet.h>
+#include <vnet/ip/ip4.h>
+
+#define FEATURE_TEST_I(_cond, _comment, _args...)		\
+({								\
+  int _evald = (_cond);						\
+  if (!(_evald)) {						\
+    fformat(stderr, "FAIL:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  } else {							\
+    fformat(stderr, "PASS:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  }								\
+  _evald;							\
+})
+#define FEATURE_TEST(_cond, _comment, _args...)			\
+{								\
+  if (!FEATURE_TEST_I(_cond, _comment, ##_args)) {		\
+    return 1;							\
+  }								\
+}
+
+/*
+ * Start a buffer on the arc as its start node does and check it is sent
+ * to the first feature expected, then on to the second one, if given.
+ * With no feature expected the buffer must be left alone.
+ */
+static int
+feature_test_check_start (vlib_main_t * vm, u8 arc, u32 sw_if_index,
+			  const char *first, const char *second)
+{
+  vnet_feature_main_t *fm = &feature_main;
+  vnet_feature_config_main_t *cm = &fm->feature_config_mains[arc];
+  u32 next, ci, expected_ci, expected_next;
+  vlib_buffer_t b;
+  vlib_node_t *n;
+
+  clib_memset (&b, 0, sizeof (b));
+  next = ~0;
+  vnet_feature_arc_start (arc, sw_if_index, &next, &b);
+
+  if (NULL == first)
+    {
+      FEATURE_TEST (!vnet_have_features (arc, sw_if_index),
+		    "no features on the interface");
+      FEATURE_TEST (~0 == next, "buffer left on the arc start node");
+      return 0;
+    }
+
+  FEATURE_TEST (vnet_have_features (arc, sw_if_index),
+		"features on the interface");
+  FEATURE_TEST (arc == vnet_buffer (&b)->feature_arc_index,
+		"buffer on arc %d", vnet_buffer (&b)->feature_arc_index);
+
+  /* the precompiled start agrees with the interface's config */
+  expected_ci = vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
+  vnet_get_config_data (&cm->config_main, &expected_ci, &expected_next, 0);
+  FEATURE_TEST (expected_next == next,
+		"next %d, expected %d", next, expected_next);
+  FEATURE_TEST (expected_ci == b.current_config_index,
+		"config index %d, expected %d",
+		b.current_config_index, expected_ci);
+
+  n = vlib_get_next_node (vm, cm->config_main.start_node_indices[0], next);
+  FEATURE_TEST (!strcmp ((char *) n->name, first),
+		"first feature %v, expected %s", n->name, first);
+
+  if (NULL == second)
+    return 0;
+
+  /* the first feature carries on from the config index left */
+  ci = b.current_config_index;
+  vnet_get_config_data (&cm->config_main, &ci, &next, 0);
+  n = vlib_get_next_node (vm, n->index, next);
+  FEATURE_TEST (!strcmp ((char *) n->name, second),
+		"second feature %v, expected %s", n->name, second);
+
+  return 0;
+}
+
+static int
+feature_test_start (vlib_main_t * vm)
+{
+  u32 sw_if_index;
+  int res = 0;
+  u8 arc;
+
+  arc = vnet_get_feature_arc_index ("ip4-unicast");
+  FEATURE_TEST (arc != (u8) ~ 0, "ip4-unicast arc found");
+
+  FEATURE_TEST (!vnet_create_loopback_interface (&sw_if_index, NULL, 0, 0),
+		"loopback created");
+  /* so that ip4-not-enabled, unordered with the others, is off */
+  ip4_sw_interface_enable_disable (sw_if_index, 1);
+
+  res |= feature_test_check_start (vm, arc, sw_if_index, NULL, NULL);
+
+  /*
+   * on this arc ip4-flow-classify runs before ip4-inacl, which runs
+   * before ip4-source-check-via-rx, which runs before
+   * ip4-source-check-via-any
+   */
+  vnet_feature_enable_disable ("ip4-unicast", "ip4-source-check-via-any",
+			       sw_if_index, 1, 0, 0);
+  res |= feature_test_check_start (vm, arc, sw_if_index,
+				   "ip4-source-check-via-any", "ip4-lookup");
+
+  vnet_feature_enable_disable ("ip4-unicast", "ip4-inacl",
+			       sw_if_index, 1, 0, 0);
+  res |= feature_test_check_start (vm, arc, sw_if_index,
+				   "ip4-inacl", "ip4-source-check-via-any");
+
+  vnet_feature_enable_disable ("ip4-unicast", "ip4-flow-classify",
+			       sw_if_index, 1, 0, 0);
+  res |= feature_test_check_start (vm, arc, sw_if_index,
+				   "ip4-flow-classify", "ip4-inacl");
+
+  /* adding a feature later in the chain leaves the start alone */
+  vnet_feature_enable_disable ("ip4-unicast", "ip4-source-check-via-rx",
+			       sw_if_index, 1, 0, 0);
+  res |= feature_test_check_start (vm, arc, sw_if_index,
+				   "ip4-flow-classify", "ip4-inacl");
+
+  vnet_feature_enable_disable ("ip4-unicast", "ip4-flow-classify",
+			       sw_if_index, 0, 0, 0);
+  res |= feature_test_check_start (vm, arc, sw_if_index,
+				   "ip4-inacl", "ip4-source-check-via-rx");
+
+  vnet_feature_enable_disable ("ip4-unicast", "ip4-inacl",
+			       sw_if_index, 0, 0, 0);
+  vnet_feature_enable_disable ("ip4-unicast", "ip4-source-check-via-rx",
+			       sw_if_index, 0, 0, 0);
+  res |= feature_test_check_start (vm, arc, sw_if_index,
+				   "ip4-source-check-via-any", "ip4-lookup");
+
+  vnet_feature_enable_disable ("ip4-unicast", "ip4-source-check-via-any",
+			       sw_if_index, 0, 0, 0);
+  res |= feature_test_check_start (vm, arc, sw_if_index, NULL, NULL);
+
+  ip4_sw_interface_enable_disable (sw_if_index, 0);
+  vnet_delete_loopback_interface (sw_if_index);
+
+  return (res);
+}
+
+static clib_error_t *
+feature_test (vlib_main_t * vm,
+	      unformat_input_t * input, vlib_cli_command_t * cmd_arg)
+{
+  int res = 0;
+
+  if (unformat (input, "start"))
+    res = feature_test_start (vm);
+  else
+    return clib_error_return (0, "unknown input `%U'",
+			      format_unformat_error, input);
+
+  if (res)
+    return clib_error_return (0, "Feature unit test failed");
+
+  vlib_cli_output (vm, "Feature unit test OK");
+  return (NULL);
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_feature_command, static) =
+{
+  .path = "test feature",
+  .short_help = "test feature start",
+  .function = feature_test,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -7482,6 +7482,204 @@ f64 fib_walk_process_queues(vlib_main_t * vm,
                             const f64 quota);
 u32 fib_walk_queue_get_size(fib_walk_priority_t prio);
 
+/*
+ * Batch updates to a real FIB: host routes recurse via 1.1.1.1, which
+ * resolves through a cover that is added and changed several times in the
+ * batch. The resolving entry's children are walked once, at the end.
+ */
+static int
+fib_test_walk_batch (void)
+{
+#define N_BATCH_ROUTES 4
+    fib_node_index_t fei, fei_rr, ai_02, fei_children[N_BATCH_ROUTES];
+    dpo_id_t dpo = DPO_INVALID;
+    fib_node_test_t *tc;
+    test_main_t *tm;
+    u32 fib_index, ii, sibling;
+    int res;
+
+    res = 0;
+    tm = &test_main;
+    fib_index = fib_table_find_or_create_and_lock(FIB_PROTOCOL_IP4, 1005,
+                                                  FIB_SOURCE_API);
+
+    fib_prefix_t pfx_1_1_1_0_s_24 = {
+        .fp_len = 24,
+        .fp_proto = FIB_PROTOCOL_IP4,
+        .fp_addr.ip4.as_u32 = clib_host_to_net_u32(0x01010100),
+    };
+    fib_prefix_t pfx_1_1_1_1_s_32 = {
+        .fp_len = 32,
+        .fp_proto = FIB_PROTOCOL_IP4,
+        .fp_addr.ip4.as_u32 = clib_host_to_net_u32(0x01010101),
+    };
+    ip46_address_t nh_10_10_10_1 = {
+        .ip4.as_u32 = clib_host_to_net_u32(0x0a0a0a01),
+    };
+    ip46_address_t nh_10_10_10_2 = {
+        .ip4.as_u32 = clib_host_to_net_u32(0x0a0a0a02),
+    };
+    ai_02 = adj_nbr_add_or_lock(FIB_PROTOCOL_IP4,
+                                VNET_LINK_IP4,
+                                &nh_10_10_10_2,
+                                tm->hw[0]->sw_if_index);
+
+    /*
+     * the host routes recurse via 1.1.1.1, which has no cover but the
+     * default route. they drop.
+     */
+    for (ii = 0; ii < N_BATCH_ROUTES; ii++)
+    {
+        fib_prefix_t pfx = {
+            .fp_len = 32,
+            .fp_proto = FIB_PROTOCOL_IP4,
+            .fp_addr.ip4.as_u32 = clib_host_to_net_u32(0x02020201 + ii),
+        };
+
+        fei_children[ii] =
+            fib_table_entry_update_one_path(fib_index,
+                                            &pfx,
+                                            FIB_SOURCE_API,
+                                            FIB_ENTRY_FLAG_NONE,
+                                            DPO_PROTO_IP4,
+                                            &pfx_1_1_1_1_s_32.fp_addr,
+                                            ~0,
+                                            fib_index,
+                                            1,
+                                            NULL,
+                                            FIB_ROUTE_PATH_FLAG_NONE);
+        FIB_TEST(load_balance_is_drop(fib_entry_contribute_ip_forwarding(
+                                          fei_children[ii])),
+                 "%U drops pre batch",
+                 format_fib_prefix, &pfx);
+    }
+
+    /*
+     * a test child on the resolving entry counts its walks
+     */
+    fei_rr = fib_table_lookup_exact_match(fib_index, &pfx_1_1_1_1_s_32);
+    FIB_TEST((FIB_NODE_INDEX_INVALID != fei_rr), "1.1.1.1/32 resolving entry present");
+
+    fib_test_walk_spawns_walks = 0;
+    tc = &fib_test_nodes[1];
+    fib_node_init(&tc->node, FIB_NODE_TYPE_TEST);
+    fib_node_lock(&tc->node);
+    tc->ctxs = NULL;
+    tc->index = 1;
+    sibling = fib_node_child_add(FIB_NODE_TYPE_ENTRY, fei_rr,
+                                 FIB_NODE_TYPE_TEST, 1);
+
+    /*
+     * add the cover and change its path three times in a batch
+     */
+    fib_table_batch_begin();
+
+    fib_table_entry_update_one_path(fib_index,
+                                    &pfx_1_1_1_0_s_24,
+                                    FIB_SOURCE_API,
+                                    FIB_ENTRY_FLAG_NONE,
+                                    DPO_PROTO_IP4,
+                                    &nh_10_10_10_1,
+                                    tm->hw[0]->sw_if_index,
+                                    ~0,
+                                    1,
+                                    NULL,
+                                    FIB_ROUTE_PATH_FLAG_NONE);
+    fib_table_entry_path_add(fib_index,
+                             &pfx_1_1_1_0_s_24,
+                             FIB_SOURCE_API,
+                             FIB_ENTRY_FLAG_NONE,
+                             DPO_PROTO_IP4,
+                             &nh_10_10_10_2,
+                             tm->hw[0]->sw_if_index,
+                             ~0,
+                             1,
+                             NULL,
+                             FIB_ROUTE_PATH_FLAG_NONE);
+    fib_table_entry_path_remove(fib_index,
+                                &pfx_1_1_1_0_s_24,
+                                FIB_SOURCE_API,
+                                DPO_PROTO_IP4,
+                                &nh_10_10_10_1,
+                                tm->hw[0]->sw_if_index,
+                                ~0,
+                                1,
+                                FIB_ROUTE_PATH_FLAG_NONE);
+
+    FIB_TEST(0 == vec_len(tc->ctxs),
+             "1.1.1.1/32 children walked %d times in open batch",
+             vec_len(tc->ctxs));
+    for (ii = 0; ii < N_BATCH_ROUTES; ii++)
+    {
+        FIB_TEST(load_balance_is_drop(fib_entry_contribute_ip_forwarding(
+                                          fei_children[ii])),
+                 "host route %d drops in open batch", ii);
+    }
+
+    fib_table_batch_end();
+
+    /*
+     * the resolving entry's children were walked once and the host
+     * routes now stack on its forwarding, via 10.10.10.2
+     */
+    FIB_TEST(1 == vec_len(tc->ctxs),
+             "1.1.1.1/32 children walked %d times post batch",
+             vec_len(tc->ctxs));
+
+    fib_test_lb_bucket_t ip_o_10_10_10_2 = {
+        .type = FT_LB_ADJ,
+        .adj = {
+            .adj = ai_02,
+        },
+    };
+    FIB_TEST(!fib_test_validate_entry(fei_rr,
+                                      FIB_FORW_CHAIN_TYPE_UNICAST_IP4,
+                                      1,
+                                      &ip_o_10_10_10_2),
+             "1.1.1.1/32 via 10.10.10.2 post batch");
+
+    fib_entry_contribute_forwarding(fei_rr,
+                                    FIB_FORW_CHAIN_TYPE_UNICAST_IP4,
+                                    &dpo);
+    fib_test_lb_bucket_t ip_o_1_1_1_1 = {
+        .type = FT_LB_O_LB,
+        .lb = {
+            .lb = dpo.dpoi_index,
+        },
+    };
+    for (ii = 0; ii < N_BATCH_ROUTES; ii++)
+    {
+        FIB_TEST(!fib_test_validate_entry(fei_children[ii],
+                                          FIB_FORW_CHAIN_TYPE_UNICAST_IP4,
+                                          1,
+                                          &ip_o_1_1_1_1),
+                 "host route %d via 1.1.1.1 post batch", ii);
+    }
+    dpo_reset(&dpo);
+
+    /*
+     * cleanup
+     */
+    fib_node_child_remove(FIB_NODE_TYPE_ENTRY, fei_rr, sibling);
+    fib_node_deinit(&tc->node);
+    fib_node_unlock(&tc->node);
+    vec_free(tc->ctxs);
+
+    for (ii = 0; ii < N_BATCH_ROUTES; ii++)
+    {
+        fib_table_entry_delete_index(fei_children[ii], FIB_SOURCE_API);
+    }
+    fib_table_entry_delete(fib_index, &pfx_1_1_1_0_s_24, FIB_SOURCE_API);
+
+    fei = fib_table_lookup_exact_match(fib_index, &pfx_1_1_1_1_s_32);
+    FIB_TEST((FIB_NODE_INDEX_INVALID == fei), "1.1.1.1/32 removed");
+
+    adj_unlock(ai_02);
+    fib_table_unlock(fib_index, FIB_PROTOCOL_IP4, FIB_SOURCE_API);
+
+    return (res);
+}
+
 static int
 fib_test_walk (void)
 {
@@ -7764,6 +7962,41 @@ fib_test_walk (void)
              "Parent has %d children post 2nd zero qunta merge walk",
              fib_node_list_get_size(PARENT()->fn_children));
 
+    /*
+     * sync walk the parent several times within nested batches. the walks
+     * are deferred and merged; the children are visited once when the
+     * outermost batch ends.
+     */
+    fib_walk_batch_begin();
+    fib_walk_sync(FIB_NODE_TYPE_TEST, PARENT_INDEX, &high_ctx);
+    fib_walk_batch_begin();
+    fib_walk_sync(FIB_NODE_TYPE_TEST, PARENT_INDEX, &high_ctx);
+    fib_walk_batch_end();
+    fib_walk_sync(FIB_NODE_TYPE_TEST, PARENT_INDEX, &high_ctx);
+
+    FOR_EACH_TEST_CHILD(tc)
+    {
+        FIB_TEST(0 == vec_len(tc->ctxs),
+                 "%d child visitsed %d times in open batch",
+                 ii, vec_len(tc->ctxs));
+    }
+    FIB_TEST(N_TEST_CHILDREN+1 == fib_node_list_get_size(PARENT()->fn_children),
+             "Parent has %d children in open batch",
+             fib_node_list_get_size(PARENT()->fn_children));
+
+    fib_walk_batch_end();
+
+    FOR_EACH_TEST_CHILD(tc)
+    {
+        FIB_TEST(1 == vec_len(tc->ctxs),
+                 "%d child visitsed %d times post batch",
+                 ii, vec_len(tc->ctxs));
+        vec_free(tc->ctxs);
+    }
+    FIB_TEST(N_TEST_CHILDREN == fib_node_list_get_size(PARENT()->fn_children),
+             "Parent has %d children post batch",
+             fib_node_list_get_size(PARENT()->fn_children));
+
     /*
      * make the parent a child of one of its children, thus inducing a routing loop.
      */
@@ -7883,6 +8116,8 @@ fib_test_walk (void)
     FIB_TEST((1 == fib_test_nodes[PARENT_INDEX].destroyed),
              "Parent was destroyed");
 
+    res += fib_test_walk_batch();
+
     return (res);
 }
 
@@ -10520,6 +10755,448 @@ fib_test_sticky (void)
     return 0;
 }
 
+/*
+ * Compare the batched (SIMD where available) mtrie lookup with the scalar
+ * walk over a table of random prefixes, and report the cost of each.
+ */
+static int
+fib_test_mtrie (void)
+{
+#define N_MTRIE_ROUTES 20000
+#define N_MTRIE_LOOKUPS (64 * VLIB_FRAME_SIZE)
+    ip4_fib_mtrie_leaf_t *scalar = NULL, *batch = NULL;
+    fib_prefix_t *pfxs = NULL, *pfx;
+    ip4_fib_mtrie_t *mtrie;
+    u64 t_scalar, t_batch;
+    u32 fib_index, ii, *dsts = NULL;
+    u32 seed = 0xdeadbeef;
+    int res = 0;
+
+    fib_index = fib_table_find_or_create_and_lock(FIB_PROTOCOL_IP4, 1001,
+                                                  FIB_SOURCE_API);
+
+    for (ii = 0; ii < N_MTRIE_ROUTES; ii++)
+    {
+        /* mostly /24s, the rest spread over the lengths the plys split */
+        u32 len = (ii & 1) ? 24 : 8 + random_u32(&seed) % 25;
+        fib_prefix_t p = {
+            .fp_len = len,
+            .fp_proto = FIB_PROTOCOL_IP4,
+            .fp_addr.ip4.as_u32 =
+                clib_host_to_net_u32(random_u32(&seed) &
+                                     ~pow2_mask(32 - len)),
+        };
+
+        fib_table_entry_special_add(fib_index, &p, FIB_SOURCE_API,
+                                    FIB_ENTRY_FLAG_DROP);
+        vec_add1(pfxs, p);
+    }
+
+    /* half the addresses within the added prefixes, half anywhere */
+    for (ii = 0; ii < N_MTRIE_LOOKUPS; ii++)
+    {
+        u32 a = random_u32(&seed);
+
+        if (ii & 1)
+        {
+            pfx = vec_elt_at_index(pfxs, random_u32(&seed) % vec_len(pfxs));
+            a = clib_host_to_net_u32(
+                clib_net_to_host_u32(pfx->fp_addr.ip4.as_u32) |
+                (a & pow2_mask(32 - pfx->fp_len)));
+        }
+        vec_add1(dsts, a);
+    }
+    vec_validate(scalar, N_MTRIE_LOOKUPS - 1);
+    vec_validate(batch, N_MTRIE_LOOKUPS - 1);
+
+    mtrie = ip4_fib_get(fib_index)->mtrie;
+
+    t_scalar = clib_cpu_time_now();
+    for (ii = 0; ii < N_MTRIE_LOOKUPS; ii++)
+        scalar[ii] = ip4_fib_mtrie_lookup(mtrie,
+                                          (ip4_address_t *)&dsts[ii]);
+    t_scalar = clib_cpu_time_now() - t_scalar;
+
+    t_batch = clib_cpu_time_now();
+    for (ii = 0; ii < N_MTRIE_LOOKUPS; ii += VLIB_FRAME_SIZE)
+        ip4_fib_mtrie_lookup_batch(mtrie, dsts + ii, batch + ii,
+                                   VLIB_FRAME_SIZE);
+    t_batch = clib_cpu_time_now() - t_batch;
+
+    for (ii = 0; ii < N_MTRIE_LOOKUPS; ii++)
+    {
+        FIB_TEST((scalar[ii] == batch[ii]),
+                 "mtrie batch lookup %U: %d == %d",
+                 format_ip4_address, &dsts[ii], batch[ii], scalar[ii]);
+        FIB_TEST(ip4_fib_mtrie_leaf_is_terminal(batch[ii]),
+                 "mtrie batch lookup %U is terminal",
+                 format_ip4_address, &dsts[ii]);
+    }
+
+    vlib_cli_output(vlib_get_main(),
+                    "mtrie %d routes: scalar %.2f clocks/lookup, "
+                    "batch %.2f clocks/lookup", vec_len(pfxs),
+                    (f64)t_scalar / N_MTRIE_LOOKUPS,
+                    (f64)t_batch / N_MTRIE_LOOKUPS);
+
+    vec_foreach(pfx, pfxs)
+    {
+        fib_table_entry_special_remove(fib_index, pfx, FIB_SOURCE_API);
+    }
+    fib_table_unlock(fib_index, FIB_PROTOCOL_IP4, FIB_SOURCE_API);
+
+    vec_free(pfxs);
+    vec_free(dsts);
+    vec_free(scalar);
+    vec_free(batch);
+
+    return (res);
+}
+
+/*
+ * Check the forwarding structure of a table against a longest prefix match
+ * on its entries.
+ */
+static int
+fib_test_fwd_validate (u32 fib_index, const u32 *addrs)
+{
+    ip4_fib_t *fib;
+    const u32 *a;
+    int res = 0;
+
+    fib = ip4_fib_get(fib_index);
+
+    vec_foreach(a, addrs)
+    {
+        ip4_address_t addr = {
+            .as_u32 = *a,
+        };
+        u32 lbi = ip4_fib_forwarding_lookup(fib_index, &addr);
+
+        FIB_TEST((lbi == ip4_fib_table_lookup_lb(fib, &addr)),
+                 "%U %U lookup %U: %d",
+                 format_ip4_fib_fwd_type, fib->fwd_type,
+                 format_fib_table_name, fib_index, FIB_PROTOCOL_IP4,
+                 format_ip4_address, &addr, lbi);
+        if (res)
+            break;
+    }
+    return (res);
+}
+
+/*
+ * Build a table of random prefixes, switch it to a poptrie, then add and
+ * remove routes so the trie is updated incrementally and check it against
+ * the table's entries at each step.
+ */
+static int
+fib_test_poptrie (void)
+{
+#define N_POPTRIE_ROUTES 4000
+#define N_POPTRIE_LOOKUPS 20000
+    fib_prefix_t *pfxs = NULL, *pfx;
+    uword mtrie_bytes, poptrie_bytes;
+    u32 fib_index, empty_index, ii, *addrs = NULL;
+    u32 seed = 0x12345678;
+    ip4_fib_t *fib, *empty;
+    int res = 0;
+
+    fib_index = fib_table_find_or_create_and_lock(FIB_PROTOCOL_IP4, 1002,
+                                                  FIB_SOURCE_API);
+    fib = ip4_fib_get(fib_index);
+    FIB_TEST((IP4_FIB_FWD_TYPE_MTRIE == fib->fwd_type),
+             "new table uses the mtrie");
+
+    for (ii = 0; ii < N_POPTRIE_ROUTES; ii++)
+    {
+        u32 len = 1 + random_u32(&seed) % 32;
+        fib_prefix_t p = {
+            .fp_len = len,
+            .fp_proto = FIB_PROTOCOL_IP4,
+            .fp_addr.ip4.as_u32 =
+                clib_host_to_net_u32(random_u32(&seed) &
+                                     ~pow2_mask(32 - len)),
+        };
+
+        if (FIB_NODE_INDEX_INVALID !=
+            fib_table_lookup_exact_match(fib_index, &p))
+            continue;
+
+        fib_table_entry_special_add(fib_index, &p, FIB_SOURCE_API,
+                                    FIB_ENTRY_FLAG_DROP);
+        vec_add1(pfxs, p);
+    }
+
+    for (ii = 0; ii < N_POPTRIE_LOOKUPS; ii++)
+    {
+        u32 a = random_u32(&seed);
+
+        if (ii & 1)
+        {
+            pfx = vec_elt_at_index(pfxs, random_u32(&seed) % vec_len(pfxs));
+            a = clib_host_to_net_u32(
+                clib_net_to_host_u32(pfx->fp_addr.ip4.as_u32) |
+                (a & pow2_mask(32 - pfx->fp_len)));
+        }
+        vec_add1(addrs, a);
+    }
+
+    res += fib_test_fwd_validate(fib_index, addrs);
+    mtrie_bytes = ip4_fib_mtrie_memory_usage(fib->mtrie);
+
+    /*
+     * switch to the poptrie; it is built from the table's entries
+     */
+    ip4_fib_table_set_fwd_type(fib_index, IP4_FIB_FWD_TYPE_POPTRIE);
+    fib = ip4_fib_get(fib_index);
+    FIB_TEST((IP4_FIB_FWD_TYPE_POPTRIE == fib->fwd_type),
+             "table uses the poptrie");
+    FIB_TEST((NULL == fib->mtrie), "mtrie freed");
+    res += fib_test_fwd_validate(fib_index, addrs);
+
+    poptrie_bytes = ip4_poptrie_memory_usage(&fib->poptrie);
+    FIB_TEST((poptrie_bytes < mtrie_bytes),
+             "poptrie:%d smaller than mtrie:%d", poptrie_bytes, mtrie_bytes);
+    vlib_cli_output(vlib_get_main(), "%d routes: mtrie:%d poptrie:%d bytes",
+                    vec_len(pfxs), mtrie_bytes, poptrie_bytes);
+
+    /*
+     * remove every other route, the covers are restored
+     */
+    for (ii = 0; ii < vec_len(pfxs); ii += 2)
+    {
+        fib_table_entry_special_remove(fib_index, &pfxs[ii], FIB_SOURCE_API);
+    }
+    res += fib_test_fwd_validate(fib_index, addrs);
+
+    /*
+     * and add them back, so the trie is updated in place
+     */
+    for (ii = 0; ii < vec_len(pfxs); ii += 2)
+    {
+        fib_table_entry_special_add(fib_index, &pfxs[ii], FIB_SOURCE_API,
+                                    FIB_ENTRY_FLAG_DROP);
+    }
+    res += fib_test_fwd_validate(fib_index, addrs);
+
+    /*
+     * back to the mtrie
+     */
+    ip4_fib_table_set_fwd_type(fib_index, IP4_FIB_FWD_TYPE_MTRIE);
+    fib = ip4_fib_get(fib_index);
+    FIB_TEST((IP4_FIB_FWD_TYPE_MTRIE == fib->fwd_type),
+             "table uses the mtrie");
+    res += fib_test_fwd_validate(fib_index, addrs);
+
+    ip4_fib_table_set_fwd_type(fib_index, IP4_FIB_FWD_TYPE_POPTRIE);
+
+    vec_foreach(pfx, pfxs)
+    {
+        fib_table_entry_special_remove(fib_index, pfx, FIB_SOURCE_API);
+    }
+    res += fib_test_fwd_validate(fib_index, addrs);
+
+    /*
+     * with only the special entries left the trie is the same size as
+     * that of a new table
+     */
+    ip4_main.fib_fwd_type_default = IP4_FIB_FWD_TYPE_POPTRIE;
+    empty_index = fib_table_find_or_create_and_lock(FIB_PROTOCOL_IP4, 1003,
+                                                    FIB_SOURCE_API);
+    ip4_main.fib_fwd_type_default = IP4_FIB_FWD_TYPE_MTRIE;
+
+    fib = ip4_fib_get(fib_index);
+    empty = ip4_fib_get(empty_index);
+    FIB_TEST((IP4_FIB_FWD_TYPE_POPTRIE == empty->fwd_type),
+             "new table uses the default poptrie");
+    FIB_TEST((pool_elts(empty->poptrie.cnodes) ==
+              pool_elts(fib->poptrie.cnodes)),
+             "poptrie emptied, %d control nodes",
+             pool_elts(fib->poptrie.cnodes));
+
+    fib_table_unlock(empty_index, FIB_PROTOCOL_IP4, FIB_SOURCE_API);
+    fib_table_unlock(fib_index, FIB_PROTOCOL_IP4, FIB_SOURCE_API);
+
+    vec_free(pfxs);
+    vec_free(addrs);
+
+    return (res);
+}
+
+static int
+fib_test_ip6_lpm_validate (u32 fib_index, const ip6_address_t *addrs)
+{
+    const ip6_address_t *a;
+    const dpo_id_t *dpo;
+    fib_node_index_t fei;
+    fib_prefix_t pfx = {
+        .fp_len = 128,
+        .fp_proto = FIB_PROTOCOL_IP6,
+    };
+    int res = 0;
+
+    vec_foreach(a, addrs)
+    {
+        pfx.fp_addr.ip6 = *a;
+        fei = fib_table_lookup(fib_index, &pfx);
+        dpo = fib_entry_contribute_ip_forwarding(fei);
+
+        FIB_TEST((dpo->dpoi_index ==
+                  ip6_fib_table_fwding_lookup(&ip6_main, fib_index, a)),
+                 "%s lookup %U",
+                 (NULL == ip6_main.fib_lpm ? "linear" : "LPM"),
+                 format_ip6_address, a);
+    }
+    return (res);
+}
+
+/*
+ * Populate many prefix lengths and check the LPM built over them against
+ * the table, and that it is kept correct in place as routes are added and
+ * removed, probing the table at lengths it was not built with.
+ */
+static int
+fib_test_ip6_lpm (void)
+{
+#define N_LPM_ROUTES 3000
+#define N_LPM_LOOKUPS 20000
+    fib_prefix_t *pfxs = NULL, *pfx;
+    ip6_address_t *addrs = NULL, *a;
+    ip6_main_t *im = &ip6_main;
+    u64 t_linear, t_lpm;
+    u32 fib_index, ii, jj;
+    u32 seed = 0x87654321;
+    ip6_fib_lpm_t *lpm;
+    int res = 0;
+
+    fib_index = fib_table_find_or_create_and_lock(FIB_PROTOCOL_IP6, 1004,
+                                                  FIB_SOURCE_API);
+    ip6_fib_lpm_rebuild();
+    lpm = im->fib_lpm;
+
+    for (ii = 0; ii < N_LPM_ROUTES; ii++)
+    {
+        u32 len = 1 + random_u32(&seed) % 128;
+        fib_prefix_t p = {
+            .fp_len = len,
+            .fp_proto = FIB_PROTOCOL_IP6,
+        };
+
+        for (jj = 0; jj < 2; jj++)
+            p.fp_addr.ip6.as_u64[jj] = (((u64)random_u32(&seed) << 32 |
+                                         random_u32(&seed)) &
+                                        im->fib_masks[len].as_u64[jj]);
+
+        if (FIB_NODE_INDEX_INVALID !=
+            fib_table_lookup_exact_match(fib_index, &p))
+            continue;
+
+        fib_table_entry_special_add(fib_index, &p, FIB_SOURCE_API,
+                                    FIB_ENTRY_FLAG_DROP);
+        vec_add1(pfxs, p);
+    }
+
+    /* half the addresses within the added prefixes, half anywhere */
+    for (ii = 0; ii < N_LPM_LOOKUPS; ii++)
+    {
+        vec_add2(addrs, a, 1);
+        for (jj = 0; jj < 2; jj++)
+            a->as_u64[jj] = ((u64)random_u32(&seed) << 32 |
+                             random_u32(&seed));
+
+        if (ii & 1)
+        {
+            pfx = vec_elt_at_index(pfxs, random_u32(&seed) % vec_len(pfxs));
+            for (jj = 0; jj < 2; jj++)
+                a->as_u64[jj] = ((a->as_u64[jj] &
+                                  ~im->fib_masks[pfx->fp_len].as_u64[jj]) |
+                                 pfx->fp_addr.ip6.as_u64[jj]);
+        }
+    }
+
+    /*
+     * the LPM is updated in place, the new lengths are probed in the table
+     */
+    FIB_TEST((lpm == im->fib_lpm), "LPM updated in place");
+    FIB_TEST((0 != lpm->n_missing_lengths), "LPM missing lengths:%d",
+             lpm->n_missing_lengths);
+    res += fib_test_ip6_lpm_validate(fib_index, addrs);
+
+    ip6_fib_lpm_rebuild();
+    lpm = im->fib_lpm;
+    FIB_TEST((NULL != lpm), "LPM rebuilt");
+    FIB_TEST((0 == lpm->n_missing_lengths), "LPM has all lengths");
+    FIB_TEST((lpm->depth <= 8), "LPM depth:%d", lpm->depth);
+    res += fib_test_ip6_lpm_validate(fib_index, addrs);
+
+    t_lpm = clib_cpu_time_now();
+    vec_foreach(a, addrs)
+        ip6_fib_table_fwding_lookup(im, fib_index, a);
+    t_lpm = clib_cpu_time_now() - t_lpm;
+
+    im->fib_lpm = NULL;
+    t_linear = clib_cpu_time_now();
+    vec_foreach(a, addrs)
+        ip6_fib_table_fwding_lookup(im, fib_index, a);
+    t_linear = clib_cpu_time_now() - t_linear;
+    im->fib_lpm = lpm;
+
+    vlib_cli_output(vlib_get_main(),
+                    "%d routes %d lengths: linear %.2f LPM %.2f "
+                    "clocks/lookup, %U",
+                    vec_len(pfxs),
+                    vec_len(im->ip6_table[IP6_FIB_TABLE_FWDING].
+                            prefix_lengths_in_search_order),
+                    (f64)t_linear / N_LPM_LOOKUPS,
+                    (f64)t_lpm / N_LPM_LOOKUPS,
+                    format_ip6_fib_lpm);
+
+    /*
+     * remove every other route, and add them back, without a rebuild;
+     * the markers left behind must match the covering routes
+     */
+    for (ii = 0; ii < vec_len(pfxs); ii += 2)
+    {
+        fib_table_entry_special_remove(fib_index, &pfxs[ii], FIB_SOURCE_API);
+    }
+    FIB_TEST((lpm == im->fib_lpm), "LPM updated in place");
+    res += fib_test_ip6_lpm_validate(fib_index, addrs);
+
+    for (ii = 0; ii < vec_len(pfxs); ii += 2)
+    {
+        fib_table_entry_special_add(fib_index, &pfxs[ii], FIB_SOURCE_API,
+                                    FIB_ENTRY_FLAG_DROP);
+    }
+    FIB_TEST((lpm == im->fib_lpm), "LPM updated in place");
+    FIB_TEST((0 == lpm->n_missing_lengths), "LPM has all lengths");
+    res += fib_test_ip6_lpm_validate(fib_index, addrs);
+
+    /*
+     * remove every other route and rebuild
+     */
+    for (ii = 0; ii < vec_len(pfxs); ii += 2)
+    {
+        fib_table_entry_special_remove(fib_index, &pfxs[ii], FIB_SOURCE_API);
+    }
+    ip6_fib_lpm_rebuild();
+    FIB_TEST((NULL != im->fib_lpm), "LPM rebuilt");
+    res += fib_test_ip6_lpm_validate(fib_index, addrs);
+
+    for (ii = 1; ii < vec_len(pfxs); ii += 2)
+    {
+        fib_table_entry_special_remove(fib_index, &pfxs[ii], FIB_SOURCE_API);
+    }
+    res += fib_test_ip6_lpm_validate(fib_index, addrs);
+
+    fib_table_unlock(fib_index, FIB_PROTOCOL_IP6, FIB_SOURCE_API);
+    ip6_fib_lpm_rebuild();
+
+    vec_free(pfxs);
+    vec_free(addrs);
+
+    return (res);
+}
+
 static clib_error_t *
 fib_test (vlib_main_t * vm,
           unformat_input_t * input,
@@ -10581,6 +11258,18 @@ fib_test (vlib_main_t * vm,
     {
         res += fib_test_sticky();
     }
+    else if (unformat (input, "mtrie"))
+    {
+        res += fib_test_mtrie();
+    }
+    else if (unformat (input, "poptrie"))
+    {
+        res += fib_test_poptrie();
+    }
+    else if (unformat (input, "lpm"))
+    {
+        res += fib_test_ip6_lpm();
+    }
     else
     {
         res += fib_test_v4();
@@ -10591,6 +11280,9 @@ fib_test (vlib_main_t * vm,
         res += fib_test_label();
         res += fib_test_inherit();
         res += lfib_test();
+        res += fib_test_mtrie();
+        res += fib_test_poptrie();
+        res += fib_test_ip6_lpm();
 
         /*
          * fib-walk process must be disabled in order for the walk tests to work
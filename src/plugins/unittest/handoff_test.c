@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+
+#define HANDOFF_TEST_I(_cond, _comment, _args...)		\
+({								\
+  int _evald = (_cond);						\
+  if (!(_evald)) {						\
+    fformat(stderr, "FAIL:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  } else {							\
+    fformat(stderr, "PASS:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  }								\
+  _evald;							\
+})
+#define HANDOFF_TEST(_cond, _comment, _args...)			\
+{								\
+  if (!HANDOFF_TEST_I(_cond, _comment, ##_args)) {		\
+    return 1;							\
+  }								\
+}
+
+typedef struct
+{
+  /* frame queues handing off to the sink, by transport */
+  u32 fq_index_elt;
+  u32 fq_index_ring;
+
+  /* indices received by the sink, in order */
+  u32 *received;
+  u32 n_frames;
+
+  u8 fq_created;
+} handoff_test_main_t;
+
+static handoff_test_main_t handoff_test_main;
+
+static uword
+handoff_test_sink_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+		      vlib_frame_t * frame)
+{
+  handoff_test_main_t *htm = &handoff_test_main;
+
+  vec_add (htm->received, vlib_frame_vector_args (frame), frame->n_vectors);
+  htm->n_frames++;
+
+  return frame->n_vectors;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (handoff_test_sink_node, static) =
+{
+  .function = handoff_test_sink_fn,
+  .name = "handoff-test-sink",
+  .vector_size = sizeof (u32),
+  .type = VLIB_NODE_TYPE_INTERNAL,
+};
+/* *INDENT-ON* */
+
+static u32
+handoff_test_fq_create (u32 ring_size)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u32 save = tm->handoff_ring_size, fq_index;
+
+  tm->handoff_ring_size = ring_size;
+  fq_index = vlib_frame_queue_main_init (handoff_test_sink_node.index, 0);
+  tm->handoff_ring_size = save;
+
+  return fq_index;
+}
+
+/* let the main loop dispatch the frames pending to the sink */
+static void
+handoff_test_dispatch (vlib_main_t * vm)
+{
+  vlib_process_suspend (vm, 1e-3);
+}
+
+static int
+handoff_test_ring (vlib_main_t * vm)
+{
+  handoff_test_main_t *htm = &handoff_test_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_handoff_ring_t *r;
+  u32 bi[VLIB_FRAME_SIZE], extra, n_alloc, n_enq, i, j, tail, n_bad;
+  u16 ti[VLIB_FRAME_SIZE];
+
+  fqm = vec_elt_at_index (tm->frame_queue_mains, htm->fq_index_ring);
+  r = fqm->handoff_rings[vm->thread_index][vm->thread_index];
+  tail = r->tail;
+
+  n_alloc = vlib_buffer_alloc (vm, bi, VLIB_FRAME_SIZE);
+  HANDOFF_TEST ((n_alloc == VLIB_FRAME_SIZE), "buffers allocated");
+  for (i = 0; i < VLIB_FRAME_SIZE; i++)
+    ti[i] = vm->thread_index;
+
+  /*
+   * small frames from the producer wrap the ring many times, and are
+   * seen by the consumer in order
+   */
+  vec_reset_length (htm->received);
+  for (i = 0; i < 1000; i++)
+    {
+      n_enq = vlib_buffer_enqueue_to_thread (vm, htm->fq_index_ring,
+					     bi + (i % 64), ti, 3, 1);
+      if (n_enq != 3)
+	break;
+      vlib_frame_queue_dequeue (vm, fqm);
+    }
+  HANDOFF_TEST ((i == 1000), "3 packet frames enqueued");
+  handoff_test_dispatch (vm);
+  HANDOFF_TEST ((vec_len (htm->received) == 3000),
+		"3000 packets received: %d", vec_len (htm->received));
+  n_bad = 0;
+  for (i = 0; i < 1000; i++)
+    for (j = 0; j < 3; j++)
+      n_bad += (htm->received[i * 3 + j] != bi[(i % 64) + j]);
+  HANDOFF_TEST ((n_bad == 0), "received in order");
+  HANDOFF_TEST ((r->head == r->tail && r->tail - tail == 3000),
+		"ring drained, head %u tail %u", r->head, r->tail);
+
+  /*
+   * frames from the producer are coalesced by the consumer; four frames of
+   * 64 arrive as one of 256
+   */
+  vec_reset_length (htm->received);
+  htm->n_frames = 0;
+  for (i = 0; i < 4; i++)
+    vlib_buffer_enqueue_to_thread (vm, htm->fq_index_ring, bi + i * 64, ti,
+				   64, 1);
+  vlib_frame_queue_dequeue (vm, fqm);
+  handoff_test_dispatch (vm);
+  HANDOFF_TEST ((htm->n_frames == 1 &&
+		 vec_len (htm->received) == VLIB_FRAME_SIZE),
+		"4 frames coalesced: %d frames %d packets", htm->n_frames,
+		vec_len (htm->received));
+
+  /*
+   * with no credits left the producer drops, rather than blocking, only
+   * what does not fit
+   */
+  vec_reset_length (htm->received);
+  n_enq = vlib_buffer_enqueue_to_thread (vm, htm->fq_index_ring, bi, ti,
+					 VLIB_FRAME_SIZE, 1);
+  HANDOFF_TEST ((n_enq == VLIB_FRAME_SIZE), "full frame enqueued");
+  HANDOFF_TEST ((r->tail - r->head == VLIB_FRAME_SIZE), "credits consumed");
+  while (vlib_handoff_ring_credits (r))
+    {
+      /* fill the ring with copies of the first index; the sink only
+         records what it receives */
+      r->buffer_index[r->tail & r->mask] = bi[0];
+      r->tail++;
+    }
+  vlib_handoff_ring_flush (r, vm->thread_index);
+  j = r->credit_stalls;
+
+  /* a buffer dropped on congestion is freed, so send a fresh one */
+  n_alloc = vlib_buffer_alloc (vm, &extra, 1);
+  HANDOFF_TEST ((n_alloc == 1), "buffer allocated");
+  n_enq = vlib_buffer_enqueue_to_thread (vm, htm->fq_index_ring, &extra, ti,
+					 1, 1);
+  HANDOFF_TEST ((n_enq == 0 && r->credit_stalls == j + 1),
+		"congested ring drops");
+
+  /* drain what the consumer has been sent; the first frame is the real
+     indices, the filler is discarded */
+  while (vlib_frame_queue_dequeue (vm, fqm))
+    ;
+  handoff_test_dispatch (vm);
+  HANDOFF_TEST ((vec_len (htm->received) == r->mask + 1),
+		"ring drained: %d", vec_len (htm->received));
+  HANDOFF_TEST ((vlib_handoff_ring_credits (r) == r->mask + 1),
+		"credits returned");
+
+  vlib_buffer_free_no_next (vm, bi, VLIB_FRAME_SIZE);
+  return 0;
+}
+
+/*
+ * Handoff cost, per packet, to this thread for a range of frame sizes,
+ * with the frame queue element and the ring transports.
+ */
+static int
+handoff_test_perf (vlib_main_t * vm, u32 n_iter)
+{
+  handoff_test_main_t *htm = &handoff_test_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u32 bi[VLIB_FRAME_SIZE], n_alloc, i, s, t;
+  u32 sizes[] = { 1, 4, 16, 64, 256 };
+  u32 fq_index[2] = { htm->fq_index_elt, htm->fq_index_ring };
+  u64 clocks[2];
+  u16 ti[VLIB_FRAME_SIZE];
+  u64 t0;
+
+  n_alloc = vlib_buffer_alloc (vm, bi, VLIB_FRAME_SIZE);
+  HANDOFF_TEST ((n_alloc == VLIB_FRAME_SIZE), "buffers allocated");
+  for (i = 0; i < VLIB_FRAME_SIZE; i++)
+    ti[i] = vm->thread_index;
+
+  for (s = 0; s < ARRAY_LEN (sizes); s++)
+    {
+      for (t = 0; t < 2; t++)
+	{
+	  vlib_frame_queue_main_t *fqm =
+	    vec_elt_at_index (tm->frame_queue_mains, fq_index[t]);
+
+	  /* start from an empty queue */
+	  while (vlib_frame_queue_dequeue (vm, fqm))
+	    ;
+	  handoff_test_dispatch (vm);
+	  vec_reset_length (htm->received);
+	  clocks[t] = 0;
+	  for (i = 0; i < n_iter; i++)
+	    {
+	      t0 = clib_cpu_time_now ();
+	      vlib_buffer_enqueue_to_thread (vm, fq_index[t], bi, ti,
+					     sizes[s], 0);
+	      vlib_frame_queue_dequeue (vm, fqm);
+	      clocks[t] += clib_cpu_time_now () - t0;
+
+	      /* don't let the pending frames pile up */
+	      if ((i & 63) == 63)
+		handoff_test_dispatch (vm);
+	    }
+	  handoff_test_dispatch (vm);
+	  HANDOFF_TEST ((vec_len (htm->received) == n_iter * sizes[s]),
+			"%s received %d", t ? "ring" : "elt",
+			vec_len (htm->received));
+	}
+      vlib_cli_output (vm, "frame %3u: elt %8.2f ring %8.2f "
+		       "clocks/packet", sizes[s],
+		       (f64) clocks[0] / (n_iter * sizes[s]),
+		       (f64) clocks[1] / (n_iter * sizes[s]));
+    }
+
+  vlib_buffer_free_no_next (vm, bi, VLIB_FRAME_SIZE);
+  return 0;
+}
+
+static clib_error_t *
+handoff_test (vlib_main_t * vm,
+	      unformat_input_t * input, vlib_cli_command_t * cmd_arg)
+{
+  handoff_test_main_t *htm = &handoff_test_main;
+  u32 n_iter = 10000, ring_size = 1024;
+  int res = 0, perf = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "perf"))
+	perf = 1;
+      else if (unformat (input, "iterations %u", &n_iter))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  /* the sink's queues are made once, the first time they're needed */
+  if (!htm->fq_created)
+    {
+      htm->fq_index_elt = handoff_test_fq_create (0);
+      htm->fq_index_ring = handoff_test_fq_create (ring_size);
+      htm->fq_created = 1;
+    }
+
+  if (perf)
+    res = handoff_test_perf (vm, n_iter);
+  else
+    res = handoff_test_ring (vm);
+
+  if (res)
+    return clib_error_return (0, "Handoff unit test failed");
+
+  vlib_cli_output (vm, "Handoff unit test OK");
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_handoff_command, static) =
+{
+  .path = "test handoff",
+  .short_help = "test handoff [perf [iterations <n>]]",
+  .function = handoff_test,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <vlib/vlib.h>
+
+#define IDLE_TEST_I(_cond, _comment, _args...)			\
+({								\
+  int _evald = (_cond);						\
+  if (!(_evald)) {						\
+    fformat(stderr, "FAIL:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  } else {							\
+    fformat(stderr, "PASS:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  }								\
+  _evald;							\
+})
+#define IDLE_TEST(_cond, _comment, _args...)			\
+{								\
+  if (!IDLE_TEST_I(_cond, _comment, ##_args)) {			\
+    return 1;							\
+  }								\
+}
+
+typedef struct
+{
+  /* runs of the interrupt node, on any thread */
+  volatile u32 n_runs;
+} idle_test_main_t;
+
+static idle_test_main_t idle_test_main;
+
+static uword
+idle_test_interrupt_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+			vlib_frame_t * frame)
+{
+  clib_atomic_fetch_add (&idle_test_main.n_runs, 1);
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (idle_test_interrupt_node, static) =
+{
+  .function = idle_test_interrupt_fn,
+  .name = "idle-test-interrupt",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_INTERRUPT,
+};
+/* *INDENT-ON* */
+
+/* wait for the worker to reach the longest sleep of its governor */
+static int
+idle_test_wait_for_sleep (vlib_main_t * vm, vlib_main_t * wvm)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_idle_governor_t *g = &wvm->idle_governor;
+  f64 t0 = unix_time_now ();
+
+  while (!(g->sleeping && g->sleep_usec == tm->idle_max_sleep_usec))
+    {
+      if (unix_time_now () - t0 > 10.0)
+	return 0;
+      vlib_process_suspend (vm, 1e-4);
+    }
+  return 1;
+}
+
+static int
+idle_test_wakeup (vlib_main_t * vm, u32 n_rounds)
+{
+  idle_test_main_t *itm = &idle_test_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  f64 max_sleep = 1e-6 * tm->idle_max_sleep_usec, t0, dt;
+  vlib_main_t *wvm = vlib_mains[1];
+  u32 i, n_runs;
+
+  /*
+   * Without a wake-up the worker would only notice once its sleep ends,
+   * half the longest sleep on average; allow it a quarter and take a few
+   * rounds so that a missed wake-up can't pass by chance.
+   */
+  for (i = 0; i < n_rounds; i++)
+    {
+      IDLE_TEST (idle_test_wait_for_sleep (vm, wvm),
+		 "round %u: worker asleep before the interrupt", i);
+      n_runs = itm->n_runs;
+      t0 = unix_time_now ();
+      vlib_node_set_interrupt_pending (wvm, idle_test_interrupt_node.index);
+      while (itm->n_runs == n_runs && unix_time_now () - t0 < 2 * max_sleep)
+	vlib_process_suspend (vm, 1e-4);
+      dt = unix_time_now () - t0;
+      IDLE_TEST ((itm->n_runs != n_runs && dt < max_sleep / 4),
+		 "round %u: interrupt ran after %.6fs", i, dt);
+
+      IDLE_TEST (idle_test_wait_for_sleep (vm, wvm),
+		 "round %u: worker asleep before the barrier", i);
+      t0 = unix_time_now ();
+      vlib_worker_thread_barrier_sync (vm);
+      dt = unix_time_now () - t0;
+      vlib_worker_thread_barrier_release (vm);
+      IDLE_TEST ((dt < max_sleep / 4),
+		 "round %u: barrier held after %.6fs", i, dt);
+    }
+
+  return 0;
+}
+
+static clib_error_t *
+idle_test (vlib_main_t * vm,
+	   unformat_input_t * input, vlib_cli_command_t * cmd_arg)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  u32 n_rounds = 4;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "rounds %u", &n_rounds))
+	;
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+
+  if (vec_len (vlib_mains) < 2 || tm->idle_max_sleep_usec == 0)
+    return clib_error_return (0, "needs workers and "
+			      "cpu { idle-max-sleep-usec <n> }");
+
+  if (idle_test_wakeup (vm, n_rounds))
+    return clib_error_return (0, "Idle governor unit test failed");
+
+  vlib_cli_output (vm, "Idle governor unit test OK");
+  return 0;
+}
+
+/*
+ * Runs without the barrier, the worker has to be left to fall asleep.
+ */
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_idle_command, static) =
+{
+  .path = "test idle",
+  .short_help = "test idle [rounds <n>]",
+  .function = idle_test,
+  .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -66,6 +66,261 @@ VLIB_CLI_COMMAND (test_ipsec_command, static) =
 };
 /* *INDENT-ON* */
 
+#define IPSEC_TEST_I(_cond, _comment, _args...)			\
+({								\
+  int _evald = (_cond);						\
+  if (!(_evald)) {						\
+    fformat(stderr, "FAIL:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  } else {							\
+    fformat(stderr, "PASS:%d: " _comment "\n",			\
+	    __LINE__, ##_args);					\
+  }								\
+  _evald;							\
+})
+#define IPSEC_TEST(_cond, _comment, _args...)			\
+{								\
+  if (!IPSEC_TEST_I(_cond, _comment, ##_args)) {		\
+    return 1;							\
+  }								\
+}
+
+/* the SPD and SA IDs used by the inbound protect lookup test */
+#define IPSEC_TEST_SPD_ID 7001
+#define IPSEC_TEST_SA_TUN_A 7001
+#define IPSEC_TEST_SA_TRA 7002
+#define IPSEC_TEST_SA_TUN_B 7003
+#define IPSEC_TEST_SA_TUN_C 7004
+
+/*
+ * The first inbound protect policy a walk of the SPD's policy vector
+ * finds, which is what the indexed lookup must return.
+ */
+static ipsec_policy_t *
+ipsec_test_protect_walk (ipsec_spd_t * spd, u32 sa, u32 da, u32 spi)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p;
+  ipsec_sa_t *s;
+  u32 *i;
+
+  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT])
+  {
+    p = pool_elt_at_index (im->policies, *i);
+    s = pool_elt_at_index (im->sad, p->sa_index);
+
+    if (spi != s->spi)
+      continue;
+
+    if (s->is_tunnel)
+      {
+	if (da == clib_net_to_host_u32 (s->tunnel_dst_addr.ip4.as_u32) &&
+	    sa == clib_net_to_host_u32 (s->tunnel_src_addr.ip4.as_u32))
+	  return p;
+	continue;
+      }
+
+    if (da >= clib_net_to_host_u32 (p->laddr.start.ip4.as_u32) &&
+	da <= clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32) &&
+	sa >= clib_net_to_host_u32 (p->raddr.start.ip4.as_u32) &&
+	sa <= clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+      return p;
+  }
+  return 0;
+}
+
+/* the indexed lookup agrees with the walk for each probe */
+static int
+ipsec_test_protect_check (u32 spd_id)
+{
+  /* {src, dst, spi}, in host byte order */
+  static const u32 probes[][3] = {
+    {0x01010101, 0x02020202, 100},
+    {0x01010101, 0x02020202, 200},
+    {0x01010101, 0x02020202, 300},
+    {0x03030303, 0x02020202, 100},
+    {0x02020202, 0x01010101, 100},
+  };
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p, *w;
+  ipsec_spd_t *spd;
+  uword *e;
+  int i;
+
+  e = hash_get (im->spd_index_by_spd_id, spd_id);
+  IPSEC_TEST (NULL != e, "SPD %d exists", spd_id);
+  spd = pool_elt_at_index (im->spds, e[0]);
+
+  for (i = 0; i < ARRAY_LEN (probes); i++)
+    {
+      p = ipsec_input_protect_policy_match (spd, probes[i][0], probes[i][1],
+					    probes[i][2]);
+      w = ipsec_test_protect_walk (spd, probes[i][0], probes[i][1],
+				   probes[i][2]);
+      IPSEC_TEST (p == w, "probe %d: lookup policy %d, walk policy %d", i,
+		  p ? p - im->policies : -1, w ? w - im->policies : -1);
+    }
+  return 0;
+}
+
+static int
+ipsec_test_protect_policy (vlib_main_t * vm, ipsec_policy_t * policy,
+			   u32 sa_id, i32 priority, int is_add, u32 * index)
+{
+  clib_memset (policy, 0, sizeof (*policy));
+  policy->id = IPSEC_TEST_SPD_ID;
+  policy->type = IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT;
+  policy->policy = IPSEC_POLICY_ACTION_PROTECT;
+  policy->sa_id = sa_id;
+  policy->priority = priority;
+  policy->laddr.stop.ip4.as_u32 = ~0;
+  policy->raddr.stop.ip4.as_u32 = ~0;
+  policy->lport.stop = policy->rport.stop = ~0;
+
+  return ipsec_add_del_policy (vm, policy, is_add, index);
+}
+
+/*
+ * Add and delete inbound protect policies of equal and different priority,
+ * overlapping on the same packets, and the SPD itself, checking after
+ * every change that the indexed lookup finds what the SPD walk finds.
+ */
+static int
+ipsec_test_protect (vlib_main_t * vm)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ip46_address_t src = { }, dst = { }, none = { };
+  ipsec_key_t key = { };
+  ipsec_policy_t pol[4];
+  u32 idx[4], sai;
+  ipsec_spd_t *spd;
+  int i, rv;
+
+  src.ip4.as_u32 = clib_host_to_net_u32 (0x01010101);
+  dst.ip4.as_u32 = clib_host_to_net_u32 (0x02020202);
+
+  rv = ipsec_sa_add (IPSEC_TEST_SA_TUN_A, 100, IPSEC_PROTOCOL_ESP,
+		     IPSEC_CRYPTO_ALG_NONE, &key, IPSEC_INTEG_ALG_NONE, &key,
+		     IPSEC_SA_FLAG_IS_TUNNEL, 0, &src, &dst, &sai);
+  rv |= ipsec_sa_add (IPSEC_TEST_SA_TRA, 100, IPSEC_PROTOCOL_ESP,
+		      IPSEC_CRYPTO_ALG_NONE, &key, IPSEC_INTEG_ALG_NONE, &key,
+		      IPSEC_SA_FLAG_NONE, 0, &none, &none, &sai);
+  rv |= ipsec_sa_add (IPSEC_TEST_SA_TUN_B, 100, IPSEC_PROTOCOL_ESP,
+		      IPSEC_CRYPTO_ALG_NONE, &key, IPSEC_INTEG_ALG_NONE, &key,
+		      IPSEC_SA_FLAG_IS_TUNNEL, 0, &src, &dst, &sai);
+  rv |= ipsec_sa_add (IPSEC_TEST_SA_TUN_C, 200, IPSEC_PROTOCOL_ESP,
+		      IPSEC_CRYPTO_ALG_NONE, &key, IPSEC_INTEG_ALG_NONE, &key,
+		      IPSEC_SA_FLAG_IS_TUNNEL, 0, &src, &dst, &sai);
+  IPSEC_TEST (0 == rv, "SAs added");
+  IPSEC_TEST (0 == ipsec_add_del_spd (vm, IPSEC_TEST_SPD_ID, 1),
+	      "SPD added");
+
+  /*
+   * All of equal priority: a tunnel policy, a transport one whose ranges
+   * cover the tunnel's packets, a second tunnel policy for the same
+   * {spi, src, dst} and one for another SPI. SPD order decides.
+   */
+  IPSEC_TEST (0 == ipsec_test_protect_policy (vm, &pol[0],
+					       IPSEC_TEST_SA_TUN_A, 10, 1,
+					       &idx[0]), "tunnel policy");
+  if (ipsec_test_protect_check (IPSEC_TEST_SPD_ID))
+    return 1;
+  IPSEC_TEST (0 == ipsec_test_protect_policy (vm, &pol[1],
+					       IPSEC_TEST_SA_TRA, 10, 1,
+					       &idx[1]), "range policy");
+  if (ipsec_test_protect_check (IPSEC_TEST_SPD_ID))
+    return 1;
+  IPSEC_TEST (0 == ipsec_test_protect_policy (vm, &pol[2],
+					       IPSEC_TEST_SA_TUN_B, 10, 1,
+					       &idx[2]), "second tunnel policy");
+  if (ipsec_test_protect_check (IPSEC_TEST_SPD_ID))
+    return 1;
+  IPSEC_TEST (0 == ipsec_test_protect_policy (vm, &pol[3],
+					       IPSEC_TEST_SA_TUN_C, 10, 1,
+					       &idx[3]), "other SPI policy");
+  if (ipsec_test_protect_check (IPSEC_TEST_SPD_ID))
+    return 1;
+
+  /* the tie is broken the way the SPD orders its policies */
+  spd = pool_elt_at_index (im->spds, hash_get (im->spd_index_by_spd_id,
+					       IPSEC_TEST_SPD_ID)[0]);
+  IPSEC_TEST (idx[0] == ipsec_input_protect_policy_match
+	      (spd, 0x01010101, 0x02020202, 100) - im->policies,
+	      "first tunnel policy wins the tie");
+
+  /* delete the first, the range policy now comes ahead of the second
+     tunnel policy the index holds */
+  IPSEC_TEST (0 == ipsec_test_protect_policy (vm, &pol[0],
+					       IPSEC_TEST_SA_TUN_A, 10, 0,
+					       &idx[0]), "tunnel policy del");
+  if (ipsec_test_protect_check (IPSEC_TEST_SPD_ID))
+    return 1;
+  IPSEC_TEST (idx[1] == ipsec_input_protect_policy_match
+	      (spd, 0x01010101, 0x02020202, 100) - im->policies,
+	      "range policy wins the tie");
+
+  /* a higher priority tunnel policy overrides the range */
+  IPSEC_TEST (0 == ipsec_test_protect_policy (vm, &pol[0],
+					       IPSEC_TEST_SA_TUN_A, 20, 1,
+					       &idx[0]), "tunnel policy re-add");
+  if (ipsec_test_protect_check (IPSEC_TEST_SPD_ID))
+    return 1;
+
+  /* delete the SPD with its index populated, and create it again */
+  IPSEC_TEST (0 == ipsec_add_del_spd (vm, IPSEC_TEST_SPD_ID, 0),
+	      "SPD deleted");
+  IPSEC_TEST (0 == ipsec_add_del_spd (vm, IPSEC_TEST_SPD_ID, 1),
+	      "SPD re-added");
+  if (ipsec_test_protect_check (IPSEC_TEST_SPD_ID))
+    return 1;
+  spd = pool_elt_at_index (im->spds, hash_get (im->spd_index_by_spd_id,
+					       IPSEC_TEST_SPD_ID)[0]);
+  IPSEC_TEST (NULL == ipsec_input_protect_policy_match
+	      (spd, 0x01010101, 0x02020202, 100),
+	      "no stale policy after SPD re-add");
+
+  for (i = 3; i >= 1; i--)
+    {
+      IPSEC_TEST (0 == ipsec_test_protect_policy (vm, &pol[i],
+						   pol[i].sa_id, 10, 1,
+						   &idx[i]), "policy %d re-add",
+		  i);
+      if (ipsec_test_protect_check (IPSEC_TEST_SPD_ID))
+	return 1;
+    }
+
+  IPSEC_TEST (0 == ipsec_add_del_spd (vm, IPSEC_TEST_SPD_ID, 0),
+	      "SPD deleted");
+  rv = ipsec_sa_del (IPSEC_TEST_SA_TUN_A);
+  rv |= ipsec_sa_del (IPSEC_TEST_SA_TRA);
+  rv |= ipsec_sa_del (IPSEC_TEST_SA_TUN_B);
+  rv |= ipsec_sa_del (IPSEC_TEST_SA_TUN_C);
+  IPSEC_TEST (0 == rv, "SAs deleted");
+
+  return 0;
+}
+
+static clib_error_t *
+test_ipsec_protect_command_fn (vlib_main_t * vm,
+			       unformat_input_t * input,
+			       vlib_cli_command_t * cmd)
+{
+  if (ipsec_test_protect (vm))
+    return clib_error_return (0, "IPsec inbound protect test failed");
+
+  vlib_cli_output (vm, "IPsec inbound protect test OK");
+  return (NULL);
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (test_ipsec_protect_command, static) =
+{
+  .path = "test ipsec protect",
+  .short_help = "test ipsec protect",
+  .function = test_ipsec_protect_command_fn,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
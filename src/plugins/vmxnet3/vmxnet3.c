@@ -809,14 +809,12 @@ vmxnet3_create_if (vlib_main_t * vm, vmxnet3_create_if_args_t * args)
   {
     vmxnet3_rxq_t *rxq = vec_elt_at_index (vd->rxqs, qid);
     u32 thread_index;
-    u32 numa_node;
 
     vnet_hw_interface_assign_rx_thread (vnm, vd->hw_if_index, qid, ~0);
     thread_index = vnet_get_device_input_thread_index (vnm, vd->hw_if_index,
 						       qid);
-    numa_node = vlib_mains[thread_index]->numa_node;
     rxq->buffer_pool_index =
-      vlib_buffer_pool_get_default_for_numa (vm, numa_node);
+      vlib_buffer_pool_get_for_rx_queue (vm, vd->numa_node, thread_index);
     vmxnet3_rxq_refill_ring0 (vm, vd, rxq);
     vmxnet3_rxq_refill_ring1 (vm, vd, rxq);
   }
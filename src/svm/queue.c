@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <poll.h>
 #include <vppinfra/mem.h>
 #include <vppinfra/format.h>
 #include <vppinfra/cache.h>
@@ -82,6 +83,17 @@ svm_queue_alloc_and_init (int nels, int elsize, int consumer_pid)
   return q;
 }
 
+svm_queue_t *
+svm_queue_alloc_and_init_spsc (int nels, int elsize, int consumer_pid)
+{
+  svm_queue_t *q;
+
+  q = svm_queue_alloc_and_init (nels, elsize, consumer_pid);
+  q->flags |= SVM_QUEUE_F_SPSC;
+
+  return q;
+}
+
 /*
  * svm_queue_free
  */
@@ -96,12 +108,16 @@ svm_queue_free (svm_queue_t * q)
 void
 svm_queue_lock (svm_queue_t * q)
 {
+  if (svm_queue_is_spsc (q))
+    return;
   pthread_mutex_lock (&q->mutex);
 }
 
 void
 svm_queue_unlock (svm_queue_t * q)
 {
+  if (svm_queue_is_spsc (q))
+    return;
   pthread_mutex_unlock (&q->mutex);
 }
 
@@ -185,6 +201,131 @@ svm_queue_timedwait (svm_queue_t * q, double timeout)
   return svm_queue_timedwait_inline (q, timeout);
 }
 
+/*
+ * Single producer, single consumer variants. The producer only ever
+ * touches tail, the consumer only ever touches head. cursize is the
+ * only shared index: the producer publishes elements with a release
+ * add, the consumer hands slots back with a release sub. No mutex,
+ * no condvar. The queue's event fd fields are not used: a queue shared
+ * between processes has different fds in each, so the caller passes
+ * its own. The consumer is signaled only on the empty to non-empty
+ * edge, the producer only when it has announced it is waiting for room.
+ */
+static inline void
+svm_queue_spsc_signal (int fd)
+{
+  int __clib_unused rv;
+  u64 data = 1;
+
+  if (fd == -1)
+    return;
+
+  rv = write (fd, &data, sizeof (data));
+}
+
+static int
+svm_queue_spsc_add (svm_queue_t * q, u8 ** elems, int n_elems, int nowait,
+		    int signal_fd)
+{
+  i8 *tailp;
+  int i;
+
+  while (clib_atomic_load_acq_n (&q->cursize) + n_elems > q->maxsize)
+    {
+      if (nowait)
+	return (-2);
+      CLIB_PAUSE ();
+    }
+
+  for (i = 0; i < n_elems; i++)
+    {
+      tailp = (i8 *) (&q->data[0] + q->elsize * q->tail);
+      clib_memcpy_fast (tailp, elems[i], q->elsize);
+      q->tail++;
+      if (q->tail == q->maxsize)
+	q->tail = 0;
+    }
+
+  if (clib_atomic_fetch_add_rel (&q->cursize, n_elems) == 0)
+    svm_queue_spsc_signal (signal_fd);
+
+  return 0;
+}
+
+static int
+svm_queue_spsc_sub (svm_queue_t * q, u8 * elem,
+		    svm_q_conditional_wait_t cond, u32 time, int wake_fd)
+{
+  i8 *headp;
+
+  if (PREDICT_FALSE (clib_atomic_load_acq_n (&q->cursize) == 0))
+    {
+      f64 max_time;
+
+      if (cond == SVM_Q_NOWAIT)
+	return (-2);
+
+      max_time = unix_time_now () + time;
+      while (clib_atomic_load_acq_n (&q->cursize) == 0)
+	{
+	  if (cond == SVM_Q_TIMEDWAIT && unix_time_now () >= max_time)
+	    return ETIMEDOUT;
+	  CLIB_PAUSE ();
+	}
+    }
+
+  headp = (i8 *) (&q->data[0] + q->elsize * q->head);
+  clib_memcpy_fast (elem, headp, q->elsize);
+
+  q->head++;
+  if (q->head == q->maxsize)
+    q->head = 0;
+
+  clib_atomic_fetch_sub_rel (&q->cursize, 1);
+
+  /*
+   * Full barrier, so that either the producer sees the room made above
+   * or we see its announcement
+   */
+  if (wake_fd != -1 && clib_atomic_cmp_and_swap (&q->producer_waiting, 1, 0))
+    svm_queue_spsc_signal (wake_fd);
+
+  return 0;
+}
+
+int
+svm_queue_spsc_add_wait (svm_queue_t * q, u8 ** elems, int n_elems,
+			 int wait_fd, int signal_fd)
+{
+  struct pollfd pfd = {.fd = wait_fd,.events = POLLIN };
+  int __clib_unused rv;
+  u64 data;
+
+  while (svm_queue_spsc_add (q, elems, n_elems, 1 /* nowait */ , signal_fd))
+    {
+      if (wait_fd == -1)
+	return (-2);
+      /*
+       * Announce the wait, then look again: the consumer may have made
+       * room before it could see the announcement. The timeout only
+       * matters if the consumer goes away.
+       */
+      clib_atomic_cmp_and_swap (&q->producer_waiting, 0, 1);
+      if (clib_atomic_load_acq_n (&q->cursize) + n_elems <= q->maxsize)
+	continue;
+      if (poll (&pfd, 1, SVM_QUEUE_SPSC_WAIT_MS) > 0)
+	rv = read (wait_fd, &data, sizeof (data));
+    }
+
+  return 0;
+}
+
+int
+svm_queue_spsc_sub_nowait (svm_queue_t * q, u8 * elem, int wake_fd)
+{
+  return svm_queue_spsc_sub (q, elem, SVM_Q_NOWAIT, 0, wake_fd) ? -1 : 0;
+}
+
 /*
  * svm_queue_add_nolock
  */
@@ -194,6 +335,9 @@ svm_queue_add_nolock (svm_queue_t * q, u8 * elem)
   i8 *tailp;
   int need_broadcast = 0;
 
+  if (svm_queue_is_spsc (q))
+    return svm_queue_spsc_add (q, &elem, 1, 0 /* nowait */ , -1);
+
   if (PREDICT_FALSE (q->cursize == q->maxsize))
     {
       while (q->cursize == q->maxsize)
@@ -221,6 +365,12 @@ svm_queue_add_raw (svm_queue_t * q, u8 * elem)
 {
   i8 *tailp;
 
+  if (svm_queue_is_spsc (q))
+    {
+      (void) svm_queue_spsc_add (q, &elem, 1, 0 /* nowait */ , -1);
+      return;
+    }
+
   tailp = (i8 *) (&q->data[0] + q->elsize * q->tail);
   clib_memcpy_fast (tailp, elem, q->elsize);
 
@@ -241,6 +391,9 @@ svm_queue_add (svm_queue_t * q, u8 * elem, int nowait)
   i8 *tailp;
   int need_broadcast = 0;
 
+  if (svm_queue_is_spsc (q))
+    return svm_queue_spsc_add (q, &elem, 1, nowait, -1);
+
   if (nowait)
     {
       /* zero on success */
@@ -291,6 +444,12 @@ svm_queue_add2 (svm_queue_t * q, u8 * elem, u8 * elem2, int nowait)
   i8 *tailp;
   int need_broadcast = 0;
 
+  if (svm_queue_is_spsc (q))
+    {
+      u8 *elems[2] = { elem, elem2 };
+      return svm_queue_spsc_add (q, elems, 2, nowait, -1);
+    }
+
   if (nowait)
     {
       /* zero on success */
@@ -352,6 +511,9 @@ svm_queue_sub (svm_queue_t * q, u8 * elem, svm_q_conditional_wait_t cond,
   int need_broadcast = 0;
   int rc = 0;
 
+  if (svm_queue_is_spsc (q))
+    return svm_queue_spsc_sub (q, elem, cond, time, -1);
+
   if (cond == SVM_Q_NOWAIT)
     {
       /* zero on success */
@@ -415,6 +577,9 @@ svm_queue_sub2 (svm_queue_t * q, u8 * elem)
   int need_broadcast;
   i8 *headp;
 
+  if (svm_queue_is_spsc (q))
+    return svm_queue_spsc_sub_nowait (q, elem, -1);
+
   pthread_mutex_lock (&q->mutex);
   if (q->cursize == 0)
     {
@@ -444,6 +609,9 @@ svm_queue_sub_raw (svm_queue_t * q, u8 * elem)
 {
   i8 *headp;
 
+  if (svm_queue_is_spsc (q))
+    return svm_queue_spsc_sub (q, elem, SVM_Q_WAIT, 0, -1);
+
   if (PREDICT_FALSE (q->cursize == 0))
     {
       while (q->cursize == 0)
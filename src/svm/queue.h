@@ -34,9 +34,19 @@ typedef struct _svm_queue
   int consumer_pid;
   int producer_evtfd;
   int consumer_evtfd;
+  int flags;
+  volatile int producer_waiting;	/* spsc: producer blocked on full */
   char data[0];
 } svm_queue_t;
 
+/** Single producer, single consumer queue. The mutex is never taken, the
+    producer owns tail, the consumer owns head and only cursize is shared */
+#define SVM_QUEUE_F_SPSC (1 << 0)
+
+/** Longest a blocked spsc producer sleeps before looking at the queue
+    again, should its wakeup be lost with the consumer */
+#define SVM_QUEUE_SPSC_WAIT_MS 1000
+
 typedef enum
 {
   SVM_Q_WAIT = 0,	/**< blocking call - best used in combination with
@@ -69,6 +79,41 @@ typedef enum
  */
 svm_queue_t *svm_queue_alloc_and_init (int nels, int elsize,
 				       int consumer_pid);
+
+/**
+ * Allocate and initialize a single producer, single consumer svm queue
+ *
+ * Same as @ref svm_queue_alloc_and_init but the queue never takes its
+ * mutex. Exactly one thread may add to it and exactly one thread may
+ * remove from it. The generic add and sub calls poll the queue; use
+ * @ref svm_queue_spsc_add_wait and @ref svm_queue_spsc_sub_nowait to
+ * signal the peer through event fds instead.
+ */
+svm_queue_t *svm_queue_alloc_and_init_spsc (int nels, int elsize,
+					    int consumer_pid);
+
+/**
+ * Add elements to a spsc queue, sleeping on wait_fd while there is no
+ * room for them all
+ *
+ * The fds are eventfds of the calling process, since the fds of a queue
+ * shared between processes differ in each. signal_fd is written on the
+ * empty to non-empty transition, so a burst of messages costs at most
+ * one doorbell. wait_fd is written by the consumer once it has made
+ * room, see @ref svm_queue_spsc_sub_nowait.
+ *
+ * @return 0 on success, -2 if there is no room and wait_fd is -1
+ */
+int svm_queue_spsc_add_wait (svm_queue_t * q, u8 ** elems, int n_elems,
+			     int wait_fd, int signal_fd);
+
+/**
+ * Take from a spsc queue without waiting, writing wake_fd if the
+ * producer is sleeping in @ref svm_queue_spsc_add_wait
+ *
+ * @return 0 on success, -1 if the queue is empty
+ */
+int svm_queue_spsc_sub_nowait (svm_queue_t * q, u8 * elem, int wake_fd);
 svm_queue_t *svm_queue_init (void *base, int nels, int elsize);
 void svm_queue_free (svm_queue_t * q);
 int svm_queue_add (svm_queue_t * q, u8 * elem, int nowait);
@@ -82,6 +127,12 @@ int svm_queue_is_full (svm_queue_t * q);
 int svm_queue_add_nolock (svm_queue_t * q, u8 * elem);
 int svm_queue_sub_raw (svm_queue_t * q, u8 * elem);
 
+static inline int
+svm_queue_is_spsc (svm_queue_t * q)
+{
+  return (q->flags & SVM_QUEUE_F_SPSC) != 0;
+}
+
 /**
  * Wait for queue event
  *
@@ -503,7 +503,7 @@ vlib_buffer_pool_create (vlib_main_t * vm, char *name, u32 data_size,
   uword start = pointer_to_uword (m->base);
   uword size = (uword) m->n_pages << m->log2_page_size;
   uword i, j;
-  u32 alloc_size, n_alloc_per_page;
+  u32 alloc_size, n_alloc_per_page, n_magazines;
 
   if (vec_len (bm->buffer_pools) >= 255)
     return ~0;
@@ -576,6 +576,35 @@ vlib_buffer_pool_create (vlib_main_t * vm, char *name, u32 data_size,
       }
 
   bp->n_buffers = vec_len (bp->buffers);
+
+  /* split the free buffers into full magazines, with spare empty ones for
+     the threads to return buffers in */
+  n_magazines = bp->n_buffers / VLIB_BUFFER_MAGAZINE_SIZE + 2;
+  bp->magazines = clib_mem_alloc_aligned (n_magazines *
+					  sizeof (vlib_buffer_magazine_t),
+					  CLIB_CACHE_LINE_BYTES);
+  bp->full.index = bp->empty.index = VLIB_BUFFER_DEPOT_EMPTY;
+  bp->full.tag = bp->empty.tag = 0;
+  bp->n_avail = 0;
+
+  for (i = 0; i < n_magazines; i++)
+    {
+      vlib_buffer_magazine_t *mag = bp->magazines + i;
+      u32 n = clib_min (bp->n_buffers - bp->n_avail,
+			VLIB_BUFFER_MAGAZINE_SIZE);
+
+      mag->n_buffers = n;
+      if (n)
+	{
+	  vlib_buffer_copy_indices (mag->buffers, bp->buffers + bp->n_avail,
+				    n);
+	  bp->n_avail += n;
+	  vlib_buffer_depot_push (bp, &bp->full, i);
+	}
+      else
+	vlib_buffer_depot_push (bp, &bp->empty, i);
+    }
+
   return bp->index;
 }
 
@@ -600,8 +629,8 @@ format_vlib_buffer_pool (u8 * s, va_list * va)
   s = format (s, "%-20s%=6d%=6d%=6u%=11u%=6u%=8u%=8u%=8u",
 	      bp->name, bp->index, bp->numa_node, bp->data_size +
 	      sizeof (vlib_buffer_t) + vm->buffer_main->ext_hdr_size,
-	      bp->data_size, bp->n_buffers, vec_len (bp->buffers), cached,
-	      bp->n_buffers - vec_len (bp->buffers) - cached);
+	      bp->data_size, bp->n_buffers, bp->n_avail, cached,
+	      bp->n_buffers - bp->n_avail - cached);
 
   return s;
 }
@@ -613,6 +642,9 @@ show_buffers (vlib_main_t * vm,
   vlib_buffer_main_t *bm = vm->buffer_main;
   vlib_buffer_pool_t *bp;
 
+  vlib_buffer_pool_thread_t *bpt;
+  int header = 0;
+
   vlib_cli_output (vm, "%U", format_vlib_buffer_pool, vm, 0);
 
   /* *INDENT-OFF* */
@@ -620,6 +652,23 @@ show_buffers (vlib_main_t * vm,
     vlib_cli_output (vm, "%U", format_vlib_buffer_pool, vm, bp);
   /* *INDENT-ON* */
 
+  /* threads touching buffers in another numa node's memory */
+  /* *INDENT-OFF* */
+  vec_foreach (bp, bm->buffer_pools)
+    vec_foreach (bpt, bp->threads)
+      {
+        if (bpt->n_remote_allocs == 0 && bpt->n_remote_frees == 0)
+          continue;
+        if (!header)
+          vlib_cli_output (vm, "\n%-20s%=8s%=14s%=14s", "Pool Name",
+                           "Thread", "Remote Alloc", "Remote Free");
+        header = 1;
+        vlib_cli_output (vm, "%-20s%=8d%=14llu%=14llu", bp->name,
+                         bpt - bp->threads, bpt->n_remote_allocs,
+                         bpt->n_remote_frees);
+      }
+  /* *INDENT-ON* */
+
   return 0;
 }
 
@@ -758,7 +807,7 @@ buffer_gauges_update_used_fn (stat_segment_directory_entry_t * e, u32 index)
   if (!bp)
     return;
 
-  e->value = bp->n_buffers - vec_len (bp->buffers) - buffer_get_cached (bp);
+  e->value = bp->n_buffers - bp->n_avail - buffer_get_cached (bp);
 }
 
 static void
@@ -770,7 +819,7 @@ buffer_gauges_update_available_fn (stat_segment_directory_entry_t * e,
   if (!bp)
     return;
 
-  e->value = vec_len (bp->buffers);
+  e->value = bp->n_avail;
 }
 
 static void
@@ -897,6 +946,8 @@ vlib_buffers_configure (vlib_main_t * vm, unformat_input_t * input)
       else if (unformat (input, "default data-size %u",
 			 &bm->default_data_size))
 	;
+      else if (unformat (input, "remote-free-batch"))
+	bm->remote_free_batch = 1;
       else
 	return unformat_parse_error (input);
     }
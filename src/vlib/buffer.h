@@ -371,7 +371,37 @@ typedef struct
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   u32 *cached_buffers;
   u32 n_alloc;
+  /* buffers this thread allocated from, or freed to, a pool on another
+     numa node; each is a header and data in remote memory */
+  u64 n_remote_allocs;
+  u64 n_remote_frees;
 } vlib_buffer_pool_thread_t;
+
+/* Buffers exchanged between a thread's cache and the depot at a time */
+#define VLIB_BUFFER_MAGAZINE_SIZE 256
+
+typedef struct
+{
+  /* next magazine on the depot stack */
+  u32 next;
+  u32 n_buffers;
+  u32 buffers[VLIB_BUFFER_MAGAZINE_SIZE];
+} vlib_buffer_magazine_t;
+
+/* Head of a lock-free stack of magazines. The tag changes on every push
+   and pop so that a stale head cannot be swapped back in (ABA). */
+typedef union
+{
+  struct
+  {
+    u32 index;
+    u32 tag;
+  };
+  u64 as_u64;
+} vlib_buffer_depot_t;
+
+#define VLIB_BUFFER_DEPOT_EMPTY ((u32) ~0)
+
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -383,11 +413,21 @@ typedef struct
   u32 physmem_map_index;
   u32 data_size;
   u32 n_buffers;
+  /* every buffer in the pool */
   u32 *buffers;
   u8 *name;
   clib_spinlock_t lock;
 
+  /* magazines of free buffers; threads refill their caches from, and
+     spill them to, the depot without taking the lock */
+  vlib_buffer_magazine_t *magazines;
+  CLIB_CACHE_LINE_ALIGN_MARK (depot_cacheline);
+  vlib_buffer_depot_t full;
+  vlib_buffer_depot_t empty;
+  volatile u32 n_avail;
+
   /* per-thread data */
+  CLIB_CACHE_LINE_ALIGN_MARK (threads_cacheline);
   vlib_buffer_pool_thread_t *threads;
 
   /* buffer metadata template */
@@ -417,6 +457,9 @@ typedef struct
   u32 buffers_per_numa;
   u16 ext_hdr_size;
   u32 default_data_size;
+  /* return buffers freed on another numa node to their pool's depot in
+     whole magazines rather than keeping them in the thread's cache */
+  u8 remote_free_batch;
 
   /* logging */
   vlib_log_class_t log_default;
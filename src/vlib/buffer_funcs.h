@@ -166,6 +166,29 @@ vlib_buffer_pool_get_default_for_numa (vlib_main_t * vm, u32 numa_node)
   return vm->buffer_main->default_buffer_pool_index_for_numa[numa_node];
 }
 
+/** \brief Select the buffer pool for a device rx queue
+
+    The pool on the device's numa node is preferred, so that received
+    packets are written to memory local to the device. The node of the
+    thread polling the queue is used when the device's is not known.
+
+    @param vm - (vlib_main_t *) vlib main data structure pointer
+    @param device_numa_node - (u32) numa node of the device, or ~0
+    @param thread_index - (u32) thread polling the queue
+    @return - (u8) buffer pool index
+*/
+always_inline u8
+vlib_buffer_pool_get_for_rx_queue (vlib_main_t * vm, u32 device_numa_node,
+				   u32 thread_index)
+{
+  u32 numa_node = device_numa_node;
+
+  if (numa_node >= VLIB_BUFFER_MAX_NUMA_NODES)
+    numa_node = vlib_mains[thread_index]->numa_node;
+
+  return vlib_buffer_pool_get_default_for_numa (vm, numa_node);
+}
+
 /** \brief Translate array of buffer indices into buffer pointers with offset
 
     @param vm - (vlib_main_t *) vlib main data structure pointer
@@ -481,34 +504,83 @@ vlib_get_buffer_pool (vlib_main_t * vm, u8 buffer_pool_index)
   return vec_elt_at_index (bm->buffer_pools, buffer_pool_index);
 }
 
-static_always_inline uword
-vlib_buffer_pool_get (vlib_main_t * vm, u8 buffer_pool_index, u32 * buffers,
-		      u32 n_buffers)
+static_always_inline void
+vlib_buffer_depot_push (vlib_buffer_pool_t * bp, vlib_buffer_depot_t * depot,
+			u32 magazine_index)
 {
-  vlib_buffer_pool_t *bp = vlib_get_buffer_pool (vm, buffer_pool_index);
-  u32 len;
+  vlib_buffer_depot_t old, new;
 
-  ASSERT (bp->buffers);
-
-  clib_spinlock_lock (&bp->lock);
-  len = vec_len (bp->buffers);
-  if (PREDICT_TRUE (n_buffers < len))
+  old.as_u64 = __atomic_load_n (&depot->as_u64, __ATOMIC_RELAXED);
+  do
     {
-      len -= n_buffers;
-      vlib_buffer_copy_indices (buffers, bp->buffers + len, n_buffers);
-      _vec_len (bp->buffers) = len;
-      clib_spinlock_unlock (&bp->lock);
-      return n_buffers;
+      bp->magazines[magazine_index].next = old.index;
+      new.index = magazine_index;
+      new.tag = old.tag + 1;
     }
-  else
+  while (!__atomic_compare_exchange_n (&depot->as_u64, &old.as_u64,
+				       new.as_u64, 1 /* weak */ ,
+				       __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static_always_inline u32
+vlib_buffer_depot_pop (vlib_buffer_pool_t * bp, vlib_buffer_depot_t * depot)
+{
+  vlib_buffer_depot_t old, new;
+
+  old.as_u64 = __atomic_load_n (&depot->as_u64, __ATOMIC_ACQUIRE);
+  do
     {
-      vlib_buffer_copy_indices (buffers, bp->buffers, len);
-      _vec_len (bp->buffers) = 0;
-      clib_spinlock_unlock (&bp->lock);
-      return len;
+      if (old.index == VLIB_BUFFER_DEPOT_EMPTY)
+	return VLIB_BUFFER_DEPOT_EMPTY;
+
+      /* may be stale if another thread pops this magazine first, in which
+         case the tag has moved on and the swap fails */
+      new.index = *(volatile u32 *) &bp->magazines[old.index].next;
+      new.tag = old.tag + 1;
     }
+  while (!__atomic_compare_exchange_n (&depot->as_u64, &old.as_u64,
+				       new.as_u64, 1 /* weak */ ,
+				       __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+  return old.index;
 }
 
+/** \brief Move full magazines from the pool's depot to the thread's cache
+
+    @param bp - (vlib_buffer_pool_t *) buffer pool
+    @param bpt - (vlib_buffer_pool_thread_t *) the thread's cache
+    @param n_buffers - (u32) number of buffers wanted in the cache
+    @return - (u32) number of buffers in the cache
+*/
+static_always_inline u32
+vlib_buffer_pool_refill (vlib_buffer_pool_t * bp,
+			 vlib_buffer_pool_thread_t * bpt, u32 n_buffers)
+{
+  vlib_buffer_magazine_t *m;
+  u32 len, mi;
+
+  len = vec_len (bpt->cached_buffers);
+
+  while (len < n_buffers)
+    {
+      mi = vlib_buffer_depot_pop (bp, &bp->full);
+      if (mi == VLIB_BUFFER_DEPOT_EMPTY)
+	break;
+
+      m = bp->magazines + mi;
+      vec_validate_aligned (bpt->cached_buffers, len + m->n_buffers - 1,
+			    CLIB_CACHE_LINE_BYTES);
+      vlib_buffer_copy_indices (bpt->cached_buffers + len, m->buffers,
+				m->n_buffers);
+      len += m->n_buffers;
+      clib_atomic_fetch_sub (&bp->n_avail, m->n_buffers);
+
+      vlib_buffer_depot_push (bp, &bp->empty, mi);
+    }
+
+  _vec_len (bpt->cached_buffers) = len;
+  return len;
+}
 
 /** \brief Allocate buffers from specific pool into supplied array
 
@@ -542,6 +614,9 @@ vlib_buffer_alloc_from_pool (vlib_main_t * vm, u32 * buffers, u32 n_buffers,
       vlib_buffer_copy_indices (dst, src, n_buffers);
       _vec_len (bpt->cached_buffers) -= n_buffers;
 
+      if (PREDICT_FALSE (bp->numa_node != vm->numa_node))
+	bpt->n_remote_allocs += n_buffers;
+
       if (CLIB_DEBUG > 0)
 	vlib_buffer_validate_alloc_free (vm, buffers, n_buffers,
 					 VLIB_BUFFER_KNOWN_FREE);
@@ -557,11 +632,7 @@ vlib_buffer_alloc_from_pool (vlib_main_t * vm, u32 * buffers, u32 n_buffers,
       n_left -= len;
     }
 
-  len = round_pow2 (n_left, 32);
-  vec_validate_aligned (bpt->cached_buffers, len - 1, CLIB_CACHE_LINE_BYTES);
-  len = vlib_buffer_pool_get (vm, buffer_pool_index, bpt->cached_buffers,
-			      len);
-  _vec_len (bpt->cached_buffers) = len;
+  len = vlib_buffer_pool_refill (bp, bpt, n_left);
 
   if (len)
     {
@@ -574,6 +645,9 @@ vlib_buffer_alloc_from_pool (vlib_main_t * vm, u32 * buffers, u32 n_buffers,
 
   n_buffers -= n_left;
 
+  if (PREDICT_FALSE (bp->numa_node != vm->numa_node))
+    bpt->n_remote_allocs += n_buffers;
+
   /* Verify that buffers are known free. */
   if (CLIB_DEBUG > 0)
     vlib_buffer_validate_alloc_free (vm, buffers, n_buffers,
@@ -683,6 +757,7 @@ vlib_buffer_pool_put (vlib_main_t * vm, u8 buffer_pool_index,
   vlib_buffer_pool_t *bp = vlib_get_buffer_pool (vm, buffer_pool_index);
   vlib_buffer_pool_thread_t *bpt =
     vec_elt_at_index (bp->threads, vm->thread_index);
+  u32 n_keep = 4 * VLIB_BUFFER_MAGAZINE_SIZE;
 
   if (CLIB_DEBUG > 0)
     vlib_buffer_validate_alloc_free (vm, buffers, n_buffers,
@@ -691,15 +766,34 @@ vlib_buffer_pool_put (vlib_main_t * vm, u8 buffer_pool_index,
   vec_add_aligned (bpt->cached_buffers, buffers, n_buffers,
 		   CLIB_CACHE_LINE_BYTES);
 
-  if (vec_len (bpt->cached_buffers) > 4 * VLIB_FRAME_SIZE)
+  if (PREDICT_FALSE (bp->numa_node != vm->numa_node))
     {
-      clib_spinlock_lock (&bp->lock);
+      bpt->n_remote_frees += n_buffers;
+      /* this thread allocates from its own node's pool, so hand the
+         buffers back to the threads on the pool's node */
+      if (vm->buffer_main->remote_free_batch)
+	n_keep = VLIB_BUFFER_MAGAZINE_SIZE - 1;
+    }
+
+  while (vec_len (bpt->cached_buffers) > n_keep)
+    {
+      vlib_buffer_magazine_t *m;
+      u32 mi;
+
+      mi = vlib_buffer_depot_pop (bp, &bp->empty);
+      if (PREDICT_FALSE (mi == VLIB_BUFFER_DEPOT_EMPTY))
+	break;
+
       /* keep last stored buffers, as they are more likely hot in the cache */
-      vec_add_aligned (bp->buffers, bpt->cached_buffers, VLIB_FRAME_SIZE,
-		       CLIB_CACHE_LINE_BYTES);
-      vec_delete (bpt->cached_buffers, VLIB_FRAME_SIZE, 0);
-      bpt->n_alloc -= VLIB_FRAME_SIZE;
-      clib_spinlock_unlock (&bp->lock);
+      m = bp->magazines + mi;
+      vlib_buffer_copy_indices (m->buffers, bpt->cached_buffers,
+				VLIB_BUFFER_MAGAZINE_SIZE);
+      m->n_buffers = VLIB_BUFFER_MAGAZINE_SIZE;
+      vec_delete (bpt->cached_buffers, VLIB_BUFFER_MAGAZINE_SIZE, 0);
+      bpt->n_alloc -= VLIB_BUFFER_MAGAZINE_SIZE;
+
+      clib_atomic_fetch_add (&bp->n_avail, VLIB_BUFFER_MAGAZINE_SIZE);
+      vlib_buffer_depot_push (bp, &bp->full, mi);
     }
 }
 
@@ -483,6 +483,56 @@ next:
   vlib_put_next_frame (vm, node, next_index, n_left_to_next);
 }
 
+static_always_inline u32
+vlib_buffer_enqueue_to_thread_ring (vlib_main_t * vm,
+				    vlib_frame_queue_main_t * fqm,
+				    u32 * buffer_indices,
+				    u16 * thread_indices, u32 n_packets,
+				    int drop_on_congestion)
+{
+  u32 drop_list[VLIB_FRAME_SIZE], n_drop = 0;
+  vlib_handoff_ring_t *r = 0;
+  u32 i, credits = 0, current_thread_index = ~0;
+
+  for (i = 0; i < n_packets; i++)
+    {
+      if (thread_indices[i] != current_thread_index)
+	{
+	  current_thread_index = thread_indices[i];
+	  r = fqm->handoff_rings[current_thread_index][vm->thread_index];
+	  credits = vlib_handoff_ring_credits (r);
+	}
+
+      if (PREDICT_FALSE (credits == 0) &&
+	  (credits = vlib_handoff_ring_credits (r)) == 0)
+	{
+	  r->credit_stalls++;
+	  /* let the consumer have what we have written so far */
+	  vlib_handoff_ring_flush (r, current_thread_index);
+	  if (drop_on_congestion)
+	    {
+	      drop_list[n_drop++] = buffer_indices[i];
+	      continue;
+	    }
+	  while ((credits = vlib_handoff_ring_credits (r)) == 0)
+	    vlib_worker_thread_barrier_check ();
+	}
+
+      r->buffer_index[r->tail & r->mask] = buffer_indices[i];
+      r->tail++;
+      credits--;
+    }
+
+  /* publish once per frame to each thread we wrote to */
+  for (i = 0; i < vec_len (fqm->handoff_rings); i++)
+    vlib_handoff_ring_flush (fqm->handoff_rings[i][vm->thread_index], i);
+
+  if (n_drop)
+    vlib_buffer_free (vm, drop_list, n_drop);
+
+  return n_packets - n_drop;
+}
+
 static_always_inline u32
 vlib_buffer_enqueue_to_thread (vlib_main_t * vm, u32 frame_queue_index,
 			       u32 * buffer_indices, u16 * thread_indices,
@@ -499,6 +549,12 @@ vlib_buffer_enqueue_to_thread (vlib_main_t * vm, u32 frame_queue_index,
   int i;
 
   fqm = vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+
+  if (fqm->handoff_rings)
+    return vlib_buffer_enqueue_to_thread_ring (vm, fqm, buffer_indices,
+					       thread_indices, n_packets,
+					       drop_on_congestion);
+
   ptd = vec_elt_at_index (fqm->per_thread_data, vm->thread_index);
 
   while (n_left)
@@ -87,6 +87,43 @@ vlib_stats_pop_heap (void *notused, void *notused2, int type)
 {
 };
 
+void vlib_stats_retire (void *) __attribute__ ((weak));
+void
+vlib_stats_retire (void *v)
+{
+  vec_free (v);
+};
+
+void *
+vlib_stats_vec_validate_ (void *v, uword index, uword elt_bytes)
+{
+  uword len = vec_len (v), n;
+  void *new;
+
+  if (index < len)
+    return v;
+
+  /* Fits, grow in place: zero the new elements, then publish them */
+  if (!_vec_resize_will_expand (v, 0, (index + 1) * elt_bytes, 0, 0))
+    {
+      clib_memset (v + len * elt_bytes, 0, (index + 1 - len) * elt_bytes);
+      CLIB_MEMORY_STORE_BARRIER ();
+      _vec_len (v) = index + 1;
+      return v;
+    }
+
+  /* Move to a zeroed copy with room to grow, keep the old one alive */
+  n = clib_max (index + 1, 2 * len);
+  new = _vec_resize ((u8 *) 0, n, n * elt_bytes, 0, CLIB_CACHE_LINE_BYTES);
+  _vec_len (new) = index + 1;
+  if (v)
+    {
+      clib_memcpy_fast (new, v, len * elt_bytes);
+      vlib_stats_retire (v);
+    }
+  return new;
+}
+
 void
 vlib_validate_simple_counter (vlib_simple_counter_main_t * cm, u32 index)
 {
@@ -94,9 +131,9 @@ vlib_validate_simple_counter (vlib_simple_counter_main_t * cm, u32 index)
   int i;
   void *oldheap = vlib_stats_push_heap ();
 
-  vec_validate (cm->counters, tm->n_vlib_mains - 1);
+  vlib_stats_vec_validate (cm->counters, tm->n_vlib_mains - 1);
   for (i = 0; i < tm->n_vlib_mains; i++)
-    vec_validate_aligned (cm->counters[i], index, CLIB_CACHE_LINE_BYTES);
+    vlib_stats_vec_validate (cm->counters[i], index);
 
   vlib_stats_pop_heap (cm, oldheap,
 		       2 /* STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE */ );
@@ -109,9 +146,9 @@ vlib_validate_combined_counter (vlib_combined_counter_main_t * cm, u32 index)
   int i;
   void *oldheap = vlib_stats_push_heap ();
 
-  vec_validate (cm->counters, tm->n_vlib_mains - 1);
+  vlib_stats_vec_validate (cm->counters, tm->n_vlib_mains - 1);
   for (i = 0; i < tm->n_vlib_mains; i++)
-    vec_validate_aligned (cm->counters[i], index, CLIB_CACHE_LINE_BYTES);
+    vlib_stats_vec_validate (cm->counters[i], index);
 
   vlib_stats_pop_heap (cm, oldheap,
 		       3 /*STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED */ );
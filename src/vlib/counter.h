@@ -313,6 +313,25 @@ void vlib_validate_simple_counter (vlib_simple_counter_main_t * cm,
 void vlib_validate_combined_counter (vlib_combined_counter_main_t * cm,
 				     u32 index);
 
+/** Grow a vector in the stats segment to hold the given index.
+    Readers of the stats segment may be walking the vector without a
+    lock, so when it has to move the old copy is not freed in place but
+    handed to vlib_stats_retire, which frees it once no reader can still
+    be using it.
+
+    @param v - vector to grow
+    @param index - index which must be valid on return
+    @param elt_bytes - element size
+    @returns the vector, which may have moved
+*/
+void *vlib_stats_vec_validate_ (void *v, uword index, uword elt_bytes);
+
+#define vlib_stats_vec_validate(v,i) \
+  ((v) = vlib_stats_vec_validate_ ((v), (i), sizeof ((v)[0])))
+
+/** Free a stats segment vector, deferred while readers may use it */
+void vlib_stats_retire (void *v);
+
 /** Obtain the number of simple or combined counters allocated.
     A macro which reduces to to vec_len(cm->maxi), the answer in either
     case.
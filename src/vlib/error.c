@@ -160,7 +160,7 @@ vlib_register_errors (vlib_main_t * vm,
   oldheap = vlib_stats_push_heap ();
 
   /* Allocate a counter/elog type for each error. */
-  vec_validate (em->counters, l - 1);
+  vlib_stats_vec_validate (em->counters, l - 1);
 
   /* Zero counters for re-registrations of errors. */
   if (n->error_heap_index + n_errors <= vec_len (em->counters_last_clear))
@@ -37,7 +37,10 @@
  *  WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#define _GNU_SOURCE
+
 #include <math.h>
+#include <poll.h>
 #include <vppinfra/format.h>
 #include <vlib/vlib.h>
 #include <vlib/threads.h>
@@ -661,6 +664,17 @@ vlib_node_runtime_update_stats (vlib_main_t * vm,
     node->max_clock_n : n_vectors;
   node->max_clock = node->max_clock > n_clocks ? node->max_clock : n_clocks;
 
+  if (PREDICT_FALSE (vm->node_main.histograms != 0) && n_calls
+      && node->node_index < vec_len (vm->node_main.histograms))
+    {
+      vlib_node_histogram_t *h =
+	vm->node_main.histograms + node->node_index;
+      h->clocks[vlib_node_histogram_bucket
+		(n_clocks, VLIB_NODE_HISTOGRAM_CLOCK_BUCKETS)]++;
+      h->vectors[vlib_node_histogram_bucket
+		 (n_vectors, VLIB_NODE_HISTOGRAM_VECTOR_BUCKETS)]++;
+    }
+
   r = vlib_node_runtime_update_main_loop_vector_stats (vm, node, n_vectors);
 
   if (PREDICT_FALSE (ca1 < ca0 || v1 < v0 || cl1 < cl0) || (ptick01 < ptick00)
@@ -1670,6 +1684,110 @@ vl_api_send_pending_rpc_requests (vlib_main_t * vm)
 }
 
 
+/*
+ * Adaptive idle governor for workers. A worker whose main loops keep
+ * finding no packets, no handoff work and no pending interrupts first
+ * keeps busy polling for idle_poll_loops loops, then spins on pause for
+ * as many loops, and then sleeps, doubling the sleep each time up to
+ * idle_max_sleep_usec. The sleep length bounds the added latency of
+ * packets; barrier requests and interrupts wake the worker up at once.
+ * Any work resets the governor to busy polling.
+ */
+#define VLIB_IDLE_GOVERNOR_MIN_SLEEP_USEC 8
+#define VLIB_IDLE_GOVERNOR_PAUSES_PER_LOOP 16
+
+static_always_inline void
+vlib_worker_idle_governor (vlib_main_t * vm, vlib_thread_main_t * tm,
+			   u32 frame_queue_check_counter)
+{
+  vlib_idle_governor_t *g = &vm->idle_governor;
+  vlib_node_main_t *nm = &vm->node_main;
+  u64 now = clib_cpu_time_now ();
+  u64 dt = now - g->last_cpu_time;
+  struct timespec ts;
+  int i;
+
+  g->last_cpu_time = now;
+
+  /* Work this loop, handoff work in flight or barrier pending: poll */
+  if (vm->main_loop_vectors_processed || vm->check_frame_queues
+      || frame_queue_check_counter
+      || _vec_len (nm->pending_interrupt_node_runtime_indices)
+      || *vlib_worker_threads->wait_at_barrier)
+    {
+      g->clocks[VLIB_IDLE_GOVERNOR_POLL] += dt;
+      g->idle_loops = 0;
+      g->sleep_usec = 0;
+      return;
+    }
+
+  g->clocks[VLIB_IDLE_GOVERNOR_IDLE_POLL] += dt;
+
+  if (PREDICT_TRUE (++g->idle_loops < tm->idle_poll_loops))
+    return;
+
+  if (g->idle_loops < 2 * tm->idle_poll_loops)
+    {
+      for (i = 0; i < VLIB_IDLE_GOVERNOR_PAUSES_PER_LOOP; i++)
+	CLIB_PAUSE ();
+      g->last_cpu_time = clib_cpu_time_now ();
+      g->clocks[VLIB_IDLE_GOVERNOR_PAUSE] += g->last_cpu_time - now;
+      return;
+    }
+
+  /* Don't wrap idle_loops back into the polling phase */
+  g->idle_loops = 2 * tm->idle_poll_loops;
+  g->sleep_usec = g->sleep_usec ?
+    clib_min (2 * g->sleep_usec, tm->idle_max_sleep_usec) :
+    clib_min (VLIB_IDLE_GOVERNOR_MIN_SLEEP_USEC, tm->idle_max_sleep_usec);
+
+  ts.tv_sec = g->sleep_usec / 1000000;
+  ts.tv_nsec = 1000 * (g->sleep_usec % 1000000);
+
+  /*
+   * A barrier request or an interrupt made pending once sleeping is set
+   * writes the eventfd, one made before is seen here. Any early wake-up
+   * ends the sleep, the next main loop finds out why.
+   */
+  g->sleeping = 1;
+  CLIB_MEMORY_BARRIER ();
+  if (!_vec_len (nm->pending_interrupt_node_runtime_indices)
+      && !*vlib_worker_threads->wait_at_barrier)
+    {
+      struct pollfd pfd = {.fd = g->wakeup_fd,.events = POLLIN };
+      u64 n_wakeups;
+
+      if (ppoll (&pfd, g->wakeup_fd >= 0, &ts, 0) > 0 &&
+	  read (g->wakeup_fd, &n_wakeups, sizeof (n_wakeups)) < 0)
+	clib_unix_warning ("idle governor wakeup read");
+    }
+  g->sleeping = 0;
+
+  g->n_sleeps++;
+  g->last_cpu_time = clib_cpu_time_now ();
+  g->clocks[VLIB_IDLE_GOVERNOR_SLEEP] += g->last_cpu_time - now;
+}
+
+/*
+ * Wake a worker sleeping in its idle governor, once a barrier is requested
+ * or an interrupt is made pending on it.
+ */
+void
+vlib_worker_idle_wakeup (vlib_main_t * vm)
+{
+  vlib_idle_governor_t *g = &vm->idle_governor;
+  u64 one = 1;
+
+  if (PREDICT_TRUE (vlib_get_thread_main ()->idle_max_sleep_usec == 0))
+    return;
+
+  /* pairs with the barrier between setting sleeping and the last check */
+  CLIB_MEMORY_BARRIER ();
+  if (g->sleeping && g->wakeup_fd >= 0 &&
+      write (g->wakeup_fd, &one, sizeof (one)) < 0)
+    clib_unix_warning ("idle governor wakeup write");
+}
+
 static_always_inline void
 vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 {
@@ -1696,6 +1814,7 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
     }
   else
     cpu_time_now = clib_cpu_time_now ();
+  vm->idle_governor.last_cpu_time = cpu_time_now;
 
   /* Pre-allocate interupt runtime indices and lock. */
   vec_alloc (nm->pending_interrupt_node_runtime_indices, 32);
@@ -1908,6 +2027,9 @@ vlib_main_or_worker_loop (vlib_main_t * vm, int is_main)
 	      _vec_len (nm->data_from_advancing_timing_wheel) = 0;
 	    }
 	}
+      else if (PREDICT_FALSE (tm->idle_max_sleep_usec != 0))
+	vlib_worker_idle_governor (vm, tm, frame_queue_check_counter);
+
       vlib_increment_main_loop_counter (vm);
 
       /* Record time stamp in case there are no enabled nodes and above
@@ -65,6 +65,43 @@ typedef struct
   pcap_main_t pcap_main;
 } vnet_pcap_t;
 
+/* What an idle governed worker did with each main loop */
+#define foreach_vlib_idle_governor_state	\
+  _(POLL, "polling")				\
+  _(IDLE_POLL, "idle polling")			\
+  _(PAUSE, "pausing")				\
+  _(SLEEP, "sleeping")
+
+typedef enum
+{
+#define _(s,n) VLIB_IDLE_GOVERNOR_##s,
+  foreach_vlib_idle_governor_state
+#undef _
+    VLIB_IDLE_GOVERNOR_N_STATE,
+} vlib_idle_governor_state_t;
+
+/* Per-worker state of the adaptive poll / pause / sleep governor */
+typedef struct
+{
+  /* Consecutive main loops which found nothing to do */
+  u32 idle_loops;
+
+  /* Length of the next sleep, doubled up to the configured maximum */
+  u32 sleep_usec;
+
+  /* Time stamp of the end of the previous main loop */
+  u64 last_cpu_time;
+
+  /* Clocks spent in each state, and number of sleeps */
+  u64 clocks[VLIB_IDLE_GOVERNOR_N_STATE];
+  u64 n_sleeps;
+
+  /* Set while the worker sleeps, and the eventfd which wakes it up early
+     for a barrier or an interrupt, see vlib_worker_idle_wakeup () */
+  volatile u32 sleeping;
+  int wakeup_fd;
+} vlib_idle_governor_t;
+
 typedef struct vlib_main_t
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
@@ -239,6 +276,9 @@ typedef struct vlib_main_t
   /* Need to check the frame queues */
   volatile uword check_frame_queues;
 
+  /* Adaptive idle governor, workers only */
+  vlib_idle_governor_t idle_governor;
+
   /* RPC requests, main thread only */
   uword *pending_rpc_requests;
   uword *processing_rpc_requests;
@@ -250,6 +290,7 @@ typedef struct vlib_main_t
 extern vlib_main_t vlib_global_main;
 
 void vlib_worker_loop (vlib_main_t * vm);
+void vlib_worker_idle_wakeup (vlib_main_t * vm);
 
 always_inline f64
 vlib_time_now (vlib_main_t * vm)
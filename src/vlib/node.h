@@ -692,6 +692,25 @@ vlib_timing_wheel_data_get_index (u32 d)
   return d / 2;
 }
 
+/* log2 buckets: bucket 0 counts zeros, bucket b > 0 counts values in
+   [2^(b-1), 2^b), the last bucket also counts everything larger */
+#define VLIB_NODE_HISTOGRAM_CLOCK_BUCKETS 32
+#define VLIB_NODE_HISTOGRAM_VECTOR_BUCKETS 16
+
+/* Per-thread distribution of a node's clocks and vectors per call. */
+typedef struct
+{
+  u64 clocks[VLIB_NODE_HISTOGRAM_CLOCK_BUCKETS];
+  u64 vectors[VLIB_NODE_HISTOGRAM_VECTOR_BUCKETS];
+} vlib_node_histogram_t;
+
+always_inline u32
+vlib_node_histogram_bucket (uword x, u32 n_buckets)
+{
+  u32 b = x ? min_log2 (x) + 1 : 0;
+  return b < n_buckets ? b : n_buckets - 1;
+}
+
 typedef struct
 {
   /* Public nodes. */
@@ -759,6 +778,10 @@ typedef struct
   /* Time of last node runtime stats clear. */
   f64 time_last_runtime_stats_clear;
 
+  /* Histograms of clocks and vectors per call, by node index; null
+     unless enabled with "set runtime histogram". */
+  vlib_node_histogram_t *histograms;
+
   /* Node registrations added by constructors */
   vlib_node_registration_t *node_registrations;
 } vlib_node_main_t;
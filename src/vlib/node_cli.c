@@ -299,6 +299,25 @@ format_vlib_node_stats (u8 * s, va_list * va)
   return s;
 }
 
+static u8 *
+format_vlib_idle_governor (u8 * s, va_list * args)
+{
+  vlib_idle_governor_t *g = va_arg (*args, vlib_idle_governor_t *);
+  u64 total = 0;
+  int i;
+
+  for (i = 0; i < VLIB_IDLE_GOVERNOR_N_STATE; i++)
+    total += g->clocks[i];
+  total = clib_max (total, 1);
+
+  i = 0;
+#define _(st,n) s = format (s, "%s%s %.1f%%", i++ ? ", " : "", n,	\
+			    100.0 * g->clocks[VLIB_IDLE_GOVERNOR_##st] / total);
+  foreach_vlib_idle_governor_state
+#undef _
+  return format (s, ", %llu sleeps", g->n_sleeps);
+}
+
 static clib_error_t *
 show_node_runtime (vlib_main_t * vm,
 		   unformat_input_t * input, vlib_cli_command_t * cmd)
@@ -310,6 +329,7 @@ show_node_runtime (vlib_main_t * vm,
   vlib_node_t ***node_dups = 0;
   f64 *vectors_per_main_loop = 0;
   f64 *last_vector_length_per_node = 0;
+  vlib_idle_governor_t *idle_governors = 0;
 
   time_now = vlib_time_now (vm);
 
@@ -371,6 +391,7 @@ show_node_runtime (vlib_main_t * vm,
 		    vlib_last_vectors_per_main_loop_as_f64 (stat_vm));
 	  vec_add1 (last_vector_length_per_node,
 		    vlib_last_vector_length_per_node (stat_vm));
+	  vec_add1 (idle_governors, stat_vm->idle_governor);
 	}
       vlib_worker_thread_barrier_release (vm);
 
@@ -446,6 +467,10 @@ show_node_runtime (vlib_main_t * vm,
 	     (f64) n_input / dt,
 	     (f64) n_output / dt, (f64) n_drop / dt, (f64) n_punt / dt);
 
+	  if (j > 0 && vlib_get_thread_main ()->idle_max_sleep_usec)
+	    vlib_cli_output (vm, "  %U", format_vlib_idle_governor,
+			     idle_governors + j);
+
 	  vlib_cli_output (vm, "%U", format_vlib_node_stats, stat_vm, 0, max);
 	  for (i = 0; i < vec_len (nodes); i++)
 	    {
@@ -467,6 +492,7 @@ show_node_runtime (vlib_main_t * vm,
       vec_free (node_dups);
       vec_free (vectors_per_main_loop);
       vec_free (last_vector_length_per_node);
+      vec_free (idle_governors);
     }
 
   return 0;
@@ -514,6 +540,12 @@ clear_node_runtime (vlib_main_t * vm,
 	  r = vlib_node_get_runtime (stat_vm, n->index);
 	  r->max_clock = 0;
 	}
+      if (nm->histograms)
+	clib_memset (nm->histograms, 0,
+		     vec_len (nm->histograms) * sizeof (nm->histograms[0]));
+      clib_memset (stat_vm->idle_governor.clocks, 0,
+		   sizeof (stat_vm->idle_governor.clocks));
+      stat_vm->idle_governor.n_sleeps = 0;
       /* Note: input/output rates computed using vlib_global_main */
       nm->time_last_runtime_stats_clear = vlib_time_now (vm);
     }
@@ -533,6 +565,216 @@ VLIB_CLI_COMMAND (clear_node_runtime_command, static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+set_node_runtime_histogram (vlib_main_t * vm,
+			    unformat_input_t * input,
+			    vlib_cli_command_t * cmd)
+{
+  vlib_node_main_t *nm;
+  int i, enable;
+
+  if (unformat (input, "on") || unformat (input, "enable"))
+    enable = 1;
+  else if (unformat (input, "off") || unformat (input, "disable"))
+    enable = 0;
+  else
+    return clib_error_return (0, "expected on or off, got `%U'",
+			      format_unformat_error, input);
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      if (!vlib_mains[i])
+	continue;
+      nm = &vlib_mains[i]->node_main;
+      if (enable)
+	vec_validate_aligned (nm->histograms, vec_len (vm->node_main.nodes) - 1,
+			      CLIB_CACHE_LINE_BYTES);
+      else
+	vec_free (nm->histograms);
+    }
+
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
+/*?
+ * Start or stop recording, for every node on every thread, log2
+ * histograms of the clocks and the vectors per call. The histograms are
+ * shown by '<em>show runtime histogram</em>', cleared by
+ * '<em>clear runtime</em>' and exported through the stats segment as
+ * /sys/node/clocks_histogram and /sys/node/vectors_histogram, indexed by
+ * node index * buckets + bucket. Those are only allocated once recording
+ * is first turned on, together with /sys/node/clocks_histogram_bounds and
+ * /sys/node/vectors_histogram_bounds holding the lower bound of each
+ * bucket.
+ *
+ * @cliexpar
+ * @cliexcmd{set runtime histogram on}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_node_runtime_histogram_command, static) = {
+  .path = "set runtime histogram",
+  .short_help = "set runtime histogram on|off",
+  .function = set_node_runtime_histogram,
+};
+/* *INDENT-ON* */
+
+/* smallest bucket holding at least the given fraction of the samples */
+static u32
+node_histogram_percentile (u64 * counts, u32 n_buckets, u64 total, f64 p)
+{
+  u64 sum = 0, want = (u64) (p * total);
+  u32 b;
+
+  for (b = 0; b < n_buckets; b++)
+    {
+      sum += counts[b];
+      if (sum > 0 && sum >= want)
+	break;
+    }
+  return b < n_buckets ? b : n_buckets - 1;
+}
+
+static u8 *
+format_node_histogram_bucket (u8 * s, va_list * args)
+{
+  u32 b = va_arg (*args, u32);
+  u32 n_buckets = va_arg (*args, u32);
+
+  if (b == 0)
+    return format (s, "0");
+  if (b == n_buckets - 1)
+    return format (s, ">= %llu", 1ULL << (b - 1));
+  if (b == 1)
+    return format (s, "1");
+  return format (s, "%llu-%llu", 1ULL << (b - 1), (1ULL << b) - 1);
+}
+
+static u8 *
+format_node_histogram (u8 * s, va_list * args)
+{
+  char *what = va_arg (*args, char *);
+  u64 *counts = va_arg (*args, u64 *);
+  u32 n_buckets = va_arg (*args, u32);
+  int verbose = va_arg (*args, int);
+  u32 indent = format_get_indent (s);
+  u64 total = 0, sum = 0;
+  u32 b;
+
+  for (b = 0; b < n_buckets; b++)
+    total += counts[b];
+
+  s = format (s, "%s per call: p50 %U, p90 %U, p99 %U", what,
+	      format_node_histogram_bucket,
+	      node_histogram_percentile (counts, n_buckets, total, 0.50),
+	      n_buckets,
+	      format_node_histogram_bucket,
+	      node_histogram_percentile (counts, n_buckets, total, 0.90),
+	      n_buckets,
+	      format_node_histogram_bucket,
+	      node_histogram_percentile (counts, n_buckets, total, 0.99),
+	      n_buckets);
+
+  if (!verbose)
+    return s;
+
+  for (b = 0; b < n_buckets; b++)
+    {
+      if (counts[b] == 0)
+	continue;
+      sum += counts[b];
+      s = format (s, "\n%U%20U%16Ld%9.2f%%%9.2f%%",
+		  format_white_space, indent + 2,
+		  format_node_histogram_bucket, b, n_buckets, counts[b],
+		  100.0 * counts[b] / total, 100.0 * sum / total);
+    }
+  return s;
+}
+
+static clib_error_t *
+show_node_runtime_histogram (vlib_main_t * vm,
+			     unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  vlib_node_histogram_t *h, *hs = 0;
+  vlib_main_t *stat_vm;
+  u32 node_index = ~0, i, b;
+  u64 calls;
+  int verbose = 0;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "verbose"))
+	verbose = 1;
+      else if (unformat (input, "%U", unformat_vlib_node, vm, &node_index))
+	;
+      else
+	return clib_error_return (0, "unknown input `%U'",
+				  format_unformat_error, input);
+    }
+
+  if (node_index == ~0)
+    return clib_error_return (0, "node name required");
+
+  if (!vm->node_main.histograms)
+    return clib_error_return (0, "histograms not enabled, use "
+			      "'set runtime histogram on'");
+
+  /* take a consistent copy from each thread */
+  vlib_worker_thread_barrier_sync (vm);
+  vec_validate (hs, vec_len (vlib_mains) - 1);
+  for (i = 0; i < vec_len (vlib_mains); i++)
+    {
+      stat_vm = vlib_mains[i];
+      if (stat_vm && node_index < vec_len (stat_vm->node_main.histograms))
+	hs[i] = stat_vm->node_main.histograms[node_index];
+    }
+  vlib_worker_thread_barrier_release (vm);
+
+  vlib_cli_output (vm, "%U:", format_vlib_node_name, vm, node_index);
+  for (i = 0; i < vec_len (hs); i++)
+    {
+      h = hs + i;
+      calls = 0;
+      for (b = 0; b < VLIB_NODE_HISTOGRAM_VECTOR_BUCKETS; b++)
+	calls += h->vectors[b];
+      if (calls == 0)
+	continue;
+
+      vlib_cli_output (vm, "  Thread %d %s: %llu calls", i,
+		       vlib_worker_threads[i].name, calls);
+      vlib_cli_output (vm, "    %U", format_node_histogram, "clocks",
+		       h->clocks, VLIB_NODE_HISTOGRAM_CLOCK_BUCKETS, verbose);
+      vlib_cli_output (vm, "    %U", format_node_histogram, "vectors",
+		       h->vectors, VLIB_NODE_HISTOGRAM_VECTOR_BUCKETS,
+		       verbose);
+    }
+
+  vec_free (hs);
+  return 0;
+}
+
+/*?
+ * Show, per thread, the percentiles of a node's clocks and vectors per
+ * call recorded since '<em>set runtime histogram on</em>' or the last
+ * '<em>clear runtime</em>'. With '<em>verbose</em>' each non-empty log2
+ * bucket is listed with its count and cumulative share.
+ *
+ * @cliexpar
+ * @cliexcmd{show runtime histogram ip4-lookup verbose}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_node_runtime_histogram_command, static) = {
+  .path = "show runtime histogram",
+  .short_help = "show runtime histogram <node> [verbose]",
+  .function = show_node_runtime_histogram,
+  .is_mp_safe = 1,
+};
+/* *INDENT-ON* */
+
 static clib_error_t *
 show_node (vlib_main_t * vm, unformat_input_t * input,
 	   vlib_cli_command_t * cmd)
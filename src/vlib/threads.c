@@ -16,6 +16,7 @@
 
 #include <signal.h>
 #include <math.h>
+#include <sys/eventfd.h>
 #include <vppinfra/format.h>
 #include <vppinfra/linux/sysfs.h>
 #include <vlib/vlib.h>
@@ -778,6 +779,9 @@ start_workers (vlib_main_t * vm)
 	      _vec_len (vm_clone->pending_rpc_requests) = 0;
 	      clib_memset (&vm_clone->random_buffer, 0,
 			   sizeof (vm_clone->random_buffer));
+	      vm_clone->idle_governor.sleeping = 0;
+	      vm_clone->idle_governor.wakeup_fd = tm->idle_max_sleep_usec ?
+		eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC) : -1;
 
 	      nm = &vlib_mains[0]->node_main;
 	      nm_clone = &vm_clone->node_main;
@@ -1239,6 +1243,7 @@ cpu_config (vlib_main_t * vm, unformat_input_t * input)
   tm->sched_policy = ~0;
   tm->sched_priority = ~0;
   tm->main_lcore = ~0;
+  tm->idle_poll_loops = 1024;
 
   tr = tm->next;
 
@@ -1284,6 +1289,19 @@ cpu_config (vlib_main_t * vm, unformat_input_t * input)
 	;
       else if (unformat (input, "scheduler-priority %u", &tm->sched_priority))
 	;
+      else if (unformat (input, "handoff-ring-size %u",
+			 &tm->handoff_ring_size))
+	{
+	  if (!is_pow2 (tm->handoff_ring_size) ||
+	      tm->handoff_ring_size < VLIB_FRAME_SIZE)
+	    return clib_error_return (0, "handoff-ring-size must be a power "
+				      "of 2 of at least %u", VLIB_FRAME_SIZE);
+	}
+      else if (unformat (input, "idle-max-sleep-usec %u",
+			 &tm->idle_max_sleep_usec))
+	;
+      else if (unformat (input, "idle-poll-loops %u", &tm->idle_poll_loops))
+	;
       else if (unformat (input, "%s %u", &name, &count))
 	{
 	  p = hash_get_mem (tm->thread_registrations_by_name, name);
@@ -1389,7 +1407,7 @@ vlib_worker_thread_barrier_sync_int (vlib_main_t * vm, const char *func_name)
   f64 t_entry;
   f64 t_open;
   f64 t_closed;
-  u32 count;
+  u32 count, i;
 
   if (vec_len (vlib_mains) < 2)
     return;
@@ -1436,6 +1454,11 @@ vlib_worker_thread_barrier_sync_int (vlib_main_t * vm, const char *func_name)
   deadline = now + BARRIER_SYNC_TIMEOUT;
 
   *vlib_worker_threads->wait_at_barrier = 1;
+
+  /* don't wait for idle workers to wake up on their own */
+  for (i = 1; i <= count; i++)
+    vlib_worker_idle_wakeup (vlib_mains[i]);
+
   while (*vlib_worker_threads->workers_at_barrier != count)
     {
       if ((now = vlib_time_now (vm)) > deadline)
@@ -1569,6 +1592,79 @@ vlib_worker_thread_barrier_release (vlib_main_t * vm)
 
 }
 
+static vlib_handoff_ring_t *
+vlib_handoff_ring_alloc (u32 size)
+{
+  vlib_handoff_ring_t *r;
+  uword n_bytes = sizeof (*r) + size * sizeof (r->buffer_index[0]);
+
+  r = clib_mem_alloc_aligned (n_bytes, CLIB_CACHE_LINE_BYTES);
+  clib_memset (r, 0, n_bytes);
+  r->mask = size - 1;
+
+  return (r);
+}
+
+/*
+ * Drain the handoff rings from every thread into frames for the handoff
+ * node. Indices from different sources share a frame, so light traffic
+ * from many threads arrives as one frame rather than many small ones.
+ */
+static int
+vlib_handoff_ring_dequeue (vlib_main_t * vm, vlib_frame_queue_main_t * fqm)
+{
+  vlib_handoff_ring_t **rings = fqm->handoff_rings[vm->thread_index];
+  vlib_frame_queue_per_thread_data_t *ptd;
+  vlib_frame_t *f = 0;
+  u32 *to = 0, n_left_to_node = VLIB_FRAME_SIZE;
+  u32 i, head, n, n_copy, slot, n_rings = vec_len (rings);
+  int processed = 0;
+
+  /* start at a different source each time so none is starved */
+  ptd = vec_elt_at_index (fqm->per_thread_data, vm->thread_index);
+  ptd->next_handoff_ring = (ptd->next_handoff_ring + 1) % n_rings;
+
+  for (i = 0; i < n_rings && n_left_to_node; i++)
+    {
+      vlib_handoff_ring_t *r = rings[(ptd->next_handoff_ring + i) % n_rings];
+
+      head = r->head;
+      n = clib_atomic_load_acq_n (&r->published_tail) - head;
+      if (n == 0)
+	continue;
+
+      if (!f)
+	{
+	  f = vlib_get_frame_to_node (vm, fqm->node_index);
+	  to = vlib_frame_vector_args (f);
+	}
+
+      n = clib_min (n, n_left_to_node);
+      r->dequeue_vectors += n;
+      n_left_to_node -= n;
+      processed++;
+
+      /* the indices may wrap around the end of the ring */
+      slot = head & r->mask;
+      n_copy = clib_min (n, r->mask + 1 - slot);
+      clib_memcpy_fast (to, r->buffer_index + slot, n_copy * sizeof (u32));
+      clib_memcpy_fast (to + n_copy, r->buffer_index,
+			(n - n_copy) * sizeof (u32));
+      to += n;
+
+      /* return the slots to the producer */
+      clib_atomic_store_rel_n (&r->head, head + n);
+    }
+
+  if (f)
+    {
+      f->n_vectors = VLIB_FRAME_SIZE - n_left_to_node;
+      vlib_put_frame_to_node (vm, fqm->node_index, f);
+    }
+
+  return processed;
+}
+
 /*
  * Check the frame queue to see if any frames are available.
  * If so, pull the packets off the frames and put them to
@@ -1592,6 +1688,10 @@ vlib_frame_queue_dequeue (vlib_main_t * vm, vlib_frame_queue_main_t * fqm)
 
   if (PREDICT_FALSE (fqm->node_index == ~0))
     return 0;
+
+  if (fqm->handoff_rings)
+    return vlib_handoff_ring_dequeue (vm, fqm);
+
   /*
    * Gather trace data for frame queues
    */
@@ -1772,6 +1872,20 @@ vlib_frame_queue_main_init (u32 node_index, u32 frame_queue_nelts)
 			       (vlib_frame_queue_t *) (~0));
     }
 
+  if (tm->handoff_ring_size)
+    {
+      int j;
+
+      vec_validate (fqm->handoff_rings, tm->n_vlib_mains - 1);
+      for (i = 0; i < tm->n_vlib_mains; i++)
+	{
+	  vec_validate (fqm->handoff_rings[i], tm->n_vlib_mains - 1);
+	  for (j = 0; j < tm->n_vlib_mains; j++)
+	    fqm->handoff_rings[i][j] =
+	      vlib_handoff_ring_alloc (tm->handoff_ring_size);
+	}
+    }
+
   return (fqm - tm->frame_queue_mains);
 }
 
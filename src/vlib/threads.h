@@ -146,10 +146,45 @@ typedef struct
 }
 vlib_frame_queue_t;
 
+/*
+ * Single-producer, single-consumer ring of buffer indices handed off from
+ * one thread to another. The producer writes indices at tail and makes
+ * them visible to the consumer once per frame by publishing the tail; the
+ * consumer returns the slots it has read by moving head. Free slots are
+ * the producer's credits: it refreshes its copy of head only when it has
+ * run out.
+ */
+typedef struct
+{
+  /* producer side */
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  u32 tail;
+  u32 head_cache;
+  u64 enqueue_vectors;
+  u64 enqueue_flushes;
+  u64 credit_stalls;
+
+  /* producer to consumer */
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  volatile u32 published_tail;
+
+  /* consumer side */
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
+  volatile u32 head;
+  u64 dequeue_vectors;
+
+  /* read-only, constant, shared */
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline3);
+  u32 mask;
+  u32 buffer_index[0];
+}
+vlib_handoff_ring_t;
+
 typedef struct
 {
   vlib_frame_queue_elt_t **handoff_queue_elt_by_thread_index;
   vlib_frame_queue_t **congested_handoff_queue_by_thread_index;
+  u32 next_handoff_ring;
 } vlib_frame_queue_per_thread_data_t;
 
 typedef struct
@@ -161,6 +196,9 @@ typedef struct
   vlib_frame_queue_t **vlib_frame_queues;
   vlib_frame_queue_per_thread_data_t *per_thread_data;
 
+  /* handoff rings by destination then source thread, if in use */
+  vlib_handoff_ring_t ***handoff_rings;
+
   /* for frame queue tracing */
   frame_queue_trace_t *frame_queue_traces;
   frame_queue_nelt_counter_t *frame_queue_histogram;
@@ -325,6 +363,16 @@ typedef struct
   /* Worker handoff queues */
   vlib_frame_queue_main_t *frame_queue_mains;
 
+  /* Slots per handoff ring, 0 to hand off in frame queue elements */
+  u32 handoff_ring_size;
+
+  /* Idle workers back off to pause and then sleep for at most this
+     long, 0 to always busy poll */
+  u32 idle_max_sleep_usec;
+
+  /* Idle main loops before a worker starts to pause, then to sleep */
+  u32 idle_poll_loops;
+
   /* worker thread initialization barrier */
   volatile u32 worker_thread_release;
 
@@ -585,6 +633,54 @@ is_vlib_frame_queue_congested (u32 frame_queue_index,
   return NULL;
 }
 
+/* free slots in the ring, refreshing the view of the consumer's head
+   only when there appear to be none */
+static inline u32
+vlib_handoff_ring_credits (vlib_handoff_ring_t * r)
+{
+  u32 size = r->mask + 1;
+
+  if (PREDICT_FALSE (r->tail - r->head_cache == size))
+    r->head_cache = clib_atomic_load_acq_n (&r->head);
+
+  return size - (r->tail - r->head_cache);
+}
+
+/* make the indices written so far visible to the consumer */
+static inline void
+vlib_handoff_ring_flush (vlib_handoff_ring_t * r, u32 thread_index)
+{
+  if (r->tail == r->published_tail)
+    return;
+
+  r->enqueue_vectors += r->tail - r->published_tail;
+  r->enqueue_flushes++;
+  clib_atomic_store_rel_n (&r->published_tail, r->tail);
+  vlib_mains[thread_index]->check_frame_queues = 1;
+}
+
+/* nothing handed off to the thread on this queue waits to be dequeued;
+   only stable while the workers are held at the barrier */
+static inline int
+vlib_frame_queue_is_empty (u32 frame_queue_index, u32 thread_index)
+{
+  vlib_thread_main_t *tm = &vlib_thread_main;
+  vlib_frame_queue_main_t *fqm =
+    vec_elt_at_index (tm->frame_queue_mains, frame_queue_index);
+  vlib_frame_queue_t *fq = fqm->vlib_frame_queues[thread_index];
+  vlib_handoff_ring_t **r;
+
+  if (fq->head != fq->tail)
+    return 0;
+
+  if (fqm->handoff_rings)
+    vec_foreach (r, fqm->handoff_rings[thread_index])
+      if (r[0]->head != r[0]->published_tail)
+	return 0;
+
+  return 1;
+}
+
 static inline vlib_frame_queue_elt_t *
 vlib_get_worker_handoff_queue_elt (u32 frame_queue_index,
 				   u32 vlib_worker_index,
@@ -370,6 +370,53 @@ VLIB_CLI_COMMAND (cmd_show_frame_queue_trace,static) = {
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+show_frame_queue_rings (vlib_main_t * vm, unformat_input_t * input,
+			vlib_cli_command_t * cmd)
+{
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vlib_frame_queue_main_t *fqm;
+  vlib_handoff_ring_t *r;
+  u32 dst, src;
+
+  vec_foreach (fqm, tm->frame_queue_mains)
+  {
+    if (!fqm->handoff_rings)
+      continue;
+
+    vlib_cli_output (vm, "Worker handoff queue index %u (next node '%U'):",
+		     fqm - tm->frame_queue_mains,
+		     format_vlib_node_name, vm, fqm->node_index);
+    vlib_cli_output (vm, "  %=6s%=6s%=14s%=10s%=12s%=10s%=14s%=8s", "To",
+		     "From", "Enqueued", "Flushes", "Vec/Flush", "Stalls",
+		     "Dequeued", "In Use");
+
+    for (dst = 0; dst < vec_len (fqm->handoff_rings); dst++)
+      for (src = 0; src < vec_len (fqm->handoff_rings[dst]); src++)
+	{
+	  r = fqm->handoff_rings[dst][src];
+	  if (r->enqueue_flushes == 0 && r->credit_stalls == 0)
+	    continue;
+	  vlib_cli_output (vm, "  %=6u%=6u%=14llu%=10llu%=12.2f%=10llu"
+			   "%=14llu%=8u", dst, src, r->enqueue_vectors,
+			   r->enqueue_flushes,
+			   r->enqueue_flushes ? (f64) r->enqueue_vectors /
+			   (f64) r->enqueue_flushes : 0.0,
+			   r->credit_stalls, r->dequeue_vectors,
+			   r->published_tail - r->head);
+	}
+  }
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (cmd_show_frame_queue_rings,static) = {
+    .path = "show frame-queue rings",
+    .short_help = "show frame-queue rings",
+    .function = show_frame_queue_rings,
+};
+/* *INDENT-ON* */
+
 /* *INDENT-OFF* */
 VLIB_CLI_COMMAND (cmd_show_frame_queue_histogram,static) = {
     .path = "show frame-queue histogram",
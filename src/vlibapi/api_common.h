@@ -61,6 +61,11 @@ typedef struct vl_api_registration_
   svm_region_t *vlib_rp;
   void *shmem_hdr;
 
+  /** shared memory only: client's spsc request ring, if any */
+  svm_queue_t *vl_request_queue;
+  u32 vl_request_queue_file_index;	/**< ring doorbell, client writes */
+  int vl_request_queue_wakeup_fd;	/**< written once the ring has room */
+
   /* socket server and client */
   u32 clib_file_index;		/**< Socket only: file index */
   i8 *unprocessed_input;	/**< Socket only: pending input */
@@ -267,6 +272,9 @@ typedef struct
   /** vlib/vpp only: vector of client registrations */
   vl_api_registration_t **vl_clients;
 
+  /** vlib/vpp only: registrations that send on a spsc request ring */
+  vl_api_registration_t **vl_ring_clients;
+
   /** vlib/vpp only: serialized (message, name, crc) table */
   u8 *serialized_message_table_in_shmem;
 
@@ -303,6 +311,19 @@ typedef struct
   /** Peer input queue pointer */
   svm_queue_t *vl_input_queue;
 
+  /** Client only: spsc request ring, replaces the shared vpp input queue */
+  svm_queue_t *vl_request_queue;
+
+  /** Client only: the one thread allowed to produce on the request ring */
+  pthread_t vl_request_queue_thread;
+
+  /** Client only: request ring doorbell, and where vpp says it has room */
+  int vl_request_queue_doorbell_fd;
+  int vl_request_queue_wakeup_fd;
+
+  /** Client only: request ring size, 0 keeps the shared input queue */
+  u32 request_ring_size;
+
   /**
    * All VLIB-side message handlers use my_client_index to identify
    * the queue / client. This works in sim replay.
@@ -15,6 +15,7 @@
  *------------------------------------------------------------------
  */
 #include <signal.h>
+#include <sys/syscall.h>
 
 #include <vlib/vlib.h>
 #include <vlibapi/api.h>
@@ -103,6 +104,18 @@ memclnt_queue_callback (vlib_main_t * vm)
 	  break;
 	}
     }
+  for (i = 0; i < vec_len (am->vl_ring_clients); i++)
+    {
+      if (am->vl_ring_clients[i]->vl_request_queue->cursize)
+	{
+	  vm->queue_signal_pending = 1;
+	  vm->api_queue_nonempty = 1;
+	  vlib_process_signal_event (vm, vl_api_clnt_node.index,
+				     /* event_type */ QUEUE_SIGNAL_EVENT,
+				     /* event_data */ 0);
+	  break;
+	}
+    }
   if (vec_len (vm->pending_rpc_requests))
     {
       vm->queue_signal_pending = 1;
@@ -239,6 +252,168 @@ vl_api_memclnt_create_t_handler (vl_api_memclnt_create_t * mp)
   vl_msg_api_send_shmem (q, (u8 *) & rp);
 }
 
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_getfd
+#define SYS_pidfd_getfd 438
+#endif
+
+/* 1 if fd is an eventfd */
+static int
+vl_api_fd_is_eventfd (int fd)
+{
+  char path[64], link[64];
+  ssize_t n;
+
+  snprintf (path, sizeof (path), "/proc/self/fd/%d", fd);
+  n = readlink (path, link, sizeof (link) - 1);
+  if (n < 0)
+    return 0;
+  link[n] = 0;
+
+  return !strcmp (link, "anon_inode:[eventfd]");
+}
+
+/*
+ * Take copies of a shared memory client's eventfds. There is no socket
+ * to pass them over, so they are taken from the client process, which
+ * needs the same privileges as ptrace. Only the registering client's
+ * own process is looked at, and only eventfds are accepted, so a client
+ * cannot have vpp read or write other files. Returns 0 on success.
+ */
+static int
+vl_api_request_ring_get_fds (vl_api_registration_t * regp, u32 pid,
+			     int doorbell_fd, int wakeup_fd,
+			     int *doorbell, int *wakeup)
+{
+  int pidfd;
+
+  *doorbell = *wakeup = -1;
+
+  if (pid == 0 || pid != regp->vl_input_queue->consumer_pid)
+    return -1;
+
+  pidfd = syscall (SYS_pidfd_open, pid, 0);
+  if (pidfd < 0)
+    return -1;
+
+  *doorbell = syscall (SYS_pidfd_getfd, pidfd, doorbell_fd, 0);
+  *wakeup = syscall (SYS_pidfd_getfd, pidfd, wakeup_fd, 0);
+  close (pidfd);
+
+  if (*doorbell >= 0 && *wakeup >= 0 &&
+      vl_api_fd_is_eventfd (*doorbell) && vl_api_fd_is_eventfd (*wakeup))
+    return 0;
+
+  if (*doorbell >= 0)
+    close (*doorbell);
+  if (*wakeup >= 0)
+    close (*wakeup);
+  *doorbell = *wakeup = -1;
+  return -1;
+}
+
+/*
+ * A client rang its request ring's doorbell: the ring just became
+ * non-empty, have the api process drain it now rather than when it
+ * next polls.
+ */
+static clib_error_t *
+vl_api_request_ring_doorbell_read (clib_file_t * uf)
+{
+  vlib_main_t *vm = vlib_get_main ();
+  int __clib_unused rv;
+  u64 data;
+
+  rv = read (uf->file_descriptor, &data, sizeof (data));
+
+  vm->queue_signal_pending = 1;
+  vm->api_queue_nonempty = 1;
+  vlib_process_signal_event (vm, vl_api_clnt_node.index,
+			     /* event_type */ QUEUE_SIGNAL_EVENT,
+			     /* event_data */ 0);
+  return 0;
+}
+
+/*
+ * Forget a registration's request ring and close its eventfds. Caller
+ * frees the ring, if need be, with the svm data heap pushed.
+ */
+static void
+vl_api_request_ring_remove (vl_api_registration_t * regp)
+{
+  api_main_t *am = &api_main;
+  int i;
+
+  if (regp->vl_request_queue == 0)
+    return;
+
+  for (i = 0; i < vec_len (am->vl_ring_clients); i++)
+    if (am->vl_ring_clients[i] == regp)
+      {
+	vec_delete (am->vl_ring_clients, 1, i);
+	break;
+      }
+
+  clib_file_del_by_index (&file_main, regp->vl_request_queue_file_index);
+  close (regp->vl_request_queue_wakeup_fd);
+}
+
+/*
+ * vl_api_memclnt_request_ring_t_handler
+ */
+static void
+vl_api_memclnt_request_ring_t_handler (vl_api_memclnt_request_ring_t * mp)
+{
+  vl_api_memclnt_request_ring_reply_t *rmp;
+  vl_api_registration_t *regp;
+  svm_queue_t *q;
+  api_main_t *am = &api_main;
+  int doorbell, wakeup;
+  int rv = 0;
+
+  regp = vl_api_client_index_to_registration (mp->client_index);
+  if (!regp)
+    return;
+
+  q = (svm_queue_t *) (uword) mp->ring;
+
+  /* Private segments have their own input queue already */
+  if (regp->registration_type != REGISTRATION_TYPE_SHMEM
+      || regp->vlib_rp != am->vlib_primary_rp)
+    rv = -9;			/* VNET_API_ERROR_UNIMPLEMENTED */
+  else if (q == 0 || !svm_queue_is_spsc (q)
+	   || q->elsize != sizeof (uword))
+    rv = -7;			/* VNET_API_ERROR_INVALID_VALUE */
+  else if (regp->vl_request_queue)
+    rv = -81;			/* VNET_API_ERROR_VALUE_EXIST */
+  else if (vl_api_request_ring_get_fds (regp, mp->pid, mp->doorbell_fd,
+					mp->wakeup_fd, &doorbell, &wakeup))
+    rv = -11;			/* VNET_API_ERROR_SYSCALL_ERROR_1 */
+  else
+    {
+      clib_file_t template = { 0 };
+
+      template.read_function = vl_api_request_ring_doorbell_read;
+      template.file_descriptor = doorbell;
+      template.description = format (0, "%s request ring", regp->name);
+      regp->vl_request_queue_file_index =
+	clib_file_add (&file_main, &template);
+      regp->vl_request_queue_wakeup_fd = wakeup;
+      regp->vl_request_queue = q;
+      vec_add1 (am->vl_ring_clients, regp);
+    }
+
+  rmp = vl_msg_api_alloc (sizeof (*rmp));
+  clib_memset (rmp, 0, sizeof (*rmp));
+  rmp->_vl_msg_id = ntohs (VL_API_MEMCLNT_REQUEST_RING_REPLY);
+  rmp->context = mp->context;
+  rmp->retval = ntohl (rv);
+
+  vl_msg_api_send_shmem (regp->vl_input_queue, (u8 *) & rmp);
+}
+
 int
 vl_api_call_reaper_functions (u32 client_index)
 {
@@ -349,6 +524,7 @@ vl_api_memclnt_delete_t_handler (vl_api_memclnt_delete_t * mp)
 
       /* No dangling references, please */
       *regpp = 0;
+      vl_api_request_ring_remove (regp);
 
       if (private_registration == 0)
 	{
@@ -357,7 +533,11 @@ vl_api_memclnt_delete_t_handler (vl_api_memclnt_delete_t * mp)
 	  pthread_mutex_lock (&svm->mutex);
 	  oldheap = svm_push_data_heap (svm);
 	  if (mp->do_cleanup)
-	    svm_queue_free (regp->vl_input_queue);
+	    {
+	      svm_queue_free (regp->vl_input_queue);
+	      if (regp->vl_request_queue)
+		svm_queue_free (regp->vl_request_queue);
+	    }
 	  vec_free (regp->name);
 	  /* Poison the old registration */
 	  clib_memset (regp, 0xF1, sizeof (*regp));
@@ -425,6 +605,7 @@ _(MEMCLNT_CREATE, memclnt_create)                       \
 _(MEMCLNT_DELETE, memclnt_delete)                       \
 _(MEMCLNT_KEEPALIVE, memclnt_keepalive)                 \
 _(MEMCLNT_KEEPALIVE_REPLY, memclnt_keepalive_reply)	\
+_(MEMCLNT_REQUEST_RING, memclnt_request_ring)		\
 
 /*
  * memory_api_init
@@ -671,6 +852,11 @@ vl_mem_api_dead_client_scan (api_main_t * am, vl_shmem_hdr_t * shm, f64 now)
 		}
 	      else
 		{
+		  if ((*regpp)->vl_request_queue)
+		    {
+		      vl_api_request_ring_remove (*regpp);
+		      svm_queue_free ((*regpp)->vl_request_queue);
+		    }
 		  /* Poison the old registration */
 		  clib_memset (*regpp, 0xF3, sizeof (**regpp));
 		  clib_mem_free (*regpp);
@@ -717,6 +903,41 @@ vl_mem_api_handle_msg_main (vlib_main_t * vm, vlib_node_runtime_t * node)
 				    am->shmem_hdr->vl_input_queue);
 }
 
+/*
+ * Drain up to VL_MEM_API_RING_BATCH messages from each client request
+ * ring. Returns the number of messages handled.
+ */
+int
+vl_mem_api_handle_msg_rings (vlib_main_t * vm, vlib_node_runtime_t * node)
+{
+  api_main_t *am = &api_main;
+  vl_api_registration_t *regp;
+  int i, n, n_msgs = 0;
+  uword mp;
+
+  for (i = 0; i < vec_len (am->vl_ring_clients); i++)
+    {
+      regp = am->vl_ring_clients[i];
+      for (n = 0; n < VL_MEM_API_RING_BATCH; n++)
+	{
+	  if (svm_queue_spsc_sub_nowait (regp->vl_request_queue, (u8 *) & mp,
+					 regp->vl_request_queue_wakeup_fd))
+	    break;
+	  vl_msg_api_handler_with_vm_node (am, (void *) mp, vm, node);
+	  n_msgs++;
+
+	  /* memclnt_delete may have taken the ring (and regp) away */
+	  if (i >= vec_len (am->vl_ring_clients)
+	      || am->vl_ring_clients[i] != regp)
+	    {
+	      i--;
+	      break;
+	    }
+	}
+    }
+  return n_msgs;
+}
+
 int
 vl_mem_api_handle_rpc (vlib_main_t * vm, vlib_node_runtime_t * node)
 {
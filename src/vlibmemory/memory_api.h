@@ -33,6 +33,11 @@ int vl_mem_api_handle_msg_main (vlib_main_t * vm, vlib_node_runtime_t * node);
 int vl_mem_api_handle_msg_private (vlib_main_t * vm,
 				   vlib_node_runtime_t * node, u32 reg_index);
 int vl_mem_api_handle_rpc (vlib_main_t * vm, vlib_node_runtime_t * node);
+int vl_mem_api_handle_msg_rings (vlib_main_t * vm,
+				 vlib_node_runtime_t * node);
+
+/** Messages taken from one client request ring per visit */
+#define VL_MEM_API_RING_BATCH 64
 
 vl_api_registration_t *vl_mem_api_client_index_to_registration (u32 handle);
 void vl_mem_api_enable_disable (vlib_main_t * vm, int yesno);
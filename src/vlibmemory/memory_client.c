@@ -18,6 +18,7 @@
  */
 
 #include <setjmp.h>
+#include <sys/eventfd.h>
 
 #include <svm/svm.h>
 #include <svm/ssvm.h>
@@ -164,6 +165,111 @@ noop_handler (void *notused)
 {
 }
 
+static void
+vl_api_memclnt_request_ring_reply_t_handler
+  (vl_api_memclnt_request_ring_reply_t * mp)
+{
+}
+
+/*
+ * Ask vpp to take our requests from a private spsc ring rather than
+ * the shared, mutex protected vpp input queue. Only the calling thread
+ * may send on the ring; vl_msg_api_send_shmem keeps every other thread
+ * on the shared queue. The ring comes with two eventfds, which vpp takes
+ * copies of: the doorbell we write when the ring becomes non-empty, and
+ * the one we sleep on while the ring is full. Falls back to the shared
+ * queue on any failure.
+ */
+static int
+vl_client_request_ring_create (u32 ring_size)
+{
+  svm_region_t *svm;
+  vl_api_memclnt_request_ring_t *mp;
+  vl_api_memclnt_request_ring_reply_t *rp;
+  svm_queue_t *q;
+  void *oldheap;
+  api_main_t *am = &api_main;
+  int i, rv = -1, doorbell_fd, wakeup_fd;
+
+  doorbell_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  wakeup_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (doorbell_fd < 0 || wakeup_fd < 0)
+    {
+      clib_unix_warning ("eventfd");
+      if (doorbell_fd >= 0)
+	close (doorbell_fd);
+      if (wakeup_fd >= 0)
+	close (wakeup_fd);
+      return rv;
+    }
+
+  svm = am->vlib_rp;
+  pthread_mutex_lock (&svm->mutex);
+  oldheap = svm_push_data_heap (svm);
+  q = svm_queue_alloc_and_init_spsc (ring_size, sizeof (uword), 0);
+  svm_pop_heap (oldheap);
+  pthread_mutex_unlock (&svm->mutex);
+
+  mp = vl_msg_api_alloc (sizeof (*mp));
+  clib_memset (mp, 0, sizeof (*mp));
+  mp->_vl_msg_id = ntohs (VL_API_MEMCLNT_REQUEST_RING);
+  mp->client_index = am->my_client_index;
+  mp->ring = (uword) q;
+  mp->pid = getpid ();
+  mp->doorbell_fd = doorbell_fd;
+  mp->wakeup_fd = wakeup_fd;
+
+  vl_msg_api_send_shmem (am->shmem_hdr->vl_input_queue, (u8 *) & mp);
+
+  /* Wait up to 10 seconds */
+  for (i = 0; i < 1000; i++)
+    {
+      struct timespec ts, tsrem;
+
+      if (svm_queue_sub (am->vl_input_queue, (u8 *) & rp,
+			 SVM_Q_NOWAIT, 0) == 0)
+	{
+	  if (ntohs (rp->_vl_msg_id) != VL_API_MEMCLNT_REQUEST_RING_REPLY)
+	    {
+	      clib_warning ("unexpected reply: id %d",
+			    ntohs (rp->_vl_msg_id));
+	      vl_msg_api_handler ((void *) rp);
+	      continue;
+	    }
+	  rv = clib_net_to_host_u32 (rp->retval);
+	  vl_msg_api_handler ((void *) rp);
+	  break;
+	}
+      ts.tv_sec = 0;
+      ts.tv_nsec = 10000 * 1000;	/* 10 ms */
+      while (nanosleep (&ts, &tsrem) < 0)
+	ts = tsrem;
+    }
+
+  if (rv)
+    {
+      clib_warning ("memclnt_request_ring failed, rv %d", rv);
+      close (doorbell_fd);
+      close (wakeup_fd);
+      /* On timeout vpp may still adopt the ring, so leak it */
+      if (i < 1000)
+	{
+	  pthread_mutex_lock (&svm->mutex);
+	  oldheap = svm_push_data_heap (svm);
+	  svm_queue_free (q);
+	  svm_pop_heap (oldheap);
+	  pthread_mutex_unlock (&svm->mutex);
+	}
+      return rv;
+    }
+
+  am->vl_request_queue_thread = pthread_self ();
+  am->vl_request_queue_doorbell_fd = doorbell_fd;
+  am->vl_request_queue_wakeup_fd = wakeup_fd;
+  am->vl_request_queue = q;
+  return 0;
+}
+
 int
 vl_client_connect (const char *name, int ctx_quota, int input_queue_size)
 {
@@ -250,9 +356,39 @@ vl_client_connect (const char *name, int ctx_quota, int input_queue_size)
       vl_msg_api_handler ((void *) rp);
       break;
     }
+
+  if (rv == 0 && am->request_ring_size)
+    (void) vl_client_request_ring_create (am->request_ring_size);
+
   return (rv);
 }
 
+/**
+ * Select the request transport for the next vl_client_connect.
+ * A non-zero ring_size gives the connecting thread its own spsc
+ * request ring of that many messages; zero (the default) keeps the
+ * shared, mutex protected vpp input queue.
+ */
+void
+vl_client_set_request_ring_size (u32 ring_size)
+{
+  api_main_t *am = &api_main;
+  am->request_ring_size = ring_size;
+}
+
+static void
+vl_client_request_ring_close (void)
+{
+  api_main_t *am = &api_main;
+
+  if (am->vl_request_queue == 0)
+    return;
+
+  close (am->vl_request_queue_doorbell_fd);
+  close (am->vl_request_queue_wakeup_fd);
+  am->vl_request_queue = 0;
+}
+
 static void
 vl_api_memclnt_delete_reply_t_handler (vl_api_memclnt_delete_reply_t * mp)
 {
@@ -262,12 +398,15 @@ vl_api_memclnt_delete_reply_t_handler (vl_api_memclnt_delete_reply_t * mp)
   pthread_mutex_lock (&am->vlib_rp->mutex);
   oldheap = svm_push_data_heap (am->vlib_rp);
   svm_queue_free (am->vl_input_queue);
+  if (am->vl_request_queue)
+    svm_queue_free (am->vl_request_queue);
   pthread_mutex_unlock (&am->vlib_rp->mutex);
   svm_pop_heap (oldheap);
 
   am->my_client_index = ~0;
   am->my_registration = 0;
   am->vl_input_queue = 0;
+  vl_client_request_ring_close ();
 }
 
 void
@@ -318,6 +457,7 @@ vl_client_disconnect (void)
 	  clib_warning ("peer unresponsive, give up");
 	  am->my_client_index = ~0;
 	  am->my_registration = 0;
+	  vl_client_request_ring_close ();
 	  am->shmem_hdr = 0;
 	  return -1;
 	}
@@ -364,7 +504,8 @@ vl_api_memclnt_keepalive_t_handler (vl_api_memclnt_keepalive_t * mp)
 _(RX_THREAD_EXIT, rx_thread_exit)               \
 _(MEMCLNT_CREATE_REPLY, memclnt_create_reply)   \
 _(MEMCLNT_DELETE_REPLY, memclnt_delete_reply)	\
-_(MEMCLNT_KEEPALIVE, memclnt_keepalive)
+_(MEMCLNT_KEEPALIVE, memclnt_keepalive)		\
+_(MEMCLNT_REQUEST_RING_REPLY, memclnt_request_ring_reply)
 
 void
 vl_client_install_client_message_handlers (void)
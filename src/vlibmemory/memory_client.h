@@ -39,6 +39,7 @@ int vl_client_connect_to_vlib_no_rx_pthread_no_map (const char *svm_name,
 						    const char *client_name,
 						    int rx_queue_size);
 void vl_client_install_client_message_handlers (void);
+void vl_client_set_request_ring_size (u32 ring_size);
 u8 vl_mem_client_is_connected (void);
 
 #endif /* SRC_VLIBMEMORY_MEMORY_CLIENT_H_ */
@@ -737,6 +737,21 @@ vl_msg_api_send_shmem (svm_queue_t * q, u8 * elem)
   if (am->tx_trace && am->tx_trace->enabled)
     vl_msg_api_trace (am, am->tx_trace, (void *) trace[0]);
 
+  /*
+   * Client side: requests from the thread which owns the spsc request
+   * ring go there instead of the shared vpp input queue, sleeping while
+   * it is full. Anything sent from another thread (e.g. keepalive
+   * replies from the rx thread) takes the shared, locked queue.
+   */
+  if (am->vl_request_queue && q == am->shmem_hdr->vl_input_queue
+      && pthread_equal (pthread_self (), am->vl_request_queue_thread))
+    {
+      (void) svm_queue_spsc_add_wait (am->vl_request_queue, &elem, 1,
+				      am->vl_request_queue_wakeup_fd,
+				      am->vl_request_queue_doorbell_fd);
+      return;
+    }
+
   /*
    * Announce a probable binary API client bug:
    * some client's input queue is stuffed.
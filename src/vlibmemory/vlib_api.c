@@ -393,6 +393,10 @@ vl_api_clnt_process (vlib_main_t * vm, vlib_node_runtime_t * node,
 	  vl_mem_api_handle_msg_private (vm, node, private_segment_rotor++);
 	}
 
+      /* Clients which asked for a spsc request ring */
+      if (PREDICT_FALSE (vec_len (am->vl_ring_clients)))
+	vl_mem_api_handle_msg_rings (vm, node);
+
       vlib_process_wait_for_event_or_clock (vm, sleep_time);
       vec_reset_length (event_data);
       event_type = vlib_process_get_events (vm, &event_data);
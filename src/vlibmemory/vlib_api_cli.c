@@ -127,6 +127,10 @@ vl_api_client_command (vlib_main_t * vm,
         vlib_cli_output (vm, "%20s %8d %14d 0x%016llx %s\n",
                          regp->name, q->consumer_pid, q->cursize,
                          q, health);
+        q = regp->vl_request_queue;
+        if (q)
+          vlib_cli_output (vm, "%20s request ring %d/%d 0x%016llx\n",
+                           "", q->cursize, q->maxsize, q);
       }
     else
       {
@@ -79,8 +79,6 @@ VLIB_NODE_FN (ip4_cop_whitelist_node) (vlib_main_t * vm,
           ip4_header_t * ip0, * ip1;
           cop_config_main_t * ccm0, * ccm1;
           cop_config_data_t * c0, * c1;
-      	  ip4_fib_mtrie_t * mtrie0, * mtrie1;
-      	  ip4_fib_mtrie_leaf_t leaf0, leaf1;
           u32 lb_index0, lb_index1;
           const load_balance_t * lb0, *lb1;
           const dpo_id_t *dpo0, *dpo1;
@@ -120,17 +118,8 @@ VLIB_NODE_FN (ip4_cop_whitelist_node) (vlib_main_t * vm,
                &next0,
                sizeof (c0[0]));
 
-	  mtrie0 = &ip4_fib_get (c0->fib_index)->mtrie;
-
-          leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, &ip0->src_address);
-
-      	  leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0,
-                                             &ip0->src_address, 2);
-
-      	  leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0,
-                                             &ip0->src_address, 3);
-
-      	  lb_index0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
+          lb_index0 = ip4_fib_forwarding_lookup (c0->fib_index,
+                                                 &ip0->src_address);
 
 	  ASSERT (lb_index0
                   == ip4_fib_table_lookup_lb (ip4_fib_get(c0->fib_index),
@@ -156,17 +145,8 @@ VLIB_NODE_FN (ip4_cop_whitelist_node) (vlib_main_t * vm,
                &vnet_buffer (b1)->cop.current_config_index,
                &next1,
                sizeof (c1[0]));
-	  mtrie1 = &ip4_fib_get (c1->fib_index)->mtrie;
-
-          leaf1 = ip4_fib_mtrie_lookup_step_one (mtrie1, &ip1->src_address);
-
-      	  leaf1 = ip4_fib_mtrie_lookup_step (mtrie1, leaf1,
-                                             &ip1->src_address, 2);
-
-      	  leaf1 = ip4_fib_mtrie_lookup_step (mtrie1, leaf1,
-                                             &ip1->src_address, 3);
-
-      	  lb_index1 = ip4_fib_mtrie_leaf_get_adj_index (leaf1);
+          lb_index1 = ip4_fib_forwarding_lookup (c1->fib_index,
+                                                 &ip1->src_address);
 	  ASSERT (lb_index1
                   == ip4_fib_table_lookup_lb (ip4_fib_get(c1->fib_index),
 	  				       &ip1->src_address));
@@ -223,8 +203,6 @@ VLIB_NODE_FN (ip4_cop_whitelist_node) (vlib_main_t * vm,
           ip4_header_t * ip0;
           cop_config_main_t *ccm0;
           cop_config_data_t *c0;
-	  ip4_fib_mtrie_t * mtrie0;
-	  ip4_fib_mtrie_leaf_t leaf0;
           u32 lb_index0;
           const load_balance_t * lb0;
           const dpo_id_t *dpo0;
@@ -250,17 +228,8 @@ VLIB_NODE_FN (ip4_cop_whitelist_node) (vlib_main_t * vm,
                &next0,
                sizeof (c0[0]));
 
-	  mtrie0 = &ip4_fib_get (c0->fib_index)->mtrie;
-
-          leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, &ip0->src_address);
-
-	  leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, 
-                                             &ip0->src_address, 2);
-
-	  leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, 
-                                             &ip0->src_address, 3);
-
-	  lb_index0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
+	  lb_index0 = ip4_fib_forwarding_lookup (c0->fib_index,
+                                                 &ip0->src_address);
 
 	  ASSERT (lb_index0 
                   == ip4_fib_table_lookup_lb (ip4_fib_get(c0->fib_index),
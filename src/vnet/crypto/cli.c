@@ -15,6 +15,7 @@
 
 #include <stdbool.h>
 #include <vlib/vlib.h>
+#include <vnet/api_errno.h>
 #include <vnet/crypto/crypto.h>
 
 static clib_error_t *
@@ -92,6 +93,130 @@ VLIB_CLI_COMMAND (show_crypto_handlers_command, static) =
 };
 /* *INDENT-ON* */
 
+static clib_error_t *
+set_crypto_async_command_fn (vlib_main_t * vm,
+			     unformat_input_t * input,
+			     vlib_cli_command_t * cmd)
+{
+  unformat_input_t _line_input, *line_input = &_line_input;
+  clib_error_t *error = 0;
+  u32 *thread_indices = 0;
+  uword *bitmap = 0;
+  int enable = -1;
+  int rv;
+
+  if (!unformat_user (input, unformat_line_input, line_input))
+    return clib_error_return (0, "expected 'on' or 'off'");
+
+  while (unformat_check_input (line_input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (line_input, "on"))
+	enable = 1;
+      else if (unformat (line_input, "off"))
+	enable = 0;
+      else if (unformat (line_input, "workers %U", unformat_bitmap_list,
+			 &bitmap))
+	;
+      else
+	{
+	  error = clib_error_return (0, "unknown input '%U'",
+				     format_unformat_error, line_input);
+	  goto done;
+	}
+    }
+
+  if (enable == -1)
+    {
+      error = clib_error_return (0, "expected 'on' or 'off'");
+      goto done;
+    }
+
+  if (bitmap)
+    {
+      uword i;
+      /* *INDENT-OFF* */
+      clib_bitmap_foreach (i, bitmap, ({
+	vec_add1 (thread_indices, vlib_get_worker_thread_index (i));
+      }));
+      /* *INDENT-ON* */
+    }
+
+  rv = vnet_crypto_set_async_mode (vm, enable, thread_indices);
+
+  if (rv == VNET_API_ERROR_INVALID_WORKER)
+    error = clib_error_return (0, "invalid worker(s)");
+  else if (rv)
+    error = clib_error_return (0, "unknown return value %d", rv);
+
+done:
+  unformat_free (line_input);
+  clib_bitmap_free (bitmap);
+  vec_free (thread_indices);
+  return error;
+}
+
+/*?
+ * Enable or disable asynchronous crypto. In async mode, crypto ops are
+ * queued by the submitting thread and processed by the crypto-dispatch
+ * node. With 'workers', the listed workers process the queues of all
+ * threads, otherwise each thread processes its own queues.
+ *
+ * @cliexpar
+ * @cliexcmd{set crypto async on workers 2-3}
+?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (set_crypto_async_command, static) =
+{
+  .path = "set crypto async",
+  .short_help = "set crypto async <on|off> [workers <list>]",
+  .function = set_crypto_async_command_fn,
+};
+/* *INDENT-ON* */
+
+static clib_error_t *
+show_crypto_async_command_fn (vlib_main_t * vm,
+			      unformat_input_t * input,
+			      vlib_cli_command_t * cmd)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  vnet_crypto_thread_t *ct;
+  vnet_crypto_op_type_t opt;
+
+  vlib_cli_output (vm, "async mode: %s", cm->async_mode ? "on" : "off");
+
+  if (!cm->async_mode)
+    return 0;
+
+  vec_foreach (ct, cm->threads)
+  {
+    u32 thread_index = ct - cm->threads;
+
+    if (vec_len (ct->dispatch_thread_indices))
+      vlib_cli_output (vm, "thread %u dispatches threads %U", thread_index,
+		       format_vec32, ct->dispatch_thread_indices, "%d");
+
+    for (opt = 1; opt < VNET_CRYPTO_N_OP_TYPES; opt++)
+      {
+	vnet_crypto_queue_t *q = ct->queues[opt];
+	if (q == 0 || q->head == q->tail)
+	  continue;
+	vlib_cli_output (vm, "  thread %u %U: %u pending", thread_index,
+			 format_vnet_crypto_op, opt, q->head - q->tail);
+      }
+  }
+
+  return 0;
+}
+
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (show_crypto_async_command, static) =
+{
+  .path = "show crypto async",
+  .short_help = "show crypto async",
+  .function = show_crypto_async_command_fn,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
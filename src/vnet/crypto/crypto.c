@@ -15,30 +15,290 @@
 
 #include <stdbool.h>
 #include <vlib/vlib.h>
+#include <vnet/api_errno.h>
 #include <vnet/crypto/crypto.h>
 
 vnet_crypto_main_t crypto_main;
 
+static_always_inline u32
+vnet_crypto_process_ops_call_handler (vlib_main_t * vm,
+				      vnet_crypto_main_t * cm,
+				      vnet_crypto_op_type_t opt,
+				      vnet_crypto_op_t * ops[], u32 n_ops)
+{
+  u32 i;
+
+  if (n_ops == 0)
+    return 0;
+
+  if (cm->ops_handlers[opt])
+    return (cm->ops_handlers[opt]) (vm, ops, n_ops);
+
+  for (i = 0; i < n_ops; i++)
+    ops[i]->status = VNET_CRYPTO_OP_STATUS_FAIL_NO_HANDLER;
+
+  return 0;
+}
+
+/*
+ * Process a vector of ops. Consecutive ops of the same type are handed
+ * over to the engine in a single call so engines can pipeline multiple
+ * buffers, callers should therefore group ops by type where possible.
+ * Returns the number of successfully completed ops.
+ */
 u32
 vnet_crypto_process_ops (vlib_main_t * vm, vnet_crypto_op_t ops[], u32 n_ops)
 {
   vnet_crypto_main_t *cm = &crypto_main;
+  vnet_crypto_op_t *op_queue[VLIB_FRAME_SIZE];
+  vnet_crypto_op_type_t opt, current_op_type = VNET_CRYPTO_OP_NONE;
+  u32 n_op_queue = 0;
   u32 rv = 0, i;
 
   for (i = 0; i < n_ops; i++)
     {
-      vnet_crypto_op_type_t opt = ops[i].op;
-      vnet_crypto_op_t *opp = &ops[i];
+      opt = ops[i].op;
+
+      if (current_op_type != opt || n_op_queue >= VLIB_FRAME_SIZE)
+	{
+	  rv += vnet_crypto_process_ops_call_handler (vm, cm, current_op_type,
+						      op_queue, n_op_queue);
+	  n_op_queue = 0;
+	  current_op_type = opt;
+	}
 
-      if (cm->ops_handlers[opt])
-	rv += (cm->ops_handlers[opt]) (vm, &opp, 1);
-      else
-	ops[i].status = VNET_CRYPTO_OP_STATUS_FAIL_NO_HANDLER;
+      op_queue[n_op_queue++] = &ops[i];
     }
 
+  rv += vnet_crypto_process_ops_call_handler (vm, cm, current_op_type,
+					      op_queue, n_op_queue);
   return rv;
 }
 
+/*
+ * Async mode: ops are enqueued on per-thread, per-op-type queues and
+ * processed by the crypto-dispatch node, either on the submitting thread
+ * or on a dedicated crypto thread. The submitter checks completion with
+ * vnet_crypto_op_is_done().
+ *
+ * Ops depending on each other (cipher then hmac on encrypt, hmac check
+ * then cipher on decrypt) may be submitted together, as queues are
+ * dispatched in async_dispatch_order (encrypt, hmac, decrypt) and heads
+ * are published in that order too.
+ */
+u32
+vnet_crypto_submit_ops (vlib_main_t * vm, vnet_crypto_op_t ** jobs,
+			u32 n_jobs)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  vnet_crypto_thread_t *ct = vec_elt_at_index (cm->threads, vm->thread_index);
+  u32 n_jobs_by_type[VNET_CRYPTO_N_OP_TYPES] = { 0 };
+  u32 heads[VNET_CRYPTO_N_OP_TYPES];
+  vnet_crypto_op_type_t opt;
+  vnet_crypto_queue_t *q;
+  u32 i;
+
+  for (i = 0; i < n_jobs; i++)
+    n_jobs_by_type[jobs[i]->op]++;
+
+  /* all or nothing, so dependent ops never end up split */
+  for (opt = 1; opt < VNET_CRYPTO_N_OP_TYPES; opt++)
+    {
+      if (n_jobs_by_type[opt] == 0)
+	continue;
+
+      q = ct->queues[opt];
+      if (PREDICT_FALSE (q == 0))
+	return 0;
+
+      heads[opt] = q->head;
+      if (heads[opt] - clib_atomic_load_acq_n (&q->tail) +
+	  n_jobs_by_type[opt] > q->size)
+	return 0;
+    }
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      vnet_crypto_op_t *op = jobs[i];
+      q = ct->queues[op->op];
+      op->status = VNET_CRYPTO_OP_STATUS_PENDING;
+      op->seq = heads[op->op]++;
+      q->jobs[op->seq & (q->size - 1)] = op;
+    }
+
+  for (i = 0; i < VNET_CRYPTO_N_OP_TYPES - 1; i++)
+    {
+      opt = cm->async_dispatch_order[i];
+      if (n_jobs_by_type[opt])
+	clib_atomic_store_rel_n (&ct->queues[opt]->head, heads[opt]);
+    }
+
+  return n_jobs;
+}
+
+static_always_inline u32
+vnet_crypto_dispatch_queue (vlib_main_t * vm, vnet_crypto_main_t * cm,
+			    vnet_crypto_queue_t * q, u32 head)
+{
+  vnet_crypto_op_t *ops[VLIB_FRAME_SIZE];
+  u32 tail = q->tail, n_total = 0;
+  u32 i, n;
+
+  while (tail != head)
+    {
+      n = clib_min (head - tail, VLIB_FRAME_SIZE);
+
+      for (i = 0; i < n; i++)
+	ops[i] = q->jobs[(tail + i) & (q->size - 1)];
+
+      vnet_crypto_process_ops_call_handler (vm, cm, q->op, ops, n);
+
+      tail += n;
+      clib_atomic_store_rel_n (&q->tail, tail);
+      n_total += n;
+    }
+
+  return n_total;
+}
+
+static u32
+vnet_crypto_dispatch_thread (vlib_main_t * vm, u32 thread_index)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  vnet_crypto_thread_t *ct = vec_elt_at_index (cm->threads, thread_index);
+  u32 heads[VNET_CRYPTO_N_OP_TYPES];
+  vnet_crypto_op_type_t opt;
+  vnet_crypto_queue_t *q;
+  u32 n_ops = 0;
+  int i;
+
+  if (clib_bitmap_is_zero (ct->act_queues))
+    return 0;
+
+  /*
+   * snapshot heads in reverse dispatch order, so any op seen here also
+   * has the ops it depends on visible in the queues dispatched before
+   */
+  for (i = VNET_CRYPTO_N_OP_TYPES - 2; i >= 0; i--)
+    {
+      opt = cm->async_dispatch_order[i];
+      if ((q = ct->queues[opt]))
+	heads[opt] = clib_atomic_load_acq_n (&q->head);
+    }
+
+  for (i = 0; i < VNET_CRYPTO_N_OP_TYPES - 1; i++)
+    {
+      opt = cm->async_dispatch_order[i];
+      if ((q = ct->queues[opt]) && q->tail != heads[opt])
+	n_ops += vnet_crypto_dispatch_queue (vm, cm, q, heads[opt]);
+    }
+
+  return n_ops;
+}
+
+static uword
+crypto_dispatch_node_fn (vlib_main_t * vm, vlib_node_runtime_t * node,
+			 vlib_frame_t * frame)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  vnet_crypto_thread_t *ct = cm->threads + vm->thread_index;
+  u32 *ti, n_ops = 0;
+
+  vec_foreach (ti, ct->dispatch_thread_indices)
+    n_ops += vnet_crypto_dispatch_thread (vm, ti[0]);
+
+  return n_ops;
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (crypto_dispatch_node) = {
+  .function = crypto_dispatch_node_fn,
+  .name = "crypto-dispatch",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_DISABLED,
+};
+/* *INDENT-ON* */
+
+int
+vnet_crypto_set_async_mode (vlib_main_t * vm, u8 enable,
+			    u32 * thread_indices)
+{
+  vnet_crypto_main_t *cm = &crypto_main;
+  vlib_thread_main_t *tm = vlib_get_thread_main ();
+  vnet_crypto_thread_t *ct;
+  vnet_crypto_op_type_t opt;
+  u32 i, *ti;
+
+  /* *INDENT-OFF* */
+  vec_foreach (ti, thread_indices)
+    if (ti[0] >= tm->n_vlib_mains)
+      return VNET_API_ERROR_INVALID_WORKER;
+  /* *INDENT-ON* */
+
+  vlib_worker_thread_barrier_sync (vm);
+
+  /* complete what is still queued before dispatchers are reassigned */
+  for (i = 0; i < tm->n_vlib_mains; i++)
+    {
+      vnet_crypto_dispatch_thread (vm, i);
+      vec_reset_length (cm->threads[i].dispatch_thread_indices);
+      vlib_node_set_state (vlib_mains[i], crypto_dispatch_node.index,
+			   VLIB_NODE_STATE_DISABLED);
+    }
+
+  vec_reset_length (cm->async_thread_indices);
+  cm->async_mode = enable;
+
+  if (!enable)
+    goto done;
+
+  vec_append (cm->async_thread_indices, thread_indices);
+
+  for (i = 0; i < tm->n_vlib_mains; i++)
+    {
+      ct = cm->threads + i;
+
+      for (opt = 1; opt < VNET_CRYPTO_N_OP_TYPES; opt++)
+	{
+	  vnet_crypto_queue_t *q;
+
+	  if (cm->ops_handlers[opt] == 0 || ct->queues[opt])
+	    continue;
+
+	  q = clib_mem_alloc_aligned (sizeof (q[0]) + VNET_CRYPTO_QUEUE_SIZE *
+				      sizeof (q->jobs[0]),
+				      CLIB_CACHE_LINE_BYTES);
+	  clib_memset (q, 0, sizeof (q[0]));
+	  q->size = VNET_CRYPTO_QUEUE_SIZE;
+	  q->alg = cm->opt_data[opt].alg;
+	  q->op = opt;
+	  ct->queues[opt] = q;
+	  ct->act_queues = clib_bitmap_set (ct->act_queues, opt, 1);
+	}
+    }
+
+  /*
+   * with dedicated crypto threads, spread the other threads' queues over
+   * them, otherwise each thread dispatches its own queues
+   */
+  for (i = 0; i < tm->n_vlib_mains; i++)
+    {
+      u32 dti = i;
+
+      if (vec_len (cm->async_thread_indices) &&
+	  vec_search (cm->async_thread_indices, i) == ~0)
+	dti = cm->async_thread_indices[i % vec_len (cm->async_thread_indices)];
+
+      vec_add1 (cm->threads[dti].dispatch_thread_indices, i);
+      vlib_node_set_state (vlib_mains[dti], crypto_dispatch_node.index,
+			   VLIB_NODE_STATE_POLLING);
+    }
+
+done:
+  vlib_worker_thread_barrier_release (vm);
+  return 0;
+}
+
 u32
 vnet_crypto_register_engine (vlib_main_t * vm, char *name, int prio,
 			     char *desc)
@@ -90,9 +350,12 @@ vnet_crypto_init (vlib_main_t * vm)
   const char *enc = "encrypt";
   const char *dec = "decrypt";
   const char *hmac = "hmac";
+  u32 i = 0;
 
   vec_validate_aligned (cm->threads, tm->n_vlib_mains, CLIB_CACHE_LINE_BYTES);
   vec_validate (cm->algs, VNET_CRYPTO_N_ALGS);
+  vec_validate_aligned (cm->ops_handlers, VNET_CRYPTO_N_OP_TYPES - 1,
+			CLIB_CACHE_LINE_BYTES);
 
 #define _(n, s) \
   cm->algs[VNET_CRYPTO_ALG_##n].name = s; \
@@ -113,6 +376,16 @@ vnet_crypto_init (vlib_main_t * vm)
   foreach_hmac_alg;
 #undef _
 
+#define _(n, s) cm->async_dispatch_order[i++] = VNET_CRYPTO_OP_##n##_ENC;
+  foreach_crypto_alg;
+#undef _
+#define _(n, s) cm->async_dispatch_order[i++] = VNET_CRYPTO_OP_##n##_HMAC;
+  foreach_hmac_alg;
+#undef _
+#define _(n, s) cm->async_dispatch_order[i++] = VNET_CRYPTO_OP_##n##_DEC;
+  foreach_crypto_alg;
+#undef _
+
   return 0;
 }
 
@@ -70,6 +70,7 @@ typedef enum
   VNET_CRYPTO_OP_STATUS_PENDING,
   VNET_CRYPTO_OP_STATUS_COMPLETED,
   VNET_CRYPTO_OP_STATUS_FAIL_NO_HANDLER,
+  VNET_CRYPTO_OP_STATUS_FAIL_BAD_HMAC,
 } vnet_crypto_op_status_t;
 
 typedef struct
@@ -79,8 +80,11 @@ typedef struct
   vnet_crypto_op_status_t status:8;
   u8 key_len, hmac_trunc_len;
   u16 flags;
-#define VNET_CRYPTO_OP_FLAG_INIT_IV 1
+#define VNET_CRYPTO_OP_FLAG_INIT_IV (1 << 0)
+#define VNET_CRYPTO_OP_FLAG_HMAC_CHECK (1 << 1)
   u32 len;
+  u32 user_data;
+  u32 seq;			/* queue position, set by submit */
   u8 *key;
   u8 *iv;
   u8 *src;
@@ -94,14 +98,23 @@ typedef struct
   u32 active_engine_index;
 } vnet_crypto_op_type_data_t;
 
+#define VNET_CRYPTO_QUEUE_SIZE (4 * VLIB_FRAME_SIZE)
+
+/*
+ * Single producer, single consumer ring of submitted ops. The thread
+ * owning the queue advances head, the dispatching thread advances tail
+ * once the ops are processed. Both are free running counters.
+ */
 typedef struct
 {
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   u32 head;
-  u32 tail;
   u32 size;
   vnet_crypto_alg_t alg:8;
   vnet_crypto_op_type_t op:8;
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline1);
+  u32 tail;
+    CLIB_CACHE_LINE_ALIGN_MARK (cacheline2);
   vnet_crypto_op_t *jobs[0];
 } vnet_crypto_queue_t;
 
@@ -110,6 +123,8 @@ typedef struct
   CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
   clib_bitmap_t *act_queues;
   vnet_crypto_queue_t *queues[VNET_CRYPTO_N_OP_TYPES];
+  /* threads whose queues are processed by this thread */
+  u32 *dispatch_thread_indices;
 } vnet_crypto_thread_t;
 
 typedef u32 (vnet_crypto_ops_handler_t) (vlib_main_t * vm,
@@ -139,16 +154,41 @@ typedef struct
   vnet_crypto_ops_handler_t **ops_handlers;
   vnet_crypto_op_type_data_t opt_data[VNET_CRYPTO_N_OP_TYPES];
   vnet_crypto_engine_t *engines;
+
+  /* async mode */
+  u8 async_mode;
+  u32 *async_thread_indices;
+  vnet_crypto_op_type_t async_dispatch_order[VNET_CRYPTO_N_OP_TYPES - 1];
 } vnet_crypto_main_t;
 
 extern vnet_crypto_main_t crypto_main;
+extern vlib_node_registration_t crypto_dispatch_node;
 
 u32 vnet_crypto_submit_ops (vlib_main_t * vm, vnet_crypto_op_t ** jobs,
 			    u32 n_jobs);
 
+int vnet_crypto_set_async_mode (vlib_main_t * vm, u8 enable,
+				u32 * thread_indices);
+
 u32 vnet_crypto_process_ops (vlib_main_t * vm, vnet_crypto_op_t ops[],
 			     u32 n_ops);
 
+static_always_inline int
+vnet_crypto_async_mode_enabled (void)
+{
+  return crypto_main.async_mode;
+}
+
+/* true once a submitted op has been processed by the dispatching thread */
+static_always_inline int
+vnet_crypto_op_is_done (vlib_main_t * vm, vnet_crypto_op_t * op)
+{
+  vnet_crypto_thread_t *ct = crypto_main.threads + vm->thread_index;
+  vnet_crypto_queue_t *q = ct->queues[op->op];
+
+  return (i32) (clib_atomic_load_acq_n (&q->tail) - op->seq) > 0;
+}
+
 format_function_t format_vnet_crypto_alg;
 format_function_t format_vnet_crypto_engine;
 format_function_t format_vnet_crypto_op;
@@ -226,6 +226,7 @@ vnet_feature_enable_disable_with_index (u8 arc_index, u32 feature_index,
 {
   vnet_feature_main_t *fm = &feature_main;
   vnet_feature_config_main_t *cm;
+  vnet_feature_start_t *st;
   i16 feature_count;
   u32 ci;
 
@@ -256,6 +257,13 @@ vnet_feature_enable_disable_with_index (u8 arc_index, u32 feature_index,
     }
   cm->config_index_by_sw_if_index[sw_if_index] = ci;
 
+  /* precompile the start of the chain for the arc start nodes */
+  vec_validate (cm->start_by_sw_if_index, sw_if_index);
+  st = vec_elt_at_index (cm->start_by_sw_if_index, sw_if_index);
+  st->config_index = ci;
+  vnet_get_config_data (&cm->config_main, &st->config_index,
+			&st->next_index, /* # bytes of config data */ 0);
+
   /* update feature count */
   enable_disable = (enable_disable > 0);
   feature_count += enable_disable ? 1 : -1;
@@ -77,10 +77,27 @@ typedef struct _vnet_feature_constraint_registration
   char **node_names;
 } vnet_feature_constraint_registration_t;
 
+/** Start of an interface's feature chain, precompiled from its config.
+    Only the arc start is precompiled: the features themselves still find
+    their successor in the config string, with vnet_feature_next. A per
+    interface table of the later hops would need the interface on every
+    hop, and features are free to rewrite the buffer's sw_if_index (NAT
+    stores a fib index in sw_if_index[VLIB_TX]) before they move on. */
+typedef struct
+{
+  /** next index from the arc start node to the first feature */
+  u32 next_index;
+  /** config index for the first feature, as left in the buffer */
+  u32 config_index;
+} vnet_feature_start_t;
+
 typedef struct vnet_feature_config_main_t_
 {
   vnet_config_main_t config_main;
   u32 *config_index_by_sw_if_index;
+  /** rebuilt by vnet_feature_enable_disable, valid if the interface
+      has features on this arc */
+  vnet_feature_start_t *start_by_sw_if_index;
 } vnet_feature_config_main_t;
 
 typedef struct
@@ -275,7 +292,17 @@ static_always_inline void
 vnet_feature_arc_start (u8 arc, u32 sw_if_index, u32 * next0,
 			vlib_buffer_t * b0)
 {
-  vnet_feature_arc_start_with_data (arc, sw_if_index, next0, b0, 0);
+  vnet_feature_main_t *fm = &feature_main;
+  vnet_feature_start_t *st;
+
+  if (PREDICT_FALSE (vnet_have_features (arc, sw_if_index)))
+    {
+      st = vec_elt_at_index (fm->feature_config_mains[arc].
+			     start_by_sw_if_index, sw_if_index);
+      vnet_buffer (b0)->feature_arc_index = arc;
+      b0->current_config_index = st->config_index;
+      *next0 = st->next_index;
+    }
 }
 
 static_always_inline void *
@@ -291,6 +318,9 @@ vnet_feature_next_with_data (u32 * next0, vlib_buffer_t * b0,
 			       n_data_bytes);
 }
 
+/** Next node after the current feature. This reads the next index from
+    the config string the buffer is walking, shared by every interface
+    with the same features on the arc, not from a per-interface table. */
 static_always_inline void
 vnet_feature_next (u32 * next0, vlib_buffer_t * b0)
 {
@@ -310,6 +340,7 @@ vnet_feature_start_device_input_x1 (u32 sw_if_index, u32 * next0,
 {
   vnet_feature_main_t *fm = &feature_main;
   vnet_feature_config_main_t *cm;
+  vnet_feature_start_t *st;
   u8 feature_arc_index = fm->device_input_feature_arc_index;
   cm = &fm->feature_config_mains[feature_arc_index];
 
@@ -327,10 +358,9 @@ vnet_feature_start_device_input_x1 (u32 sw_if_index, u32 * next0,
       vlib_buffer_advance (b0, -adv);
 
       vnet_buffer (b0)->feature_arc_index = feature_arc_index;
-      b0->current_config_index =
-	vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
-      vnet_get_config_data (&cm->config_main, &b0->current_config_index,
-			    next0, /* # bytes of config data */ 0);
+      st = vec_elt_at_index (cm->start_by_sw_if_index, sw_if_index);
+      b0->current_config_index = st->config_index;
+      *next0 = st->next_index;
     }
 }
 
@@ -342,6 +372,7 @@ vnet_feature_start_device_input_x2 (u32 sw_if_index,
 {
   vnet_feature_main_t *fm = &feature_main;
   vnet_feature_config_main_t *cm;
+  vnet_feature_start_t *st;
   u8 feature_arc_index = fm->device_input_feature_arc_index;
   cm = &fm->feature_config_mains[feature_arc_index];
 
@@ -363,13 +394,10 @@ vnet_feature_start_device_input_x2 (u32 sw_if_index,
 
       vnet_buffer (b0)->feature_arc_index = feature_arc_index;
       vnet_buffer (b1)->feature_arc_index = feature_arc_index;
-      b0->current_config_index =
-	vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
-      b1->current_config_index = b0->current_config_index;
-      vnet_get_config_data (&cm->config_main, &b0->current_config_index,
-			    next0, /* # bytes of config data */ 0);
-      vnet_get_config_data (&cm->config_main, &b1->current_config_index,
-			    next1, /* # bytes of config data */ 0);
+      st = vec_elt_at_index (cm->start_by_sw_if_index, sw_if_index);
+      b0->current_config_index = st->config_index;
+      b1->current_config_index = st->config_index;
+      *next0 = *next1 = st->next_index;
     }
 }
 
@@ -385,6 +413,7 @@ vnet_feature_start_device_input_x4 (u32 sw_if_index,
 {
   vnet_feature_main_t *fm = &feature_main;
   vnet_feature_config_main_t *cm;
+  vnet_feature_start_t *st;
   u8 feature_arc_index = fm->device_input_feature_arc_index;
   cm = &fm->feature_config_mains[feature_arc_index];
 
@@ -415,20 +444,12 @@ vnet_feature_start_device_input_x4 (u32 sw_if_index,
       vnet_buffer (b2)->feature_arc_index = feature_arc_index;
       vnet_buffer (b3)->feature_arc_index = feature_arc_index;
 
-      b0->current_config_index =
-	vec_elt (cm->config_index_by_sw_if_index, sw_if_index);
-      b1->current_config_index = b0->current_config_index;
-      b2->current_config_index = b0->current_config_index;
-      b3->current_config_index = b0->current_config_index;
-
-      vnet_get_config_data (&cm->config_main, &b0->current_config_index,
-			    next0, /* # bytes of config data */ 0);
-      vnet_get_config_data (&cm->config_main, &b1->current_config_index,
-			    next1, /* # bytes of config data */ 0);
-      vnet_get_config_data (&cm->config_main, &b2->current_config_index,
-			    next2, /* # bytes of config data */ 0);
-      vnet_get_config_data (&cm->config_main, &b3->current_config_index,
-			    next3, /* # bytes of config data */ 0);
+      st = vec_elt_at_index (cm->start_by_sw_if_index, sw_if_index);
+      b0->current_config_index = st->config_index;
+      b1->current_config_index = st->config_index;
+      b2->current_config_index = st->config_index;
+      b3->current_config_index = st->config_index;
+      *next0 = *next1 = *next2 = *next3 = st->next_index;
     }
 }
 
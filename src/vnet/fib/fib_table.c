@@ -19,6 +19,7 @@
 #include <vnet/fib/fib_table.h>
 #include <vnet/fib/fib_entry_cover.h>
 #include <vnet/fib/fib_internal.h>
+#include <vnet/fib/fib_walk.h>
 #include <vnet/fib/ip4_fib.h>
 #include <vnet/fib/ip6_fib.h>
 #include <vnet/fib/mpls_fib.h>
@@ -1233,6 +1234,18 @@ fib_table_sub_tree_walk (u32 fib_index,
     }
 }
 
+void
+fib_table_batch_begin (void)
+{
+    fib_walk_batch_begin();
+}
+
+void
+fib_table_batch_end (void)
+{
+    fib_walk_batch_end();
+}
+
 void
 fib_table_unlock (u32 fib_index,
 		  fib_protocol_t proto,
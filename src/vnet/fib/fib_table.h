@@ -904,6 +904,21 @@ extern void fib_table_sub_tree_walk(u32 fib_index,
                                     fib_table_walk_fn_t fn,
                                     void *ctx);
 
+/**
+ * @brief Start a batch of updates to any FIB tables.
+ * Until the matching fib_table_batch_end, the back-walks from entries and
+ * path-lists whose forwarding changed are deferred and merged per object,
+ * so an object updated many times in the batch walks its children once.
+ * The entries' own forwarding is still updated as each call is made.
+ * Batches nest; the walks run when the outermost batch ends.
+ */
+extern void fib_table_batch_begin(void);
+
+/**
+ * @brief End a batch of updates started with fib_table_batch_begin
+ */
+extern void fib_table_batch_end(void);
+
 /**
  * @brief format (display) the memory used by the FIB tables
  */
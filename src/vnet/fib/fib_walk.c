@@ -40,6 +40,11 @@ typedef enum fib_walk_flags_t_
      * An indication that the walk is currently executing.
      */
     FIB_WALK_FLAG_EXECUTING = (1 << 2),
+    /**
+     * A synchronous walk requested while a batch is open. It holds its
+     * place in the parent's dependency list and runs when the batch ends.
+     */
+    FIB_WALK_FLAG_DEFERRED = (1 << 3),
 } fib_walk_flags_t;
 
 /**
@@ -155,6 +160,38 @@ typedef struct fib_walk_queues_t_
  */
 static fib_walk_queues_t fib_walk_queues;
 
+/**
+ * @brief State of the open walk batch, if any.
+ * While a batch is open, synchronous walks are not run but recorded, one per
+ * parent, and walks requested again on the same parent are merged into the
+ * recorded one. All are run when the outermost batch closes.
+ */
+typedef struct fib_walk_batch_t_
+{
+    /**
+     * Nesting depth of fib_walk_batch_begin calls
+     */
+    u32 fwb_depth;
+
+    /**
+     * Deferred walks, in the order they were first requested
+     */
+    index_t *fwb_walks;
+
+    /**
+     * Deferred walk indexed by parent; key is (type << 32 | index)
+     */
+    uword *fwb_walk_by_parent;
+
+    /**
+     * Walks deferred and walks merged into a deferred one
+     */
+    u64 fwb_n_deferred;
+    u64 fwb_n_merged;
+} fib_walk_batch_t;
+
+static fib_walk_batch_t fib_walk_batch;
+
 /**
  * The names of the walk priorities
  */
@@ -187,6 +224,9 @@ typedef struct fib_walk_history_t_ {
 static fib_walk_history_t fib_walk_history[HISTORY_N_WALKS];
 
 static u8* format_fib_walk (u8* s, va_list *ap);
+static fib_node_back_walk_rc_t fib_walk_back_walk_notify(
+    fib_node_t *node,
+    fib_node_back_walk_ctx_t *ctx);
 
 #define FIB_WALK_DBG(_walk, _fmt, _args...)                     \
 {                                                               \
@@ -735,50 +775,16 @@ fib_walk_async (fib_node_type_t parent_type,
 }
 
 /**
- * @brief Back walk all the children of a FIB node.
- *
- * note this is a synchronous depth first walk. Children visited may propagate
- * the walk to thier children. Other children node types may not propagate,
- * synchronously but instead queue the walk for later async completion.
+ * @brief Run a synchronous walk to completion and destroy it
  */
-void
-fib_walk_sync (fib_node_type_t parent_type,
-	       fib_node_index_t parent_index,
-	       fib_node_back_walk_ctx_t *ctx)
+static void
+fib_walk_sync_run (index_t fwi,
+                   fib_node_back_walk_ctx_t *ctx)
 {
     fib_walk_advance_rc_t rc;
-    fib_node_index_t fwi;
     fib_walk_t *fwalk;
 
-    if (FIB_NODE_GRAPH_MAX_DEPTH < ++ctx->fnbw_depth)
-    {
-	/*
-	 * The walk has reached the maximum depth. there is a loop in the graph.
-	 * bail.
-	 */
-	return;
-    }
-    if (0 == fib_node_get_n_children(parent_type,
-                                     parent_index))
-    {
-        /*
-         * no children to walk - quit now
-         */
-        return;
-    }
-
-    fwalk = fib_walk_alloc(parent_type,
-			   parent_index,
-			   FIB_WALK_FLAG_SYNC,
-			   ctx);
-
-    fwalk->fw_dep_sibling = fib_node_child_add(parent_type,
-					       parent_index,
-					       FIB_NODE_TYPE_WALK,
-					       fib_walk_get_index(fwalk));
-    fwi = fib_walk_get_index(fwalk);
-    FIB_WALK_DBG(fwalk, "sync-start: %U",
-                 format_fib_node_bw_reason, ctx->fnbw_reason);
+    fwalk = fib_walk_get(fwi);
 
     while (1)
     {
@@ -839,6 +845,16 @@ fib_walk_sync (fib_node_type_t parent_type,
 		fwalk = NULL;
 		break;
 	    }
+	    if (FIB_WALK_FLAG_DEFERRED & fwalk->fw_flags)
+	    {
+		/*
+		 * we have met a walk deferred by a batch that is being
+		 * closed. it now carries our context and will visit all
+		 * the remaining children when its turn comes.
+		 */
+		fwalk = NULL;
+		break;
+	    }
 	}
 	else
 	{
@@ -858,6 +874,164 @@ fib_walk_sync (fib_node_type_t parent_type,
     }
 }
 
+/**
+ * @brief Record a synchronous walk in the open batch. A walk already
+ * deferred for the same parent absorbs the context, as walks that catch
+ * up with one another do.
+ */
+static void
+fib_walk_defer (fib_node_type_t parent_type,
+                fib_node_index_t parent_index,
+                fib_node_back_walk_ctx_t *ctx)
+{
+    fib_walk_t *fwalk;
+    uword key, *p;
+
+    key = ((u64)parent_type << 32) | parent_index;
+    p = hash_get(fib_walk_batch.fwb_walk_by_parent, key);
+
+    if (NULL != p)
+    {
+        fwalk = fib_walk_get(p[0]);
+        fib_walk_back_walk_notify(&fwalk->fw_node, ctx);
+        fib_walk_batch.fwb_n_merged++;
+        return;
+    }
+
+    fwalk = fib_walk_alloc(parent_type,
+			   parent_index,
+			   FIB_WALK_FLAG_SYNC | FIB_WALK_FLAG_DEFERRED,
+			   ctx);
+
+    /*
+     * being on the parent's dependency list keeps the parent alive
+     * until the batch ends, as it does for async walks
+     */
+    fwalk->fw_dep_sibling = fib_node_child_add(parent_type,
+					       parent_index,
+					       FIB_NODE_TYPE_WALK,
+					       fib_walk_get_index(fwalk));
+
+    hash_set(fib_walk_batch.fwb_walk_by_parent, key,
+             fib_walk_get_index(fwalk));
+    vec_add1(fib_walk_batch.fwb_walks, fib_walk_get_index(fwalk));
+    fib_walk_batch.fwb_n_deferred++;
+
+    FIB_WALK_DBG(fwalk, "deferred: %U",
+                 format_fib_node_bw_reason, ctx->fnbw_reason);
+}
+
+/**
+ * @brief Back walk all the children of a FIB node.
+ *
+ * note this is a synchronous depth first walk. Children visited may propagate
+ * the walk to thier children. Other children node types may not propagate,
+ * synchronously but instead queue the walk for later async completion.
+ * Within a batch the walk is deferred until fib_walk_batch_end.
+ */
+void
+fib_walk_sync (fib_node_type_t parent_type,
+	       fib_node_index_t parent_index,
+	       fib_node_back_walk_ctx_t *ctx)
+{
+    fib_walk_t *fwalk;
+
+    if (FIB_NODE_GRAPH_MAX_DEPTH < ++ctx->fnbw_depth)
+    {
+	/*
+	 * The walk has reached the maximum depth. there is a loop in the graph.
+	 * bail.
+	 */
+	return;
+    }
+    if (0 == fib_node_get_n_children(parent_type,
+                                     parent_index))
+    {
+        /*
+         * no children to walk - quit now
+         */
+        return;
+    }
+    if (0 != fib_walk_batch.fwb_depth)
+    {
+        fib_walk_defer(parent_type, parent_index, ctx);
+        return;
+    }
+
+    fwalk = fib_walk_alloc(parent_type,
+			   parent_index,
+			   FIB_WALK_FLAG_SYNC,
+			   ctx);
+
+    fwalk->fw_dep_sibling = fib_node_child_add(parent_type,
+					       parent_index,
+					       FIB_NODE_TYPE_WALK,
+					       fib_walk_get_index(fwalk));
+    FIB_WALK_DBG(fwalk, "sync-start: %U",
+                 format_fib_node_bw_reason, ctx->fnbw_reason);
+
+    fib_walk_sync_run(fib_walk_get_index(fwalk), ctx);
+}
+
+void
+fib_walk_batch_begin (void)
+{
+    fib_walk_batch.fwb_depth++;
+}
+
+void
+fib_walk_batch_end (void)
+{
+    fib_node_back_walk_ctx_t ctx;
+    fib_walk_t *fwalk;
+    index_t *fwis;
+    u32 sibling;
+    index_t *fwi;
+
+    ASSERT(0 != fib_walk_batch.fwb_depth);
+
+    if (0 != --fib_walk_batch.fwb_depth)
+        return;
+
+    /*
+     * walks run now may open batches of their own and defer new walks,
+     * so take the current set first.
+     */
+    fwis = fib_walk_batch.fwb_walks;
+    fib_walk_batch.fwb_walks = NULL;
+    hash_free(fib_walk_batch.fwb_walk_by_parent);
+
+    vec_foreach(fwi, fwis)
+    {
+        fwalk = fib_walk_get(*fwi);
+
+        /*
+         * children added to the parent since the walk was deferred sit in
+         * front of it in the dependency list. move the walk to the front,
+         * adding before removing so the parent's lock count never drops.
+         */
+        sibling = fib_node_child_add(fwalk->fw_parent.fnp_type,
+                                     fwalk->fw_parent.fnp_index,
+                                     FIB_NODE_TYPE_WALK,
+                                     *fwi);
+        fwalk = fib_walk_get(*fwi);
+        fib_node_child_remove(fwalk->fw_parent.fnp_type,
+                              fwalk->fw_parent.fnp_index,
+                              fwalk->fw_dep_sibling);
+        fwalk = fib_walk_get(*fwi);
+        fwalk->fw_dep_sibling = sibling;
+        fwalk->fw_flags &= ~FIB_WALK_FLAG_DEFERRED;
+
+        ctx = fwalk->fw_ctx[0];
+
+        FIB_WALK_DBG(fwalk, "sync-start: %U",
+                     format_fib_node_bw_reason, ctx.fnbw_reason);
+
+        fib_walk_sync_run(*fwi, &ctx);
+    }
+    vec_free(fwis);
+}
+
 static fib_node_t *
 fib_walk_get_node (fib_node_index_t index)
 {
@@ -1035,6 +1209,12 @@ fib_walk_show (vlib_main_t * vm,
 	}
     }
 
+    vlib_cli_output(vm, "Batched walks:");
+    vlib_cli_output(vm, "  deferred:%lld merged:%lld pending:%d",
+                    fib_walk_batch.fwb_n_deferred,
+                    fib_walk_batch.fwb_n_merged,
+                    vec_len(fib_walk_batch.fwb_walks));
+
     vlib_cli_output(vm, "Histogram Statistics:");
     vlib_cli_output(vm, " Number of Elements visit per-quota:");
     for (ii = 0; ii < N_ELTS_BUCKETS; ii++)
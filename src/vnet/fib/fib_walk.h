@@ -52,6 +52,20 @@ extern void fib_walk_sync(fib_node_type_t parent_type,
                           fib_node_index_t parent_index,
                           fib_node_back_walk_ctx_t *ctx);
 
+/**
+ * @brief Open a walk batch.
+ * Until the matching fib_walk_batch_end, synchronous walks are deferred and
+ * repeated walks from the same parent are merged, so a parent updated many
+ * times in the batch has its children walked once. Batches nest.
+ */
+extern void fib_walk_batch_begin(void);
+
+/**
+ * @brief Close a walk batch. Closing the outermost one runs the deferred
+ * walks.
+ */
+extern void fib_walk_batch_end(void);
+
 extern u8* format_fib_walk_priority(u8 *s, va_list *ap);
 
 extern void fib_walk_process_enable(void);
@@ -99,6 +99,51 @@ static const ip4_fib_table_special_prefix_t ip4_specials[] = {
     }
 };
 
+static void
+ip4_fib_fwd_init (ip4_fib_t *fib,
+                  ip4_fib_fwd_type_t type)
+{
+    void *old_heap;
+
+    fib->fwd_type = type;
+
+    switch (type)
+    {
+    case IP4_FIB_FWD_TYPE_MTRIE:
+        old_heap = clib_mem_set_heap (ip4_main.mtrie_mheap);
+        fib->mtrie = clib_mem_alloc_aligned(sizeof(*fib->mtrie),
+                                            CLIB_CACHE_LINE_BYTES);
+        clib_mem_set_heap (old_heap);
+        ip4_mtrie_init(fib->mtrie);
+        clib_memset(&fib->poptrie, 0, sizeof(fib->poptrie));
+        break;
+    case IP4_FIB_FWD_TYPE_POPTRIE:
+        fib->mtrie = NULL;
+        ip4_poptrie_init(&fib->poptrie);
+        break;
+    }
+}
+
+static void
+ip4_fib_fwd_free (ip4_fib_t *fib)
+{
+    void *old_heap;
+
+    switch (fib->fwd_type)
+    {
+    case IP4_FIB_FWD_TYPE_MTRIE:
+        ip4_mtrie_free(fib->mtrie);
+        old_heap = clib_mem_set_heap (ip4_main.mtrie_mheap);
+        clib_mem_free(fib->mtrie);
+        clib_mem_set_heap (old_heap);
+        fib->mtrie = NULL;
+        break;
+    case IP4_FIB_FWD_TYPE_POPTRIE:
+        ip4_poptrie_free(&fib->poptrie);
+        clib_memset(&fib->poptrie, 0, sizeof(fib->poptrie));
+        break;
+    }
+}
 
 static u32
 ip4_create_fib_with_table_id (u32 table_id,
@@ -132,7 +177,7 @@ ip4_create_fib_with_table_id (u32 table_id,
     
     fib_table_lock(fib_table->ft_index, FIB_PROTOCOL_IP4, src);
 
-    ip4_mtrie_init(&v4_fib->mtrie);
+    ip4_fib_fwd_init(v4_fib, ip4_main.fib_fwd_type_default);
 
     /*
      * add the special entries into the new FIB
@@ -192,7 +237,7 @@ ip4_fib_table_destroy (u32 fib_index)
 	hash_unset (ip4_main.fib_index_by_table_id, fib_table->ft_table_id);
     }
 
-    ip4_mtrie_free(&v4_fib->mtrie);
+    ip4_fib_fwd_free(v4_fib);
 
     pool_put(ip4_main.v4_fibs, v4_fib);
     pool_put(ip4_main.fibs, fib_table);
@@ -381,7 +426,15 @@ ip4_fib_table_fwding_dpo_update (ip4_fib_t *fib,
 				 u32 len,
 				 const dpo_id_t *dpo)
 {
-    ip4_fib_mtrie_route_add(&fib->mtrie, addr, len, dpo->dpoi_index);
+    switch (fib->fwd_type)
+    {
+    case IP4_FIB_FWD_TYPE_MTRIE:
+        ip4_fib_mtrie_route_add(fib->mtrie, addr, len, dpo->dpoi_index);
+        break;
+    case IP4_FIB_FWD_TYPE_POPTRIE:
+        ip4_poptrie_route_add(&fib->poptrie, addr, len, dpo->dpoi_index);
+        break;
+    }
 }
 
 void
@@ -402,10 +455,142 @@ ip4_fib_table_fwding_dpo_remove (ip4_fib_t *fib,
     cover_prefix = fib_entry_get_prefix(cover_index);
     cover_dpo = fib_entry_contribute_ip_forwarding(cover_index);
 
-    ip4_fib_mtrie_route_del(&fib->mtrie,
-                            addr, len, dpo->dpoi_index,
-                            cover_prefix->fp_len,
-                            cover_dpo->dpoi_index);
+    switch (fib->fwd_type)
+    {
+    case IP4_FIB_FWD_TYPE_MTRIE:
+        ip4_fib_mtrie_route_del(fib->mtrie,
+                                addr, len, dpo->dpoi_index,
+                                cover_prefix->fp_len,
+                                cover_dpo->dpoi_index);
+        break;
+    case IP4_FIB_FWD_TYPE_POPTRIE:
+        ip4_poptrie_route_del(&fib->poptrie,
+                              addr, len, dpo->dpoi_index,
+                              cover_prefix->fp_len,
+                              cover_dpo->dpoi_index);
+        break;
+    }
+}
+
+static fib_table_walk_rc_t
+ip4_fib_fwd_populate_walk (fib_node_index_t fib_entry_index,
+                           void *arg)
+{
+    ip4_fib_t *fib = arg;
+    fib_entry_t *fib_entry;
+
+    fib_entry = fib_entry_get(fib_entry_index);
+
+    /*
+     * only those entries that are installed have a load-balance
+     */
+    if (dpo_id_is_valid(&fib_entry->fe_lb))
+    {
+        ip4_fib_table_fwding_dpo_update(fib,
+                                        &fib_entry->fe_prefix.fp_addr.ip4,
+                                        fib_entry->fe_prefix.fp_len,
+                                        &fib_entry->fe_lb);
+    }
+
+    return (FIB_TABLE_WALK_CONTINUE);
+}
+
+void
+ip4_fib_table_set_fwd_type (u32 fib_index,
+                            ip4_fib_fwd_type_t type)
+{
+    ip4_fib_t *fib, old, new;
+
+    fib = ip4_fib_get(fib_index);
+
+    if (type == fib->fwd_type)
+        return;
+
+    /*
+     * populate the new structure on the side, then switch the data-plane
+     * over to it, then free the old
+     */
+    new = *fib;
+    ip4_fib_fwd_init(&new, type);
+    ip4_fib_table_walk(fib, ip4_fib_fwd_populate_walk, &new);
+
+    old = *fib;
+
+    switch (type)
+    {
+    case IP4_FIB_FWD_TYPE_MTRIE:
+        fib->mtrie = new.mtrie;
+        break;
+    case IP4_FIB_FWD_TYPE_POPTRIE:
+        fib->poptrie = new.poptrie;
+        break;
+    }
+    CLIB_MEMORY_STORE_BARRIER();
+    fib->fwd_type = type;
+
+    /*
+     * workers may still be looking up in the old structure
+     */
+    vlib_worker_thread_barrier_sync(vlib_get_main());
+    ip4_fib_fwd_free(&old);
+    vlib_worker_thread_barrier_release(vlib_get_main());
+    switch (type)
+    {
+    case IP4_FIB_FWD_TYPE_MTRIE:
+        fib->poptrie = old.poptrie;
+        break;
+    case IP4_FIB_FWD_TYPE_POPTRIE:
+        fib->mtrie = old.mtrie;
+        break;
+    }
+}
+
+static uword
+ip4_fib_fwd_memory_usage (ip4_fib_t *fib)
+{
+    switch (fib->fwd_type)
+    {
+    case IP4_FIB_FWD_TYPE_MTRIE:
+        return (ip4_fib_mtrie_memory_usage(fib->mtrie));
+    case IP4_FIB_FWD_TYPE_POPTRIE:
+        return (ip4_poptrie_memory_usage(&fib->poptrie));
+    }
+    return (0);
+}
+
+static char *ip4_fib_fwd_type_names[] = {
+#define _(a,b) [IP4_FIB_FWD_TYPE_##a] = b,
+    foreach_ip4_fib_fwd_type
+#undef _
+};
+
+u8 *
+format_ip4_fib_fwd_type (u8 * s, va_list * args)
+{
+    ip4_fib_fwd_type_t type = va_arg(*args, int);
+
+    if (type >= IP4_FIB_FWD_TYPE_N)
+        return (format(s, "unknown"));
+
+    return (format(s, "%s", ip4_fib_fwd_type_names[type]));
+}
+
+uword
+unformat_ip4_fib_fwd_type (unformat_input_t * input,
+                           va_list * args)
+{
+    ip4_fib_fwd_type_t *type = va_arg(*args, ip4_fib_fwd_type_t *);
+
+#define _(a,b)                                  \
+    if (unformat(input, b))                     \
+    {                                           \
+        *type = IP4_FIB_FWD_TYPE_##a;           \
+        return (1);                             \
+    }
+    foreach_ip4_fib_fwd_type
+#undef _
+
+    return (0);
 }
 
 void
@@ -646,7 +831,7 @@ ip4_show_fib (vlib_main_t * vm,
             uword mtrie_size, hash_size, *old_heap;
 
 
-            mtrie_size = ip4_fib_mtrie_memory_usage(&fib->mtrie);
+            mtrie_size = ip4_fib_fwd_memory_usage(fib);
             hash_size = 0;
 
             old_heap = clib_mem_set_heap (ip4_main.mtrie_mheap);
@@ -661,9 +846,10 @@ ip4_show_fib (vlib_main_t * vm,
             clib_mem_set_heap (old_heap);
 
             if (verbose)
-                vlib_cli_output (vm, "%U mtrie:%d hash:%d",
+                vlib_cli_output (vm, "%U %U:%d hash:%d",
                                  format_fib_table_name, fib->index,
                                  FIB_PROTOCOL_IP4,
+                                 format_ip4_fib_fwd_type, fib->fwd_type,
                                  mtrie_size,
                                  hash_size);
             total_mtrie_memory += mtrie_size;
@@ -693,11 +879,24 @@ ip4_show_fib (vlib_main_t * vm,
 	/* Show summary? */
 	if (mtrie)
         {
-	    vlib_cli_output (vm, "%U", format_ip4_fib_mtrie, &fib->mtrie, verbose);
+            switch (fib->fwd_type)
+            {
+            case IP4_FIB_FWD_TYPE_MTRIE:
+                vlib_cli_output (vm, "%U", format_ip4_fib_mtrie,
+                                 fib->mtrie, verbose);
+                break;
+            case IP4_FIB_FWD_TYPE_POPTRIE:
+                vlib_cli_output (vm, "%U", format_ip4_poptrie,
+                                 &fib->poptrie, verbose);
+                break;
+            }
             continue;
         }
 	if (! verbose)
 	{
+	    vlib_cli_output (vm, "forwarding: %U bytes:%d",
+                             format_ip4_fib_fwd_type, fib->fwd_type,
+                             ip4_fib_fwd_memory_usage(fib));
 	    vlib_cli_output (vm, "%=20s%=16s", "Prefix length", "Count");
 	    for (i = 0; i < ARRAY_LEN (fib->fib_entry_by_dst_address); i++)
 	    {
@@ -722,7 +921,7 @@ ip4_show_fib (vlib_main_t * vm,
 
     if (memory)
     {
-        vlib_cli_output (vm, "totals: mtrie:%ld hash:%ld all:%ld",
+        vlib_cli_output (vm, "totals: fwd:%ld hash:%ld all:%ld",
                          total_mtrie_memory,
                          total_hash_memory,
                          total_mtrie_memory + total_hash_memory);
@@ -864,11 +1063,13 @@ ip4_show_fib (vlib_main_t * vm,
  * Example of how to display a summary of all IPv4 FIB tables:
  * @cliexstart{show ip fib summary}
  * ipv4-VRF:0, fib_index 0, flow hash: src dst sport dport proto
+ * forwarding: mtrie bytes:329088
  *     Prefix length         Count
  *                    0               1
  *                    8               2
  *                   32               4
  * ipv4-VRF:7, fib_index 1, flow hash: src dst sport dport proto
+ * forwarding: poptrie bytes:2968
  *     Prefix length         Count
  *                    0               1
  *                    8               2
@@ -883,3 +1084,59 @@ VLIB_CLI_COMMAND (ip4_show_fib_command, static) = {
     .function = ip4_show_fib,
 };
 /* *INDENT-ON* */
+
+static clib_error_t *
+ip4_fib_fwd_type_command_fn (vlib_main_t * vm,
+                             unformat_input_t * input,
+                             vlib_cli_command_t * cmd)
+{
+    ip4_fib_fwd_type_t type = IP4_FIB_FWD_TYPE_N;
+    u32 table_id = ~0, fib_index;
+
+    while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+        if (unformat (input, "%U", unformat_ip4_fib_fwd_type, &type))
+            ;
+        else if (unformat (input, "table %d", &table_id))
+            ;
+        else
+            return (clib_error_return (0, "unknown input '%U'",
+                                       format_unformat_error, input));
+    }
+
+    if (IP4_FIB_FWD_TYPE_N == type)
+        return (clib_error_return (0, "specify mtrie or poptrie"));
+
+    if (~0 == table_id)
+    {
+        ip4_main.fib_fwd_type_default = type;
+        return (NULL);
+    }
+
+    fib_index = ip4_fib_index_from_table_id(table_id);
+
+    if (~0 == fib_index)
+        return (clib_error_return (0, "no such table %d", table_id));
+
+    ip4_fib_table_set_fwd_type(fib_index, type);
+
+    return (NULL);
+}
+
+/*?
+ * This command selects the data-structure used for forwarding lookups in an
+ * IPv4 FIB table. The mtrie is fastest to look up, the poptrie uses far less
+ * memory per table. Without a table the type is the default for tables
+ * created from then on; the startup default can be given in the 'ip'
+ * section of the configuration as 'fib-forwarding poptrie'.
+ *
+ * @cliexpar
+ * @cliexcmd{set ip fib forwarding poptrie table 7}
+ ?*/
+/* *INDENT-OFF* */
+VLIB_CLI_COMMAND (ip4_fib_fwd_type_command, static) = {
+    .path = "set ip fib forwarding",
+    .short_help = "set ip fib forwarding <mtrie|poptrie> [table <table-id>]",
+    .function = ip4_fib_fwd_type_command_fn,
+};
+/* *INDENT-ON* */
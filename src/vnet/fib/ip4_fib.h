@@ -20,7 +20,8 @@
  * forwarding table contains the sub-set of those routes that can be used to
  * forward packets.
  * In the IPv4 FIB the non-forwarding table is an array of hash tables indexed
- * by mask length, the forwarding table is an mtrie
+ * by mask length, the forwarding table is, per-table, either an mtrie or the
+ * more compact poptrie
  *
  * This IPv4 FIB is used by the protocol independent FIB. So directly using
  * this APIs in client code is not encouraged. However, this IPv4 FIB can be
@@ -35,6 +36,23 @@
 #include <vnet/fib/fib_entry.h>
 #include <vnet/fib/fib_table.h>
 #include <vnet/ip/ip4_mtrie.h>
+#include <vnet/ip/ip4_poptrie.h>
+
+/**
+ * The data-structures that can be used for forwarding lookups
+ */
+#define foreach_ip4_fib_fwd_type                \
+    _(MTRIE, "mtrie")                           \
+    _(POPTRIE, "poptrie")
+
+typedef enum ip4_fib_fwd_type_t_
+{
+#define _(a,b) IP4_FIB_FWD_TYPE_##a,
+    foreach_ip4_fib_fwd_type
+#undef _
+} __attribute__ ((packed)) ip4_fib_fwd_type_t;
+
+#define IP4_FIB_FWD_TYPE_N (IP4_FIB_FWD_TYPE_POPTRIE + 1)
 
 typedef struct ip4_fib_t_
 {
@@ -42,10 +60,22 @@ typedef struct ip4_fib_t_
   CLIB_CACHE_LINE_ALIGN_MARK(cacheline0);
 
   /**
-   * Mtrie for fast lookups. Hash is used to maintain overlapping prefixes.
-   * First member so it's in the first cacheline.
+   * The structure used for forwarding lookups; mtrie or poptrie.
+   * Hash is used to maintain overlapping prefixes.
+   * The lookup structures are in the first cacheline.
+   */
+  ip4_fib_fwd_type_t fwd_type;
+
+  /**
+   * Mtrie for fast lookups. Allocated only when it is the forwarding type,
+   * since its root ply alone is over 300k.
    */
-  ip4_fib_mtrie_t mtrie;
+  ip4_fib_mtrie_t *mtrie;
+
+  /**
+   * Poptrie for compact lookups.
+   */
+  ip4_poptrie_t poptrie;
 
   /* Hash table for each prefix length mapping. */
   uword *fib_entry_by_dst_address[33];
@@ -141,6 +171,18 @@ extern u32 ip4_fib_table_create_and_lock(fib_source_t src);
 
 extern u8 *format_ip4_fib_table_memory(u8 * s, va_list * args);
 
+/**
+ * @brief Change the structure used for forwarding lookups in a table.
+ * The new structure is populated from the table's entries before it is
+ * used, so forwarding is not interrupted.
+ */
+extern void ip4_fib_table_set_fwd_type(u32 fib_index,
+                                       ip4_fib_fwd_type_t type);
+
+extern u8 *format_ip4_fib_fwd_type(u8 * s, va_list * args);
+extern uword unformat_ip4_fib_fwd_type(unformat_input_t * input,
+                                       va_list * args);
+
 static inline 
 u32 ip4_fib_index_from_table_id (u32 table_id)
 {
@@ -162,8 +204,14 @@ ip4_fib_forwarding_lookup (u32 fib_index,
 {
     ip4_fib_mtrie_leaf_t leaf;
     ip4_fib_mtrie_t * mtrie;
+    ip4_fib_t * fib;
+
+    fib = ip4_fib_get(fib_index);
+
+    if (PREDICT_FALSE(IP4_FIB_FWD_TYPE_POPTRIE == fib->fwd_type))
+        return (ip4_poptrie_lookup(&fib->poptrie, addr));
 
-    mtrie = &ip4_fib_get(fib_index)->mtrie;
+    mtrie = fib->mtrie;
 
     leaf = ip4_fib_mtrie_lookup_step_one (mtrie, addr);
     leaf = ip4_fib_mtrie_lookup_step (mtrie, leaf, addr, 2);
@@ -314,6 +314,726 @@ ip6_fib_table_entry_insert (u32 fib_index,
     compute_prefix_lengths_in_search_order (table);
 }
 
+/**
+ * The LPM being built by the process, which takes over from the serving
+ * one once complete. Updates are applied to both in the meantime.
+ */
+static ip6_fib_lpm_t *ip6_fib_lpm_building;
+
+/**
+ * The forwarding table's entries when the build started, and how many of
+ * them have been added to the LPM being built.
+ */
+static clib_bihash_kv_24_8_t *ip6_fib_lpm_snapshot;
+static u32 ip6_fib_lpm_snapshot_next;
+
+/**
+ * The process has been signalled and has not yet woken
+ */
+static int ip6_fib_lpm_signalled;
+
+/**
+ * Wait this long after a change before rebuilding, so that a burst of
+ * updates costs one rebuild.
+ */
+#define IP6_FIB_LPM_HOLDDOWN 10e-3
+
+/**
+ * Table entries added to the LPM being built between yields of the process
+ */
+#define IP6_FIB_LPM_BUILD_BATCH 1024
+
+/**
+ * Markers per chunk of the sorted index, a chunk is split at twice this
+ */
+#define IP6_FIB_LPM_MARKER_CHUNK 256
+
+typedef enum ip6_fib_lpm_process_event_t_
+{
+    IP6_FIB_LPM_EVENT_REBUILD,
+} ip6_fib_lpm_process_event_t;
+
+static_always_inline u64
+ip6_fib_lpm_mk_value (u32 lbi, u32 len, u64 flags_and_n_marked)
+{
+    return ((flags_and_n_marked & ~0xffffffffffULL) |
+            ((u64)len << 32) | lbi);
+}
+
+static_always_inline void
+ip6_fib_lpm_mk_marker (ip6_fib_lpm_marker_t *m,
+                       const clib_bihash_kv_24_8_t *kv)
+{
+    m->addr[0] = clib_net_to_host_u64(kv->key[0]);
+    m->addr[1] = clib_net_to_host_u64(kv->key[1]);
+    m->fib_index = kv->key[2] >> 32;
+    m->len = kv->key[2] & 0xff;
+}
+
+static_always_inline void
+ip6_fib_lpm_mk_key (clib_bihash_kv_24_8_t *kv,
+                    const ip6_fib_lpm_marker_t *m)
+{
+    kv->key[0] = clib_host_to_net_u64(m->addr[0]);
+    kv->key[1] = clib_host_to_net_u64(m->addr[1]);
+    kv->key[2] = ((u64)m->fib_index << 32) | m->len;
+}
+
+static int
+ip6_fib_lpm_marker_cmp (const ip6_fib_lpm_marker_t *m1,
+                        const ip6_fib_lpm_marker_t *m2)
+{
+    if (m1->fib_index != m2->fib_index)
+        return (m1->fib_index < m2->fib_index ? -1 : 1);
+    if (m1->addr[0] != m2->addr[0])
+        return (m1->addr[0] < m2->addr[0] ? -1 : 1);
+    if (m1->addr[1] != m2->addr[1])
+        return (m1->addr[1] < m2->addr[1] ? -1 : 1);
+    if (m1->len != m2->len)
+        return (m1->len < m2->len ? -1 : 1);
+    return (0);
+}
+
+/**
+ * The position of the first marker in the index not less than m
+ */
+static void
+ip6_fib_lpm_marker_find (const ip6_fib_lpm_t *lpm,
+                         const ip6_fib_lpm_marker_t *m,
+                         u32 *chunk, u32 *pos)
+{
+    const ip6_fib_lpm_marker_t *markers;
+    u32 lo, hi, mid;
+
+    /* the last chunk starting at or before m */
+    lo = 0;
+    hi = vec_len(lpm->markers);
+    while (hi - lo > 1)
+    {
+        mid = (lo + hi) / 2;
+        if (ip6_fib_lpm_marker_cmp(&lpm->markers[mid][0], m) <= 0)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    *chunk = lo;
+
+    if (lo >= vec_len(lpm->markers))
+    {
+        *pos = 0;
+        return;
+    }
+
+    markers = lpm->markers[lo];
+    lo = 0;
+    hi = vec_len(markers);
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (ip6_fib_lpm_marker_cmp(&markers[mid], m) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *pos = lo;
+}
+
+static void
+ip6_fib_lpm_marker_index_add (ip6_fib_lpm_t *lpm,
+                              const clib_bihash_kv_24_8_t *kv)
+{
+    ip6_fib_lpm_marker_t m, *split = NULL;
+    u32 chunk, pos, n;
+
+    ip6_fib_lpm_mk_marker(&m, kv);
+
+    if (0 == vec_len(lpm->markers))
+        vec_add1(lpm->markers, NULL);
+
+    ip6_fib_lpm_marker_find(lpm, &m, &chunk, &pos);
+    vec_insert_elts(lpm->markers[chunk], &m, 1, pos);
+
+    n = vec_len(lpm->markers[chunk]);
+    if (n >= 2 * IP6_FIB_LPM_MARKER_CHUNK)
+    {
+        vec_add(split, lpm->markers[chunk] + n / 2, n - n / 2);
+        _vec_len(lpm->markers[chunk]) = n / 2;
+        vec_insert_elts(lpm->markers, &split, 1, chunk + 1);
+    }
+}
+
+static void
+ip6_fib_lpm_marker_index_del (ip6_fib_lpm_t *lpm,
+                              const clib_bihash_kv_24_8_t *kv)
+{
+    ip6_fib_lpm_marker_t m;
+    u32 chunk, pos;
+
+    ip6_fib_lpm_mk_marker(&m, kv);
+    ip6_fib_lpm_marker_find(lpm, &m, &chunk, &pos);
+
+    ASSERT(chunk < vec_len(lpm->markers));
+    ASSERT(pos < vec_len(lpm->markers[chunk]));
+    ASSERT(0 == ip6_fib_lpm_marker_cmp(&lpm->markers[chunk][pos], &m));
+
+    vec_delete(lpm->markers[chunk], 1, pos);
+    if (0 == vec_len(lpm->markers[chunk]))
+    {
+        vec_free(lpm->markers[chunk]);
+        vec_delete(lpm->markers, 1, chunk);
+    }
+}
+
+/**
+ * The best match for an address in the forwarding table, from the
+ * prefixes no longer than len. Returns 0, for no match, if there are none.
+ */
+static u64
+ip6_fib_lpm_best_match (const clib_bihash_kv_24_8_t *key,
+                        u32 len)
+{
+    ip6_fib_table_instance_t *table;
+    clib_bihash_kv_24_8_t kv, value;
+    ip6_address_t *mask;
+    int i;
+
+    table = &ip6_main.ip6_table[IP6_FIB_TABLE_FWDING];
+
+    for (i = 0; i < vec_len(table->prefix_lengths_in_search_order); i++)
+    {
+        int dst_address_length = table->prefix_lengths_in_search_order[i];
+
+        if (dst_address_length > len)
+            continue;
+
+        mask = &ip6_main.fib_masks[dst_address_length];
+        kv.key[0] = key->key[0] & mask->as_u64[0];
+        kv.key[1] = key->key[1] & mask->as_u64[1];
+        kv.key[2] = (key->key[2] & ~0xffULL) | dst_address_length;
+
+        if (0 == clib_bihash_search_24_8(&table->ip6_hash, &kv, &value))
+            return (ip6_fib_lpm_mk_value(value.value, dst_address_length, 0));
+    }
+
+    return (0);
+}
+
+/**
+ * Set the best match of the markers under a prefix whose best match is
+ * no longer than max_len, or exactly len if exact.
+ */
+static void
+ip6_fib_lpm_markers_update (ip6_fib_lpm_t *lpm,
+                            const clib_bihash_kv_24_8_t *pfx,
+                            u64 best,
+                            int exact)
+{
+    ip6_fib_lpm_marker_t lo, hi, *m;
+    clib_bihash_kv_24_8_t kv;
+    u32 chunk, pos, len, mlen;
+    const ip6_address_t *mask;
+
+    len = pfx->key[2] & 0xff;
+    mask = &ip6_main.fib_masks[len];
+
+    ip6_fib_lpm_mk_marker(&lo, pfx);
+    lo.len = 0;
+    hi = lo;
+    hi.addr[0] |= ~clib_net_to_host_u64(mask->as_u64[0]);
+    hi.addr[1] |= ~clib_net_to_host_u64(mask->as_u64[1]);
+    hi.len = ~0;
+
+    ip6_fib_lpm_marker_find(lpm, &lo, &chunk, &pos);
+
+    for (; chunk < vec_len(lpm->markers); chunk++, pos = 0)
+    {
+        for (; pos < vec_len(lpm->markers[chunk]); pos++)
+        {
+            m = &lpm->markers[chunk][pos];
+
+            if (ip6_fib_lpm_marker_cmp(m, &hi) > 0)
+                return;
+            if (m->len <= len)
+                continue;
+
+            ip6_fib_lpm_mk_key(&kv, m);
+            if (clib_bihash_search_24_8(&lpm->ip6_hash, &kv, &kv))
+            {
+                ASSERT(0);
+                continue;
+            }
+
+            mlen = IP6_FIB_LPM_VALUE_LEN(kv.value);
+            if (exact ? mlen != len : mlen > len)
+                continue;
+
+            kv.value = ip6_fib_lpm_mk_value(IP6_FIB_LPM_VALUE_LBI(best),
+                                            IP6_FIB_LPM_VALUE_LEN(best),
+                                            kv.value);
+            clib_bihash_add_del_24_8(&lpm->ip6_hash, &kv, 1);
+        }
+    }
+}
+
+static int
+ip6_fib_lpm_has_length (const ip6_fib_lpm_t *lpm,
+                        u32 len)
+{
+    u32 node = 0;
+
+    while (node < IP6_FIB_LPM_N_NODES &&
+           IP6_FIB_LPM_NODE_NONE != lpm->lengths[node])
+    {
+        if (lpm->lengths[node] == len)
+            return (1);
+        node = 2 * node + (lpm->lengths[node] > len ? 1 : 2);
+    }
+    return (0);
+}
+
+/**
+ * Take or release a reference on the markers on the path of a prefix
+ */
+static void
+ip6_fib_lpm_path_markers (ip6_fib_lpm_t *lpm,
+                          const clib_bihash_kv_24_8_t *pfx,
+                          int is_add)
+{
+    clib_bihash_kv_24_8_t kv;
+    ip6_address_t *mask;
+    u32 len, node, mlen;
+
+    len = pfx->key[2] & 0xff;
+    node = 0;
+
+    while (lpm->lengths[node] != len)
+    {
+        mlen = lpm->lengths[node];
+        if (mlen > len)
+        {
+            node = 2 * node + 1;
+            continue;
+        }
+        mask = &ip6_main.fib_masks[mlen];
+        kv.key[0] = pfx->key[0] & mask->as_u64[0];
+        kv.key[1] = pfx->key[1] & mask->as_u64[1];
+        kv.key[2] = (pfx->key[2] & ~0xffULL) | mlen;
+
+        if (0 == clib_bihash_search_24_8(&lpm->ip6_hash, &kv, &kv))
+        {
+            if (is_add)
+                kv.value += IP6_FIB_LPM_VALUE_MARKED_ONE;
+            else
+            {
+                ASSERT(IP6_FIB_LPM_VALUE_N_MARKED(kv.value));
+                kv.value -= IP6_FIB_LPM_VALUE_MARKED_ONE;
+            }
+
+            if (0 == IP6_FIB_LPM_VALUE_N_MARKED(kv.value) &&
+                !(kv.value & IP6_FIB_LPM_VALUE_IS_PREFIX))
+            {
+                clib_bihash_add_del_24_8(&lpm->ip6_hash, &kv, 0);
+                ip6_fib_lpm_marker_index_del(lpm, &kv);
+                lpm->n_markers--;
+            }
+            else
+                clib_bihash_add_del_24_8(&lpm->ip6_hash, &kv, 1);
+        }
+        else
+        {
+            ASSERT(is_add);
+            kv.value = (ip6_fib_lpm_best_match(&kv, mlen) +
+                        IP6_FIB_LPM_VALUE_MARKED_ONE);
+            clib_bihash_add_del_24_8(&lpm->ip6_hash, &kv, 1);
+            ip6_fib_lpm_marker_index_add(lpm, &kv);
+            lpm->n_markers++;
+        }
+
+        node = 2 * node + 2;
+    }
+}
+
+static void
+ip6_fib_lpm_add_missing_length (ip6_fib_lpm_t *lpm,
+                                u32 len)
+{
+    u32 i;
+
+    for (i = 0; i < lpm->n_missing_lengths; i++)
+        if (lpm->missing_lengths[i] == len)
+            return;
+
+    lpm->missing_lengths[i] = len;
+    clib_atomic_store_rel_n(&lpm->n_missing_lengths, i + 1);
+}
+
+/**
+ * A prefix has been added to, or updated in, the forwarding table. When
+ * populating an LPM from the table the markers under the prefix were
+ * made knowing of it, and are left alone.
+ */
+static void
+ip6_fib_lpm_prefix_add (ip6_fib_lpm_t *lpm,
+                        const clib_bihash_kv_24_8_t *pfx,
+                        int is_populate)
+{
+    clib_bihash_kv_24_8_t kv;
+    u32 len;
+
+    len = pfx->key[2] & 0xff;
+
+    if (!ip6_fib_lpm_has_length(lpm, len))
+        ip6_fib_lpm_add_missing_length(lpm, len);
+    else
+    {
+        kv = *pfx;
+        if (0 == clib_bihash_search_24_8(&lpm->ip6_hash, &kv, &kv))
+        {
+            if (kv.value & IP6_FIB_LPM_VALUE_IS_PREFIX)
+            {
+                /* an update; the markers are already in place */
+                if (IP6_FIB_LPM_VALUE_LBI(kv.value) == (u32)pfx->value)
+                    return;
+            }
+            else
+            {
+                ip6_fib_lpm_marker_index_del(lpm, &kv);
+                lpm->n_markers--;
+                lpm->n_prefixes++;
+                ip6_fib_lpm_path_markers(lpm, pfx, 1);
+            }
+        }
+        else
+        {
+            kv.value = 0;
+            lpm->n_prefixes++;
+            ip6_fib_lpm_path_markers(lpm, pfx, 1);
+        }
+
+        kv.value = ip6_fib_lpm_mk_value(pfx->value, len,
+                                        kv.value |
+                                        IP6_FIB_LPM_VALUE_IS_PREFIX);
+        clib_bihash_add_del_24_8(&lpm->ip6_hash, &kv, 1);
+    }
+
+    if (!is_populate)
+        ip6_fib_lpm_markers_update(lpm, pfx,
+                                   ip6_fib_lpm_mk_value(pfx->value, len, 0),
+                                   0);
+}
+
+/**
+ * A prefix has been removed from the forwarding table. The markers that
+ * matched it now match its cover, even if the prefix's length is not in
+ * the tree, since markers are made from the whole table.
+ */
+static void
+ip6_fib_lpm_prefix_del (ip6_fib_lpm_t *lpm,
+                        const clib_bihash_kv_24_8_t *pfx)
+{
+    clib_bihash_kv_24_8_t kv;
+    u64 cover;
+    u32 len;
+
+    len = pfx->key[2] & 0xff;
+    cover = (len ? ip6_fib_lpm_best_match(pfx, len - 1) : 0);
+
+    kv = *pfx;
+    if (ip6_fib_lpm_has_length(lpm, len) &&
+        0 == clib_bihash_search_24_8(&lpm->ip6_hash, &kv, &kv) &&
+        (kv.value & IP6_FIB_LPM_VALUE_IS_PREFIX))
+    {
+        ip6_fib_lpm_path_markers(lpm, pfx, 0);
+        lpm->n_prefixes--;
+
+        if (IP6_FIB_LPM_VALUE_N_MARKED(kv.value))
+        {
+            /* still a marker for longer prefixes */
+            kv.value = ip6_fib_lpm_mk_value(IP6_FIB_LPM_VALUE_LBI(cover),
+                                            IP6_FIB_LPM_VALUE_LEN(cover),
+                                            kv.value &
+                                            ~IP6_FIB_LPM_VALUE_IS_PREFIX);
+            clib_bihash_add_del_24_8(&lpm->ip6_hash, &kv, 1);
+            ip6_fib_lpm_marker_index_add(lpm, &kv);
+            lpm->n_markers++;
+        }
+        else
+            clib_bihash_add_del_24_8(&lpm->ip6_hash, &kv, 0);
+    }
+
+    ip6_fib_lpm_markers_update(lpm, pfx, cover, 1);
+}
+
+/**
+ * Fill the tree of lengths from the sorted lengths in [lo, hi]
+ */
+static u32
+ip6_fib_lpm_build_tree (ip6_fib_lpm_t *lpm,
+                        const u8 *lengths,
+                        int lo, int hi,
+                        u32 node)
+{
+    u32 mid, l, r;
+
+    if (node >= IP6_FIB_LPM_N_NODES)
+        return (0);
+    if (lo > hi)
+    {
+        lpm->lengths[node] = IP6_FIB_LPM_NODE_NONE;
+        return (0);
+    }
+
+    mid = (lo + hi + 1) / 2;
+    lpm->lengths[node] = lengths[mid];
+
+    l = ip6_fib_lpm_build_tree(lpm, lengths, lo, mid - 1, 2 * node + 1);
+    r = ip6_fib_lpm_build_tree(lpm, lengths, mid + 1, hi, 2 * node + 2);
+
+    return (1 + clib_max(l, r));
+}
+
+static void
+ip6_fib_lpm_free (ip6_fib_lpm_t *lpm)
+{
+    u32 i;
+
+    vec_foreach_index(i, lpm->markers)
+        vec_free(lpm->markers[i]);
+    vec_free(lpm->markers);
+    clib_bihash_free_24_8(&lpm->ip6_hash);
+    clib_mem_free(lpm);
+}
+
+static void
+ip6_fib_lpm_snapshot_add (clib_bihash_kv_24_8_t * kvp,
+                          void *arg)
+{
+    vec_add1(ip6_fib_lpm_snapshot, *kvp);
+}
+
+/**
+ * Start building an LPM over the lengths now in the table. The table is
+ * copied, so that the LPM can be populated a batch at a time.
+ */
+static void
+ip6_fib_lpm_build_begin (void)
+{
+    ip6_fib_table_instance_t *table;
+    ip6_main_t *im = &ip6_main;
+    ip6_fib_lpm_t *lpm;
+    u8 *lengths = NULL;
+    f64 start;
+    int i;
+
+    if (NULL != ip6_fib_lpm_building)
+        ip6_fib_lpm_free(ip6_fib_lpm_building);
+
+    start = vlib_time_now(vlib_get_main());
+    table = &im->ip6_table[IP6_FIB_TABLE_FWDING];
+
+    lpm = clib_mem_alloc_aligned(sizeof(*lpm), CLIB_CACHE_LINE_BYTES);
+    clib_memset(lpm, 0, sizeof(*lpm));
+    clib_memset(lpm->lengths, IP6_FIB_LPM_NODE_NONE, sizeof(lpm->lengths));
+    /* room for the markers as well as the prefixes */
+    clib_bihash_init_24_8(&lpm->ip6_hash, "ip6 FIB LPM table",
+                          im->lookup_table_nbuckets,
+                          2 * im->lookup_table_size);
+
+    /* the search order is longest first; the tree wants them ascending */
+    for (i = vec_len(table->prefix_lengths_in_search_order) - 1; i >= 0; i--)
+        vec_add1(lengths, table->prefix_lengths_in_search_order[i]);
+    lpm->depth = ip6_fib_lpm_build_tree(lpm, lengths,
+                                        0, vec_len(lengths) - 1, 0);
+    vec_free(lengths);
+
+    vec_reset_length(ip6_fib_lpm_snapshot);
+    clib_bihash_foreach_key_value_pair_24_8(&table->ip6_hash,
+                                            ip6_fib_lpm_snapshot_add,
+                                            NULL);
+    ip6_fib_lpm_snapshot_next = 0;
+
+    lpm->build_time = vlib_time_now(vlib_get_main()) - start;
+    ip6_fib_lpm_building = lpm;
+}
+
+/**
+ * Add up to n more of the table's entries to the LPM being built, and
+ * swap it in once they are all added. Returns 1 when it has been.
+ */
+static int
+ip6_fib_lpm_build_continue (u32 n)
+{
+    clib_bihash_kv_24_8_t *kvp, kv;
+    ip6_main_t *im = &ip6_main;
+    ip6_fib_lpm_t *lpm, *old;
+    f64 start;
+
+    lpm = ip6_fib_lpm_building;
+    start = vlib_time_now(vlib_get_main());
+
+    while (n-- && ip6_fib_lpm_snapshot_next < vec_len(ip6_fib_lpm_snapshot))
+    {
+        kvp = vec_elt_at_index(ip6_fib_lpm_snapshot,
+                               ip6_fib_lpm_snapshot_next++);
+
+        /* changes since the copy have been applied already */
+        kv = *kvp;
+        if (0 == clib_bihash_search_24_8(&im->ip6_table[IP6_FIB_TABLE_FWDING].
+                                         ip6_hash, &kv, &kv))
+            ip6_fib_lpm_prefix_add(lpm, &kv, 1);
+    }
+
+    lpm->build_time += vlib_time_now(vlib_get_main()) - start;
+
+    if (ip6_fib_lpm_snapshot_next < vec_len(ip6_fib_lpm_snapshot))
+        return (0);
+
+    vec_reset_length(ip6_fib_lpm_snapshot);
+    ip6_fib_lpm_building = NULL;
+
+    old = im->fib_lpm;
+    CLIB_MEMORY_STORE_BARRIER();
+    im->fib_lpm = lpm;
+
+    if (NULL != old)
+    {
+        /* no worker is still in a lookup once they are all at the barrier */
+        vlib_worker_thread_barrier_sync(vlib_get_main());
+        ip6_fib_lpm_free(old);
+        vlib_worker_thread_barrier_release(vlib_get_main());
+    }
+
+    return (1);
+}
+
+/**
+ * The LPM does not serve all the lengths in the table
+ */
+static int
+ip6_fib_lpm_is_stale (void)
+{
+    ip6_main_t *im = &ip6_main;
+
+    if (NULL == im->fib_lpm)
+        return (0 != vec_len(im->ip6_table[IP6_FIB_TABLE_FWDING].
+                             prefix_lengths_in_search_order));
+
+    return (0 != im->fib_lpm->n_missing_lengths);
+}
+
+void
+ip6_fib_lpm_rebuild (void)
+{
+    ip6_fib_lpm_build_begin();
+    while (!ip6_fib_lpm_build_continue(~0))
+        ;
+}
+
+static uword
+ip6_fib_lpm_process (vlib_main_t * vm,
+                     vlib_node_runtime_t * rt,
+                     vlib_frame_t * f)
+{
+    ip6_main_t *im = &ip6_main;
+    f64 build_time = 0;
+
+    while (1)
+    {
+        vlib_process_wait_for_event(vm);
+        vlib_process_get_events(vm, NULL);
+        ip6_fib_lpm_signalled = 0;
+
+        while (ip6_fib_lpm_is_stale())
+        {
+            /*
+             * gather a burst of changes into one rebuild, and spend no
+             * more than a tenth of the time rebuilding when they are
+             * continuous
+             */
+            vlib_process_suspend(vm, clib_max(IP6_FIB_LPM_HOLDDOWN,
+                                              10 * build_time));
+
+            /* a rebuild may have been forced in the meantime */
+            if (!ip6_fib_lpm_is_stale())
+                break;
+
+            ip6_fib_lpm_build_begin();
+
+            /* updates are applied to both LPMs whilst this one yields */
+            while (NULL != ip6_fib_lpm_building &&
+                   !ip6_fib_lpm_build_continue(IP6_FIB_LPM_BUILD_BATCH))
+                vlib_process_suspend(vm, 1e-5);
+
+            if (NULL != im->fib_lpm)
+                build_time = im->fib_lpm->build_time;
+        }
+    }
+
+    return (0);
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (ip6_fib_lpm_process_node,static) = {
+    .function = ip6_fib_lpm_process,
+    .type = VLIB_NODE_TYPE_PROCESS,
+    .name = "ip6-fib-lpm-process",
+};
+/* *INDENT-ON* */
+
+/**
+ * Apply a change of the forwarding table to the LPMs, and have them
+ * rebuilt if a length is new to them.
+ */
+static void
+ip6_fib_lpm_update (const clib_bihash_kv_24_8_t *kv,
+                    int is_add)
+{
+    ip6_fib_lpm_t *lpms[] = {
+        ip6_main.fib_lpm,
+        ip6_fib_lpm_building,
+    };
+    u32 i;
+
+    for (i = 0; i < ARRAY_LEN(lpms); i++)
+    {
+        if (NULL == lpms[i])
+            continue;
+        if (is_add)
+            ip6_fib_lpm_prefix_add(lpms[i], kv, 0);
+        else
+            ip6_fib_lpm_prefix_del(lpms[i], kv);
+    }
+
+    if (!ip6_fib_lpm_signalled && ip6_fib_lpm_is_stale())
+    {
+        ip6_fib_lpm_signalled = 1;
+        vlib_process_signal_event(vlib_get_main(),
+                                  ip6_fib_lpm_process_node.index,
+                                  IP6_FIB_LPM_EVENT_REBUILD, 0);
+    }
+}
+
+u8 *
+format_ip6_fib_lpm (u8 * s, va_list * args)
+{
+    const ip6_fib_lpm_t *lpm = ip6_main.fib_lpm;
+
+    if (NULL == lpm)
+        return (format(s, "LPM: not built"));
+
+    s = format(s, "LPM: prefixes:%d markers:%d depth:%d missing-lengths:%d "
+               "bytes:%ld build:%.3fs",
+               lpm->n_prefixes, lpm->n_markers, lpm->depth,
+               lpm->n_missing_lengths,
+               alloc_arena_next(&lpm->ip6_hash),
+               lpm->build_time);
+
+    if (NULL != ip6_fib_lpm_building)
+        s = format(s, " rebuilding");
+
+    return (s);
+}
+
 u32 ip6_fib_table_fwding_lookup_with_if_index (ip6_main_t * im,
 					       u32 sw_if_index,
 					       const ip6_address_t * dst)
@@ -364,6 +1084,8 @@ ip6_fib_table_fwding_dpo_update (u32 fib_index,
         clib_bitmap_set (table->non_empty_dst_address_length_bitmap, 
 			 128 - len, 1);
     compute_prefix_lengths_in_search_order (table);
+
+    ip6_fib_lpm_update(&kv, 1);
 }
 
 void
@@ -397,6 +1119,8 @@ ip6_fib_table_fwding_dpo_remove (u32 fib_index,
                              128 - len, 0);
 	compute_prefix_lengths_in_search_order (table);
     }
+
+    ip6_fib_lpm_update(&kv, 0);
 }
 
 /**
@@ -582,6 +1306,9 @@ format_ip6_fib_table_memory (u8 * s, va_list * args)
         alloc_arena_next(&(ip6_main.ip6_table[IP6_FIB_TABLE_FWDING].ip6_hash))
         - alloc_arena(&(ip6_main.ip6_table[IP6_FIB_TABLE_FWDING].ip6_hash));
 
+    if (NULL != ip6_main.fib_lpm)
+        bytes_inuse += alloc_arena_next(&ip6_main.fib_lpm->ip6_hash);
+
     s = format(s, "%=30s %=6d %=8ld\n",
                "IPv6 unicast",
                pool_elts(ip6_main.fibs),
@@ -653,6 +1380,9 @@ ip6_show_fib (vlib_main_t * vm,
 	    break;
     }
 
+    if (!verbose)
+        vlib_cli_output (vm, "%U", format_ip6_fib_lpm);
+
     pool_foreach (fib_table, im6->fibs,
     ({
         fib_source_t source;
@@ -799,6 +1529,7 @@ ip6_show_fib (vlib_main_t * vm,
  *
  * Example of how to display a summary of all IPv6 FIB tables:
  * @cliexstart{show ip6 fib summary}
+ * LPM: prefixes:13 markers:4 depth:3 bytes:524608 build:0.000s
  * ipv6-VRF:0, fib_index 0, flow hash: src dst sport dport proto
  *     Prefix length         Count
  *          128                3
@@ -63,6 +63,97 @@ extern void ip6_fib_table_walk(u32 fib_index,
                                fib_table_walk_fn_t fn,
                                void *ctx);
 
+/**
+ * @brief Rebuild the LPM from the forwarding table now, rather than
+ * waiting for the process to do so.
+ */
+extern void ip6_fib_lpm_rebuild(void);
+
+extern u8 *format_ip6_fib_lpm(u8 * s, va_list * args);
+
+/**
+ * @brief Probe the forwarding table at the lengths the LPM's tree does not
+ * have, for a match longer than the one the LPM found.
+ */
+always_inline u64
+ip6_fib_lpm_lookup_missing (ip6_fib_lpm_t *lpm,
+                            u32 fib_index,
+                            const ip6_address_t * dst,
+                            u64 best)
+{
+    ip6_fib_table_instance_t *table;
+    clib_bihash_kv_24_8_t kv, value;
+    const ip6_address_t *mask;
+    u32 i, len, n;
+    u64 fib;
+
+    table = &ip6_main.ip6_table[IP6_FIB_TABLE_FWDING];
+    fib = ((u64)((fib_index))<<32);
+    /* a length is written before the count is raised */
+    n = clib_atomic_load_acq_n(&lpm->n_missing_lengths);
+
+    for (i = 0; i < n; i++)
+    {
+        len = lpm->missing_lengths[i];
+        if (len <= IP6_FIB_LPM_VALUE_LEN(best))
+            continue;
+
+        mask = &ip6_main.fib_masks[len];
+        kv.key[0] = dst->as_u64[0] & mask->as_u64[0];
+        kv.key[1] = dst->as_u64[1] & mask->as_u64[1];
+        kv.key[2] = fib | len;
+
+        if (0 == clib_bihash_search_inline_2_24_8(&table->ip6_hash,
+                                                  &kv, &value))
+            best = ((u64)len << 32) | (u32)value.value;
+    }
+
+    return (best);
+}
+
+/**
+ * @brief Binary search on the prefix lengths. A hit, on a prefix or a
+ * marker, records its best match and moves to the longer lengths; a miss
+ * moves to the shorter.
+ */
+always_inline u32
+ip6_fib_lpm_lookup (ip6_fib_lpm_t *lpm,
+                    u32 fib_index,
+                    const ip6_address_t * dst)
+{
+    clib_bihash_kv_24_8_t kv, value;
+    const ip6_address_t *mask;
+    u32 i, len;
+    u64 fib, best;
+
+    fib = ((u64)((fib_index))<<32);
+    best = 0;
+    i = 0;
+
+    while (i < IP6_FIB_LPM_N_NODES &&
+           IP6_FIB_LPM_NODE_NONE != (len = lpm->lengths[i]))
+    {
+        mask = &ip6_main.fib_masks[len];
+        kv.key[0] = dst->as_u64[0] & mask->as_u64[0];
+        kv.key[1] = dst->as_u64[1] & mask->as_u64[1];
+        kv.key[2] = fib | len;
+
+        if (0 == clib_bihash_search_inline_2_24_8(&lpm->ip6_hash,
+                                                  &kv, &value))
+        {
+            best = value.value;
+            i = 2 * i + 2;
+        }
+        else
+            i = 2 * i + 1;
+    }
+
+    if (PREDICT_FALSE(lpm->n_missing_lengths))
+        best = ip6_fib_lpm_lookup_missing(lpm, fib_index, dst, best);
+
+    return (IP6_FIB_LPM_VALUE_LBI(best));
+}
+
 always_inline u32
 ip6_fib_table_fwding_lookup (ip6_main_t * im,
                              u32 fib_index,
@@ -70,10 +161,18 @@ ip6_fib_table_fwding_lookup (ip6_main_t * im,
 {
     ip6_fib_table_instance_t *table;
     clib_bihash_kv_24_8_t kv, value;
+    ip6_fib_lpm_t *lpm;
     int i, len;
     int rv;
     u64 fib;
 
+    lpm = ip6_main.fib_lpm;
+    if (PREDICT_TRUE(NULL != lpm))
+        return (ip6_fib_lpm_lookup(lpm, fib_index, dst));
+
+    /*
+     * the LPM is not built yet; probe each prefix length in turn
+     */
     table = &ip6_main.ip6_table[IP6_FIB_TABLE_FWDING];
     len = vec_len (table->prefix_lengths_in_search_order);
 
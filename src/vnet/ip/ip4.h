@@ -156,6 +156,9 @@ typedef struct ip4_main_t
   /** The memory heap for the mtries */
   void *mtrie_mheap;
 
+  /** Forwarding structure, an ip4_fib_fwd_type_t, for new FIB tables */
+  u8 fib_fwd_type_default;
+
   /** ARP throttling */
   throttle_t arp_throttle;
 
@@ -110,6 +110,24 @@ VLIB_REGISTER_NODE (ip4_lookup_node) =
 };
 /* *INDENT-ON* */
 
+CLIB_MARCH_FN (ip4_fib_mtrie_lookup_batch, void, const ip4_fib_mtrie_t * m,
+	       const u32 * dst_addresses, ip4_fib_mtrie_leaf_t * leaves,
+	       u32 n)
+{
+  ip4_fib_mtrie_lookup_n (m, dst_addresses, leaves, n);
+}
+
+#ifndef CLIB_MARCH_VARIANT
+void
+ip4_fib_mtrie_lookup_batch (const ip4_fib_mtrie_t * m,
+			    const u32 * dst_addresses,
+			    ip4_fib_mtrie_leaf_t * leaves, u32 n)
+{
+  CLIB_MARCH_FN_SELECT (ip4_fib_mtrie_lookup_batch) (m, dst_addresses,
+						     leaves, n);
+}
+#endif
+
 VLIB_NODE_FN (ip4_load_balance_node) (vlib_main_t * vm,
 				      vlib_node_runtime_t * node,
 				      vlib_frame_t * frame)
@@ -1339,8 +1357,6 @@ static inline void
 ip4_local_check_src (vlib_buffer_t * b, ip4_header_t * ip0,
 		     ip4_local_last_check_t * last_check, u8 * error0)
 {
-  ip4_fib_mtrie_leaf_t leaf0;
-  ip4_fib_mtrie_t *mtrie0;
   const dpo_id_t *dpo0;
   load_balance_t *lb0;
   u32 lbi0;
@@ -1352,11 +1368,8 @@ ip4_local_check_src (vlib_buffer_t * b, ip4_header_t * ip0,
   if (PREDICT_FALSE (last_check->first ||
 		     (last_check->src.as_u32 != ip0->src_address.as_u32)))
     {
-      mtrie0 = &ip4_fib_get (vnet_buffer (b)->ip.fib_index)->mtrie;
-      leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, &ip0->src_address);
-      leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 2);
-      leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 3);
-      lbi0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
+      lbi0 = ip4_fib_forwarding_lookup (vnet_buffer (b)->ip.fib_index,
+					&ip0->src_address);
 
       vnet_buffer (b)->ip.adj_index[VLIB_TX] = lbi0;
       vnet_buffer (b)->ip.adj_index[VLIB_RX] = lbi0;
@@ -1400,8 +1413,6 @@ static inline void
 ip4_local_check_src_x2 (vlib_buffer_t ** b, ip4_header_t ** ip,
 			ip4_local_last_check_t * last_check, u8 * error)
 {
-  ip4_fib_mtrie_leaf_t leaf[2];
-  ip4_fib_mtrie_t *mtrie[2];
   const dpo_id_t *dpo[2];
   load_balance_t *lb[2];
   u32 not_last_hit;
@@ -1423,24 +1434,10 @@ ip4_local_check_src_x2 (vlib_buffer_t ** b, ip4_header_t ** ip,
 
   if (PREDICT_FALSE (not_last_hit))
     {
-      mtrie[0] = &ip4_fib_get (vnet_buffer (b[0])->ip.fib_index)->mtrie;
-      mtrie[1] = &ip4_fib_get (vnet_buffer (b[1])->ip.fib_index)->mtrie;
-
-      leaf[0] = ip4_fib_mtrie_lookup_step_one (mtrie[0], &ip[0]->src_address);
-      leaf[1] = ip4_fib_mtrie_lookup_step_one (mtrie[1], &ip[1]->src_address);
-
-      leaf[0] = ip4_fib_mtrie_lookup_step (mtrie[0], leaf[0],
-					   &ip[0]->src_address, 2);
-      leaf[1] = ip4_fib_mtrie_lookup_step (mtrie[1], leaf[1],
-					   &ip[1]->src_address, 2);
-
-      leaf[0] = ip4_fib_mtrie_lookup_step (mtrie[0], leaf[0],
-					   &ip[0]->src_address, 3);
-      leaf[1] = ip4_fib_mtrie_lookup_step (mtrie[1], leaf[1],
-					   &ip[1]->src_address, 3);
-
-      lbi[0] = ip4_fib_mtrie_leaf_get_adj_index (leaf[0]);
-      lbi[1] = ip4_fib_mtrie_leaf_get_adj_index (leaf[1]);
+      lbi[0] = ip4_fib_forwarding_lookup (vnet_buffer (b[0])->ip.fib_index,
+					  &ip[0]->src_address);
+      lbi[1] = ip4_fib_forwarding_lookup (vnet_buffer (b[1])->ip.fib_index,
+					  &ip[1]->src_address);
 
       vnet_buffer (b[0])->ip.adj_index[VLIB_TX] = lbi[0];
       vnet_buffer (b[0])->ip.adj_index[VLIB_RX] = lbi[0];
@@ -2627,17 +2624,9 @@ VLIB_REGISTER_NODE (ip4_midchain_node) = {
 static int
 ip4_lookup_validate (ip4_address_t * a, u32 fib_index0)
 {
-  ip4_fib_mtrie_t *mtrie0;
-  ip4_fib_mtrie_leaf_t leaf0;
   u32 lbi0;
 
-  mtrie0 = &ip4_fib_get (fib_index0)->mtrie;
-
-  leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, a);
-  leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, a, 2);
-  leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, a, 3);
-
-  lbi0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
+  lbi0 = ip4_fib_forwarding_lookup (fib_index0, a);
 
   return lbi0 == ip4_fib_table_lookup_lb (ip4_fib_get (fib_index0), a);
 }
@@ -3004,12 +2993,16 @@ static clib_error_t *
 ip4_config (vlib_main_t * vm, unformat_input_t * input)
 {
   ip4_main_t *im = &ip4_main;
+  ip4_fib_fwd_type_t fwd_type;
   uword heapsize = 0;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
       if (unformat (input, "heap-size %U", unformat_memory_size, &heapsize))
 	;
+      else if (unformat (input, "fib-forwarding %U",
+			 unformat_ip4_fib_fwd_type, &fwd_type))
+	im->fib_fwd_type_default = fwd_type;
       else
 	return clib_error_return (0,
 				  "invalid heap-size parameter `%U'",
@@ -51,6 +51,66 @@
  * This file contains the source code for IPv4 forwarding.
  */
 
+/**
+ * @brief Set the FIB index of each packet in the frame and, if asked,
+ * resolve its load-balance.
+ *
+ * The destinations are collected first so that each run of packets in
+ * the same FIB is looked up in the mtrie as a batch, which uses SIMD
+ * gathers where the CPU supports them. Tables that forward with a poptrie
+ * are looked up one packet at a time.
+ */
+always_inline void
+ip4_lookup_frame (vlib_main_t * vm, ip4_main_t * im, u32 * from,
+		  u32 n_pkts, u32 * lb_indices, int do_lookup)
+{
+  vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b = bufs;
+  u32 dsts[VLIB_FRAME_SIZE], fib_indices[VLIB_FRAME_SIZE];
+  ip4_header_t *ip;
+  ip4_fib_t *fib;
+  u32 i, j, n;
+
+  vlib_get_buffers (vm, from, bufs, n_pkts);
+
+  for (i = 0; i < n_pkts; i++)
+    {
+      if (i + 4 < n_pkts)
+	{
+	  vlib_prefetch_buffer_header (b[4], LOAD);
+	  CLIB_PREFETCH (b[4]->data, sizeof (ip[0]), LOAD);
+	}
+
+      ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, b[0]);
+      ip = vlib_buffer_get_current (b[0]);
+      dsts[i] = ip->dst_address.as_u32;
+      fib_indices[i] = vnet_buffer (b[0])->ip.fib_index;
+      b += 1;
+    }
+
+  if (!do_lookup)
+    return;
+
+  for (i = 0; i < n_pkts; i += n)
+    {
+      for (n = 1; i + n < n_pkts && fib_indices[i + n] == fib_indices[i];
+	   n++)
+	;
+      fib = ip4_fib_get (fib_indices[i]);
+
+      if (PREDICT_FALSE (IP4_FIB_FWD_TYPE_POPTRIE == fib->fwd_type))
+	{
+	  for (j = i; j < i + n; j++)
+	    lb_indices[j] = ip4_poptrie_lookup (&fib->poptrie,
+						(ip4_address_t *) & dsts[j]);
+	  continue;
+	}
+
+      ip4_fib_mtrie_lookup_n (fib->mtrie, dsts + i, lb_indices + i, n);
+      for (j = i; j < i + n; j++)
+	lb_indices[j] = ip4_fib_mtrie_leaf_get_adj_index (lb_indices[j]);
+    }
+}
+
 always_inline uword
 ip4_lookup_inline (vlib_main_t * vm,
 		   vlib_node_runtime_t * node,
@@ -60,6 +120,7 @@ ip4_lookup_inline (vlib_main_t * vm,
   ip4_main_t *im = &ip4_main;
   vlib_combined_counter_main_t *cm = &load_balance_main.lbm_to_counters;
   u32 n_left_from, n_left_to_next, *from, *to_next;
+  u32 lb_indices[VLIB_FRAME_SIZE], *lbi = lb_indices;
   ip_lookup_next_t next;
   u32 thread_index = vm->thread_index;
 
@@ -67,6 +128,9 @@ ip4_lookup_inline (vlib_main_t * vm,
   n_left_from = frame->n_vectors;
   next = node->cached_next_index;
 
+  ip4_lookup_frame (vm, im, from, n_left_from, lb_indices,
+		    !lookup_for_responses_to_locally_received_packets);
+
   while (n_left_from > 0)
     {
       vlib_get_next_frame (vm, node, next, to_next, n_left_to_next);
@@ -78,9 +142,6 @@ ip4_lookup_inline (vlib_main_t * vm,
 	  ip4_header_t *ip0, *ip1, *ip2, *ip3;
 	  ip_lookup_next_t next0, next1, next2, next3;
 	  const load_balance_t *lb0, *lb1, *lb2, *lb3;
-	  ip4_fib_mtrie_t *mtrie0, *mtrie1, *mtrie2, *mtrie3;
-	  ip4_fib_mtrie_leaf_t leaf0, leaf1, leaf2, leaf3;
-	  ip4_address_t *dst_addr0, *dst_addr1, *dst_addr2, *dst_addr3;
 	  u32 pi0, pi1, pi2, pi3, lb_index0, lb_index1, lb_index2, lb_index3;
 	  flow_hash_config_t flow_hash_config0, flow_hash_config1;
 	  flow_hash_config_t flow_hash_config2, flow_hash_config3;
@@ -127,45 +188,6 @@ ip4_lookup_inline (vlib_main_t * vm,
 	  ip2 = vlib_buffer_get_current (p2);
 	  ip3 = vlib_buffer_get_current (p3);
 
-	  dst_addr0 = &ip0->dst_address;
-	  dst_addr1 = &ip1->dst_address;
-	  dst_addr2 = &ip2->dst_address;
-	  dst_addr3 = &ip3->dst_address;
-
-	  ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, p0);
-	  ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, p1);
-	  ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, p2);
-	  ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, p3);
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    {
-	      mtrie0 = &ip4_fib_get (vnet_buffer (p0)->ip.fib_index)->mtrie;
-	      mtrie1 = &ip4_fib_get (vnet_buffer (p1)->ip.fib_index)->mtrie;
-	      mtrie2 = &ip4_fib_get (vnet_buffer (p2)->ip.fib_index)->mtrie;
-	      mtrie3 = &ip4_fib_get (vnet_buffer (p3)->ip.fib_index)->mtrie;
-
-	      leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, dst_addr0);
-	      leaf1 = ip4_fib_mtrie_lookup_step_one (mtrie1, dst_addr1);
-	      leaf2 = ip4_fib_mtrie_lookup_step_one (mtrie2, dst_addr2);
-	      leaf3 = ip4_fib_mtrie_lookup_step_one (mtrie3, dst_addr3);
-	    }
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    {
-	      leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 2);
-	      leaf1 = ip4_fib_mtrie_lookup_step (mtrie1, leaf1, dst_addr1, 2);
-	      leaf2 = ip4_fib_mtrie_lookup_step (mtrie2, leaf2, dst_addr2, 2);
-	      leaf3 = ip4_fib_mtrie_lookup_step (mtrie3, leaf3, dst_addr3, 2);
-	    }
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    {
-	      leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 3);
-	      leaf1 = ip4_fib_mtrie_lookup_step (mtrie1, leaf1, dst_addr1, 3);
-	      leaf2 = ip4_fib_mtrie_lookup_step (mtrie2, leaf2, dst_addr2, 3);
-	      leaf3 = ip4_fib_mtrie_lookup_step (mtrie3, leaf3, dst_addr3, 3);
-	    }
-
 	  if (lookup_for_responses_to_locally_received_packets)
 	    {
 	      lb_index0 = vnet_buffer (p0)->ip.adj_index[VLIB_RX];
@@ -175,11 +197,12 @@ ip4_lookup_inline (vlib_main_t * vm,
 	    }
 	  else
 	    {
-	      lb_index0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
-	      lb_index1 = ip4_fib_mtrie_leaf_get_adj_index (leaf1);
-	      lb_index2 = ip4_fib_mtrie_leaf_get_adj_index (leaf2);
-	      lb_index3 = ip4_fib_mtrie_leaf_get_adj_index (leaf3);
+	      lb_index0 = lbi[0];
+	      lb_index1 = lbi[1];
+	      lb_index2 = lbi[2];
+	      lb_index3 = lbi[3];
 	    }
+	  lbi += 4;
 
 	  ASSERT (lb_index0 && lb_index1 && lb_index2 && lb_index3);
 	  lb0 = load_balance_get (lb_index0);
@@ -292,9 +315,6 @@ ip4_lookup_inline (vlib_main_t * vm,
 	  ip4_header_t *ip0, *ip1;
 	  ip_lookup_next_t next0, next1;
 	  const load_balance_t *lb0, *lb1;
-	  ip4_fib_mtrie_t *mtrie0, *mtrie1;
-	  ip4_fib_mtrie_leaf_t leaf0, leaf1;
-	  ip4_address_t *dst_addr0, *dst_addr1;
 	  u32 pi0, pi1, lb_index0, lb_index1;
 	  flow_hash_config_t flow_hash_config0, flow_hash_config1;
 	  u32 hash_c0, hash_c1;
@@ -328,33 +348,6 @@ ip4_lookup_inline (vlib_main_t * vm,
 	  ip0 = vlib_buffer_get_current (p0);
 	  ip1 = vlib_buffer_get_current (p1);
 
-	  dst_addr0 = &ip0->dst_address;
-	  dst_addr1 = &ip1->dst_address;
-
-	  ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, p0);
-	  ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, p1);
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    {
-	      mtrie0 = &ip4_fib_get (vnet_buffer (p0)->ip.fib_index)->mtrie;
-	      mtrie1 = &ip4_fib_get (vnet_buffer (p1)->ip.fib_index)->mtrie;
-
-	      leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, dst_addr0);
-	      leaf1 = ip4_fib_mtrie_lookup_step_one (mtrie1, dst_addr1);
-	    }
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    {
-	      leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 2);
-	      leaf1 = ip4_fib_mtrie_lookup_step (mtrie1, leaf1, dst_addr1, 2);
-	    }
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    {
-	      leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 3);
-	      leaf1 = ip4_fib_mtrie_lookup_step (mtrie1, leaf1, dst_addr1, 3);
-	    }
-
 	  if (lookup_for_responses_to_locally_received_packets)
 	    {
 	      lb_index0 = vnet_buffer (p0)->ip.adj_index[VLIB_RX];
@@ -362,9 +355,10 @@ ip4_lookup_inline (vlib_main_t * vm,
 	    }
 	  else
 	    {
-	      lb_index0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
-	      lb_index1 = ip4_fib_mtrie_leaf_get_adj_index (leaf1);
+	      lb_index0 = lbi[0];
+	      lb_index1 = lbi[1];
 	    }
+	  lbi += 2;
 
 	  ASSERT (lb_index0 && lb_index1);
 	  lb0 = load_balance_get (lb_index0);
@@ -430,9 +424,6 @@ ip4_lookup_inline (vlib_main_t * vm,
 	  ip4_header_t *ip0;
 	  ip_lookup_next_t next0;
 	  const load_balance_t *lb0;
-	  ip4_fib_mtrie_t *mtrie0;
-	  ip4_fib_mtrie_leaf_t leaf0;
-	  ip4_address_t *dst_addr0;
 	  u32 pi0, lbi0;
 	  flow_hash_config_t flow_hash_config0;
 	  const dpo_id_t *dpo0;
@@ -443,28 +434,12 @@ ip4_lookup_inline (vlib_main_t * vm,
 
 	  p0 = vlib_get_buffer (vm, pi0);
 	  ip0 = vlib_buffer_get_current (p0);
-	  dst_addr0 = &ip0->dst_address;
-	  ip_lookup_set_buffer_fib_index (im->fib_index_by_sw_if_index, p0);
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    {
-	      mtrie0 = &ip4_fib_get (vnet_buffer (p0)->ip.fib_index)->mtrie;
-	      leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, dst_addr0);
-	    }
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 2);
-
-	  if (!lookup_for_responses_to_locally_received_packets)
-	    leaf0 = ip4_fib_mtrie_lookup_step (mtrie0, leaf0, dst_addr0, 3);
 
 	  if (lookup_for_responses_to_locally_received_packets)
 	    lbi0 = vnet_buffer (p0)->ip.adj_index[VLIB_RX];
 	  else
-	    {
-	      /* Handle default route. */
-	      lbi0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
-	    }
+	    lbi0 = lbi[0];
+	  lbi += 1;
 
 	  ASSERT (lbi0);
 	  lb0 = load_balance_get (lbi0);
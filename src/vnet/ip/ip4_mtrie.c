@@ -195,20 +195,37 @@ get_next_ply_for_leaf (ip4_fib_mtrie_t * m, ip4_fib_mtrie_leaf_t l)
   return pool_elt_at_index (ip4_ply_pool, n);
 }
 
+static void
+ply_free (ip4_fib_mtrie_t * m, ip4_fib_mtrie_8_ply_t * p)
+{
+  int i;
+
+  for (i = 0; i < ARRAY_LEN (p->leaves); i++)
+    {
+      if (ip4_fib_mtrie_leaf_is_next_ply (p->leaves[i]))
+	ply_free (m, get_next_ply_for_leaf (m, p->leaves[i]));
+    }
+
+  pool_put (ip4_ply_pool, p);
+}
+
 void
 ip4_mtrie_free (ip4_fib_mtrie_t * m)
 {
-  /* the root ply is embedded so the is nothing to do,
-   * the assumption being that the IP4 FIB table has emptied the trie
-   * before deletion.
+  /* the root ply is embedded so the is nothing to do for it. When the
+   * IP4 FIB table is destroyed it has emptied the trie first, but when the
+   * table changes its forwarding type the plys are still populated.
    */
-#if CLIB_DEBUG > 0
+  void *old_heap;
   int i;
+
+  old_heap = clib_mem_set_heap (ip4_main.mtrie_mheap);
   for (i = 0; i < ARRAY_LEN (m->root_ply.leaves); i++)
     {
-      ASSERT (!ip4_fib_mtrie_leaf_is_next_ply (m->root_ply.leaves[i]));
+      if (ip4_fib_mtrie_leaf_is_next_ply (m->root_ply.leaves[i]))
+	ply_free (m, get_next_ply_for_leaf (m, m->root_ply.leaves[i]));
     }
-#endif
+  clib_mem_set_heap (old_heap);
 }
 
 void
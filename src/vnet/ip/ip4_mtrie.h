@@ -142,7 +142,7 @@ typedef struct
 void ip4_mtrie_init (ip4_fib_mtrie_t * m);
 
 /**
- * @brief Free an mtrie, It must be emty when free'd
+ * @brief Free the plys of an mtrie
  */
 void ip4_mtrie_free (ip4_fib_mtrie_t * m);
 
@@ -231,6 +231,145 @@ ip4_fib_mtrie_lookup_step_one (const ip4_fib_mtrie_t * m,
   return next_leaf;
 }
 
+/**
+ * @brief Full lookup of one address.
+ */
+always_inline ip4_fib_mtrie_leaf_t
+ip4_fib_mtrie_lookup (const ip4_fib_mtrie_t * m,
+		      const ip4_address_t * dst_address)
+{
+  ip4_fib_mtrie_leaf_t leaf;
+
+  leaf = ip4_fib_mtrie_lookup_step_one (m, dst_address);
+  leaf = ip4_fib_mtrie_lookup_step (m, leaf, dst_address, 2);
+  leaf = ip4_fib_mtrie_lookup_step (m, leaf, dst_address, 3);
+
+  return leaf;
+}
+
+/**
+ * The distance, in leaves, between the same slot of consecutive plys in
+ * the pool. Used to index the pool for gathers.
+ */
+#define IP4_FIB_MTRIE_PLY_STRIDE \
+  (sizeof (ip4_fib_mtrie_8_ply_t) / sizeof (ip4_fib_mtrie_leaf_t))
+
+STATIC_ASSERT (0 == sizeof (ip4_fib_mtrie_8_ply_t) %
+	       sizeof (ip4_fib_mtrie_leaf_t), "IP4 Mtrie ply stride");
+
+#ifdef CLIB_HAVE_VEC512
+/**
+ * @brief Lookup 16 addresses (u32s in network order) with gathers.
+ * At each ply only the lanes that are not yet terminal are loaded.
+ */
+always_inline void
+ip4_fib_mtrie_lookup_x16 (const ip4_fib_mtrie_t * m,
+			  const u32 * dst_addresses,
+			  ip4_fib_mtrie_leaf_t * leaves)
+{
+  u32x16 dst, leaf, index;
+  u16 non_terminal;
+
+  dst = u32x16_load_unaligned ((void *) dst_addresses);
+  leaf = u32x16_gather_u32 ((void *) m->root_ply.leaves, dst & 0xffff);
+
+  non_terminal = ~u32x16_is_zero_mask (leaf & 1);
+  if (non_terminal)
+    {
+      index = (leaf >> 1) * IP4_FIB_MTRIE_PLY_STRIDE + ((dst >> 16) & 0xff);
+      leaf = u32x16_mask_gather_u32 (leaf, ip4_ply_pool, index, non_terminal);
+
+      non_terminal = ~u32x16_is_zero_mask (leaf & 1);
+      if (non_terminal)
+	{
+	  index = (leaf >> 1) * IP4_FIB_MTRIE_PLY_STRIDE + (dst >> 24);
+	  leaf = u32x16_mask_gather_u32 (leaf, ip4_ply_pool, index,
+					 non_terminal);
+	}
+    }
+
+  u32x16_store_unaligned (leaf, leaves);
+}
+#endif
+
+#ifdef CLIB_HAVE_VEC256
+/**
+ * @brief Lookup 8 addresses (u32s in network order) with gathers.
+ * At each ply only the lanes that are not yet terminal are loaded.
+ */
+always_inline void
+ip4_fib_mtrie_lookup_x8 (const ip4_fib_mtrie_t * m,
+			 const u32 * dst_addresses,
+			 ip4_fib_mtrie_leaf_t * leaves)
+{
+  u32x8 dst, leaf, index, non_terminal;
+
+  dst = u32x8_load_unaligned ((void *) dst_addresses);
+  leaf = u32x8_gather_u32 ((void *) m->root_ply.leaves, dst & 0xffff);
+
+  non_terminal = (u32x8) ((leaf & 1) == 0);
+  if (!u32x8_is_all_zero (non_terminal))
+    {
+      index = (leaf >> 1) * IP4_FIB_MTRIE_PLY_STRIDE + ((dst >> 16) & 0xff);
+      leaf = u32x8_mask_gather_u32 (leaf, ip4_ply_pool, index, non_terminal);
+
+      non_terminal = (u32x8) ((leaf & 1) == 0);
+      if (!u32x8_is_all_zero (non_terminal))
+	{
+	  index = (leaf >> 1) * IP4_FIB_MTRIE_PLY_STRIDE + (dst >> 24);
+	  leaf = u32x8_mask_gather_u32 (leaf, ip4_ply_pool, index,
+					non_terminal);
+	}
+    }
+
+  u32x8_store_unaligned (leaf, leaves);
+}
+#endif
+
+/**
+ * @brief Lookup a batch of addresses (u32s in network order) in one mtrie,
+ * using the widest gathers the CPU we are compiled for has.
+ */
+always_inline void
+ip4_fib_mtrie_lookup_n (const ip4_fib_mtrie_t * m,
+			const u32 * dst_addresses,
+			ip4_fib_mtrie_leaf_t * leaves, u32 n)
+{
+#ifdef CLIB_HAVE_VEC512
+  while (n >= 16)
+    {
+      ip4_fib_mtrie_lookup_x16 (m, dst_addresses, leaves);
+      dst_addresses += 16;
+      leaves += 16;
+      n -= 16;
+    }
+#endif
+#ifdef CLIB_HAVE_VEC256
+  while (n >= 8)
+    {
+      ip4_fib_mtrie_lookup_x8 (m, dst_addresses, leaves);
+      dst_addresses += 8;
+      leaves += 8;
+      n -= 8;
+    }
+#endif
+  while (n)
+    {
+      leaves[0] = ip4_fib_mtrie_lookup (m, (ip4_address_t *) dst_addresses);
+      dst_addresses += 1;
+      leaves += 1;
+      n -= 1;
+    }
+}
+
+/**
+ * @brief Lookup a batch of addresses with the best variant for the CPU
+ * we are running on; for callers not built per-CPU themselves.
+ */
+void ip4_fib_mtrie_lookup_batch (const ip4_fib_mtrie_t * m,
+				 const u32 * dst_addresses,
+				 ip4_fib_mtrie_leaf_t * leaves, u32 n);
+
 #endif /* included_ip_ip4_fib_h */
 
 /*
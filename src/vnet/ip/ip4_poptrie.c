@@ -0,0 +1,588 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/ip/ip.h>
+#include <vnet/ip/ip4_poptrie.h>
+
+typedef struct ip4_poptrie_set_unset_leaf_args_t_
+{
+  u64 key;
+  u32 dst_address_length;
+  u32 lb_index;
+  u32 cover_address_length;
+  u32 cover_lb_index;
+  ip4_poptrie_block_t *retired;
+} ip4_poptrie_set_unset_leaf_args_t;
+
+static u32
+ip4_poptrie_block_alloc (ip4_poptrie_t * t, u32 n_elts, u8 is_leaf)
+{
+  u32 ***free_by_size, index;
+  int will_expand;
+
+  if (0 == n_elts)
+    return (0);
+
+  free_by_size = (is_leaf ? &t->leaf_free_by_size : &t->node_free_by_size);
+  vec_validate (*free_by_size, n_elts);
+
+  if (vec_len ((*free_by_size)[n_elts]))
+    return (vec_pop ((*free_by_size)[n_elts]));
+
+  /*
+   * the workers walk the vectors without a lock, so if they are to be
+   * reallocated, stop them first
+   */
+  if (is_leaf)
+    {
+      index = vec_len (t->leaves);
+      will_expand = _vec_resize_will_expand (t->leaves, n_elts,
+					     (index + n_elts) *
+					     sizeof (t->leaves[0]), 0, 0);
+      if (will_expand)
+	vlib_worker_thread_barrier_sync (vlib_get_main ());
+      vec_resize (t->leaves, n_elts);
+    }
+  else
+    {
+      index = vec_len (t->nodes);
+      will_expand = _vec_resize_will_expand (t->nodes, n_elts,
+					     (index + n_elts) *
+					     sizeof (t->nodes[0]), 0,
+					     CLIB_CACHE_LINE_BYTES);
+      if (will_expand)
+	vlib_worker_thread_barrier_sync (vlib_get_main ());
+      vec_resize_aligned (t->nodes, n_elts, CLIB_CACHE_LINE_BYTES);
+    }
+  if (will_expand)
+    vlib_worker_thread_barrier_release (vlib_get_main ());
+
+  return (index);
+}
+
+static void
+ip4_poptrie_block_retire (ip4_poptrie_block_t ** retired,
+			  u32 index, u32 n_elts, u8 is_leaf)
+{
+  ip4_poptrie_block_t *b;
+
+  if (0 == n_elts)
+    return;
+
+  vec_add2 (*retired, b, 1);
+  b->index = index;
+  b->n_elts = n_elts;
+  b->is_leaf = is_leaf;
+}
+
+static void
+ip4_poptrie_block_free (ip4_poptrie_t * t, const ip4_poptrie_block_t * b)
+{
+  u32 **free_by_size;
+
+  free_by_size = (b->is_leaf ? t->leaf_free_by_size : t->node_free_by_size);
+  vec_add1 (free_by_size[b->n_elts], b->index);
+}
+
+/**
+ * Return to the free lists the retired blocks no worker can still be
+ * reading; those released before the last barrier, or all of them if
+ * the workers are stopped now.
+ */
+static void
+ip4_poptrie_reclaim (ip4_poptrie_t * t)
+{
+  ip4_poptrie_block_t *b;
+  u64 barrier_sync_count;
+  u32 i;
+
+  if (vlib_thread_is_main_w_barrier ())
+    {
+      vec_foreach (b, t->retired) ip4_poptrie_block_free (t, b);
+      vec_reset_length (t->retired);
+      return;
+    }
+
+  barrier_sync_count = vlib_worker_threads[0].barrier_sync_count;
+
+  /* blocks are retired in barrier order */
+  for (i = 0; i < vec_len (t->retired); i++)
+    {
+      b = vec_elt_at_index (t->retired, i);
+      if (b->barrier_sync_count >= barrier_sync_count)
+	break;
+      ip4_poptrie_block_free (t, b);
+    }
+  if (i)
+    vec_delete (t->retired, i, 0);
+}
+
+static void
+ip4_poptrie_cnode_retire (ip4_poptrie_cnode_t * c,
+			  ip4_poptrie_block_t ** retired)
+{
+  if (!c->built)
+    return;
+
+  ip4_poptrie_block_retire (retired, c->node.base0,
+			    count_set_bits (c->node.vector), 0);
+  ip4_poptrie_block_retire (retired, c->node.base1,
+			    count_set_bits (c->node.leafvec), 1);
+}
+
+always_inline u32
+ip4_poptrie_leaf_is_non_empty (const ip4_poptrie_cnode_t * c, u32 slot)
+{
+  /* as with the mtrie; more specific than the node's cover */
+  return (c->dst_address_bits_of_leaves[slot] > c->dst_address_bits_base);
+}
+
+always_inline u32
+ip4_poptrie_slot_is_child (const ip4_poptrie_cnode_t * c, u32 slot)
+{
+  return (!!(c->children & (1ULL << slot)));
+}
+
+static u32
+ip4_poptrie_cnode_create (ip4_poptrie_t * t,
+			  u32 init_lb_index, u32 init_len, u32 base_len)
+{
+  ip4_poptrie_cnode_t *c;
+  u32 i;
+
+  pool_get (t->cnodes, c);
+  clib_memset (c, 0, sizeof (*c));
+
+  for (i = 0; i < IP4_POPTRIE_N_SLOTS; i++)
+    c->slots[i] = init_lb_index;
+  clib_memset (c->dst_address_bits_of_leaves, init_len,
+	       sizeof (c->dst_address_bits_of_leaves));
+  c->dst_address_bits_base = base_len;
+  c->n_non_empty_leafs = (init_len > base_len ? IP4_POPTRIE_N_SLOTS : 0);
+  c->dirty = 1;
+
+  return (c - t->cnodes);
+}
+
+/**
+ * Build the data-plane node for a cnode, and for each modified cnode
+ * below it, into fresh blocks.
+ */
+static ip4_poptrie_node_t
+ip4_poptrie_build (ip4_poptrie_t * t, u32 ci, ip4_poptrie_block_t ** retired)
+{
+  u32 leaves[IP4_POPTRIE_N_SLOTS], n_leaves, base0, base1, i, k;
+  ip4_poptrie_node_t child;
+  ip4_poptrie_cnode_t *c;
+  u64 leafvec;
+
+  c = pool_elt_at_index (t->cnodes, ci);
+
+  if (!c->dirty)
+    return (c->node);
+
+  base0 = ip4_poptrie_block_alloc (t, count_set_bits (c->children), 0);
+
+  for (i = 0, k = 0; i < IP4_POPTRIE_N_SLOTS; i++)
+    {
+      if (!ip4_poptrie_slot_is_child (c, i))
+	continue;
+
+      /* the build may grow the node vector */
+      child = ip4_poptrie_build (t, c->slots[i], retired);
+      t->nodes[base0 + k++] = child;
+    }
+
+  /*
+   * a leaf starts a new run if it differs from the previous leaf; the
+   * slots of children in between do not break the run
+   */
+  leafvec = 0;
+  n_leaves = 0;
+  for (i = 0; i < IP4_POPTRIE_N_SLOTS; i++)
+    {
+      if (ip4_poptrie_slot_is_child (c, i))
+	continue;
+
+      if (0 == n_leaves || leaves[n_leaves - 1] != c->slots[i])
+	{
+	  leafvec |= (1ULL << i);
+	  leaves[n_leaves++] = c->slots[i];
+	}
+    }
+
+  base1 = ip4_poptrie_block_alloc (t, n_leaves, 1);
+  clib_memcpy_fast (t->leaves + base1, leaves, n_leaves * sizeof (leaves[0]));
+
+  ip4_poptrie_cnode_retire (c, retired);
+
+  c->node.vector = c->children;
+  c->node.leafvec = leafvec;
+  c->node.base0 = base0;
+  c->node.base1 = base1;
+  c->built = 1;
+  c->dirty = 0;
+
+  return (c->node);
+}
+
+/**
+ * Rebuild the modified paths and publish the new root
+ */
+static void
+ip4_poptrie_commit (ip4_poptrie_t * t, ip4_poptrie_block_t * retired)
+{
+  ip4_poptrie_block_t *b;
+  ip4_poptrie_node_t root;
+  u32 index;
+
+  root = ip4_poptrie_build (t, 0, &retired);
+
+  index = ip4_poptrie_block_alloc (t, 1, 0);
+  t->nodes[index] = root;
+
+  if (~0 != t->root)
+    ip4_poptrie_block_retire (&retired, t->root, 1, 0);
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  t->root = index;
+
+  /*
+   * a worker may still be walking the old root; its blocks wait on the
+   * retired list until a barrier has been taken
+   */
+  vec_foreach (b, retired)
+  {
+    b->barrier_sync_count = vlib_worker_threads[0].barrier_sync_count;
+    vec_add1 (t->retired, *b);
+  }
+  vec_free (retired);
+
+  ip4_poptrie_reclaim (t);
+}
+
+static void
+ip4_poptrie_set_more_specific (ip4_poptrie_t * t,
+			       u32 ci, u32 lb_index, u32 dst_address_length)
+{
+  ip4_poptrie_cnode_t *c;
+  u32 i;
+
+  c = pool_elt_at_index (t->cnodes, ci);
+  c->dirty = 1;
+
+  for (i = 0; i < IP4_POPTRIE_N_SLOTS; i++)
+    {
+      if (ip4_poptrie_slot_is_child (c, i))
+	ip4_poptrie_set_more_specific (t, c->slots[i],
+				       lb_index, dst_address_length);
+      else if (dst_address_length >= c->dst_address_bits_of_leaves[i])
+	{
+	  /* Replace less specific leaves with new leaf. */
+	  c->n_non_empty_leafs -= ip4_poptrie_leaf_is_non_empty (c, i);
+	  c->slots[i] = lb_index;
+	  c->dst_address_bits_of_leaves[i] = dst_address_length;
+	  c->n_non_empty_leafs += ip4_poptrie_leaf_is_non_empty (c, i);
+	}
+    }
+}
+
+static void
+ip4_poptrie_set_leaf (ip4_poptrie_t * t,
+		      ip4_poptrie_set_unset_leaf_args_t * a, u32 ci)
+{
+  i32 n_dst_bits_next_nodes, n_dst_bits_this_node;
+  ip4_poptrie_cnode_t *c;
+  u32 i, slot, base_len;
+
+  c = pool_elt_at_index (t->cnodes, ci);
+  c->dirty = 1;
+  base_len = c->dst_address_bits_base;
+
+  /* how many bits of the destination address are in the next nodes */
+  n_dst_bits_next_nodes =
+    a->dst_address_length - (base_len + IP4_POPTRIE_STRIDE);
+  slot = ip4_poptrie_slot (a->key, base_len / IP4_POPTRIE_STRIDE);
+
+  if (n_dst_bits_next_nodes <= 0)
+    {
+      /* a less specific prefix recursing into a child covers all of it */
+      n_dst_bits_this_node = clib_min (IP4_POPTRIE_STRIDE,
+				       -n_dst_bits_next_nodes);
+
+      /* The mask length of the address to insert maps to this node; fill
+       * each of the slots it covers */
+      for (i = slot; i < slot + (1 << n_dst_bits_this_node); i++)
+	{
+	  /* recursion may grow the pool */
+	  c = pool_elt_at_index (t->cnodes, ci);
+
+	  if (a->dst_address_length >= c->dst_address_bits_of_leaves[i])
+	    {
+	      if (!ip4_poptrie_slot_is_child (c, i))
+		{
+		  c->n_non_empty_leafs -=
+		    ip4_poptrie_leaf_is_non_empty (c, i);
+		  c->slots[i] = a->lb_index;
+		  c->dst_address_bits_of_leaves[i] = a->dst_address_length;
+		  c->n_non_empty_leafs +=
+		    ip4_poptrie_leaf_is_non_empty (c, i);
+		}
+	      else
+		ip4_poptrie_set_more_specific (t, c->slots[i],
+					       a->lb_index,
+					       a->dst_address_length);
+	    }
+	  else if (ip4_poptrie_slot_is_child (c, i))
+	    ip4_poptrie_set_leaf (t, a, c->slots[i]);
+	}
+    }
+  else
+    {
+      /* The address to insert requires us to move down a level */
+      if (!ip4_poptrie_slot_is_child (c, slot))
+	{
+	  u32 child;
+
+	  child = ip4_poptrie_cnode_create (t, c->slots[slot],
+					    c->dst_address_bits_of_leaves
+					    [slot],
+					    base_len + IP4_POPTRIE_STRIDE);
+	  c = pool_elt_at_index (t->cnodes, ci);
+
+	  c->n_non_empty_leafs -= ip4_poptrie_leaf_is_non_empty (c, slot);
+	  c->slots[slot] = child;
+	  c->children |= (1ULL << slot);
+	  c->dst_address_bits_of_leaves[slot] = base_len + IP4_POPTRIE_STRIDE;
+	  c->n_non_empty_leafs += ip4_poptrie_leaf_is_non_empty (c, slot);
+	}
+      ip4_poptrie_set_leaf (t, a, c->slots[slot]);
+    }
+}
+
+static uword
+ip4_poptrie_unset_leaf (ip4_poptrie_t * t,
+			ip4_poptrie_set_unset_leaf_args_t * a, u32 ci)
+{
+  i32 n_dst_bits_next_nodes, n_dst_bits_this_node;
+  ip4_poptrie_cnode_t *c;
+  u32 i, slot, base_len;
+
+  c = pool_elt_at_index (t->cnodes, ci);
+  c->dirty = 1;
+  base_len = c->dst_address_bits_base;
+
+  n_dst_bits_next_nodes =
+    a->dst_address_length - (base_len + IP4_POPTRIE_STRIDE);
+  n_dst_bits_this_node =
+    (n_dst_bits_next_nodes <= 0 ?
+     clib_min (IP4_POPTRIE_STRIDE, -n_dst_bits_next_nodes) : 0);
+  slot = ip4_poptrie_slot (a->key, base_len / IP4_POPTRIE_STRIDE);
+
+  for (i = slot; i < slot + (1 << n_dst_bits_this_node); i++)
+    {
+      if (ip4_poptrie_slot_is_child (c, i) ?
+	  ip4_poptrie_unset_leaf (t, a, c->slots[i]) :
+	  c->slots[i] == a->lb_index)
+	{
+	  c->n_non_empty_leafs -= ip4_poptrie_leaf_is_non_empty (c, i);
+	  c->children &= ~(1ULL << i);
+	  c->slots[i] = a->cover_lb_index;
+	  c->dst_address_bits_of_leaves[i] = a->cover_address_length;
+	  c->n_non_empty_leafs += ip4_poptrie_leaf_is_non_empty (c, i);
+
+	  ASSERT (c->n_non_empty_leafs >= 0);
+	  if (0 == c->n_non_empty_leafs && base_len > 0)
+	    {
+	      ip4_poptrie_cnode_retire (c, &a->retired);
+	      pool_put (t->cnodes, c);
+	      /* node was deleted */
+	      return (1);
+	    }
+	}
+    }
+
+  /* node was not deleted */
+  return (0);
+}
+
+void
+ip4_poptrie_route_add (ip4_poptrie_t * t,
+		       const ip4_address_t * dst_address,
+		       u32 dst_address_length, u32 lb_index)
+{
+  ip4_poptrie_set_unset_leaf_args_t a = { 0 };
+  ip4_main_t *im = &ip4_main;
+  ip4_address_t dst;
+  void *old_heap;
+
+  /* Honor dst_address_length. Fib masks are in network byte order */
+  dst.as_u32 = dst_address->as_u32 & im->fib_masks[dst_address_length];
+  a.key = ip4_poptrie_key (&dst);
+  a.dst_address_length = dst_address_length;
+  a.lb_index = lb_index;
+
+  old_heap = clib_mem_set_heap (ip4_main.mtrie_mheap);
+  ip4_poptrie_set_leaf (t, &a, 0);
+  ip4_poptrie_commit (t, a.retired);
+  clib_mem_set_heap (old_heap);
+}
+
+void
+ip4_poptrie_route_del (ip4_poptrie_t * t,
+		       const ip4_address_t * dst_address,
+		       u32 dst_address_length,
+		       u32 lb_index,
+		       u32 cover_address_length, u32 cover_lb_index)
+{
+  ip4_poptrie_set_unset_leaf_args_t a = { 0 };
+  ip4_main_t *im = &ip4_main;
+  ip4_address_t dst;
+  void *old_heap;
+
+  dst.as_u32 = dst_address->as_u32 & im->fib_masks[dst_address_length];
+  a.key = ip4_poptrie_key (&dst);
+  a.dst_address_length = dst_address_length;
+  a.lb_index = lb_index;
+  a.cover_address_length = cover_address_length;
+  a.cover_lb_index = cover_lb_index;
+
+  old_heap = clib_mem_set_heap (ip4_main.mtrie_mheap);
+  /* the root node is never removed */
+  ip4_poptrie_unset_leaf (t, &a, 0);
+  ip4_poptrie_commit (t, a.retired);
+  clib_mem_set_heap (old_heap);
+}
+
+void
+ip4_poptrie_init (ip4_poptrie_t * t)
+{
+  void *old_heap;
+
+  clib_memset (t, 0, sizeof (*t));
+  t->root = ~0;
+
+  old_heap = clib_mem_set_heap (ip4_main.mtrie_mheap);
+  /* all slots of the root resolve to the miss load-balance */
+  ip4_poptrie_cnode_create (t, 0, 0, 0);
+  ip4_poptrie_commit (t, NULL);
+  clib_mem_set_heap (old_heap);
+}
+
+void
+ip4_poptrie_free (ip4_poptrie_t * t)
+{
+  void *old_heap;
+  u32 i;
+
+  old_heap = clib_mem_set_heap (ip4_main.mtrie_mheap);
+  vec_foreach_index (i, t->node_free_by_size)
+    vec_free (t->node_free_by_size[i]);
+  vec_foreach_index (i, t->leaf_free_by_size)
+    vec_free (t->leaf_free_by_size[i]);
+  vec_free (t->node_free_by_size);
+  vec_free (t->leaf_free_by_size);
+  vec_free (t->retired);
+  vec_free (t->nodes);
+  vec_free (t->leaves);
+  pool_free (t->cnodes);
+  clib_mem_set_heap (old_heap);
+}
+
+/* Returns number of bytes of memory used by the trie. */
+uword
+ip4_poptrie_memory_usage (ip4_poptrie_t * t)
+{
+  uword bytes;
+  u32 i;
+
+  bytes = sizeof (*t);
+  bytes += vec_bytes (t->nodes);
+  bytes += vec_bytes (t->leaves);
+  bytes += pool_elts (t->cnodes) * sizeof (t->cnodes[0]);
+  bytes += vec_bytes (t->retired);
+
+  vec_foreach_index (i, t->node_free_by_size)
+    bytes += vec_bytes (t->node_free_by_size[i]);
+  vec_foreach_index (i, t->leaf_free_by_size)
+    bytes += vec_bytes (t->leaf_free_by_size[i]);
+
+  return (bytes);
+}
+
+static u8 *
+format_ip4_poptrie_node (u8 * s, va_list * va)
+{
+  ip4_poptrie_t *t = va_arg (*va, ip4_poptrie_t *);
+  u32 ci = va_arg (*va, u32);
+  u32 indent = va_arg (*va, u32);
+  ip4_poptrie_cnode_t *c;
+  u32 i;
+
+  c = pool_elt_at_index (t->cnodes, ci);
+
+  s = format (s, "%Unode:%d base:%d children:%d leaves:%d non-empty:%d",
+	      format_white_space, indent, ci, c->dst_address_bits_base,
+	      count_set_bits (c->node.vector),
+	      count_set_bits (c->node.leafvec), c->n_non_empty_leafs);
+
+  for (i = 0; i < IP4_POPTRIE_N_SLOTS; i++)
+    if (ip4_poptrie_slot_is_child (c, i))
+      s = format (s, "\n%U", format_ip4_poptrie_node, t, c->slots[i],
+		  indent + 2);
+
+  return (s);
+}
+
+u8 *
+format_ip4_poptrie (u8 * s, va_list * va)
+{
+  ip4_poptrie_t *t = va_arg (*va, ip4_poptrie_t *);
+  int verbose = va_arg (*va, int);
+  u32 i, n_free_nodes, n_free_leaves;
+  ip4_poptrie_block_t *b;
+
+  n_free_nodes = n_free_leaves = 0;
+  vec_foreach_index (i, t->node_free_by_size)
+    n_free_nodes += i * vec_len (t->node_free_by_size[i]);
+  vec_foreach_index (i, t->leaf_free_by_size)
+    n_free_leaves += i * vec_len (t->leaf_free_by_size[i]);
+  /* retired blocks are no longer part of the trie either */
+  vec_foreach (b, t->retired)
+  {
+    if (b->is_leaf)
+      n_free_leaves += b->n_elts;
+    else
+      n_free_nodes += b->n_elts;
+  }
+
+  s = format (s, "%d nodes, %d leaves, %d control nodes, %d bytes",
+	      vec_len (t->nodes) - n_free_nodes,
+	      vec_len (t->leaves) - n_free_leaves,
+	      pool_elts (t->cnodes), ip4_poptrie_memory_usage (t));
+
+  if (verbose)
+    s = format (s, "\n%U", format_ip4_poptrie_node, t, 0, 2);
+
+  return (s);
+}
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
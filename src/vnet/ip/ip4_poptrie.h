@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/**
+ * @brief A compressed IPv4 forwarding trie (Poptrie).
+ *
+ * A multiway trie with a 6 bit stride in which each node holds two 64 bit
+ * bitmaps in place of the 64 slot arrays of the mtrie plys:
+ *  - vector: slot i descends to an internal node
+ *  - leafvec: slot i starts a run of identical leaves
+ * The children of a node are contiguous, as are its leaves, so the index
+ * of the child or leaf for a slot is the base plus the population count of
+ * the bitmap below it. Runs of slots that resolve to the same load-balance
+ * share one leaf. A node is 24 bytes and a leaf 4, so a table with few
+ * routes costs a few hundred bytes rather than the mtrie's 16 bit root ply.
+ *
+ * The data-plane nodes are built from a control-plane copy of the trie
+ * which carries the per-slot prefix lengths needed to apply route updates
+ * incrementally. An update rebuilds only the nodes on the modified paths
+ * into fresh blocks and then swaps the root, so lookups on other threads
+ * see either the old or the new trie. The blocks the update replaced are
+ * not reused until the workers have passed a barrier, and growing the node
+ * or leaf vectors is done with the workers stopped.
+ */
+
+#ifndef __IP4_POPTRIE_H__
+#define __IP4_POPTRIE_H__
+
+#include <vppinfra/bitops.h>
+#include <vnet/ip/ip4_packet.h>
+
+/**
+ * Bits of address consumed at each level of the trie
+ */
+#define IP4_POPTRIE_STRIDE 6
+#define IP4_POPTRIE_N_SLOTS (1 << IP4_POPTRIE_STRIDE)
+
+/**
+ * The address is left aligned in a 36 bit key, 6 strides of 6 bits.
+ */
+#define IP4_POPTRIE_KEY_BITS (6 * IP4_POPTRIE_STRIDE)
+
+/**
+ * @brief A data-plane node
+ */
+typedef struct ip4_poptrie_node_t_
+{
+  /**
+   * Slots that descend to an internal node
+   */
+  u64 vector;
+
+  /**
+   * Slots that start a new run of leaves
+   */
+  u64 leafvec;
+
+  /**
+   * Index of the first child in the node vector
+   */
+  u32 base0;
+
+  /**
+   * Index of the first leaf in the leaf vector
+   */
+  u32 base1;
+} ip4_poptrie_node_t;
+
+/**
+ * @brief A block of nodes or leaves released by an update
+ */
+typedef struct ip4_poptrie_block_t_
+{
+  u32 index;
+  u32 n_elts;
+  u8 is_leaf;
+
+  /**
+   * The barrier count when the block was released. The block can be
+   * reused once a later barrier has been taken.
+   */
+  u64 barrier_sync_count;
+} ip4_poptrie_block_t;
+
+/**
+ * @brief A control-plane node.
+ * The slots and their prefix lengths, as in an mtrie ply, from which the
+ * data-plane node is built.
+ */
+typedef struct ip4_poptrie_cnode_t_
+{
+  /**
+   * The data-plane node last built from this one
+   */
+  ip4_poptrie_node_t node;
+
+  /**
+   * Slots that descend to a child cnode
+   */
+  u64 children;
+
+  /**
+   * Load-balance index for a leaf slot, cnode index for a child slot
+   */
+  u32 slots[IP4_POPTRIE_N_SLOTS];
+
+  /**
+   * Prefix length of the leaf in each slot
+   */
+  u8 dst_address_bits_of_leaves[IP4_POPTRIE_N_SLOTS];
+
+  /**
+   * Number of slots with a leaf more specific than the node's cover
+   */
+  i32 n_non_empty_leafs;
+
+  /**
+   * Length of the prefix the node covers
+   */
+  u8 dst_address_bits_base;
+
+  /**
+   * Modified since the data-plane node was last built
+   */
+  u8 dirty;
+
+  /**
+   * A data-plane node has been built
+   */
+  u8 built;
+} ip4_poptrie_cnode_t;
+
+/**
+ * @brief The trie.
+ * Embedded in the IPv4 FIB so the data-path needs no indirection to find
+ * the node and leaf vectors.
+ */
+typedef struct ip4_poptrie_t_
+{
+  /**
+   * Index of the root in the node vector
+   */
+  u32 root;
+
+  /**
+   * Data-plane nodes and leaves
+   */
+  ip4_poptrie_node_t *nodes;
+  u32 *leaves;
+
+  /**
+   * Pool of control-plane nodes. The root is at index 0.
+   */
+  ip4_poptrie_cnode_t *cnodes;
+
+  /**
+   * Free blocks of nodes and leaves, indexed by block size
+   */
+  u32 **node_free_by_size;
+  u32 **leaf_free_by_size;
+
+  /**
+   * Blocks released by updates that workers may still be reading
+   */
+  ip4_poptrie_block_t *retired;
+} ip4_poptrie_t;
+
+/**
+ * @brief Initialise a trie
+ */
+extern void ip4_poptrie_init (ip4_poptrie_t * t);
+
+/**
+ * @brief Free a trie and all its nodes
+ */
+extern void ip4_poptrie_free (ip4_poptrie_t * t);
+
+/**
+ * @brief Add a route to the trie
+ */
+extern void ip4_poptrie_route_add (ip4_poptrie_t * t,
+				   const ip4_address_t * dst_address,
+				   u32 dst_address_length, u32 lb_index);
+
+/**
+ * @brief Remove a route from the trie
+ */
+extern void ip4_poptrie_route_del (ip4_poptrie_t * t,
+				   const ip4_address_t * dst_address,
+				   u32 dst_address_length,
+				   u32 lb_index,
+				   u32 cover_address_length,
+				   u32 cover_lb_index);
+
+/**
+ * @brief return the memory used by the trie
+ */
+extern uword ip4_poptrie_memory_usage (ip4_poptrie_t * t);
+
+/**
+ * @brief Format/display the shape of the trie
+ */
+extern format_function_t format_ip4_poptrie;
+
+/**
+ * The slot for a key at the given depth
+ */
+always_inline u32
+ip4_poptrie_slot (u64 key, u32 depth)
+{
+  return ((key >> (IP4_POPTRIE_KEY_BITS - IP4_POPTRIE_STRIDE * (depth + 1)))
+	  & (IP4_POPTRIE_N_SLOTS - 1));
+}
+
+always_inline u64
+ip4_poptrie_key (const ip4_address_t * dst)
+{
+  return ((u64) clib_net_to_host_u32 (dst->as_u32) <<
+	  (IP4_POPTRIE_KEY_BITS - 32));
+}
+
+/**
+ * @brief Lookup the load-balance index for the destination
+ */
+always_inline u32
+ip4_poptrie_lookup (const ip4_poptrie_t * t, const ip4_address_t * dst)
+{
+  const ip4_poptrie_node_t *n;
+  u32 depth, slot;
+  u64 key;
+
+  key = ip4_poptrie_key (dst);
+  n = t->nodes + t->root;
+  depth = 0;
+  slot = ip4_poptrie_slot (key, depth);
+
+  while (n->vector & (1ULL << slot))
+    {
+      /* the population below and including the slot counts the children
+       * before it, so the child is one less than that from the base */
+      n = (t->nodes + n->base0 +
+	   count_set_bits (n->vector << (IP4_POPTRIE_N_SLOTS - 1 - slot)) -
+	   1);
+      depth++;
+      slot = ip4_poptrie_slot (key, depth);
+    }
+
+  return (t->leaves[n->base1 +
+		    count_set_bits (n->leafvec <<
+				    (IP4_POPTRIE_N_SLOTS - 1 - slot)) - 1]);
+}
+
+#endif
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
@@ -116,8 +116,6 @@ ip4_source_check_inline (vlib_main_t * vm,
 	{
 	  vlib_buffer_t *p0, *p1;
 	  ip4_header_t *ip0, *ip1;
-	  ip4_fib_mtrie_t *mtrie0, *mtrie1;
-	  ip4_fib_mtrie_leaf_t leaf0, leaf1;
 	  ip4_source_check_config_t *c0, *c1;
 	  const load_balance_t *lb0, *lb1;
 	  u32 pi0, next0, pass0, lb_index0;
@@ -153,24 +151,10 @@ ip4_source_check_inline (vlib_main_t * vm,
 	  c0 = vnet_feature_next_with_data (&next0, p0, sizeof (c0[0]));
 	  c1 = vnet_feature_next_with_data (&next1, p1, sizeof (c1[0]));
 
-	  mtrie0 = &ip4_fib_get (c0->fib_index)->mtrie;
-	  mtrie1 = &ip4_fib_get (c1->fib_index)->mtrie;
-
-	  leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, &ip0->src_address);
-	  leaf1 = ip4_fib_mtrie_lookup_step_one (mtrie1, &ip1->src_address);
-
-	  leaf0 =
-	    ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 2);
-	  leaf1 =
-	    ip4_fib_mtrie_lookup_step (mtrie1, leaf1, &ip1->src_address, 2);
-
-	  leaf0 =
-	    ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 3);
-	  leaf1 =
-	    ip4_fib_mtrie_lookup_step (mtrie1, leaf1, &ip1->src_address, 3);
-
-	  lb_index0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
-	  lb_index1 = ip4_fib_mtrie_leaf_get_adj_index (leaf1);
+	  lb_index0 = ip4_fib_forwarding_lookup (c0->fib_index,
+						 &ip0->src_address);
+	  lb_index1 = ip4_fib_forwarding_lookup (c1->fib_index,
+						 &ip1->src_address);
 
 	  lb0 = load_balance_get (lb_index0);
 	  lb1 = load_balance_get (lb_index1);
@@ -212,8 +196,6 @@ ip4_source_check_inline (vlib_main_t * vm,
 	{
 	  vlib_buffer_t *p0;
 	  ip4_header_t *ip0;
-	  ip4_fib_mtrie_t *mtrie0;
-	  ip4_fib_mtrie_leaf_t leaf0;
 	  ip4_source_check_config_t *c0;
 	  u32 pi0, next0, pass0, lb_index0;
 	  const load_balance_t *lb0;
@@ -230,17 +212,8 @@ ip4_source_check_inline (vlib_main_t * vm,
 
 	  c0 = vnet_feature_next_with_data (&next0, p0, sizeof (c0[0]));
 
-	  mtrie0 = &ip4_fib_get (c0->fib_index)->mtrie;
-
-	  leaf0 = ip4_fib_mtrie_lookup_step_one (mtrie0, &ip0->src_address);
-
-	  leaf0 =
-	    ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 2);
-
-	  leaf0 =
-	    ip4_fib_mtrie_lookup_step (mtrie0, leaf0, &ip0->src_address, 3);
-
-	  lb_index0 = ip4_fib_mtrie_leaf_get_adj_index (leaf0);
+	  lb_index0 = ip4_fib_forwarding_lookup (c0->fib_index,
+						 &ip0->src_address);
 
 	  lb0 = load_balance_get (lb_index0);
 
@@ -150,6 +150,68 @@ typedef struct ip6_fib_table_instance_t_
   i32 dst_address_length_refcounts[129];
 } ip6_fib_table_instance_t;
 
+/**
+ * The number of nodes in the tree of prefix lengths; enough for a
+ * balanced tree of all 129 lengths.
+ */
+#define IP6_FIB_LPM_N_NODES 255
+#define IP6_FIB_LPM_NODE_NONE 0xff
+
+/**
+ * The value of an LPM entry: the load-balance of its best matching prefix
+ * and that prefix's length, whether the entry is itself a prefix, and the
+ * number of prefixes it is a marker for.
+ */
+#define IP6_FIB_LPM_VALUE_LBI(_v) ((u32) (_v))
+#define IP6_FIB_LPM_VALUE_LEN(_v) (((_v) >> 32) & 0xff)
+#define IP6_FIB_LPM_VALUE_IS_PREFIX (1ULL << 40)
+#define IP6_FIB_LPM_VALUE_N_MARKED(_v) ((_v) >> 41)
+#define IP6_FIB_LPM_VALUE_MARKED_ONE (1ULL << 41)
+
+/**
+ * A marker of the LPM that is not also a prefix, with the address in host
+ * byte order so that the markers under a prefix sort together.
+ */
+typedef struct ip6_fib_lpm_marker_t_
+{
+  u64 addr[2];
+  u32 fib_index;
+  u32 len;
+} ip6_fib_lpm_marker_t;
+
+/**
+ * A binary search on prefix lengths over the forwarding table.
+ * The populated prefix lengths form a balanced binary tree. Each prefix
+ * is stored with a marker at each shorter length on its path through the
+ * tree, and a marker's value is its best matching prefix, so a lookup
+ * probes at most one hash bucket per level of the tree rather than one
+ * per populated length.
+ *
+ * Updates to the forwarding table are applied in place. A prefix of a
+ * length the tree does not have is only found through the forwarding
+ * table, probed at those missing lengths, until the LPM is rebuilt.
+ */
+typedef struct ip6_fib_lpm_t_
+{
+  /* The tree of prefix lengths, in level order */
+  u8 lengths[IP6_FIB_LPM_N_NODES + 1];
+
+  /* Populated lengths that are not in the tree, in no order */
+  u8 missing_lengths[129];
+  u32 n_missing_lengths;
+
+  /* Prefixes and markers, keyed as the forwarding table */
+  clib_bihash_24_8_t ip6_hash;
+
+  /* The entries that are only markers, sorted, in chunks */
+  ip6_fib_lpm_marker_t **markers;
+
+  u32 n_prefixes;
+  u32 n_markers;
+  u32 depth;
+  f64 build_time;
+} ip6_fib_lpm_t;
+
 /**
  * A represenation of a single IP6 mfib table
  */
@@ -171,6 +233,12 @@ typedef struct ip6_main_t
    */
   ip6_fib_table_instance_t ip6_table[IP6_FIB_NUM_TABLES];
 
+  /**
+   * The LPM built from the forwarding table; NULL until it is first
+   * built.
+   */
+  ip6_fib_lpm_t *fib_lpm;
+
   /**
    * the single MFIB table
    */
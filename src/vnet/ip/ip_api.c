@@ -93,6 +93,7 @@ _(PROXY_ARP_INTFC_ENABLE_DISABLE, proxy_arp_intfc_enable_disable)       \
  _(PROXY_ARP_INTFC_DUMP, proxy_arp_intfc_dump)                          \
 _(RESET_FIB, reset_fib)							\
 _(IP_ADD_DEL_ROUTE, ip_add_del_route)                                   \
+_(IP_ADD_DEL_ROUTE_BULK, ip_add_del_route_bulk)                         \
 _(IP_TABLE_ADD_DEL, ip_table_add_del)                                   \
 _(IP_PUNT_POLICE, ip_punt_police)                                       \
 _(IP_PUNT_REDIRECT, ip_punt_redirect)                                   \
@@ -1192,6 +1193,102 @@ vl_api_ip_add_del_route_t_handler (vl_api_ip_add_del_route_t * mp)
   /* *INDENT-ON* */
 }
 
+static int
+ip_add_del_route_bulk_one (vl_api_ip_add_del_route_bulk_t * mp,
+			   vl_api_ip_route_bulk_entry_t * r)
+{
+  u32 fib_index, next_hop_fib_index;
+  fib_protocol_t fproto;
+  dpo_proto_t dproto;
+  ip46_address_t nh;
+  int rv;
+
+  fproto = (mp->is_ipv6 ? FIB_PROTOCOL_IP6 : FIB_PROTOCOL_IP4);
+  dproto = fib_proto_to_dpo (fproto);
+
+  rv = add_del_route_check (fproto,
+			    mp->table_id,
+			    r->next_hop_sw_if_index,
+			    dproto,
+			    mp->next_hop_table_id,
+			    0, &fib_index, &next_hop_fib_index);
+  if (0 != rv)
+    return (rv);
+
+  fib_prefix_t pfx = {
+    .fp_len = r->dst_address_length,
+    .fp_proto = fproto,
+  };
+  clib_memset (&nh, 0, sizeof (nh));
+  if (mp->is_ipv6)
+    {
+      clib_memcpy (&pfx.fp_addr.ip6, r->dst_address,
+		   sizeof (pfx.fp_addr.ip6));
+      clib_memcpy (&nh.ip6, r->next_hop_address, sizeof (nh.ip6));
+    }
+  else
+    {
+      clib_memcpy (&pfx.fp_addr.ip4, r->dst_address,
+		   sizeof (pfx.fp_addr.ip4));
+      clib_memcpy (&nh.ip4, r->next_hop_address, sizeof (nh.ip4));
+    }
+
+  return (add_del_route_t_handler (mp->is_multipath,
+				   r->is_add,
+				   r->is_drop,
+				   0, 0, 0, 0, 0, ~0, 0, 0, 0, 0, 0, 0, 0,
+				   fib_index, &pfx, dproto,
+				   &nh, ~0,
+				   ntohl (r->next_hop_sw_if_index),
+				   next_hop_fib_index,
+				   r->next_hop_weight,
+				   r->next_hop_preference,
+				   MPLS_LABEL_INVALID, NULL));
+}
+
+void
+vl_api_ip_add_del_route_bulk_t_handler (vl_api_ip_add_del_route_bulk_t * mp)
+{
+  vl_api_ip_add_del_route_bulk_reply_t *rmp;
+  vnet_main_t *vnm = vnet_get_main ();
+  u32 n_routes, n_done = 0;
+  int rv = 0;
+
+  vnm->api_errno = 0;
+  n_routes = ntohl (mp->n_routes);
+
+  if (vl_msg_api_get_msg_length (mp) <
+      sizeof (*mp) + n_routes * sizeof (mp->routes[0]))
+    {
+      rv = VNET_API_ERROR_INVALID_VALUE;
+      goto done;
+    }
+
+  /*
+   * Children of entries and path-lists that change are walked once,
+   * at the end, however many of the routes share them.
+   */
+  fib_table_batch_begin ();
+
+  for (n_done = 0; n_done < n_routes; n_done++)
+    {
+      rv = ip_add_del_route_bulk_one (mp, &mp->routes[n_done]);
+      rv = (rv == 0) ? vnm->api_errno : rv;
+      if (rv)
+	break;
+    }
+
+  fib_table_batch_end ();
+
+done:
+  /* *INDENT-OFF* */
+  REPLY_MACRO2 (VL_API_IP_ADD_DEL_ROUTE_BULK_REPLY,
+  ({
+    rmp->n_done = htonl (n_done);
+  }))
+  /* *INDENT-ON* */
+}
+
 void
 ip_table_create (fib_protocol_t fproto,
 		 u32 table_id, u8 is_api, const u8 * name)
@@ -3493,6 +3590,8 @@ ip_api_hookup (vlib_main_t * vm)
    */
   am->is_mp_safe[VL_API_IP_ADD_DEL_ROUTE] = 1;
   am->is_mp_safe[VL_API_IP_ADD_DEL_ROUTE_REPLY] = 1;
+  am->is_mp_safe[VL_API_IP_ADD_DEL_ROUTE_BULK] = 1;
+  am->is_mp_safe[VL_API_IP_ADD_DEL_ROUTE_BULK_REPLY] = 1;
 
   /*
    * Set up the (msg_name, crc, message-id) table
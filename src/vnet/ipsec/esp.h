@@ -59,6 +59,83 @@ typedef CLIB_PACKED (struct {
 
 u8 *format_esp_header (u8 * s, va_list * args);
 
+/*
+ * Async crypto: move the crypto and integrity ops of a frame into the
+ * thread's in-flight ring and submit them. Returns 0 if there is no room
+ * in the ring or the crypto queues. The caller may then process the frame
+ * synchronously only if the ring is empty; otherwise the frame would
+ * overtake the packets in flight, reordering their SAs and, on decrypt,
+ * moving the replay windows past them, so it is dropped.
+ */
+static_always_inline int
+esp_async_submit (vlib_main_t * vm, ipsec_per_thread_data_t * ptd,
+		  ipsec_async_ring_t * ring, u32 post_node_index,
+		  u32 * from, u32 * to, u16 * nexts, u32 n_pkts)
+{
+  ipsec_async_pkt_t *p;
+  vnet_crypto_op_t *op;
+  u32 i, n_jobs;
+
+  if (!ipsec_async_ring_has_room (ring, n_pkts))
+    return 0;
+
+  vec_reset_length (ptd->async_jobs);
+
+  for (i = 0; i < n_pkts; i++)
+    {
+      p = ipsec_async_ring_elt (ring, ring->head + i);
+      p->from_bi = from[i];
+      p->to_bi = to[i];
+      p->next_index = nexts[i];
+      p->flags = 0;
+    }
+
+  /* *INDENT-OFF* */
+  vec_foreach (op, ptd->crypto_ops)
+    {
+      p = ipsec_async_ring_elt (ring, ring->head + op->user_data);
+      clib_memcpy_fast (&p->crypto_op, op, sizeof (op[0]));
+      p->flags |= IPSEC_ASYNC_PKT_F_CRYPTO;
+      vec_add1 (ptd->async_jobs, &p->crypto_op);
+    }
+  vec_foreach (op, ptd->integ_ops)
+    {
+      p = ipsec_async_ring_elt (ring, ring->head + op->user_data);
+      clib_memcpy_fast (&p->integ_op, op, sizeof (op[0]));
+      p->flags |= IPSEC_ASYNC_PKT_F_INTEG;
+      vec_add1 (ptd->async_jobs, &p->integ_op);
+    }
+  /* *INDENT-ON* */
+
+  n_jobs = vec_len (ptd->async_jobs);
+  if (vnet_crypto_submit_ops (vm, ptd->async_jobs, n_jobs) != n_jobs)
+    return 0;
+
+  if (ring->head == ring->tail)
+    vlib_node_set_state (vm, post_node_index, VLIB_NODE_STATE_POLLING);
+
+  ring->head += n_pkts;
+  return 1;
+}
+
+/*
+ * Ops of a packet are dispatched in order (cipher before hmac on encrypt,
+ * hmac check before cipher on decrypt), so checking the last one is enough.
+ */
+static_always_inline int
+esp_async_pkt_is_done (vlib_main_t * vm, ipsec_async_pkt_t * p,
+		       int is_decrypt)
+{
+  vnet_crypto_op_t *op = 0;
+
+  if (p->flags & IPSEC_ASYNC_PKT_F_CRYPTO)
+    op = &p->crypto_op;
+  if ((p->flags & IPSEC_ASYNC_PKT_F_INTEG) && (!is_decrypt || op == 0))
+    op = &p->integ_op;
+
+  return op == 0 || vnet_crypto_op_is_done (vm, op);
+}
+
 always_inline int
 esp_replay_check (ipsec_sa_t * sa, u32 seq)
 {
@@ -231,6 +308,53 @@ hmac_calc (vlib_main_t * vm, ipsec_sa_t * sa, u8 * data, int data_len,
   return sa->integ_trunc_size;
 }
 
+/*
+ * An SA's sequence number and anti-replay state are only touched by its
+ * owning thread. Packets of SAs owned by another thread are passed to the
+ * handoff node; the ones to process here are compacted into 'local'.
+ */
+always_inline u32
+esp_handoff_foreign (vlib_main_t * vm, vlib_node_runtime_t * node,
+		     u32 * from, u32 n_pkts, u32 * local,
+		     u32 handoff_node_index)
+{
+  ipsec_main_t *im = &ipsec_main;
+  u32 thread_index = vm->thread_index;
+  u32 n_local = 0, n_foreign = 0, *to;
+  vlib_frame_t *f = 0;
+  vlib_buffer_t *b;
+  ipsec_sa_t *sa;
+  u32 i;
+
+  for (i = 0; i < n_pkts; i++)
+    {
+      b = vlib_get_buffer (vm, from[i]);
+      sa = pool_elt_at_index (im->sad, vnet_buffer (b)->ipsec.sad_index);
+
+      if (PREDICT_TRUE (sa->thread_index == thread_index))
+	{
+	  local[n_local++] = from[i];
+	  continue;
+	}
+
+      if (f == 0)
+	{
+	  f = vlib_get_frame_to_node (vm, handoff_node_index);
+	  f->frame_flags |= node->flags & VLIB_NODE_FLAG_TRACE;
+	  to = vlib_frame_vector_args (f);
+	}
+      to[n_foreign++] = from[i];
+    }
+
+  if (f)
+    {
+      f->n_vectors = n_foreign;
+      vlib_put_frame_to_node (vm, handoff_node_index, f);
+    }
+
+  return n_local;
+}
+
 #endif /* __ESP_H__ */
 
 /*
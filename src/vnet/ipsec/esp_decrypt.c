@@ -44,6 +44,8 @@ typedef enum
  _(DECRYPTION_FAILED, "ESP decryption failed")      \
  _(INTEG_ERROR, "Integrity check failed")           \
  _(REPLAY, "SA replayed packet")                    \
+ _(NO_TAIL_SPACE, "No space for the ESN high bits") \
+ _(ASYNC_RING_FULL, "async crypto ring full (dropped)") \
  _(NOT_IP, "Not IP packet (dropped)")
 
 
@@ -81,24 +83,283 @@ format_esp_decrypt_trace (u8 * s, va_list * args)
   return s;
 }
 
-always_inline void
-esp_decrypt_cbc (vlib_main_t * vm, ipsec_sa_t * sa,
-		 u8 * in, u8 * out, size_t in_len, u8 * key, u8 * iv)
+typedef struct
+{
+  u32 sa_index;
+  u32 seq;
+  u16 crypto_len;
+  u8 ip_hdr_size;
+  u8 is_dropped;
+} esp_decrypt_packet_data_t;
+
+/* the original packet is sent to the drop node, see esp_decrypt_enqueue */
+static_always_inline void
+esp_decrypt_drop (vlib_node_runtime_t * node, vlib_buffer_t * b,
+		  esp_decrypt_packet_data_t * pd, u16 * next, u32 error)
 {
-  vnet_crypto_op_t _op, *op = &_op;
+  b->error = node->errors[error];
+  next[0] = ESP_DECRYPT_NEXT_DROP;
+  pd->is_dropped = 1;
+}
 
+static_always_inline void
+esp_process_ops (vlib_main_t * vm, vlib_node_runtime_t * node,
+		 vnet_crypto_op_t * ops, vlib_buffer_t * b[],
+		 esp_decrypt_packet_data_t * pds, u16 * nexts, u32 error)
+{
+  u32 n_fail, n_ops = vec_len (ops);
+  vnet_crypto_op_t *op = ops;
 
-  if (PREDICT_FALSE (sa->crypto_dec_op_type == VNET_CRYPTO_OP_NONE))
+  if (n_ops == 0)
     return;
 
-  op->op = sa->crypto_dec_op_type;
-  op->iv = iv;
-  op->src = in;
-  op->dst = out;
-  op->len = in_len;
-  op->key = key;
+  n_fail = n_ops - vnet_crypto_process_ops (vm, op, n_ops);
+
+  while (n_fail)
+    {
+      ASSERT (op - ops < n_ops);
+
+      if (op->status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+	{
+	  u32 bi = op->user_data;
+	  if (!pds[bi].is_dropped)
+	    esp_decrypt_drop (node, b[bi], pds + bi, nexts + bi, error);
+	  n_fail--;
+	}
+      op++;
+    }
+}
+
+/*
+ * Advance the replay window and build the decrypted packet once the
+ * crypto ops of a packet are complete.
+ */
+static_always_inline void
+esp_decrypt_post_crypto (vlib_main_t * vm, vlib_node_runtime_t * node,
+			 vlib_buffer_t * ib, vlib_buffer_t * ob,
+			 esp_decrypt_packet_data_t * pd, u16 * next,
+			 int is_ip6)
+{
+  ipsec_main_t *im = &ipsec_main;
+  esp_header_t *esp0;
+  ipsec_sa_t *sa0;
+  ip4_header_t *ih4 = 0, *oh4 = 0;
+  ip6_header_t *ih6 = 0, *oh6 = 0;
+  esp_footer_t *f0;
+
+  sa0 = pool_elt_at_index (im->sad, pd->sa_index);
+
+  if (pd->is_dropped)
+    goto trace;
+
+  /* the check is repeated as the frame may hold the same seq twice */
+  if (PREDICT_TRUE (sa0->use_anti_replay))
+    {
+      int rv;
+
+      if (PREDICT_TRUE (sa0->use_esn))
+	rv = esp_replay_check_esn (sa0, pd->seq);
+      else
+	rv = esp_replay_check (sa0, pd->seq);
+
+      if (PREDICT_FALSE (rv))
+	{
+	  esp_decrypt_drop (node, ib, pd, next, ESP_DECRYPT_ERROR_REPLAY);
+	  goto trace;
+	}
+
+      if (PREDICT_TRUE (sa0->use_esn))
+	esp_replay_advance_esn (sa0, pd->seq);
+      else
+	esp_replay_advance (sa0, pd->seq);
+    }
+
+  if (PREDICT_FALSE (pd->crypto_len == 0))
+    goto trace;
+
+  esp0 = vlib_buffer_get_current (ib);
+
+  if (PREDICT_FALSE (pd->ip_hdr_size))
+    {
+      if (is_ip6)
+	{
+	  ih6 = (ip6_header_t *) ((u8 *) esp0 - pd->ip_hdr_size);
+	  oh6 = vlib_buffer_get_current (ob);
+	}
+      else
+	{
+	  if (sa0->udp_encap)
+	    ih4 = (ip4_header_t *) ((u8 *) esp0 - pd->ip_hdr_size -
+				    sizeof (udp_header_t));
+	  else
+	    ih4 = (ip4_header_t *) ((u8 *) esp0 - pd->ip_hdr_size);
+	  oh4 = vlib_buffer_get_current (ob);
+	}
+    }
+
+  ob->current_length = pd->crypto_len - 2 + pd->ip_hdr_size;
+  ob->flags = VLIB_BUFFER_TOTAL_LENGTH_VALID;
+  f0 = (esp_footer_t *) ((u8 *) vlib_buffer_get_current (ob) +
+			 ob->current_length);
+  ob->current_length -= f0->pad_length;
+
+  /* tunnel mode */
+  if (PREDICT_TRUE (pd->ip_hdr_size == 0))
+    {
+      if (PREDICT_TRUE (f0->next_header == IP_PROTOCOL_IP_IN_IP))
+	{
+	  next[0] = ESP_DECRYPT_NEXT_IP4_INPUT;
+	  oh4 = vlib_buffer_get_current (ob);
+	}
+      else if (f0->next_header == IP_PROTOCOL_IPV6)
+	next[0] = ESP_DECRYPT_NEXT_IP6_INPUT;
+      else
+	{
+	  vlib_node_increment_counter (vm, node->node_index,
+				       ESP_DECRYPT_ERROR_DECRYPTION_FAILED,
+				       1);
+	  return;
+	}
+    }
+  /* transport mode */
+  else
+    {
+      u32 len = vlib_buffer_length_in_chain (vm, ob);
+      if (is_ip6)
+	{
+	  next[0] = ESP_DECRYPT_NEXT_IP6_INPUT;
+	  oh6->ip_version_traffic_class_and_flow_label =
+	    ih6->ip_version_traffic_class_and_flow_label;
+	  oh6->protocol = f0->next_header;
+	  oh6->hop_limit = ih6->hop_limit;
+	  oh6->src_address.as_u64[0] = ih6->src_address.as_u64[0];
+	  oh6->src_address.as_u64[1] = ih6->src_address.as_u64[1];
+	  oh6->dst_address.as_u64[0] = ih6->dst_address.as_u64[0];
+	  oh6->dst_address.as_u64[1] = ih6->dst_address.as_u64[1];
+	  len -= sizeof (ip6_header_t);
+	  oh6->payload_length = clib_host_to_net_u16 (len);
+	}
+      else
+	{
+	  next[0] = ESP_DECRYPT_NEXT_IP4_INPUT;
+	  oh4->ip_version_and_header_length = 0x45;
+	  oh4->tos = ih4->tos;
+	  oh4->fragment_id = 0;
+	  oh4->flags_and_fragment_offset = 0;
+	  oh4->ttl = ih4->ttl;
+	  oh4->protocol = f0->next_header;
+	  oh4->src_address.as_u32 = ih4->src_address.as_u32;
+	  oh4->dst_address.as_u32 = ih4->dst_address.as_u32;
+	  oh4->length = clib_host_to_net_u16 (len);
+	  oh4->checksum = ip4_header_checksum (oh4);
+	}
+    }
+
+  /* for IPSec-GRE tunnel next node is ipsec-gre-input */
+  if (PREDICT_FALSE
+      ((vnet_buffer (ib)->ipsec.flags) & IPSEC_FLAG_IPSEC_GRE_TUNNEL))
+    next[0] = ESP_DECRYPT_NEXT_IPSEC_GRE_INPUT;
+
+  vnet_buffer (ob)->sw_if_index[VLIB_TX] = (u32) ~ 0;
+  vnet_buffer (ob)->sw_if_index[VLIB_RX] =
+    vnet_buffer (ib)->sw_if_index[VLIB_RX];
+
+trace:
+  if (PREDICT_FALSE (ib->flags & VLIB_BUFFER_IS_TRACED))
+    {
+      ob->flags |= VLIB_BUFFER_IS_TRACED;
+      ob->trace_index = ib->trace_index;
+      esp_decrypt_trace_t *tr = vlib_add_trace (vm, node, ob, sizeof (*tr));
+      tr->crypto_alg = sa0->crypto_alg;
+      tr->integ_alg = sa0->integ_alg;
+    }
+}
+
+/*
+ * Enqueue the decrypted packets, or the original ones for the packets
+ * being dropped, and free the others.
+ */
+static_always_inline void
+esp_decrypt_enqueue (vlib_main_t * vm, vlib_node_runtime_t * node,
+		     u32 * from, u32 * to, esp_decrypt_packet_data_t * pds,
+		     u16 * nexts, u32 n)
+{
+  u32 i, tmp;
+
+  for (i = 0; i < n; i++)
+    if (PREDICT_FALSE (pds[i].is_dropped))
+      {
+	tmp = from[i];
+	from[i] = to[i];
+	to[i] = tmp;
+      }
+
+  vlib_buffer_enqueue_to_next (vm, node, to, nexts, n);
+  vlib_buffer_free (vm, from, n);
+}
+
+/*
+ * Hand on, in order, up to a frame of the packets at the tail of the
+ * in-flight ring whose crypto is complete, advancing the replay windows.
+ * Also called from the decrypt node once async mode is turned off, see
+ * esp_encrypt_async_drain ().
+ */
+static_always_inline u32
+esp_decrypt_async_drain (vlib_main_t * vm, vlib_node_runtime_t * node,
+			 ipsec_async_ring_t * ring, int is_ip6)
+{
+  u32 to[VLIB_FRAME_SIZE], from[VLIB_FRAME_SIZE];
+  u16 nexts[VLIB_FRAME_SIZE];
+  esp_decrypt_packet_data_t pkt_data[VLIB_FRAME_SIZE], *pd = pkt_data;
+  vlib_node_runtime_t *dnode;
+  u32 n = 0;
+
+  /* errors and traces are accounted to the decrypt node */
+  dnode = vlib_node_get_runtime (vm, is_ip6 ? esp6_decrypt_node.index :
+				 esp4_decrypt_node.index);
+
+  while (ring->tail != ring->head && n < VLIB_FRAME_SIZE)
+    {
+      ipsec_async_pkt_t *p = ipsec_async_ring_elt (ring, ring->tail);
+      vlib_buffer_t *ib, *ob;
+
+      if (!esp_async_pkt_is_done (vm, p, 1 /* is_decrypt */ ))
+	break;
+
+      to[n] = p->to_bi;
+      from[n] = p->from_bi;
+      nexts[n] = p->next_index;
+      pd->sa_index = p->sa_index;
+      pd->seq = p->seq;
+      pd->crypto_len = p->crypto_len;
+      pd->ip_hdr_size = p->ip_hdr_size;
+      pd->is_dropped = p->is_dropped;
+
+      ib = vlib_get_buffer (vm, from[n]);
+      ob = vlib_get_buffer (vm, to[n]);
+
+      if (PREDICT_FALSE ((p->flags & IPSEC_ASYNC_PKT_F_INTEG) &&
+			 p->integ_op.status !=
+			 VNET_CRYPTO_OP_STATUS_COMPLETED))
+	esp_decrypt_drop (dnode, ib, pd, nexts + n,
+			  ESP_DECRYPT_ERROR_INTEG_ERROR);
+      else if (PREDICT_FALSE ((p->flags & IPSEC_ASYNC_PKT_F_CRYPTO) &&
+			      p->crypto_op.status !=
+			      VNET_CRYPTO_OP_STATUS_COMPLETED))
+	esp_decrypt_drop (dnode, ib, pd, nexts + n,
+			  ESP_DECRYPT_ERROR_DECRYPTION_FAILED);
+
+      esp_decrypt_post_crypto (vm, dnode, ib, ob, pd, nexts + n, is_ip6);
+
+      ring->tail++;
+      pd++;
+      n++;
+    }
+
+  if (n)
+    esp_decrypt_enqueue (vm, node, from, to, pkt_data, nexts, n);
 
-  vnet_crypto_process_ops (vm, op, 1);
+  return n;
 }
 
 always_inline uword
@@ -108,12 +369,40 @@ esp_decrypt_inline (vlib_main_t * vm,
 {
   ipsec_main_t *im = &ipsec_main;
   u32 *from = vlib_frame_vector_args (from_frame);
-  u32 n_left_from = from_frame->n_vectors;
+  u32 n_pkts = from_frame->n_vectors, n_left_from;
+  u32 local_bufs[VLIB_FRAME_SIZE];
   u32 new_bufs[VLIB_FRAME_SIZE];
   vlib_buffer_t *i_bufs[VLIB_FRAME_SIZE], **ib = i_bufs;
   vlib_buffer_t *o_bufs[VLIB_FRAME_SIZE], **ob = o_bufs;
   u16 nexts[VLIB_FRAME_SIZE], *next = nexts;
-  u32 n_alloc, thread_index = vm->thread_index;
+  esp_decrypt_packet_data_t pkt_data[VLIB_FRAME_SIZE], *pd = pkt_data;
+  u32 n_alloc, i, thread_index = vm->thread_index;
+  ipsec_per_thread_data_t *ptd = vec_elt_at_index (im->ptd, thread_index);
+
+  vec_reset_length (ptd->crypto_ops);
+  vec_reset_length (ptd->integ_ops);
+
+  /*
+   * async mode was turned off with packets in flight: they go first, and
+   * move the replay windows before this frame is checked against them
+   */
+  if (PREDICT_FALSE (!vnet_crypto_async_mode_enabled ()))
+    {
+      ipsec_async_ring_t *ring = ptd->esp_decrypt_ring + is_ip6;
+
+      while (ring->tail != ring->head &&
+	     esp_decrypt_async_drain (vm, node, ring, is_ip6))
+	;
+    }
+
+  if (PREDICT_FALSE (vlib_num_workers ()))
+    {
+      n_pkts = esp_handoff_foreign (vm, node, from, n_pkts, local_bufs,
+				    is_ip6 ? esp6_decrypt_handoff_node.index :
+				    esp4_decrypt_handoff_node.index);
+      from = local_bufs;
+    }
+  n_left_from = n_pkts;
 
   n_alloc = vlib_buffer_alloc (vm, new_bufs, n_left_from);
   if (n_alloc != n_left_from)
@@ -129,22 +418,23 @@ esp_decrypt_inline (vlib_main_t * vm,
   vlib_get_buffers (vm, from, ib, n_left_from);
   vlib_get_buffers (vm, new_bufs, ob, n_left_from);
 
+  /*
+   * first pass: replay check and collect integrity and cipher ops for
+   * the whole frame, so the crypto engine gets them in one batch
+   */
   while (n_left_from > 0)
     {
       esp_header_t *esp0;
       ipsec_sa_t *sa0;
-      u32 sa_index0 = ~0;
-      u32 seq;
-      ip4_header_t *ih4 = 0, *oh4 = 0;
-      ip6_header_t *ih6 = 0, *oh6 = 0;
-      u8 tunnel_mode = 1;
+      u32 off = n_alloc - n_left_from;
 
       next[0] = ESP_DECRYPT_NEXT_DROP;
+      clib_memset (pd, 0, sizeof (pd[0]));
 
       esp0 = vlib_buffer_get_current (ib[0]);
-      sa_index0 = vnet_buffer (ib[0])->ipsec.sad_index;
-      sa0 = pool_elt_at_index (im->sad, sa_index0);
-      seq = clib_host_to_net_u32 (esp0->seq);
+      pd->sa_index = vnet_buffer (ib[0])->ipsec.sad_index;
+      sa0 = pool_elt_at_index (im->sad, pd->sa_index);
+      pd->seq = clib_host_to_net_u32 (esp0->seq);
 
       /* anti-replay check */
       if (sa0->use_anti_replay)
@@ -152,59 +442,64 @@ esp_decrypt_inline (vlib_main_t * vm,
 	  int rv = 0;
 
 	  if (PREDICT_TRUE (sa0->use_esn))
-	    rv = esp_replay_check_esn (sa0, seq);
+	    rv = esp_replay_check_esn (sa0, pd->seq);
 	  else
-	    rv = esp_replay_check (sa0, seq);
+	    rv = esp_replay_check (sa0, pd->seq);
 
 	  if (PREDICT_FALSE (rv))
 	    {
-	      u32 tmp, off = n_alloc - n_left_from;
-	      /* send original packet to drop node */
-	      tmp = from[off];
-	      from[off] = new_bufs[off];
-	      new_bufs[off] = tmp;
-	      ib[0]->error = node->errors[ESP_DECRYPT_ERROR_REPLAY];
-	      next[0] = ESP_DECRYPT_NEXT_DROP;
-	      goto trace;
+	      esp_decrypt_drop (node, ib[0], pd, next,
+				ESP_DECRYPT_ERROR_REPLAY);
+	      goto next;
 	    }
 	}
 
+      /* the ESN high bits are inserted before the ICV for the check */
+      if (PREDICT_FALSE (sa0->use_esn &&
+			 sa0->integ_alg != IPSEC_INTEG_ALG_NONE &&
+			 vlib_buffer_space_left_at_end (vm, ib[0]) <
+			 sizeof (sa0->seq_hi)))
+	{
+	  esp_decrypt_drop (node, ib[0], pd, next,
+			    ESP_DECRYPT_ERROR_NO_TAIL_SPACE);
+	  goto next;
+	}
+
       vlib_increment_combined_counter
-	(&ipsec_sa_counters, thread_index, sa_index0,
+	(&ipsec_sa_counters, thread_index, pd->sa_index,
 	 1, ib[0]->current_length);
 
       if (PREDICT_TRUE (sa0->integ_alg != IPSEC_INTEG_ALG_NONE))
 	{
-	  u8 sig[64];
+	  vnet_crypto_op_t *op;
 	  int icv_size = sa0->integ_trunc_size;
-	  clib_memset (sig, 0, sizeof (sig));
-	  u8 *icv = vlib_buffer_get_current (ib[0]) + ib[0]->current_length -
-	    icv_size;
-	  ib[0]->current_length -= icv_size;
 
-	  hmac_calc (vm, sa0, (u8 *) esp0, ib[0]->current_length, sig);
+	  ib[0]->current_length -= icv_size;
 
-	  if (PREDICT_FALSE (memcmp (icv, sig, icv_size)))
+	  vec_add2_aligned (ptd->integ_ops, op, 1, CLIB_CACHE_LINE_BYTES);
+	  clib_memset (op, 0, sizeof (*op));
+	  op->op = sa0->integ_op_type;
+	  op->flags = VNET_CRYPTO_OP_FLAG_HMAC_CHECK;
+	  op->key = sa0->integ_key.data;
+	  op->key_len = sa0->integ_key.len;
+	  op->src = (u8 *) esp0;
+	  op->len = ib[0]->current_length;
+	  op->dst = op->src + op->len;
+	  op->hmac_trunc_len = icv_size;
+	  op->user_data = off;
+
+	  if (sa0->use_esn)
 	    {
-	      u32 tmp, off = n_alloc - n_left_from;
-	      /* send original packet to drop node */
-	      tmp = from[off];
-	      from[off] = new_bufs[off];
-	      new_bufs[off] = tmp;
-	      ib[0]->error = node->errors[ESP_DECRYPT_ERROR_INTEG_ERROR];
-	      next[0] = ESP_DECRYPT_NEXT_DROP;
-	      goto trace;
+	      /* shift ICV by 4 bytes to make room for the ESN high bits */
+	      u8 tmp[64], sz = sizeof (sa0->seq_hi);
+	      clib_memcpy_fast (tmp, op->dst, icv_size);
+	      clib_memcpy_fast (op->dst, &sa0->seq_hi, sz);
+	      clib_memcpy_fast (op->dst + sz, tmp, icv_size);
+	      op->len += sz;
+	      op->dst += sz;
 	    }
 	}
 
-      if (PREDICT_TRUE (sa0->use_anti_replay))
-	{
-	  if (PREDICT_TRUE (sa0->use_esn))
-	    esp_replay_advance_esn (sa0, seq);
-	  else
-	    esp_replay_advance (sa0, seq);
-	}
-
       if ((sa0->crypto_alg >= IPSEC_CRYPTO_ALG_AES_CBC_128 &&
 	   sa0->crypto_alg <= IPSEC_CRYPTO_ALG_AES_CBC_256) ||
 	  (sa0->crypto_alg >= IPSEC_CRYPTO_ALG_DES_CBC &&
@@ -212,8 +507,6 @@ esp_decrypt_inline (vlib_main_t * vm,
 	{
 	  const int BLOCK_SIZE = sa0->crypto_block_size;
 	  const int IV_SIZE = sa0->crypto_block_size;
-	  esp_footer_t *f0;
-	  u8 ip_hdr_size = 0;
 
 	  int blocks =
 	    (ib[0]->current_length - sizeof (esp_header_t) -
@@ -223,130 +516,100 @@ esp_decrypt_inline (vlib_main_t * vm,
 
 	  /* transport mode */
 	  if (PREDICT_FALSE (!sa0->is_tunnel && !sa0->is_tunnel_ip6))
-	    {
-	      tunnel_mode = 0;
-
-	      if (is_ip6)
-		{
-		  ip_hdr_size = sizeof (ip6_header_t);
-		  ih6 = (ip6_header_t *) ((u8 *) esp0 - ip_hdr_size);
-		  oh6 = vlib_buffer_get_current (ob[0]);
-		}
-	      else
-		{
-		  ip_hdr_size = sizeof (ip4_header_t);
-		  if (sa0->udp_encap)
-		    ih4 = (ip4_header_t *) ((u8 *) esp0 - ip_hdr_size -
-					    sizeof (udp_header_t));
-		  else
-		    ih4 = (ip4_header_t *) ((u8 *) esp0 - ip_hdr_size);
-		  oh4 = vlib_buffer_get_current (ob[0]);
-		}
-	    }
+	    pd->ip_hdr_size = is_ip6 ? sizeof (ip6_header_t) :
+	      sizeof (ip4_header_t);
 
-	  esp_decrypt_cbc (vm, sa0, esp0->data + IV_SIZE,
-			   (u8 *) vlib_buffer_get_current (ob[0]) +
-			   ip_hdr_size, BLOCK_SIZE * blocks,
-			   sa0->crypto_key.data, esp0->data);
+	  pd->crypto_len = BLOCK_SIZE * blocks;
 
-	  ob[0]->current_length = (blocks * BLOCK_SIZE) - 2 + ip_hdr_size;
-	  ob[0]->flags = VLIB_BUFFER_TOTAL_LENGTH_VALID;
-	  f0 = (esp_footer_t *) ((u8 *) vlib_buffer_get_current (ob[0]) +
-				 ob[0]->current_length);
-	  ob[0]->current_length -= f0->pad_length;
-
-	  /* tunnel mode */
-	  if (PREDICT_TRUE (tunnel_mode))
-	    {
-	      if (PREDICT_TRUE (f0->next_header == IP_PROTOCOL_IP_IN_IP))
-		{
-		  next[0] = ESP_DECRYPT_NEXT_IP4_INPUT;
-		  oh4 = vlib_buffer_get_current (ob[0]);
-		}
-	      else if (f0->next_header == IP_PROTOCOL_IPV6)
-		next[0] = ESP_DECRYPT_NEXT_IP6_INPUT;
-	      else
-		{
-		  vlib_node_increment_counter (vm, node->node_index,
-					       ESP_DECRYPT_ERROR_DECRYPTION_FAILED,
-					       1);
-		  ob[0] = 0;
-		  goto trace;
-		}
-	    }
-	  /* transport mode */
-	  else
+	  if (PREDICT_TRUE (sa0->crypto_dec_op_type != VNET_CRYPTO_OP_NONE))
 	    {
-	      u32 len = vlib_buffer_length_in_chain (vm, ob[0]);
-	      if (is_ip6)
-		{
-		  next[0] = ESP_DECRYPT_NEXT_IP6_INPUT;
-		  oh6->ip_version_traffic_class_and_flow_label =
-		    ih6->ip_version_traffic_class_and_flow_label;
-		  oh6->protocol = f0->next_header;
-		  oh6->hop_limit = ih6->hop_limit;
-		  oh6->src_address.as_u64[0] = ih6->src_address.as_u64[0];
-		  oh6->src_address.as_u64[1] = ih6->src_address.as_u64[1];
-		  oh6->dst_address.as_u64[0] = ih6->dst_address.as_u64[0];
-		  oh6->dst_address.as_u64[1] = ih6->dst_address.as_u64[1];
-		  len -= sizeof (ip6_header_t);
-		  oh6->payload_length = clib_host_to_net_u16 (len);
-		}
-	      else
-		{
-		  next[0] = ESP_DECRYPT_NEXT_IP4_INPUT;
-		  oh4->ip_version_and_header_length = 0x45;
-		  oh4->tos = ih4->tos;
-		  oh4->fragment_id = 0;
-		  oh4->flags_and_fragment_offset = 0;
-		  oh4->ttl = ih4->ttl;
-		  oh4->protocol = f0->next_header;
-		  oh4->src_address.as_u32 = ih4->src_address.as_u32;
-		  oh4->dst_address.as_u32 = ih4->dst_address.as_u32;
-		  oh4->length = clib_host_to_net_u16 (len);
-		  oh4->checksum = ip4_header_checksum (oh4);
-		}
-	    }
-
-	  /* for IPSec-GRE tunnel next node is ipsec-gre-input */
-	  if (PREDICT_FALSE
-	      ((vnet_buffer (ib[0])->ipsec.flags) &
-	       IPSEC_FLAG_IPSEC_GRE_TUNNEL))
-	    next[0] = ESP_DECRYPT_NEXT_IPSEC_GRE_INPUT;
-
-	  vnet_buffer (ob[0])->sw_if_index[VLIB_TX] = (u32) ~ 0;
-	  vnet_buffer (ob[0])->sw_if_index[VLIB_RX] =
-	    vnet_buffer (ib[0])->sw_if_index[VLIB_RX];
-	}
-
-    trace:
-      if (PREDICT_FALSE (ib[0]->flags & VLIB_BUFFER_IS_TRACED))
-	{
-	  if (ob[0])
-	    {
-	      ob[0]->flags |= VLIB_BUFFER_IS_TRACED;
-	      ob[0]->trace_index = ib[0]->trace_index;
-	      esp_decrypt_trace_t *tr =
-		vlib_add_trace (vm, node, ob[0], sizeof (*tr));
-	      tr->crypto_alg = sa0->crypto_alg;
-	      tr->integ_alg = sa0->integ_alg;
+	      vnet_crypto_op_t *op;
+	      vec_add2_aligned (ptd->crypto_ops, op, 1, CLIB_CACHE_LINE_BYTES);
+	      clib_memset (op, 0, sizeof (*op));
+	      op->op = sa0->crypto_dec_op_type;
+	      op->iv = esp0->data;
+	      op->src = esp0->data + IV_SIZE;
+	      op->dst = (u8 *) vlib_buffer_get_current (ob[0]) +
+		pd->ip_hdr_size;
+	      op->len = pd->crypto_len;
+	      op->key = sa0->crypto_key.data;
+	      op->user_data = off;
 	    }
 	}
 
+    next:
       /* next */
       n_left_from -= 1;
       ib += 1;
       ob += 1;
       next += 1;
+      pd += 1;
     }
 
   vlib_node_increment_counter (vm, node->node_index,
 			       ESP_DECRYPT_ERROR_RX_PKTS, n_alloc);
 
-  vlib_buffer_enqueue_to_next (vm, node, new_bufs, nexts, n_alloc);
-done:
-  vlib_buffer_free (vm, from, from_frame->n_vectors);
+  /* in async mode buffers are handed over once crypto is complete */
+  if (vnet_crypto_async_mode_enabled ())
+    {
+      ipsec_async_ring_t *ring = ptd->esp_decrypt_ring + is_ip6;
+      u32 head = ring->head;
+
+      if (esp_async_submit (vm, ptd, ring, is_ip6 ?
+			    esp6_decrypt_post_node.index :
+			    esp4_decrypt_post_node.index, from, new_bufs,
+			    nexts, n_alloc))
+	{
+	  for (i = 0; i < n_alloc; i++)
+	    {
+	      ipsec_async_pkt_t *p = ipsec_async_ring_elt (ring, head + i);
+	      pd = pkt_data + i;
+	      p->sa_index = pd->sa_index;
+	      p->seq = pd->seq;
+	      p->crypto_len = pd->crypto_len;
+	      p->ip_hdr_size = pd->ip_hdr_size;
+	      p->is_dropped = pd->is_dropped;
+	    }
+
+	  if (n_alloc != n_pkts)
+	    vlib_buffer_free (vm, from + n_alloc,
+			      n_pkts - n_alloc);
+	  return n_alloc;
+	}
+
+      /*
+       * must not overtake the packets in flight, nor move the replay
+       * windows past their sequence numbers
+       */
+      if (ring->head != ring->tail)
+	{
+	  for (i = 0; i < n_alloc; i++)
+	    if (!pkt_data[i].is_dropped)
+	      esp_decrypt_drop (node, i_bufs[i], pkt_data + i, nexts + i,
+				ESP_DECRYPT_ERROR_ASYNC_RING_FULL);
+	  goto enqueue;
+	}
+    }
+
+  esp_process_ops (vm, node, ptd->integ_ops, i_bufs, pkt_data, nexts,
+		   ESP_DECRYPT_ERROR_INTEG_ERROR);
+  esp_process_ops (vm, node, ptd->crypto_ops, i_bufs, pkt_data, nexts,
+		   ESP_DECRYPT_ERROR_DECRYPTION_FAILED);
+
+  /* second pass: advance replay windows and build the decrypted packets */
+  for (i = 0; i < n_alloc; i++)
+    esp_decrypt_post_crypto (vm, node, i_bufs[i], o_bufs[i], pkt_data + i,
+			     nexts + i, is_ip6);
+
+enqueue:
+  esp_decrypt_enqueue (vm, node, from, new_bufs, pkt_data, nexts, n_alloc);
+  if (n_alloc != n_pkts)
+    vlib_buffer_free (vm, from + n_alloc, n_pkts - n_alloc);
   return n_alloc;
+
+done:
+  vlib_buffer_free (vm, from, n_pkts);
+  return 0;
 }
 
 VLIB_NODE_FN (esp4_decrypt_node) (vlib_main_t * vm,
@@ -401,6 +664,56 @@ VLIB_REGISTER_NODE (esp6_decrypt_node) = {
 };
 /* *INDENT-ON* */
 
+always_inline uword
+esp_decrypt_post_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+			 int is_ip6)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_per_thread_data_t *ptd = vec_elt_at_index (im->ptd,
+						   vm->thread_index);
+  ipsec_async_ring_t *ring = ptd->esp_decrypt_ring + is_ip6;
+  u32 n;
+
+  n = esp_decrypt_async_drain (vm, node, ring, is_ip6);
+
+  if (ring->tail == ring->head)
+    vlib_node_set_state (vm, node->node_index, VLIB_NODE_STATE_DISABLED);
+
+  return n;
+}
+
+VLIB_NODE_FN (esp4_decrypt_post_node) (vlib_main_t * vm,
+				       vlib_node_runtime_t * node,
+				       vlib_frame_t * frame)
+{
+  return esp_decrypt_post_inline (vm, node, 0 /* is_ip6 */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (esp4_decrypt_post_node) = {
+  .name = "esp4-decrypt-post",
+  .sibling_of = "esp4-decrypt",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_DISABLED,
+};
+/* *INDENT-ON* */
+
+VLIB_NODE_FN (esp6_decrypt_post_node) (vlib_main_t * vm,
+				       vlib_node_runtime_t * node,
+				       vlib_frame_t * frame)
+{
+  return esp_decrypt_post_inline (vm, node, 1 /* is_ip6 */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (esp6_decrypt_post_node) = {
+  .name = "esp6-decrypt-post",
+  .sibling_of = "esp6-decrypt",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_DISABLED,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
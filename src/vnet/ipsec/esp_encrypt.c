@@ -43,7 +43,9 @@ typedef enum
  _(RX_PKTS, "ESP pkts received")                    \
  _(NO_BUFFER, "No buffer (packet dropped)")         \
  _(DECRYPTION_FAILED, "ESP encryption failed")      \
- _(SEQ_CYCLED, "sequence number cycled")
+ _(SEQ_CYCLED, "sequence number cycled")            \
+ _(CRYPTO_ENGINE_ERROR, "crypto engine error (packet dropped)") \
+ _(ASYNC_RING_FULL, "async crypto ring full (packet dropped)")
 
 
 typedef enum
@@ -86,25 +88,86 @@ format_esp_encrypt_trace (u8 * s, va_list * args)
   return s;
 }
 
-always_inline void
-esp_encrypt_cbc (vlib_main_t * vm, ipsec_sa_t * sa,
-		 u8 * in, u8 * out, size_t in_len, u8 * key, u8 * iv)
+static_always_inline void
+esp_process_ops (vlib_main_t * vm, vlib_node_runtime_t * node,
+		 vnet_crypto_op_t * ops, vlib_buffer_t * b[], u16 * nexts)
 {
-  vnet_crypto_op_t _op, *op = &_op;
+  u32 n_fail, n_ops = vec_len (ops);
+  vnet_crypto_op_t *op = ops;
 
-
-  if (PREDICT_FALSE (sa->crypto_enc_op_type == VNET_CRYPTO_OP_NONE))
+  if (n_ops == 0)
     return;
 
-  op->op = sa->crypto_enc_op_type;
-  op->flags = VNET_CRYPTO_OP_FLAG_INIT_IV;
-  op->iv = iv;
-  op->src = in;
-  op->dst = out;
-  op->len = in_len;
-  op->key = key;
+  n_fail = n_ops - vnet_crypto_process_ops (vm, op, n_ops);
+
+  while (n_fail)
+    {
+      ASSERT (op - ops < n_ops);
+
+      if (op->status != VNET_CRYPTO_OP_STATUS_COMPLETED)
+	{
+	  u32 bi = op->user_data;
+	  b[bi]->error = node->errors[ESP_ENCRYPT_ERROR_CRYPTO_ENGINE_ERROR];
+	  nexts[bi] = ESP_ENCRYPT_NEXT_DROP;
+	  n_fail--;
+	}
+      op++;
+    }
+}
+
+/*
+ * Hand on, in order, up to a frame of the packets at the tail of the
+ * in-flight ring whose crypto is complete. Called from the post node, and
+ * from the encrypt node itself so that once async mode is turned off no
+ * frame is processed before what is left in the ring; the post nodes are
+ * siblings of the encrypt nodes so either runtime can enqueue them.
+ */
+static_always_inline u32
+esp_encrypt_async_drain (vlib_main_t * vm, vlib_node_runtime_t * node,
+			 ipsec_async_ring_t * ring, int is_ip6)
+{
+  u32 to[VLIB_FRAME_SIZE], from[VLIB_FRAME_SIZE];
+  u16 nexts[VLIB_FRAME_SIZE];
+  vlib_node_runtime_t *enode;
+  u32 n = 0;
+
+  /* errors are accounted to the encrypt node */
+  enode = vlib_node_get_runtime (vm, is_ip6 ? esp6_encrypt_node.index :
+				 esp4_encrypt_node.index);
+
+  while (ring->tail != ring->head && n < VLIB_FRAME_SIZE)
+    {
+      ipsec_async_pkt_t *p = ipsec_async_ring_elt (ring, ring->tail);
+
+      if (!esp_async_pkt_is_done (vm, p, 0 /* is_decrypt */ ))
+	break;
+
+      to[n] = p->to_bi;
+      from[n] = p->from_bi;
+      nexts[n] = p->next_index;
+
+      if (PREDICT_FALSE
+	  (((p->flags & IPSEC_ASYNC_PKT_F_CRYPTO) &&
+	    p->crypto_op.status != VNET_CRYPTO_OP_STATUS_COMPLETED) ||
+	   ((p->flags & IPSEC_ASYNC_PKT_F_INTEG) &&
+	    p->integ_op.status != VNET_CRYPTO_OP_STATUS_COMPLETED)))
+	{
+	  vlib_buffer_t *b = vlib_get_buffer (vm, to[n]);
+	  b->error = enode->errors[ESP_ENCRYPT_ERROR_CRYPTO_ENGINE_ERROR];
+	  nexts[n] = ESP_ENCRYPT_NEXT_DROP;
+	}
+
+      ring->tail++;
+      n++;
+    }
+
+  if (n)
+    {
+      vlib_buffer_enqueue_to_next (vm, node, to, nexts, n);
+      vlib_buffer_free (vm, from, n);
+    }
 
-  vnet_crypto_process_ops (vm, op, 1);
+  return n;
 }
 
 always_inline uword
@@ -113,13 +176,40 @@ esp_encrypt_inline (vlib_main_t * vm,
 		    int is_ip6)
 {
   u32 *from = vlib_frame_vector_args (from_frame);
-  u32 n_left_from = from_frame->n_vectors;
+  u32 n_pkts = from_frame->n_vectors, n_left_from;
+  u32 local_bufs[VLIB_FRAME_SIZE];
   ipsec_main_t *im = &ipsec_main;
   u32 new_bufs[VLIB_FRAME_SIZE];
   vlib_buffer_t *i_bufs[VLIB_FRAME_SIZE], **ib = i_bufs;
   vlib_buffer_t *o_bufs[VLIB_FRAME_SIZE], **ob = o_bufs;
   u16 nexts[VLIB_FRAME_SIZE], *next = nexts;
   u32 n_alloc, thread_index = vm->thread_index;
+  ipsec_per_thread_data_t *ptd = vec_elt_at_index (im->ptd, thread_index);
+
+  vec_reset_length (ptd->crypto_ops);
+  vec_reset_length (ptd->integ_ops);
+
+  /*
+   * async mode was turned off with packets in flight: their crypto was
+   * completed then, they go first
+   */
+  if (PREDICT_FALSE (!vnet_crypto_async_mode_enabled ()))
+    {
+      ipsec_async_ring_t *ring = ptd->esp_encrypt_ring + is_ip6;
+
+      while (ring->tail != ring->head &&
+	     esp_encrypt_async_drain (vm, node, ring, is_ip6))
+	;
+    }
+
+  if (PREDICT_FALSE (vlib_num_workers ()))
+    {
+      n_pkts = esp_handoff_foreign (vm, node, from, n_pkts, local_bufs,
+				    is_ip6 ? esp6_encrypt_handoff_node.index :
+				    esp4_encrypt_handoff_node.index);
+      from = local_bufs;
+    }
+  n_left_from = n_pkts;
 
   n_alloc = vlib_buffer_alloc (vm, new_bufs, n_left_from);
   if (n_alloc != n_left_from)
@@ -304,22 +394,45 @@ esp_encrypt_inline (vlib_main_t * vm,
 	  u8 *iv = vlib_buffer_get_current (ob[0]) + ip_udp_hdr_size +
 	    sizeof (esp_header_t);
 
-	  clib_memcpy_fast ((u8 *) vlib_buffer_get_current (ob[0]) +
-			    ip_udp_hdr_size + sizeof (esp_header_t), iv,
-			    IV_SIZE);
-
-	  esp_encrypt_cbc (vm, sa0, (u8 *) vlib_buffer_get_current (ib[0]),
-			   (u8 *) vlib_buffer_get_current (ob[0]) +
-			   ip_udp_hdr_size + sizeof (esp_header_t) +
-			   IV_SIZE, BLOCK_SIZE * blocks,
-			   sa0->crypto_key.data, iv);
+	  if (PREDICT_TRUE (sa0->crypto_enc_op_type != VNET_CRYPTO_OP_NONE))
+	    {
+	      vnet_crypto_op_t *op;
+	      vec_add2_aligned (ptd->crypto_ops, op, 1, CLIB_CACHE_LINE_BYTES);
+	      clib_memset (op, 0, sizeof (*op));
+	      op->op = sa0->crypto_enc_op_type;
+	      op->flags = VNET_CRYPTO_OP_FLAG_INIT_IV;
+	      op->iv = iv;
+	      op->src = vlib_buffer_get_current (ib[0]);
+	      op->dst = iv + IV_SIZE;
+	      op->len = BLOCK_SIZE * blocks;
+	      op->key = sa0->crypto_key.data;
+	      op->user_data = ob - o_bufs;
+	    }
 	}
 
-      ob[0]->current_length +=
-	hmac_calc (vm, sa0, (u8 *) o_esp0,
-		   ob[0]->current_length - ip_udp_hdr_size,
-		   vlib_buffer_get_current (ob[0]) + ob[0]->current_length);
+      if (PREDICT_TRUE (sa0->integ_op_type != VNET_CRYPTO_OP_NONE))
+	{
+	  vnet_crypto_op_t *op;
+	  vec_add2_aligned (ptd->integ_ops, op, 1, CLIB_CACHE_LINE_BYTES);
+	  clib_memset (op, 0, sizeof (*op));
+	  op->op = sa0->integ_op_type;
+	  op->key = sa0->integ_key.data;
+	  op->key_len = sa0->integ_key.len;
+	  op->src = (u8 *) o_esp0;
+	  op->len = ob[0]->current_length - ip_udp_hdr_size;
+	  op->dst = vlib_buffer_get_current (ob[0]) + ob[0]->current_length;
+	  op->hmac_trunc_len = sa0->integ_trunc_size;
+	  op->user_data = ob - o_bufs;
+
+	  if (sa0->use_esn)
+	    {
+	      clib_memcpy_fast (op->src + op->len, &sa0->seq_hi,
+				sizeof (sa0->seq_hi));
+	      op->len += sizeof (sa0->seq_hi);
+	    }
 
+	  ob[0]->current_length += sa0->integ_trunc_size;
+	}
 
       if (is_ip6)
 	{
@@ -377,9 +490,45 @@ esp_encrypt_inline (vlib_main_t * vm,
   vlib_node_increment_counter (vm, node->node_index,
 			       ESP_ENCRYPT_ERROR_RX_PKTS, n_alloc);
 
+  /* in async mode buffers are handed over once crypto is complete */
+  if (vnet_crypto_async_mode_enabled ())
+    {
+      ipsec_async_ring_t *ring = ptd->esp_encrypt_ring + is_ip6;
+
+      if (esp_async_submit (vm, ptd, ring, is_ip6 ?
+			    esp6_encrypt_post_node.index :
+			    esp4_encrypt_post_node.index, from, new_bufs,
+			    nexts, n_alloc))
+	{
+	  if (n_alloc != n_pkts)
+	    vlib_buffer_free (vm, from + n_alloc,
+			      n_pkts - n_alloc);
+	  return n_alloc;
+	}
+
+      /* must not overtake the packets in flight */
+      if (ring->head != ring->tail)
+	{
+	  u32 i;
+
+	  for (i = 0; i < n_alloc; i++)
+	    {
+	      o_bufs[i]->error =
+		node->errors[ESP_ENCRYPT_ERROR_ASYNC_RING_FULL];
+	      nexts[i] = ESP_ENCRYPT_NEXT_DROP;
+	    }
+	  goto enqueue;
+	}
+    }
+
+  /* integrity is computed over the cipher text, so encrypt first */
+  esp_process_ops (vm, node, ptd->crypto_ops, o_bufs, nexts);
+  esp_process_ops (vm, node, ptd->integ_ops, o_bufs, nexts);
+
+enqueue:
   vlib_buffer_enqueue_to_next (vm, node, new_bufs, nexts, n_alloc);
 done:
-  vlib_buffer_free (vm, from, from_frame->n_vectors);
+  vlib_buffer_free (vm, from, n_pkts);
   return n_alloc;
 }
 
@@ -435,6 +584,56 @@ VLIB_REGISTER_NODE (esp6_encrypt_node) = {
 };
 /* *INDENT-ON* */
 
+always_inline uword
+esp_encrypt_post_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+			 int is_ip6)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_per_thread_data_t *ptd = vec_elt_at_index (im->ptd,
+						   vm->thread_index);
+  ipsec_async_ring_t *ring = ptd->esp_encrypt_ring + is_ip6;
+  u32 n;
+
+  n = esp_encrypt_async_drain (vm, node, ring, is_ip6);
+
+  if (ring->tail == ring->head)
+    vlib_node_set_state (vm, node->node_index, VLIB_NODE_STATE_DISABLED);
+
+  return n;
+}
+
+VLIB_NODE_FN (esp4_encrypt_post_node) (vlib_main_t * vm,
+				       vlib_node_runtime_t * node,
+				       vlib_frame_t * frame)
+{
+  return esp_encrypt_post_inline (vm, node, 0 /* is_ip6 */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (esp4_encrypt_post_node) = {
+  .name = "esp4-encrypt-post",
+  .sibling_of = "esp4-encrypt",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_DISABLED,
+};
+/* *INDENT-ON* */
+
+VLIB_NODE_FN (esp6_encrypt_post_node) (vlib_main_t * vm,
+				       vlib_node_runtime_t * node,
+				       vlib_frame_t * frame)
+{
+  return esp_encrypt_post_inline (vm, node, 1 /* is_ip6 */ );
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (esp6_encrypt_post_node) = {
+  .name = "esp6-encrypt-post",
+  .sibling_of = "esp6-encrypt",
+  .type = VLIB_NODE_TYPE_INPUT,
+  .state = VLIB_NODE_STATE_DISABLED,
+};
+/* *INDENT-ON* */
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
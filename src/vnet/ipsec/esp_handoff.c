@@ -0,0 +1,210 @@
+/*
+ * esp_handoff.c : IPSec ESP SA thread handoff
+ *
+ * Copyright (c) 2019 Cisco and/or its affiliates.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vnet/vnet.h>
+#include <vnet/ipsec/ipsec.h>
+
+#define foreach_esp_handoff_error                 \
+_(CONGESTION_DROP, "congestion drop")
+
+typedef enum
+{
+#define _(sym,str) ESP_HANDOFF_ERROR_##sym,
+  foreach_esp_handoff_error
+#undef _
+    ESP_HANDOFF_N_ERROR,
+} esp_handoff_error_t;
+
+static char *esp_handoff_error_strings[] = {
+#define _(sym,string) string,
+  foreach_esp_handoff_error
+#undef _
+};
+
+typedef struct
+{
+  u32 sa_index;
+  u32 next_worker_index;
+} esp_handoff_trace_t;
+
+/* packet trace format function */
+static u8 *
+format_esp_handoff_trace (u8 * s, va_list * args)
+{
+  CLIB_UNUSED (vlib_main_t * vm) = va_arg (*args, vlib_main_t *);
+  CLIB_UNUSED (vlib_node_t * node) = va_arg (*args, vlib_node_t *);
+  esp_handoff_trace_t *t = va_arg (*args, esp_handoff_trace_t *);
+
+  s = format (s, "esp-handoff: sa %u next-worker %d",
+	      t->sa_index, t->next_worker_index);
+
+  return s;
+}
+
+/*
+ * Packets arrive here from an ESP node running on a thread that does not
+ * own the packet's SA; they are queued to the same ESP node on the owner.
+ */
+always_inline uword
+esp_handoff_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
+		    vlib_frame_t * frame, u32 fq_index)
+{
+  ipsec_main_t *im = &ipsec_main;
+  vlib_buffer_t *bufs[VLIB_FRAME_SIZE], **b;
+  u16 thread_indices[VLIB_FRAME_SIZE], *ti;
+  u32 n_enq, n_left_from, *from;
+  ipsec_sa_t *sa;
+  u32 sa_index;
+
+  from = vlib_frame_vector_args (frame);
+  n_left_from = frame->n_vectors;
+  vlib_get_buffers (vm, from, bufs, n_left_from);
+
+  b = bufs;
+  ti = thread_indices;
+
+  while (n_left_from > 0)
+    {
+      sa_index = vnet_buffer (b[0])->ipsec.sad_index;
+      sa = pool_elt_at_index (im->sad, sa_index);
+      ti[0] = sa->thread_index;
+
+      if (PREDICT_FALSE ((node->flags & VLIB_NODE_FLAG_TRACE) &&
+			 (b[0]->flags & VLIB_BUFFER_IS_TRACED)))
+	{
+	  esp_handoff_trace_t *t =
+	    vlib_add_trace (vm, node, b[0], sizeof (*t));
+	  t->sa_index = sa_index;
+	  t->next_worker_index = ti[0];
+	}
+
+      n_left_from -= 1;
+      ti += 1;
+      b += 1;
+    }
+
+  n_enq = vlib_buffer_enqueue_to_thread (vm, fq_index, from, thread_indices,
+					 frame->n_vectors, 1);
+
+  if (n_enq < frame->n_vectors)
+    vlib_node_increment_counter (vm, node->node_index,
+				 ESP_HANDOFF_ERROR_CONGESTION_DROP,
+				 frame->n_vectors - n_enq);
+  return frame->n_vectors;
+}
+
+VLIB_NODE_FN (esp4_encrypt_handoff_node) (vlib_main_t * vm,
+					  vlib_node_runtime_t * node,
+					  vlib_frame_t * from_frame)
+{
+  return esp_handoff_inline (vm, node, from_frame,
+			     ipsec_main.esp4_encrypt_fq_index);
+}
+
+VLIB_NODE_FN (esp6_encrypt_handoff_node) (vlib_main_t * vm,
+					  vlib_node_runtime_t * node,
+					  vlib_frame_t * from_frame)
+{
+  return esp_handoff_inline (vm, node, from_frame,
+			     ipsec_main.esp6_encrypt_fq_index);
+}
+
+VLIB_NODE_FN (esp4_decrypt_handoff_node) (vlib_main_t * vm,
+					  vlib_node_runtime_t * node,
+					  vlib_frame_t * from_frame)
+{
+  return esp_handoff_inline (vm, node, from_frame,
+			     ipsec_main.esp4_decrypt_fq_index);
+}
+
+VLIB_NODE_FN (esp6_decrypt_handoff_node) (vlib_main_t * vm,
+					  vlib_node_runtime_t * node,
+					  vlib_frame_t * from_frame)
+{
+  return esp_handoff_inline (vm, node, from_frame,
+			     ipsec_main.esp6_decrypt_fq_index);
+}
+
+/* *INDENT-OFF* */
+VLIB_REGISTER_NODE (esp4_encrypt_handoff_node) = {
+  .name = "esp4-encrypt-handoff",
+  .vector_size = sizeof (u32),
+  .format_trace = format_esp_handoff_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_errors = ARRAY_LEN(esp_handoff_error_strings),
+  .error_strings = esp_handoff_error_strings,
+
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+
+VLIB_REGISTER_NODE (esp6_encrypt_handoff_node) = {
+  .name = "esp6-encrypt-handoff",
+  .vector_size = sizeof (u32),
+  .format_trace = format_esp_handoff_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_errors = ARRAY_LEN(esp_handoff_error_strings),
+  .error_strings = esp_handoff_error_strings,
+
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+
+VLIB_REGISTER_NODE (esp4_decrypt_handoff_node) = {
+  .name = "esp4-decrypt-handoff",
+  .vector_size = sizeof (u32),
+  .format_trace = format_esp_handoff_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_errors = ARRAY_LEN(esp_handoff_error_strings),
+  .error_strings = esp_handoff_error_strings,
+
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+
+VLIB_REGISTER_NODE (esp6_decrypt_handoff_node) = {
+  .name = "esp6-decrypt-handoff",
+  .vector_size = sizeof (u32),
+  .format_trace = format_esp_handoff_trace,
+  .type = VLIB_NODE_TYPE_INTERNAL,
+
+  .n_errors = ARRAY_LEN(esp_handoff_error_strings),
+  .error_strings = esp_handoff_error_strings,
+
+  .n_next_nodes = 1,
+  .next_nodes = {
+    [0] = "error-drop",
+  },
+};
+/* *INDENT-ON* */
+
+/*
+ * fd.io coding-style-patch-verification: ON
+ *
+ * Local Variables:
+ * eval: (c-set-style "gnu")
+ * End:
+ */
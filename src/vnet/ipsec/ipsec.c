@@ -316,11 +316,58 @@ ipsec_init (vlib_main_t * vm)
   i->op_type = VNET_CRYPTO_OP_SHA512_HMAC;
   i->trunc_size = 32;
 
+  vec_validate_aligned (im->ptd, vlib_num_workers (), CLIB_CACHE_LINE_BYTES);
+
+  im->esp4_encrypt_fq_index =
+    vlib_frame_queue_main_init (esp4_encrypt_node.index, 0);
+  im->esp6_encrypt_fq_index =
+    vlib_frame_queue_main_init (esp6_encrypt_node.index, 0);
+  im->esp4_decrypt_fq_index =
+    vlib_frame_queue_main_init (esp4_decrypt_node.index, 0);
+  im->esp6_decrypt_fq_index =
+    vlib_frame_queue_main_init (esp6_decrypt_node.index, 0);
+
+  im->in_protect_hash_num_buckets = IPSEC_IN_PROTECT_HASH_NUM_BUCKETS;
+  im->in_protect_hash_memory_size = IPSEC_IN_PROTECT_HASH_MEMORY_SIZE;
+  im->out_flow_cache_max_entries = IPSEC_OUT_FLOW_CACHE_MAX_ENTRIES;
+
   return 0;
 }
 
 VLIB_INIT_FUNCTION (ipsec_init);
 
+static clib_error_t *
+ipsec_config (vlib_main_t * vm, unformat_input_t * input)
+{
+  ipsec_main_t *im = &ipsec_main;
+  uword memory_size;
+  u32 nbuckets, max_entries;
+
+  while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
+    {
+      if (unformat (input, "protect-hash-buckets %u", &nbuckets))
+	im->in_protect_hash_num_buckets = nbuckets;
+      else if (unformat (input, "protect-hash-memory %U",
+			 unformat_memory_size, &memory_size))
+	im->in_protect_hash_memory_size = memory_size;
+      else if (unformat (input, "flow-cache-max-entries %u", &max_entries))
+	{
+	  /* the tables' memory is sized for the default */
+	  if (max_entries == 0 || max_entries > IPSEC_OUT_FLOW_CACHE_MAX_ENTRIES)
+	    return clib_error_return (0, "flow-cache-max-entries must be "
+				      "between 1 and %u",
+				      IPSEC_OUT_FLOW_CACHE_MAX_ENTRIES);
+	  im->out_flow_cache_max_entries = max_entries;
+	}
+      else
+	return clib_error_return (0, "unknown input '%U'",
+				  format_unformat_error, input);
+    }
+  return 0;
+}
+
+VLIB_CONFIG_FUNCTION (ipsec_config, "ipsec");
+
 /*
  * fd.io coding-style-patch-verification: ON
  *
@@ -78,6 +78,62 @@ typedef struct
   u8 trunc_size;
 } ipsec_main_integ_alg_t;
 
+/* packet waiting for its crypto ops to complete in async crypto mode */
+typedef struct
+{
+  vnet_crypto_op_t crypto_op;
+  vnet_crypto_op_t integ_op;
+  u32 from_bi;
+  u32 to_bi;
+  u32 sa_index;
+  u32 seq;
+  u16 next_index;
+  u16 crypto_len;
+  u8 ip_hdr_size;
+  u8 is_dropped;
+  u8 flags;
+#define IPSEC_ASYNC_PKT_F_CRYPTO (1 << 0)
+#define IPSEC_ASYNC_PKT_F_INTEG (1 << 1)
+} ipsec_async_pkt_t;
+
+#define IPSEC_ASYNC_RING_SIZE (4 * VLIB_FRAME_SIZE)
+
+/* in-order ring of packets in flight, local to the owning thread */
+typedef struct
+{
+  u32 head;
+  u32 tail;
+  ipsec_async_pkt_t *pkts;
+} ipsec_async_ring_t;
+
+typedef struct
+{
+  CLIB_CACHE_LINE_ALIGN_MARK (cacheline0);
+  vnet_crypto_op_t *crypto_ops;
+  vnet_crypto_op_t *integ_ops;
+  vnet_crypto_op_t **async_jobs;
+  /* indexed by is_ip6 */
+  ipsec_async_ring_t esp_encrypt_ring[2];
+  ipsec_async_ring_t esp_decrypt_ring[2];
+  /* outbound SPD flow cache, entries carry the SPD generation */
+  clib_bihash_16_8_t out_flow4;
+  clib_bihash_40_8_t out_flow6;
+  u32 out_flow4_n_entries;
+  u32 out_flow6_n_entries;
+} ipsec_per_thread_data_t;
+
+/* defaults, the "ipsec" startup config section overrides them */
+#define IPSEC_IN_PROTECT_HASH_NUM_BUCKETS (1 << 10)
+#define IPSEC_IN_PROTECT_HASH_MEMORY_SIZE (32 << 20)
+
+/* per-thread outbound SPD flow cache, flushed when a new flow finds it
+   holding this many entries; the startup config may only lower it */
+#define IPSEC_OUT_FLOW_CACHE_MAX_ENTRIES (1 << 16)
+#define IPSEC4_OUT_FLOW_CACHE_NUM_BUCKETS (1 << 16)
+#define IPSEC4_OUT_FLOW_CACHE_MEMORY_SIZE (32 << 20)
+#define IPSEC6_OUT_FLOW_CACHE_NUM_BUCKETS (1 << 16)
+#define IPSEC6_OUT_FLOW_CACHE_MEMORY_SIZE (64 << 20)
+
 typedef struct
 {
   /* pool of tunnel instances */
@@ -87,6 +143,23 @@ typedef struct
   /* pool of policies */
   ipsec_policy_t *policies;
 
+  /* inbound protect policies of tunnel SAs by {spd, spi, src, dst},
+     created with the first SPD */
+  clib_bihash_16_8_t ipsec4_in_protect_hash;
+  clib_bihash_40_8_t ipsec6_in_protect_hash;
+  u32 in_protect_hash_num_buckets;
+  uword in_protect_hash_memory_size;
+  u8 in_protect_hash_initialized;
+
+  /* last SPD generation handed out, see ipsec_spd_t */
+  u32 spd_gen;
+
+  /* outbound flow cache entries per thread and table before a flush */
+  u32 out_flow_cache_max_entries;
+
+  /* next worker to own a new SA */
+  u32 sa_next_worker;
+
   /* pool of tunnel interfaces */
   ipsec_tunnel_if_t *tunnel_interfaces;
 
@@ -124,6 +197,12 @@ typedef struct
   u32 ah6_encrypt_next_index;
   u32 ah6_decrypt_next_index;
 
+  /* frame queues to hand packets to their SA's thread */
+  u32 esp4_encrypt_fq_index;
+  u32 esp6_encrypt_fq_index;
+  u32 esp4_decrypt_fq_index;
+  u32 esp6_decrypt_fq_index;
+
   /* pool of ah backends */
   ipsec_ah_backend_t *ah_backends;
   /* pool of esp backends */
@@ -142,6 +221,9 @@ typedef struct
 
   /* crypto integ data */
   ipsec_main_integ_alg_t *integ_algs;
+
+  /* per-thread data */
+  ipsec_per_thread_data_t *ptd;
 } ipsec_main_t;
 
 extern ipsec_main_t ipsec_main;
@@ -159,6 +241,14 @@ extern vlib_node_registration_t esp6_encrypt_node;
 extern vlib_node_registration_t esp6_decrypt_node;
 extern vlib_node_registration_t ah6_encrypt_node;
 extern vlib_node_registration_t ah6_decrypt_node;
+extern vlib_node_registration_t esp4_encrypt_handoff_node;
+extern vlib_node_registration_t esp6_encrypt_handoff_node;
+extern vlib_node_registration_t esp4_decrypt_handoff_node;
+extern vlib_node_registration_t esp6_decrypt_handoff_node;
+extern vlib_node_registration_t esp4_encrypt_post_node;
+extern vlib_node_registration_t esp6_encrypt_post_node;
+extern vlib_node_registration_t esp4_decrypt_post_node;
+extern vlib_node_registration_t esp6_decrypt_post_node;
 extern vlib_node_registration_t ipsec4_if_input_node;
 extern vlib_node_registration_t ipsec6_if_input_node;
 
@@ -171,6 +261,23 @@ u8 *format_ipsec_replay_window (u8 * s, va_list * args);
  *  inline functions
  */
 
+/* the ring is allocated on first use */
+static_always_inline int
+ipsec_async_ring_has_room (ipsec_async_ring_t * ring, u32 n)
+{
+  if (PREDICT_FALSE (ring->pkts == 0))
+    vec_validate_aligned (ring->pkts, IPSEC_ASYNC_RING_SIZE - 1,
+			  CLIB_CACHE_LINE_BYTES);
+
+  return ring->head - ring->tail + n <= IPSEC_ASYNC_RING_SIZE;
+}
+
+static_always_inline ipsec_async_pkt_t *
+ipsec_async_ring_elt (ipsec_async_ring_t * ring, u32 i)
+{
+  return ring->pkts + (i & (IPSEC_ASYNC_RING_SIZE - 1));
+}
+
 static_always_inline u32
 get_next_output_feature_node_index (vlib_buffer_t * b,
 				    vlib_node_runtime_t * nr)
@@ -183,6 +290,112 @@ get_next_output_feature_node_index (vlib_buffer_t * b,
   return node->next_nodes[next];
 }
 
+/*
+ * SPD order: higher priority first, then lower policy index, the order
+ * ipsec_spd_entry_sort keeps the policy vectors in.
+ */
+static_always_inline int
+ipsec_policy_is_before (ipsec_policy_t * p1, ipsec_policy_t * p2)
+{
+  ipsec_main_t *im = &ipsec_main;
+
+  if (p1->priority != p2->priority)
+    return p1->priority > p2->priority;
+  return (p1 - im->policies) < (p2 - im->policies);
+}
+
+/*
+ * Inbound protect policy lookups. The policy found is the first match in
+ * SPD order, as a walk of the SPD's policy vector would find.
+ */
+always_inline ipsec_policy_t *
+ipsec_input_protect_policy_match (ipsec_spd_t * spd, u32 sa, u32 da, u32 spi)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p, *match = 0;
+  clib_bihash_kv_16_8_t kv;
+  u32 *i;
+
+  /* tunnel SA policies match exactly on {spi, src, dst} */
+  ipsec4_in_protect_mk_key (&kv, spd - im->spds, spi, sa, da);
+  if (!clib_bihash_search_inline_16_8 (&im->ipsec4_in_protect_hash, &kv))
+    match = pool_elt_at_index (im->policies, kv.value);
+
+  /* only range policies ahead of it in SPD order can override it */
+  vec_foreach (i, spd->range_policies[IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT])
+  {
+    p = pool_elt_at_index (im->policies, *i);
+
+    if (match && ipsec_policy_is_before (match, p))
+      break;
+
+    if (spi != pool_elt_at_index (im->sad, p->sa_index)->spi)
+      continue;
+
+    if (da < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
+      continue;
+
+    if (da > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
+      continue;
+
+    if (sa < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
+      continue;
+
+    if (sa > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
+      continue;
+
+    return p;
+  }
+  return match;
+}
+
+always_inline uword
+ip6_addr_match_range (ip6_address_t * a, ip6_address_t * la,
+		      ip6_address_t * ua)
+{
+  if ((memcmp (a->as_u64, la->as_u64, 2 * sizeof (u64)) >= 0) &&
+      (memcmp (a->as_u64, ua->as_u64, 2 * sizeof (u64)) <= 0))
+    return 1;
+  return 0;
+}
+
+always_inline ipsec_policy_t *
+ipsec6_input_protect_policy_match (ipsec_spd_t * spd,
+				   ip6_address_t * sa,
+				   ip6_address_t * da, u32 spi)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_policy_t *p, *match = 0;
+  clib_bihash_kv_40_8_t kv;
+  u32 *i;
+
+  /* tunnel SA policies match exactly on {spi, src, dst} */
+  ipsec6_in_protect_mk_key (&kv, spd - im->spds, spi, sa, da);
+  if (!clib_bihash_search_inline_40_8 (&im->ipsec6_in_protect_hash, &kv))
+    match = pool_elt_at_index (im->policies, kv.value);
+
+  /* only range policies ahead of it in SPD order can override it */
+  vec_foreach (i, spd->range_policies[IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT])
+  {
+    p = pool_elt_at_index (im->policies, *i);
+
+    if (match && ipsec_policy_is_before (match, p))
+      break;
+
+    if (spi != pool_elt_at_index (im->sad, p->sa_index)->spi)
+      continue;
+
+    if (!ip6_addr_match_range (sa, &p->raddr.start.ip6, &p->raddr.stop.ip6))
+      continue;
+
+    if (!ip6_addr_match_range (da, &p->laddr.start.ip6, &p->laddr.stop.ip6))
+      continue;
+
+    return p;
+  }
+  return match;
+}
+
 u32 ipsec_register_ah_backend (vlib_main_t * vm, ipsec_main_t * im,
 			       const char *name,
 			       const char *ah4_encrypt_node_name,
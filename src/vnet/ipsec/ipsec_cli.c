@@ -373,8 +373,9 @@ set_ipsec_sa_key_command_fn (vlib_main_t * vm,
 {
   unformat_input_t _line_input, *line_input = &_line_input;
   clib_error_t *error = NULL;
-  ipsec_key_t ck, ik;
-  u32 id;
+  ipsec_key_t ck = { 0 }, ik = { 0 };
+  u32 id, worker = ~0;
+  int rv;
 
   if (!unformat_user (input, unformat_line_input, line_input))
     return 0;
@@ -388,6 +389,8 @@ set_ipsec_sa_key_command_fn (vlib_main_t * vm,
 	;
       else if (unformat (line_input, "integ-key %U", unformat_ipsec_key, &ik))
 	;
+      else if (unformat (line_input, "worker %u", &worker))
+	;
       else
 	{
 	  error = clib_error_return (0, "parse error: '%U'",
@@ -396,7 +399,18 @@ set_ipsec_sa_key_command_fn (vlib_main_t * vm,
 	}
     }
 
-  ipsec_set_sa_key (id, &ck, &ik);
+  if (worker != ~0)
+    {
+      rv = ipsec_sa_set_worker (id, worker);
+      if (rv)
+	{
+	  error = clib_error_return (0, "set sa worker failed: %d", rv);
+	  goto done;
+	}
+    }
+
+  if (ck.len || ik.len)
+    ipsec_set_sa_key (id, &ck, &ik);
 
 done:
   unformat_free (line_input);
@@ -408,7 +422,7 @@ done:
 VLIB_CLI_COMMAND (set_ipsec_sa_key_command, static) = {
     .path = "set ipsec sa",
     .short_help =
-    "set ipsec sa <id> crypto-key <key> integ-key <key>",
+    "set ipsec sa <id> [crypto-key <key>] [integ-key <key>] [worker <n>]",
     .function = set_ipsec_sa_key_command_fn,
 };
 /* *INDENT-ON* */
@@ -615,6 +629,8 @@ clear_ipsec_counters_command_fn (vlib_main_t * vm,
 {
   vlib_clear_combined_counters (&ipsec_spd_policy_counters);
   vlib_clear_combined_counters (&ipsec_sa_counters);
+  vlib_clear_simple_counters (&ipsec_spd_flow_cache_hit_counters);
+  vlib_clear_simple_counters (&ipsec_spd_flow_cache_miss_counters);
 
   return (NULL);
 }
@@ -206,6 +206,10 @@ format_ipsec_spd (u8 * s, va_list * args)
   spd = pool_elt_at_index (im->spds, si);
 
   s = format (s, "spd %u", spd->id);
+  s = format (s, "\n flow-cache: hits %Ld misses %Ld",
+	      vlib_get_simple_counter (&ipsec_spd_flow_cache_hit_counters, si),
+	      vlib_get_simple_counter (&ipsec_spd_flow_cache_miss_counters,
+				       si));
 
 #define _(v, n)                                                 \
   s = format (s, "\n %s:", n);                                  \
@@ -262,6 +266,7 @@ format_ipsec_sa (u8 * s, va_list * args)
 	      sa->udp_encap ? " udp-encap-enabled" : "",
 	      sa->use_anti_replay ? " anti-replay" : "",
 	      sa->use_esn ? " extended-sequence-number" : "");
+  s = format (s, "\n   thread %u", sa->thread_index);
   s = format (s, "\n   seq %u seq-hi %u", sa->seq, sa->seq_hi);
   s = format (s, "\n   last-seq %u last-seq-hi %u window %U",
 	      sa->last_seq, sa->last_seq_hi,
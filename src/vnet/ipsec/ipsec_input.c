@@ -68,100 +68,6 @@ format_ipsec_input_trace (u8 * s, va_list * args)
   return s;
 }
 
-always_inline ipsec_policy_t *
-ipsec_input_protect_policy_match (ipsec_spd_t * spd, u32 sa, u32 da, u32 spi)
-{
-  ipsec_main_t *im = &ipsec_main;
-  ipsec_policy_t *p;
-  ipsec_sa_t *s;
-  u32 *i;
-
-  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT])
-  {
-    p = pool_elt_at_index (im->policies, *i);
-    s = pool_elt_at_index (im->sad, p->sa_index);
-
-    if (spi != s->spi)
-      continue;
-
-    if (s->is_tunnel)
-      {
-	if (da != clib_net_to_host_u32 (s->tunnel_dst_addr.ip4.as_u32))
-	  continue;
-
-	if (sa != clib_net_to_host_u32 (s->tunnel_src_addr.ip4.as_u32))
-	  continue;
-
-	return p;
-      }
-
-    if (da < clib_net_to_host_u32 (p->laddr.start.ip4.as_u32))
-      continue;
-
-    if (da > clib_net_to_host_u32 (p->laddr.stop.ip4.as_u32))
-      continue;
-
-    if (sa < clib_net_to_host_u32 (p->raddr.start.ip4.as_u32))
-      continue;
-
-    if (sa > clib_net_to_host_u32 (p->raddr.stop.ip4.as_u32))
-      continue;
-
-    return p;
-  }
-  return 0;
-}
-
-always_inline uword
-ip6_addr_match_range (ip6_address_t * a, ip6_address_t * la,
-		      ip6_address_t * ua)
-{
-  if ((memcmp (a->as_u64, la->as_u64, 2 * sizeof (u64)) >= 0) &&
-      (memcmp (a->as_u64, ua->as_u64, 2 * sizeof (u64)) <= 0))
-    return 1;
-  return 0;
-}
-
-always_inline ipsec_policy_t *
-ipsec6_input_protect_policy_match (ipsec_spd_t * spd,
-				   ip6_address_t * sa,
-				   ip6_address_t * da, u32 spi)
-{
-  ipsec_main_t *im = &ipsec_main;
-  ipsec_policy_t *p;
-  ipsec_sa_t *s;
-  u32 *i;
-
-  vec_foreach (i, spd->policies[IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT])
-  {
-    p = pool_elt_at_index (im->policies, *i);
-    s = pool_elt_at_index (im->sad, p->sa_index);
-
-    if (spi != s->spi)
-      continue;
-
-    if (s->is_tunnel)
-      {
-	if (!ip6_address_is_equal (sa, &s->tunnel_src_addr.ip6))
-	  continue;
-
-	if (!ip6_address_is_equal (da, &s->tunnel_dst_addr.ip6))
-	  continue;
-
-	return p;
-      }
-
-    if (!ip6_addr_match_range (sa, &p->raddr.start.ip6, &p->raddr.stop.ip6))
-      continue;
-
-    if (!ip6_addr_match_range (da, &p->laddr.start.ip6, &p->laddr.stop.ip6))
-      continue;
-
-    return p;
-  }
-  return 0;
-}
-
 static vlib_node_registration_t ipsec4_input_node;
 
 VLIB_NODE_FN (ipsec4_input_node) (vlib_main_t * vm,
@@ -116,16 +116,6 @@ ipsec_output_policy_match (ipsec_spd_t * spd, u8 pr, u32 la, u32 ra, u16 lp,
   return 0;
 }
 
-always_inline uword
-ip6_addr_match_range (ip6_address_t * a, ip6_address_t * la,
-		      ip6_address_t * ua)
-{
-  if ((memcmp (a->as_u64, la->as_u64, 2 * sizeof (u64)) >= 0) &&
-      (memcmp (a->as_u64, ua->as_u64, 2 * sizeof (u64)) <= 0))
-    return 1;
-  return 0;
-}
-
 always_inline ipsec_policy_t *
 ipsec6_output_policy_match (ipsec_spd_t * spd,
 			    ip6_address_t * la,
@@ -173,11 +163,185 @@ ipsec6_output_policy_match (ipsec_spd_t * spd,
   return 0;
 }
 
+/*
+ * Outbound SPD flow cache. The key is the 5-tuple as found in the packet
+ * plus the SPD index, the value the SPD generation in the upper 32 bits
+ * and the index of the matched policy (or ~0 when none matched) in the
+ * lower. Ports are only part of the key for the protocols the policies
+ * match ports on.
+ *
+ * A change to an SPD gives it a new generation, so the entries made
+ * before are treated as misses and overwritten in place rather than
+ * flushed. Entries of flows that stopped, or of SPDs that changed or went
+ * away, are only dropped when a new flow finds the table holding
+ * im->out_flow_cache_max_entries keys: the whole table is then freed and
+ * started afresh, so a full cache costs one round of misses rather than
+ * locking new flows out for good.
+ */
+always_inline u64
+ipsec_out_flow_key_tail (u32 spd_index, u8 pr, u16 lp, u16 rp)
+{
+  if ((pr != IP_PROTOCOL_TCP) && (pr != IP_PROTOCOL_UDP)
+      && (pr != IP_PROTOCOL_SCTP))
+    lp = rp = 0;
+
+  ASSERT (spd_index < (1 << 24));
+  return ((u64) lp << 48 | (u64) rp << 32 | (u64) pr << 24 | spd_index);
+}
+
+always_inline void
+ipsec_out_flow_cache_count (u32 thread_index, u32 spd_index,
+			    u32 n_lookups, u32 n_hits)
+{
+  vlib_increment_simple_counter (&ipsec_spd_flow_cache_hit_counters,
+				 thread_index, spd_index, n_hits);
+  vlib_increment_simple_counter (&ipsec_spd_flow_cache_miss_counters,
+				 thread_index, spd_index, n_lookups - n_hits);
+}
+
+always_inline u64
+ipsec_out_flow_value (ipsec_spd_t * spd, ipsec_policy_t * p)
+{
+  ipsec_main_t *im = &ipsec_main;
+
+  return ((u64) spd->gen << 32 | (p ? p - im->policies : (u32) ~ 0));
+}
+
+static void
+ipsec_out_flow_cache_init (ipsec_per_thread_data_t * ptd, int is_ipv6)
+{
+  if (is_ipv6)
+    clib_bihash_init_40_8 (&ptd->out_flow6, "ipsec6 spd flow cache",
+			   IPSEC6_OUT_FLOW_CACHE_NUM_BUCKETS,
+			   IPSEC6_OUT_FLOW_CACHE_MEMORY_SIZE);
+  else
+    clib_bihash_init_16_8 (&ptd->out_flow4, "ipsec4 spd flow cache",
+			   IPSEC4_OUT_FLOW_CACHE_NUM_BUCKETS,
+			   IPSEC4_OUT_FLOW_CACHE_MEMORY_SIZE);
+}
+
+static void
+ipsec_out_flow_cache_flush (ipsec_per_thread_data_t * ptd, int is_ipv6)
+{
+  /* the policies handed out are pool elements, nothing points in here */
+  if (is_ipv6)
+    {
+      clib_bihash_free_40_8 (&ptd->out_flow6);
+      ipsec_out_flow_cache_init (ptd, 1);
+      ptd->out_flow6_n_entries = 0;
+    }
+  else
+    {
+      clib_bihash_free_16_8 (&ptd->out_flow4);
+      ipsec_out_flow_cache_init (ptd, 0);
+      ptd->out_flow4_n_entries = 0;
+    }
+}
+
+always_inline void
+ipsec_out_flow_cache_validate (ipsec_per_thread_data_t * ptd, int is_ipv6)
+{
+  /* the tables are created with the thread's first outbound packet */
+  if (is_ipv6)
+    {
+      if (PREDICT_FALSE (ptd->out_flow6.nbuckets == 0))
+	ipsec_out_flow_cache_init (ptd, 1);
+    }
+  else
+    {
+      if (PREDICT_FALSE (ptd->out_flow4.nbuckets == 0))
+	ipsec_out_flow_cache_init (ptd, 0);
+    }
+}
+
+always_inline ipsec_policy_t *
+ipsec_output_policy_lookup (ipsec_per_thread_data_t * ptd,
+			    ipsec_spd_t * spd, u32 spd_index, u8 pr,
+			    u32 la, u32 ra, u16 lp, u16 rp, u32 * n_hits)
+{
+  ipsec_main_t *im = &ipsec_main;
+  clib_bihash_kv_16_8_t kv;
+  ipsec_policy_t *p;
+  int is_stale = 0;
+
+  kv.key[0] = (u64) la << 32 | ra;
+  kv.key[1] = ipsec_out_flow_key_tail (spd_index, pr, lp, rp);
+
+  if (!clib_bihash_search_inline_16_8 (&ptd->out_flow4, &kv))
+    {
+      if (PREDICT_TRUE ((kv.value >> 32) == spd->gen))
+	{
+	  *n_hits += 1;
+	  if ((u32) kv.value == ~0)
+	    return 0;
+	  return pool_elt_at_index (im->policies, (u32) kv.value);
+	}
+      /* made under an older generation of the SPD, replace it */
+      is_stale = 1;
+    }
+
+  p = ipsec_output_policy_match (spd, pr, la, ra, lp, rp);
+  kv.value = ipsec_out_flow_value (spd, p);
+  if (!is_stale)
+    {
+      if (PREDICT_FALSE (ptd->out_flow4_n_entries >=
+			 im->out_flow_cache_max_entries))
+	ipsec_out_flow_cache_flush (ptd, 0);
+      ptd->out_flow4_n_entries++;
+    }
+  clib_bihash_add_del_16_8 (&ptd->out_flow4, &kv, 1 /* is_add */ );
+  return p;
+}
+
+always_inline ipsec_policy_t *
+ipsec6_output_policy_lookup (ipsec_per_thread_data_t * ptd,
+			     ipsec_spd_t * spd, u32 spd_index,
+			     ip6_address_t * la, ip6_address_t * ra,
+			     u16 lp, u16 rp, u8 pr, u32 * n_hits)
+{
+  ipsec_main_t *im = &ipsec_main;
+  clib_bihash_kv_40_8_t kv;
+  ipsec_policy_t *p;
+  int is_stale = 0;
+
+  kv.key[0] = la->as_u64[0];
+  kv.key[1] = la->as_u64[1];
+  kv.key[2] = ra->as_u64[0];
+  kv.key[3] = ra->as_u64[1];
+  kv.key[4] = ipsec_out_flow_key_tail (spd_index, pr, lp, rp);
+
+  if (!clib_bihash_search_inline_40_8 (&ptd->out_flow6, &kv))
+    {
+      if (PREDICT_TRUE ((kv.value >> 32) == spd->gen))
+	{
+	  *n_hits += 1;
+	  if ((u32) kv.value == ~0)
+	    return 0;
+	  return pool_elt_at_index (im->policies, (u32) kv.value);
+	}
+      /* made under an older generation of the SPD, replace it */
+      is_stale = 1;
+    }
+
+  p = ipsec6_output_policy_match (spd, la, ra, lp, rp, pr);
+  kv.value = ipsec_out_flow_value (spd, p);
+  if (!is_stale)
+    {
+      if (PREDICT_FALSE (ptd->out_flow6_n_entries >=
+			 im->out_flow_cache_max_entries))
+	ipsec_out_flow_cache_flush (ptd, 1);
+      ptd->out_flow6_n_entries++;
+    }
+  clib_bihash_add_del_40_8 (&ptd->out_flow6, &kv, 1 /* is_add */ );
+  return p;
+}
+
 static inline uword
 ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 		     vlib_frame_t * from_frame, int is_ipv6)
 {
   ipsec_main_t *im = &ipsec_main;
+  ipsec_per_thread_data_t *ptd;
 
   u32 *from, *to_next = 0, thread_index;
   u32 n_left_from, sw_if_index0, last_sw_if_index = (u32) ~ 0;
@@ -187,10 +351,14 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
   ipsec_spd_t *spd0 = 0;
   int bogus;
   u64 nc_protect = 0, nc_bypass = 0, nc_discard = 0, nc_nomatch = 0;
+  u32 n_lookups = 0, n_hits = 0;
 
   from = vlib_frame_vector_args (from_frame);
   n_left_from = from_frame->n_vectors;
   thread_index = vm->thread_index;
+  ptd = vec_elt_at_index (im->ptd, thread_index);
+
+  ipsec_out_flow_cache_validate (ptd, is_ipv6);
 
   while (n_left_from > 0)
     {
@@ -216,6 +384,10 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	{
 	  uword *p = hash_get (im->spd_index_by_sw_if_index, sw_if_index0);
 	  ASSERT (p);
+	  if (n_lookups)
+	    ipsec_out_flow_cache_count (thread_index, spd_index0,
+					n_lookups, n_hits);
+	  n_lookups = n_hits = 0;
 	  spd_index0 = p[0];
 	  spd0 = pool_elt_at_index (im->spds, spd_index0);
 	  last_sw_if_index = sw_if_index0;
@@ -236,11 +408,12 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 	     spd0->id);
 #endif
 
-	  p0 = ipsec6_output_policy_match (spd0,
-					   &ip6_0->src_address,
-					   &ip6_0->dst_address,
-					   udp0->src_port,
-					   udp0->dst_port, ip6_0->protocol);
+	  p0 = ipsec6_output_policy_lookup (ptd, spd0, spd_index0,
+					    &ip6_0->src_address,
+					    &ip6_0->dst_address,
+					    udp0->src_port,
+					    udp0->dst_port, ip6_0->protocol,
+					    &n_hits);
 	}
       else
 	{
@@ -255,11 +428,14 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
 			sw_if_index0, spd_index0, spd0->id);
 #endif
 
-	  p0 = ipsec_output_policy_match (spd0, ip0->protocol,
-					  ip0->src_address.as_u32,
-					  ip0->dst_address.as_u32,
-					  udp0->src_port, udp0->dst_port);
+	  p0 = ipsec_output_policy_lookup (ptd, spd0, spd_index0,
+					   ip0->protocol,
+					   ip0->src_address.as_u32,
+					   ip0->dst_address.as_u32,
+					   udp0->src_port, udp0->dst_port,
+					   &n_hits);
 	}
+      n_lookups++;
       tcp0 = (void *) udp0;
 
       if (PREDICT_TRUE (p0 != NULL))
@@ -394,6 +570,8 @@ ipsec_output_inline (vlib_main_t * vm, vlib_node_runtime_t * node,
     }
 
   vlib_put_frame_to_node (vm, next_node_index, f);
+  if (n_lookups)
+    ipsec_out_flow_cache_count (thread_index, spd_index0, n_lookups, n_hits);
   vlib_node_increment_counter (vm, node->node_index,
 			       IPSEC_OUTPUT_ERROR_POLICY_PROTECT, nc_protect);
   vlib_node_increment_counter (vm, node->node_index,
@@ -108,6 +108,21 @@ ipsec_sa_set_integ_alg (ipsec_sa_t * sa, ipsec_integ_alg_t integ_alg)
   sa->integ_op_type = im->integ_algs[integ_alg].op_type;
 }
 
+/*
+ * Each SA is owned by one thread, which alone runs its sequence numbers
+ * and anti-replay window. New SAs are spread round robin over the workers.
+ */
+static u32
+ipsec_sa_pick_thread (ipsec_main_t * im)
+{
+  u32 n_workers = vlib_num_workers ();
+
+  if (n_workers == 0)
+    return 0;
+
+  return vlib_get_worker_thread_index (im->sa_next_worker++ % n_workers);
+}
+
 int
 ipsec_sa_add (u32 id,
 	      u32 spi,
@@ -143,6 +158,7 @@ ipsec_sa_add (u32 id,
   sa->spi = spi;
   sa->stat_index = sa_index;
   sa->protocol = proto;
+  sa->thread_index = ipsec_sa_pick_thread (im);
   ipsec_sa_set_crypto_alg (sa, crypto_alg);
   clib_memcpy (&sa->crypto_key, ck, sizeof (sa->crypto_key));
   ipsec_sa_set_integ_alg (sa, integ_alg);
@@ -315,6 +331,83 @@ ipsec_set_sa_key (u32 id, const ipsec_key_t * ck, const ipsec_key_t * ik)
   return 0;
 }
 
+/* how many milliseconds an owner change waits for the old owner */
+#define IPSEC_SA_SET_WORKER_DRAIN_TRIES 1000
+
+/* nothing for the thread is queued to the ESP nodes or their crypto */
+static int
+ipsec_sa_owner_is_drained (u32 thread_index)
+{
+  ipsec_main_t *im = &ipsec_main;
+  ipsec_per_thread_data_t *ptd;
+  int is_ip6;
+
+  if (!vlib_frame_queue_is_empty (im->esp4_encrypt_fq_index, thread_index) ||
+      !vlib_frame_queue_is_empty (im->esp6_encrypt_fq_index, thread_index) ||
+      !vlib_frame_queue_is_empty (im->esp4_decrypt_fq_index, thread_index) ||
+      !vlib_frame_queue_is_empty (im->esp6_decrypt_fq_index, thread_index))
+    return 0;
+
+  ptd = vec_elt_at_index (im->ptd, thread_index);
+  for (is_ip6 = 0; is_ip6 < 2; is_ip6++)
+    if (ptd->esp_encrypt_ring[is_ip6].head !=
+	ptd->esp_encrypt_ring[is_ip6].tail ||
+	ptd->esp_decrypt_ring[is_ip6].head !=
+	ptd->esp_decrypt_ring[is_ip6].tail)
+      return 0;
+
+  return 1;
+}
+
+/*
+ * Moving an SA while its packets are queued to the old owner would let
+ * the new owner process later packets first; the old ones would follow
+ * out of order, as false replays on decrypt. So the owner is only
+ * changed with the workers held at the barrier, which also finishes the
+ * packets in their graphs, and with nothing left queued to the old owner.
+ */
+int
+ipsec_sa_set_worker (u32 id, u32 worker_index)
+{
+  ipsec_main_t *im = &ipsec_main;
+  vlib_main_t *vm = vlib_get_main ();
+  ipsec_sa_t *sa;
+  u32 old, tries;
+  uword *p;
+
+  p = hash_get (im->sa_index_by_sa_id, id);
+  if (!p)
+    return VNET_API_ERROR_NO_SUCH_ENTRY;
+
+  if (worker_index >= vlib_num_workers ())
+    return VNET_API_ERROR_INVALID_WORKER;
+
+  sa = pool_elt_at_index (im->sad, p[0]);
+  old = sa->thread_index;
+
+  for (tries = 0;; tries++)
+    {
+      vlib_worker_thread_barrier_sync (vm);
+      if (ipsec_sa_owner_is_drained (old))
+	break;
+      vlib_worker_thread_barrier_release (vm);
+
+      if (tries == IPSEC_SA_SET_WORKER_DRAIN_TRIES)
+	return VNET_API_ERROR_QUEUE_FULL;
+
+      /* let the old owner work its queues down */
+      if (vlib_in_process_context (vm))
+	vlib_process_suspend (vm, 1e-3);
+      else
+	vlib_time_wait (vm, 1e-3);
+    }
+
+  sa->thread_index = vlib_get_worker_thread_index (worker_index);
+  vlib_worker_thread_barrier_release (vm);
+
+  return 0;
+}
+
 u32
 ipsec_get_sa_index_by_sa_id (u32 sa_id)
 {
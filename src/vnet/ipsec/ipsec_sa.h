@@ -132,6 +132,9 @@ typedef struct
   u32 tx_fib_index;
   u32 salt;
 
+  /* the thread that owns the runtime state below */
+  u32 thread_index;
+
   /* runtime */
   u32 seq;
   u32 seq_hi;
@@ -171,6 +174,7 @@ extern u8 ipsec_is_sa_used (u32 sa_index);
 extern int ipsec_set_sa_key (u32 id,
 			     const ipsec_key_t * ck, const ipsec_key_t * ik);
 extern u32 ipsec_get_sa_index_by_sa_id (u32 sa_id);
+extern int ipsec_sa_set_worker (u32 id, u32 worker_index);
 
 typedef walk_rc_t (*ipsec_sa_walk_cb_t) (ipsec_sa_t * sa, void *ctx);
 extern void ipsec_sa_walk (ipsec_sa_walk_cb_t cd, void *ctx);
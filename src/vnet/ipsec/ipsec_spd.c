@@ -16,13 +16,68 @@
 #include <vnet/ipsec/ipsec.h>
 #include <vnet/ipsec/ipsec_io.h>
 
+/**
+ * @brief
+ * Outbound flow cache counters
+ */
+vlib_simple_counter_main_t ipsec_spd_flow_cache_hit_counters = {
+  .name = "spd-flow-cache-hits",
+  .stat_segment_name = "/net/ipsec/spd/flow-cache/hits",
+};
+
+vlib_simple_counter_main_t ipsec_spd_flow_cache_miss_counters = {
+  .name = "spd-flow-cache-misses",
+  .stat_segment_name = "/net/ipsec/spd/flow-cache/misses",
+};
+
+/*
+ * Remove the SPD's inbound protect hash entries; with the policy vector
+ * emptied the index update for each SA finds no policy left to add.
+ * The policies themselves are freed afterwards.
+ */
+static void
+ipsec_spd_in_protect_index_flush (ipsec_spd_t * spd,
+				  ipsec_spd_policy_type_t type)
+{
+  ipsec_main_t *im = &ipsec_main;
+  u32 *policies, *i;
+
+  policies = spd->policies[type];
+  spd->policies[type] = 0;
+
+  vec_foreach (i, policies)
+    ipsec_spd_in_protect_index_update (spd, type,
+				       pool_elt_at_index (im->policies,
+							  *i)->sa_index);
+  vec_foreach (i, policies) pool_put_index (im->policies, *i);
+  vec_free (policies);
+}
+
+/* the inbound protect hashes are only needed once there is an SPD */
+static void
+ipsec_spd_in_protect_hash_init (ipsec_main_t * im)
+{
+  if (im->in_protect_hash_initialized)
+    return;
+
+  clib_bihash_init_16_8 (&im->ipsec4_in_protect_hash,
+			 "ipsec4 inbound protect",
+			 im->in_protect_hash_num_buckets,
+			 im->in_protect_hash_memory_size);
+  clib_bihash_init_40_8 (&im->ipsec6_in_protect_hash,
+			 "ipsec6 inbound protect",
+			 im->in_protect_hash_num_buckets,
+			 im->in_protect_hash_memory_size);
+  im->in_protect_hash_initialized = 1;
+}
+
 int
 ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
 {
   ipsec_main_t *im = &ipsec_main;
   ipsec_spd_t *spd = 0;
   uword *p;
-  u32 spd_index, k, v;
+  u32 spd_index, k, v, *pi;
 
   p = hash_get (im->spd_index_by_spd_id, spd_id);
   if (p && is_add)
@@ -43,18 +98,38 @@ ipsec_add_del_spd (vlib_main_t * vm, u32 spd_id, int is_add)
       }));
       /* *INDENT-ON* */
       hash_unset (im->spd_index_by_spd_id, spd_id);
-#define _(s,v) vec_free(spd->policies[IPSEC_SPD_POLICY_##s]);
+      ipsec_spd_in_protect_index_flush (spd,
+					IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT);
+      ipsec_spd_in_protect_index_flush (spd,
+					IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT);
+      /* the policies go with the SPD, so their SAs can be deleted */
+#define _(s,v) vec_foreach (pi, spd->policies[IPSEC_SPD_POLICY_##s]) \
+	pool_put_index (im->policies, *pi); \
+      vec_free(spd->policies[IPSEC_SPD_POLICY_##s]); \
+      vec_free(spd->range_policies[IPSEC_SPD_POLICY_##s]);
       foreach_ipsec_spd_policy_type
 #undef _
 	pool_put (im->spds, spd);
     }
   else				/* create new SPD */
     {
+      ipsec_spd_in_protect_hash_init (im);
       pool_get (im->spds, spd);
       clib_memset (spd, 0, sizeof (*spd));
       spd_index = spd - im->spds;
       spd->id = spd_id;
+      /* the index may be reused, a fresh generation hides its old flows */
+      spd->gen = ++im->spd_gen;
       hash_set (im->spd_index_by_spd_id, spd_id, spd_index);
+
+      vlib_validate_simple_counter (&ipsec_spd_flow_cache_hit_counters,
+				    spd_index);
+      vlib_zero_simple_counter (&ipsec_spd_flow_cache_hit_counters,
+				spd_index);
+      vlib_validate_simple_counter (&ipsec_spd_flow_cache_miss_counters,
+				    spd_index);
+      vlib_zero_simple_counter (&ipsec_spd_flow_cache_miss_counters,
+				spd_index);
     }
   return 0;
 }
@@ -47,6 +47,12 @@ typedef struct
   u32 id;
   /** vectors for each of the policy types */
   u32 *policies[IPSEC_SPD_POLICY_N_TYPES];
+  /** inbound protect policies whose SA is not a tunnel, in priority
+      order. Tunnel SA policies are found in the inbound protect hash */
+  u32 *range_policies[IPSEC_SPD_POLICY_N_TYPES];
+  /** generation of the policies, flow cache entries made under an
+      older one are ignored */
+  u32 gen;
 } ipsec_spd_t;
 
 /**
@@ -62,6 +68,12 @@ extern int ipsec_set_interface_spd (vlib_main_t * vm,
 
 extern u8 *format_ipsec_spd (u8 * s, va_list * args);
 
+/**
+ * @brief Outbound flow cache hit and miss counters, per-SPD
+ */
+extern vlib_simple_counter_main_t ipsec_spd_flow_cache_hit_counters;
+extern vlib_simple_counter_main_t ipsec_spd_flow_cache_miss_counters;
+
 #endif /* __IPSEC_SPD_H__ */
 
 /*
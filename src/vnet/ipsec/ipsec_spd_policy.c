@@ -90,10 +90,11 @@ ipsec_spd_entry_sort (void *a1, void *a2)
 
   p1 = pool_elt_at_index (im->policies, *id1);
   p2 = pool_elt_at_index (im->policies, *id2);
-  if (p1 && p2)
+  if (p1 && p2 && p1->priority != p2->priority)
     return p2->priority - p1->priority;
 
-  return 0;
+  /* equal priorities keep a stable order for the inbound protect index */
+  return (*id1 > *id2) - (*id1 < *id2);
 }
 
 int
@@ -132,6 +133,82 @@ ipsec_policy_mk_type (bool is_outbound,
   return (-1);
 }
 
+static int
+ipsec_policy_is_in_protect (ipsec_spd_policy_type_t type)
+{
+  return (type == IPSEC_SPD_POLICY_IP4_INBOUND_PROTECT ||
+	  type == IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT);
+}
+
+/*
+ * Inbound protect policies of tunnel SAs match exactly on the SPI and the
+ * tunnel addresses; the highest priority one for each {spi, src, dst} is
+ * kept in a hash. The others match on address ranges and are kept, in
+ * priority order, on the SPD's range vector.
+ */
+void
+ipsec_spd_in_protect_index_update (ipsec_spd_t * spd,
+				   ipsec_spd_policy_type_t type, u32 sa_index)
+{
+  ipsec_main_t *im = &ipsec_main;
+  u32 spd_index = spd - im->spds;
+  ipsec_sa_t *sa, *s;
+  ipsec_policy_t *p;
+  int is_ip6, is_add;
+  u32 *i;
+
+  is_ip6 = (type == IPSEC_SPD_POLICY_IP6_INBOUND_PROTECT);
+  sa = pool_elt_at_index (im->sad, sa_index);
+
+  if (!sa->is_tunnel)
+    {
+      vec_reset_length (spd->range_policies[type]);
+      vec_foreach (i, spd->policies[type])
+      {
+	p = pool_elt_at_index (im->policies, *i);
+	s = pool_elt_at_index (im->sad, p->sa_index);
+	if (!s->is_tunnel)
+	  vec_add1 (spd->range_policies[type], *i);
+      }
+      return;
+    }
+
+  /* the policies are sorted, the first one using an equivalent SA wins */
+  vec_foreach (i, spd->policies[type])
+  {
+    p = pool_elt_at_index (im->policies, *i);
+    s = pool_elt_at_index (im->sad, p->sa_index);
+    if (s->is_tunnel && s->spi == sa->spi &&
+	ip46_address_is_equal (&s->tunnel_src_addr, &sa->tunnel_src_addr) &&
+	ip46_address_is_equal (&s->tunnel_dst_addr, &sa->tunnel_dst_addr))
+      break;
+  }
+  is_add = (i < vec_end (spd->policies[type]));
+
+  if (is_ip6)
+    {
+      clib_bihash_kv_40_8_t kv;
+
+      ipsec6_in_protect_mk_key (&kv, spd_index, sa->spi,
+				&sa->tunnel_src_addr.ip6,
+				&sa->tunnel_dst_addr.ip6);
+      kv.value = is_add ? *i : ~0;
+      clib_bihash_add_del_40_8 (&im->ipsec6_in_protect_hash, &kv, is_add);
+    }
+  else
+    {
+      clib_bihash_kv_16_8_t kv;
+
+      ipsec4_in_protect_mk_key (&kv, spd_index, sa->spi,
+				clib_net_to_host_u32 (sa->tunnel_src_addr.
+						      ip4.as_u32),
+				clib_net_to_host_u32 (sa->tunnel_dst_addr.
+						      ip4.as_u32));
+      kv.value = is_add ? *i : ~0;
+      clib_bihash_add_del_16_8 (&im->ipsec4_in_protect_hash, &kv, is_add);
+    }
+}
+
 int
 ipsec_add_del_policy (vlib_main_t * vm,
 		      ipsec_policy_t * policy, int is_add, u32 * stat_index)
@@ -178,6 +255,9 @@ ipsec_add_del_policy (vlib_main_t * vm,
       vec_add1 (spd->policies[policy->type], policy_index);
       vec_sort_with_function (spd->policies[policy->type],
 			      ipsec_spd_entry_sort);
+      if (ipsec_policy_is_in_protect (policy->type))
+	ipsec_spd_in_protect_index_update (spd, policy->type,
+					   policy->sa_index);
       *stat_index = policy_index;
     }
   else
@@ -192,7 +272,10 @@ ipsec_add_del_policy (vlib_main_t * vm,
 	  vp = pool_elt_at_index (im->policies, spd->policies[ptype][ii]);
 	  if (ipsec_policy_is_equal (vp, policy))
 	    {
-	      vec_del1 (spd->policies[ptype], ii);
+	      /* keep the vector in priority order */
+	      vec_delete (spd->policies[ptype], 1, ii);
+	      if (ipsec_policy_is_in_protect (ptype))
+		ipsec_spd_in_protect_index_update (spd, ptype, vp->sa_index);
 	      pool_put (im->policies, vp);
 	      goto done;
 	    }
@@ -201,6 +284,8 @@ ipsec_add_del_policy (vlib_main_t * vm,
     done:;
     }
 
+  spd->gen = ++im->spd_gen;
+
   return 0;
 }
 
@@ -16,6 +16,8 @@
 #define __IPSEC_SPD_POLICY_H__
 
 #include <vnet/ipsec/ipsec_spd.h>
+#include <vppinfra/bihash_16_8.h>
+#include <vppinfra/bihash_40_8.h>
 
 #define foreach_ipsec_policy_action \
   _ (0, BYPASS, "bypass")           \
@@ -92,6 +94,40 @@ extern int ipsec_policy_mk_type (bool is_outbound,
 				 ipsec_policy_action_t action,
 				 ipsec_spd_policy_type_t * type);
 
+/**
+ * @brief Refresh the inbound protect policy index for an SA
+ *
+ * Called when a policy using the SA is added to or removed from the
+ * SPD's policy vector of the given (inbound protect) type.
+ */
+extern void ipsec_spd_in_protect_index_update (ipsec_spd_t * spd,
+					       ipsec_spd_policy_type_t type,
+					       u32 sa_index);
+
+/**
+ * Inbound protect hash keys. The SPD index and SPI share the first word,
+ * the IPv4 addresses are in host byte order.
+ */
+static_always_inline void
+ipsec4_in_protect_mk_key (clib_bihash_kv_16_8_t * kv, u32 spd_index,
+			  u32 spi, u32 sa, u32 da)
+{
+  kv->key[0] = (u64) spd_index << 32 | spi;
+  kv->key[1] = (u64) sa << 32 | da;
+}
+
+static_always_inline void
+ipsec6_in_protect_mk_key (clib_bihash_kv_40_8_t * kv, u32 spd_index,
+			  u32 spi, const ip6_address_t * sa,
+			  const ip6_address_t * da)
+{
+  kv->key[0] = (u64) spd_index << 32 | spi;
+  kv->key[1] = sa->as_u64[0];
+  kv->key[2] = sa->as_u64[1];
+  kv->key[3] = da->as_u64[0];
+  kv->key[4] = da->as_u64[1];
+}
+
 #endif /* __IPSEC_SPD_POLICY_H__ */
 
 /*
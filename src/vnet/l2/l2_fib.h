@@ -391,30 +391,32 @@ l2fib_lookup_4 (BVT (clib_bihash) * mac_table,
     }
   else
     {
-      BVT (clib_bihash_kv) kv0, kv1, kv2, kv3;
+      BVT (clib_bihash_kv) kv[4];
+      u64 hash[4];
+      u8 found[4];
+      int i;
 
       /*
        * Do a regular mac table lookup
-       * Interleave lookups for packet 0 and packet 1
+       * The four lookups' bucket and page fetches are overlapped
        */
-      kv0.key = key0->raw;
-      kv1.key = key1->raw;
-      kv2.key = key2->raw;
-      kv3.key = key3->raw;
-      kv0.value = ~0ULL;
-      kv1.value = ~0ULL;
-      kv2.value = ~0ULL;
-      kv3.value = ~0ULL;
-
-      BV (clib_bihash_search_inline) (mac_table, &kv0);
-      BV (clib_bihash_search_inline) (mac_table, &kv1);
-      BV (clib_bihash_search_inline) (mac_table, &kv2);
-      BV (clib_bihash_search_inline) (mac_table, &kv3);
-
-      result0->raw = kv0.value;
-      result1->raw = kv1.value;
-      result2->raw = kv2.value;
-      result3->raw = kv3.value;
+      kv[0].key = key0->raw;
+      kv[1].key = key1->raw;
+      kv[2].key = key2->raw;
+      kv[3].key = key3->raw;
+
+      for (i = 0; i < 4; i++)
+	{
+	  kv[i].value = ~0ULL;
+	  hash[i] = BV (clib_bihash_hash) (&kv[i]);
+	}
+
+      BV (clib_bihash_search_batch) (mac_table, kv, hash, found, 4);
+
+      result0->raw = kv[0].value;
+      result1->raw = kv[1].value;
+      result2->raw = kv[2].value;
+      result3->raw = kv[3].value;
 
       /* Update one-entry cache */
       cached_key->raw = key1->raw;
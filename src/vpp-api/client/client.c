@@ -314,6 +314,13 @@ vac_msg_table_size(void)
   return hash_elts(am->msg_index_by_name_and_crc);
 }
 
+/* Requests from the connecting thread go on their own ring, if sized */
+void
+vac_set_request_ring_size (int request_ring_size)
+{
+  vl_client_set_request_ring_size(request_ring_size);
+}
+
 int
 vac_connect (char * name, char * chroot_prefix, vac_callback_t cb,
                int rx_qlen)
@@ -36,7 +36,6 @@ struct stat_client_main_t
 {
   uint64_t current_epoch;
   stat_segment_shared_header_t *shared_header;
-  stat_segment_directory_entry_t *directory_vector;
   ssize_t memory_size;
 };
 
@@ -104,6 +103,23 @@ get_stat_vector (void)
   return get_stat_vector_r (sm);
 }
 
+/*
+ * The writer frees vectors it replaced STAT_SEGMENT_RECLAIM_DELAY seconds
+ * after, with reclaim_gen odd while it does. A copy is only good if the
+ * generation was even before it and unchanged after it.
+ */
+static inline uint64_t
+stat_segment_reclaim_gen (stat_client_main_t * sm)
+{
+  return sm->shared_header->reclaim_gen;
+}
+
+static inline int
+stat_segment_reclaim_gen_valid (stat_client_main_t * sm, uint64_t gen)
+{
+  return (gen & 1) == 0 && sm->shared_header->reclaim_gen == gen;
+}
+
 int
 stat_segment_connect_r (const char *socket_name, stat_client_main_t * sm)
 {
@@ -156,8 +172,6 @@ stat_segment_connect_r (const char *socket_name, stat_client_main_t * sm)
   close (mfd);
   sm->memory_size = st.st_size;
   sm->shared_header = memaddr;
-  sm->directory_vector =
-    stat_segment_pointer (memaddr, sm->shared_header->directory_offset);
 
   return 0;
 }
@@ -198,6 +212,16 @@ stat_segment_heartbeat (void)
   return stat_segment_heartbeat_r (sm);
 }
 
+/*
+ * The writer publishes the offset vector before the vector it describes,
+ * and may grow either in place, so never walk past the shorter one.
+ */
+#define vec_set_len_bounded(v, offset_vector)				\
+do {									\
+  if (vec_len (v) > vec_len (offset_vector))				\
+    _vec_len (v) = vec_len (offset_vector);				\
+} while (0)
+
 stat_segment_data_t
 copy_data (stat_segment_directory_entry_t * ep, stat_client_main_t * sm)
 {
@@ -225,7 +249,8 @@ copy_data (stat_segment_directory_entry_t * ep, stat_client_main_t * sm)
       result.simple_counter_vec = vec_dup (simple_c);
       offset_vector =
 	stat_segment_pointer (sm->shared_header, ep->offset_vector);
-      for (i = 0; i < vec_len (simple_c); i++)
+      vec_set_len_bounded (result.simple_counter_vec, offset_vector);
+      for (i = 0; i < vec_len (result.simple_counter_vec); i++)
 	{
 	  counter_t *cb =
 	    stat_segment_pointer (sm->shared_header, offset_vector[i]);
@@ -240,7 +265,8 @@ copy_data (stat_segment_directory_entry_t * ep, stat_client_main_t * sm)
       result.combined_counter_vec = vec_dup (combined_c);
       offset_vector =
 	stat_segment_pointer (sm->shared_header, ep->offset_vector);
-      for (i = 0; i < vec_len (combined_c); i++)
+      vec_set_len_bounded (result.combined_counter_vec, offset_vector);
+      for (i = 0; i < vec_len (result.combined_counter_vec); i++)
 	{
 	  vlib_counter_t *cb =
 	    stat_segment_pointer (sm->shared_header, offset_vector[i]);
@@ -252,7 +278,8 @@ copy_data (stat_segment_directory_entry_t * ep, stat_client_main_t * sm)
       error_base =
 	stat_segment_pointer (sm->shared_header,
 			      sm->shared_header->error_offset);
-      result.error_value = error_base[ep->index];
+      if (ep->index < vec_len (error_base))
+	result.error_value = error_base[ep->index];
       break;
 
     case STAT_DIR_TYPE_NAME_VECTOR:
@@ -263,7 +290,8 @@ copy_data (stat_segment_directory_entry_t * ep, stat_client_main_t * sm)
       result.name_vector = vec_dup (name_vector);
       offset_vector =
 	stat_segment_pointer (sm->shared_header, ep->offset_vector);
-      for (i = 0; i < vec_len (name_vector); i++)
+      vec_set_len_bounded (result.name_vector, offset_vector);
+      for (i = 0; i < vec_len (result.name_vector); i++)
 	{
 	  if (offset_vector[i])
 	    {
@@ -308,37 +336,18 @@ stat_segment_data_free (stat_segment_data_t * res)
   vec_free (res);
 }
 
-
-typedef struct
-{
-  uint64_t epoch;
-} stat_segment_access_t;
-
-static void
-stat_segment_access_start (stat_segment_access_t * sa,
-			   stat_client_main_t * sm)
-{
-  stat_segment_shared_header_t *shared_header = sm->shared_header;
-  sa->epoch = shared_header->epoch;
-  while (shared_header->in_progress != 0)
-    ;
-}
-
-static bool
-stat_segment_access_end (stat_segment_access_t * sa, stat_client_main_t * sm)
-{
-  stat_segment_shared_header_t *shared_header = sm->shared_header;
-
-  if (shared_header->epoch != sa->epoch || shared_header->in_progress)
-    return false;
-  return true;
-}
+/*
+ * Readers never wait for the writer: the directory is append-only, and
+ * vectors the writer replaces stay allocated for
+ * STAT_SEGMENT_RECLAIM_DELAY seconds. A reader slower than that sees the
+ * reclaim generation change and copies again. epoch is the directory
+ * version, it only changes when entries are added.
+ */
 
 uint32_t *
 stat_segment_ls_r (uint8_t ** patterns, stat_client_main_t * sm)
 {
-  stat_segment_access_t sa;
-
+  uint64_t epoch, gen;
   uint32_t *dir = 0;
   regex_t regex[vec_len (patterns)];
 
@@ -353,37 +362,34 @@ stat_segment_ls_r (uint8_t ** patterns, stat_client_main_t * sm)
 	}
     }
 
-  stat_segment_access_start (&sa, sm);
-
-  stat_segment_directory_entry_t *counter_vec = get_stat_vector_r (sm);
-  for (j = 0; j < vec_len (counter_vec); j++)
+  do
     {
-      for (i = 0; i < vec_len (patterns); i++)
+      gen = stat_segment_reclaim_gen (sm);
+      epoch = sm->shared_header->epoch;
+      vec_reset_length (dir);
+      stat_segment_directory_entry_t *counter_vec = get_stat_vector_r (sm);
+      for (j = 0; j < vec_len (counter_vec); j++)
 	{
-	  int rv = regexec (&regex[i], counter_vec[j].name, 0, NULL, 0);
-	  if (rv == 0)
+	  for (i = 0; i < vec_len (patterns); i++)
 	    {
-	      vec_add1 (dir, j);
-	      break;
+	      int rv = regexec (&regex[i], counter_vec[j].name, 0, NULL, 0);
+	      if (rv == 0)
+		{
+		  vec_add1 (dir, j);
+		  break;
+		}
 	    }
+	  if (vec_len (patterns) == 0)
+	    vec_add1 (dir, j);
 	}
-      if (vec_len (patterns) == 0)
-	vec_add1 (dir, j);
     }
+  while (!stat_segment_reclaim_gen_valid (sm, gen));
 
   for (i = 0; i < vec_len (patterns); i++)
     regfree (&regex[i]);
 
-  if (!stat_segment_access_end (&sa, sm))
-    {
-      /* Failed, clean up */
-      vec_free (dir);
-      return 0;
-
-    }
-
   /* Update last version */
-  sm->current_epoch = sa.epoch;
+  sm->current_epoch = epoch;
   return dir;
 }
 
@@ -397,29 +403,33 @@ stat_segment_ls (uint8_t ** patterns)
 stat_segment_data_t *
 stat_segment_dump_r (uint32_t * stats, stat_client_main_t * sm)
 {
+  uint64_t gen;
   int i;
-  stat_segment_directory_entry_t *ep;
+  stat_segment_directory_entry_t *counter_vec, *ep;
   stat_segment_data_t *res = 0;
-  stat_segment_access_t sa;
 
-  /* Has directory been update? */
+  /* Have entries been added since ls? Caller lists again */
   if (sm->shared_header->epoch != sm->current_epoch)
     return 0;
 
-  stat_segment_access_start (&sa, sm);
-  for (i = 0; i < vec_len (stats); i++)
+  do
     {
-      /* Collect counter */
-      ep = vec_elt_at_index (sm->directory_vector, stats[i]);
-      vec_add1 (res, copy_data (ep, sm));
+      gen = stat_segment_reclaim_gen (sm);
+      stat_segment_data_free (res);
+      res = 0;
+      counter_vec = get_stat_vector_r (sm);
+      for (i = 0; i < vec_len (stats); i++)
+	{
+	  if (stats[i] >= vec_len (counter_vec))
+	    continue;
+	  /* Collect counter */
+	  ep = vec_elt_at_index (counter_vec, stats[i]);
+	  vec_add1 (res, copy_data (ep, sm));
+	}
     }
+  while (!stat_segment_reclaim_gen_valid (sm, gen));
 
-  if (stat_segment_access_end (&sa, sm))
-    return res;
-
-  fprintf (stderr, "Epoch changed while reading, invalid results\n");
-  // TODO increase counter
-  return 0;
+  return res;
 }
 
 stat_segment_data_t *
@@ -457,19 +467,26 @@ stat_segment_string_vector (uint8_t ** string_vector, const char *string)
 stat_segment_data_t *
 stat_segment_dump_entry_r (uint32_t index, stat_client_main_t * sm)
 {
-  stat_segment_directory_entry_t *ep;
+  stat_segment_directory_entry_t *counter_vec, *ep;
   stat_segment_data_t *res = 0;
-  stat_segment_access_t sa;
+  uint64_t gen;
 
-  stat_segment_access_start (&sa, sm);
+  do
+    {
+      gen = stat_segment_reclaim_gen (sm);
+      stat_segment_data_free (res);
+      res = 0;
+      counter_vec = get_stat_vector_r (sm);
+      if (index >= vec_len (counter_vec))
+	return 0;
 
-  /* Collect counter */
-  ep = vec_elt_at_index (sm->directory_vector, index);
-  vec_add1 (res, copy_data (ep, sm));
+      /* Collect counter */
+      ep = vec_elt_at_index (counter_vec, index);
+      vec_add1 (res, copy_data (ep, sm));
+    }
+  while (!stat_segment_reclaim_gen_valid (sm, gen));
 
-  if (stat_segment_access_end (&sa, sm))
-    return res;
-  return 0;
+  return res;
 }
 
 stat_segment_data_t *
@@ -479,6 +496,307 @@ stat_segment_dump_entry (uint32_t index)
   return stat_segment_dump_entry_r (index, sm);
 }
 
+/*
+ * Delta dumps. Per-thread vectors, errors and scalars are compared
+ * against the shadow. For the collector's summary entries the change
+ * bitmap it publishes is used instead, when exactly one collector pass
+ * has completed since the previous delta dump; when no pass has, they
+ * are skipped. Each entry is copied out before it is compared, so that
+ * nothing is reported from a vector freed while it was being read.
+ */
+typedef struct
+{
+  uint64_t **threads;		/* last reported values, by thread */
+  uint64_t seq;			/* aggregate_seq the values match */
+} stat_segment_shadow_t;
+
+struct stat_segment_delta_t
+{
+  stat_segment_shadow_t *shadow;	/* by directory index */
+  uint64_t **copy;		/* entry being compared, by thread */
+  uint64_t *changed;		/* and its change bitmap */
+};
+
+stat_segment_delta_t *
+stat_segment_delta_create (void)
+{
+  stat_segment_delta_t *d;
+  d = (stat_segment_delta_t *) malloc (sizeof (stat_segment_delta_t));
+  clib_memset (d, 0, sizeof (stat_segment_delta_t));
+  return d;
+}
+
+void
+stat_segment_delta_free (stat_segment_delta_t * d)
+{
+  int i, j;
+  for (i = 0; i < vec_len (d->shadow); i++)
+    {
+      for (j = 0; j < vec_len (d->shadow[i].threads); j++)
+	vec_free (d->shadow[i].threads[j]);
+      vec_free (d->shadow[i].threads);
+    }
+  vec_free (d->shadow);
+  for (i = 0; i < vec_len (d->copy); i++)
+    vec_free (d->copy[i]);
+  vec_free (d->copy);
+  vec_free (d->changed);
+  free (d);
+}
+
+static_always_inline int
+delta_report (stat_segment_delta_value_t * v, uint32_t index,
+	      uint64_t * now, uint64_t * last, uint32_t n_words,
+	      stat_segment_delta_fn_t fn, void *ctx)
+{
+  clib_memcpy (last, now, n_words * sizeof (now[0]));
+  if (n_words == 1)
+    v->simple_value = now[0];
+  else
+    {
+      v->combined_value.packets = now[0];
+      v->combined_value.bytes = now[1];
+    }
+  v->index = index;
+  fn (v, ctx);
+  return 1;
+}
+
+static int
+delta_vector (stat_segment_delta_value_t * v, uint64_t ** shadowp,
+	      uint64_t * c, uint32_t n, uint32_t n_words, int use_changed,
+	      uint64_t * changed, stat_segment_delta_fn_t fn, void *ctx)
+{
+  uint64_t *shadow = *shadowp, bits;
+  uint32_t i, w, n_old = vec_len (shadow) / n_words;
+  int n_reported = 0;
+
+  if (n_old < n)
+    {
+      vec_validate (shadow, n * n_words - 1);
+      *shadowp = shadow;
+    }
+  else if (use_changed)
+    {
+      /* Only what the collector flagged */
+      for (w = 0; w < vec_len (changed); w++)
+	{
+	  bits = changed[w];
+	  while (bits)
+	    {
+	      i = w * 64 + count_trailing_zeros (bits);
+	      bits &= bits - 1;
+	      if (i < n)
+		n_reported += delta_report (v, i, c + i * n_words,
+					    shadow + i * n_words, n_words,
+					    fn, ctx);
+	    }
+	}
+      return n_reported;
+    }
+
+  /* New elements are always reported */
+  for (i = 0; i < n; i++)
+    if (i >= n_old || memcmp (c + i * n_words, shadow + i * n_words,
+			      n_words * sizeof (c[0])))
+      n_reported += delta_report (v, i, c + i * n_words,
+				  shadow + i * n_words, n_words, fn, ctx);
+  return n_reported;
+}
+
+static int
+delta_word (stat_segment_delta_value_t * v, stat_segment_shadow_t * s,
+	    uint64_t value, stat_segment_delta_fn_t fn, void *ctx)
+{
+  vec_validate (s->threads, 0);
+  if (vec_len (s->threads[0]) && s->threads[0][0] == value)
+    return 0;
+  vec_validate (s->threads[0], 0);
+  s->threads[0][0] = value;
+  v->index = 0;
+  fn (v, ctx);
+  return 1;
+}
+
+/*
+ * Copy directory entry index to e, an error's value to e->value, and a
+ * counter vector's threads to d->copy. The change bitmap of a summary is
+ * copied to d->changed when want_changed is set. Returns the number of
+ * threads copied, or -1 if there is nothing to compare.
+ */
+static int
+delta_copy_entry (stat_client_main_t * sm, uint32_t index,
+		  stat_segment_delta_t * d,
+		  stat_segment_directory_entry_t * e, int want_changed,
+		  int *is_aggregate)
+{
+  stat_segment_directory_entry_t *counter_vec;
+  uint64_t **threads, *offset_vector, *error_base, *c, gen;
+  int t, n_threads, n_words;
+  size_t prefix_len = strlen (STAT_SEGMENT_AGGREGATE_PREFIX);
+
+  do
+    {
+      gen = stat_segment_reclaim_gen (sm);
+      n_threads = -1;
+      *is_aggregate = 0;
+      vec_reset_length (d->changed);
+      counter_vec = get_stat_vector_r (sm);
+      if (index >= vec_len (counter_vec))
+	continue;
+      *e = counter_vec[index];
+
+      switch (e->type)
+	{
+	case STAT_DIR_TYPE_SCALAR_INDEX:
+	  n_threads = 0;
+	  break;
+
+	case STAT_DIR_TYPE_ERROR_INDEX:
+	  error_base =
+	    stat_segment_pointer (sm->shared_header,
+				  sm->shared_header->error_offset);
+	  if (e->index >= vec_len (error_base))
+	    break;
+	  e->value = error_base[e->index];
+	  n_threads = 0;
+	  break;
+
+	case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+	case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+	  if (e->offset == 0)
+	    break;
+	  n_words = e->type == STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE ? 1 : 2;
+	  threads = stat_segment_pointer (sm->shared_header, e->offset);
+	  offset_vector =
+	    stat_segment_pointer (sm->shared_header, e->offset_vector);
+	  n_threads = clib_min (vec_len (threads), vec_len (offset_vector));
+
+	  vec_validate (d->copy, n_threads);
+	  for (t = 0; t < n_threads; t++)
+	    {
+	      c = stat_segment_pointer (sm->shared_header, offset_vector[t]);
+	      vec_reset_length (d->copy[t]);
+	      vec_add (d->copy[t], c, vec_len (c) * n_words);
+	    }
+
+	  /* Summaries carry the change bitmap after their one thread */
+	  *is_aggregate = vec_len (offset_vector) > n_threads &&
+	    !strncmp (e->name, STAT_SEGMENT_AGGREGATE_PREFIX, prefix_len);
+	  if (*is_aggregate && want_changed)
+	    {
+	      c = stat_segment_pointer (sm->shared_header,
+					offset_vector[n_threads]);
+	      vec_add (d->changed, c, vec_len (c));
+	    }
+	  break;
+
+	default:
+	  ;
+	}
+    }
+  while (!stat_segment_reclaim_gen_valid (sm, gen));
+
+  return n_threads;
+}
+
+/*
+ * Report the values in stats which changed since the previous call with
+ * the same delta. Returns the number reported, or -1 if entries have been
+ * added to the directory since ls, like stat_segment_dump returning 0.
+ */
+int
+stat_segment_dump_delta_r (uint32_t * stats, stat_segment_delta_t * d,
+			   stat_segment_delta_fn_t fn, void *ctx,
+			   stat_client_main_t * sm)
+{
+  stat_segment_directory_entry_t *counter_vec, e;
+  stat_segment_delta_value_t v;
+  stat_segment_shadow_t *s;
+  uint64_t seq, seq_after;
+  int i, t, n_threads, n_words, is_aggregate, use_changed;
+  int unchanged, n_reported = 0;
+
+  if (sm->shared_header->epoch != sm->current_epoch)
+    return -1;
+
+  counter_vec = get_stat_vector_r (sm);
+  seq = counter_vec[STAT_COUNTER_AGGREGATE_SEQ].value;
+
+  for (i = 0; i < vec_len (stats); i++)
+    {
+      vec_validate (d->shadow, stats[i]);
+      s = vec_elt_at_index (d->shadow, stats[i]);
+      if (!s->threads)
+	s->seq = ~0ULL;
+
+      /* Odd while the collector is rewriting summaries */
+      unchanged = (seq & 1) == 0 && seq == s->seq;
+      use_changed = (seq & 1) == 0 && seq == s->seq + 2;
+
+      n_threads = delta_copy_entry (sm, stats[i], d, &e, use_changed,
+				    &is_aggregate);
+      if (n_threads < 0)
+	continue;
+
+      clib_memset (&v, 0, sizeof (v));
+      v.name = e.name;
+      v.type = e.type;
+      v.thread = -1;
+
+      switch (e.type)
+	{
+	case STAT_DIR_TYPE_SCALAR_INDEX:
+	  v.scalar_value = e.value;
+	  n_reported += delta_word (&v, s, e.value, fn, ctx);
+	  break;
+
+	case STAT_DIR_TYPE_ERROR_INDEX:
+	  v.error_value = e.value;
+	  n_reported += delta_word (&v, s, v.error_value, fn, ctx);
+	  break;
+
+	case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+	case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+	  if (n_threads == 0)
+	    break;
+	  n_words = e.type == STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE ? 1 : 2;
+	  vec_validate (s->threads, n_threads - 1);
+	  for (t = 0; t < n_threads; t++)
+	    {
+	      v.thread = is_aggregate ? -1 : t;
+	      n_reported +=
+		delta_vector (&v, &s->threads[t], d->copy[t],
+			      vec_len (d->copy[t]) / n_words, n_words,
+			      is_aggregate && (unchanged || use_changed),
+			      d->changed, fn, ctx);
+	    }
+	  break;
+
+	default:
+	  ;
+	}
+    }
+
+  /* The shadow matches a whole collector pass only if none overlapped */
+  seq_after = counter_vec[STAT_COUNTER_AGGREGATE_SEQ].value;
+  if ((seq & 1) || seq_after != seq)
+    seq = ~0ULL;
+  for (i = 0; i < vec_len (stats); i++)
+    if (stats[i] < vec_len (d->shadow))
+      d->shadow[stats[i]].seq = seq;
+
+  return n_reported;
+}
+
+int
+stat_segment_dump_delta (uint32_t * stats, stat_segment_delta_t * d,
+			 stat_segment_delta_fn_t fn, void *ctx)
+{
+  stat_client_main_t *sm = &stat_client_main;
+  return stat_segment_dump_delta_r (stats, d, fn, ctx, sm);
+}
+
 char *
 stat_segment_index_to_name (uint32_t index)
 {
@@ -34,6 +34,9 @@ typedef enum
 /* Default socket to exchange segment fd */
 #define STAT_SEGMENT_SOCKET_FILE "/run/vpp/stats.sock"
 
+/* Prefix of the single thread, summed across threads counter entries */
+#define STAT_SEGMENT_AGGREGATE_PREFIX "/aggregate"
+
 typedef struct stat_client_main_t stat_client_main_t;
 
 typedef struct
@@ -50,6 +53,31 @@ typedef struct
   };
 } stat_segment_data_t;
 
+/*
+ * Delta dumps: the client keeps a shadow of the values it last reported
+ * and only reports values which have changed since, one at a time, to a
+ * callback. No memory is allocated once the shadow is sized.
+ */
+typedef struct stat_segment_delta_t stat_segment_delta_t;
+
+typedef struct
+{
+  const char *name;		/* only valid during the callback */
+  stat_directory_type_t type;
+  int thread;			/* -1 if not per thread */
+  uint32_t index;
+  union
+  {
+    double scalar_value;
+    uint64_t error_value;
+    counter_t simple_value;
+    vlib_counter_t combined_value;
+  };
+} stat_segment_delta_value_t;
+
+typedef void (*stat_segment_delta_fn_t) (const stat_segment_delta_value_t *
+					 v, void *ctx);
+
 stat_client_main_t *stat_client_get (void);
 void stat_client_free (stat_client_main_t * sm);
 int stat_segment_connect_r (const char *socket_name, stat_client_main_t * sm);
@@ -68,6 +96,13 @@ stat_segment_data_t *stat_segment_dump (uint32_t * counter_vec);
 stat_segment_data_t *stat_segment_dump_entry_r (uint32_t index,
 						stat_client_main_t * sm);
 stat_segment_data_t *stat_segment_dump_entry (uint32_t index);
+stat_segment_delta_t *stat_segment_delta_create (void);
+void stat_segment_delta_free (stat_segment_delta_t * d);
+int stat_segment_dump_delta_r (uint32_t * stats, stat_segment_delta_t * d,
+			       stat_segment_delta_fn_t fn, void *ctx,
+			       stat_client_main_t * sm);
+int stat_segment_dump_delta (uint32_t * stats, stat_segment_delta_t * d,
+			     stat_segment_delta_fn_t fn, void *ctx);
 
 void stat_segment_data_free (stat_segment_data_t * res);
 double stat_segment_heartbeat_r (stat_client_main_t * sm);
@@ -21,6 +21,7 @@ typedef void (*vac_callback_t)(unsigned char * data, int len);
 typedef void (*vac_error_callback_t)(void *, unsigned char *, int);
 int vac_connect(char * name, char * chroot_prefix, vac_callback_t cb,
     int rx_qlen);
+void vac_set_request_ring_size(int request_ring_size);
 int vac_disconnect(void);
 int vac_read(char **data, int *l, unsigned short timeout);
 int vac_write(char *data, int len);
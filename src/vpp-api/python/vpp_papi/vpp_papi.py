@@ -447,11 +447,11 @@ class VPP(object):
                     'No such message type or failed CRC checksum: %s', n)
 
     def connect_internal(self, name, msg_handler, chroot_prefix, rx_qlen,
-                         do_async):
+                         do_async, request_ring_size=0):
         pfx = chroot_prefix.encode('utf-8') if chroot_prefix else None
 
         rv = self.transport.connect(name.encode('utf-8'), pfx,
-                                    msg_handler, rx_qlen)
+                                    msg_handler, rx_qlen, request_ring_size)
         if rv != 0:
             raise VPPIOError(2, 'Connect failed')
         self.vpp_dictionary_maxid = self.transport.msg_table_max_index()
@@ -469,7 +469,8 @@ class VPP(object):
             self.event_thread.start()
         return rv
 
-    def connect(self, name, chroot_prefix=None, do_async=False, rx_qlen=32):
+    def connect(self, name, chroot_prefix=None, do_async=False, rx_qlen=32,
+                request_ring_size=0):
         """Attach to VPP.
 
         name - the name of the client.
@@ -477,10 +478,13 @@ class VPP(object):
         do_async - if true, messages are sent without waiting for a reply
         rx_qlen - the length of the VPP message receive queue between
         client and server.
+        request_ring_size - if not 0, requests sent from the connecting
+        thread go on a ring of that many messages of their own, rather
+        than on the queue shared by all clients (shared memory only).
         """
         msg_handler = self.transport.get_callback(do_async)
         return self.connect_internal(name, msg_handler, chroot_prefix, rx_qlen,
-                                     do_async)
+                                     do_async, request_ring_size)
 
     def connect_sync(self, name, chroot_prefix=None, rx_qlen=32):
         """Attach to VPP in synchronous mode. Application must poll for events.
@@ -52,6 +52,7 @@ typedef struct
   uint64_t directory_offset;
   uint64_t error_offset;
   uint64_t stats_offset;
+  uint64_t reclaim_gen;
 } stat_segment_shared_header_t;
 
 typedef struct
@@ -79,6 +80,29 @@ double stat_segment_heartbeat_r (stat_client_main_t * sm);
 double stat_segment_heartbeat (void);
 int stat_segment_vec_len(void *vec);
 uint8_t **stat_segment_string_vector(uint8_t **string_vector, char *string);
+
+typedef struct stat_segment_delta_t stat_segment_delta_t;
+typedef struct
+{
+  const char *name;
+  stat_directory_type_t type;
+  int thread;
+  uint32_t index;
+  union
+  {
+    double scalar_value;
+    uint64_t error_value;
+    counter_t simple_value;
+    vlib_counter_t combined_value;
+  };
+} stat_segment_delta_value_t;
+typedef void (*stat_segment_delta_fn_t) (const stat_segment_delta_value_t *v,
+                                         void *ctx);
+stat_segment_delta_t *stat_segment_delta_create (void);
+void stat_segment_delta_free (stat_segment_delta_t * d);
+int stat_segment_dump_delta_r (uint32_t * stats, stat_segment_delta_t * d,
+                               stat_segment_delta_fn_t fn, void *ctx,
+                               stat_client_main_t * sm);
 """)
 
 
@@ -137,6 +161,24 @@ def stat_entry_to_python(api, e):
     return None
 
 
+def delta_value_to_python(v):
+    if v.type == 1:
+        value = v.scalar_value
+    elif v.type == 2:
+        value = v.simple_value
+    elif v.type == 3:
+        value = vlib_counter_dict(v.combined_value)
+    else:
+        value = v.error_value
+    return (ffi.string(v.name).decode('utf-8'), v.thread, v.index, value)
+
+
+# Called for each value a delta dump reports, ctx is a handle to a list
+@ffi.callback("void(const stat_segment_delta_value_t *, void *)")
+def delta_value_cb(v, ctx):
+    ffi.from_handle(ctx).append(delta_value_to_python(v))
+
+
 class VPPStatsIOError(IOError):
     message = "Stat segment client connection returned: " \
               "%(retval)s %(strerror)s."
@@ -214,6 +256,24 @@ class VPPStats(object):
                 stats[n] = e
         return stats
 
+    def delta_create(self):
+        '''State for dump_delta, one per consumer'''
+        return ffi.gc(self.api.stat_segment_delta_create(),
+                      self.api.stat_segment_delta_free)
+
+    def dump_delta(self, counters, delta):
+        '''(name, thread, index, value) of what changed since the last
+           dump_delta with the same delta, thread is -1 if not per thread'''
+        values = []
+        rv = self.api.stat_segment_dump_delta_r(counters, delta,
+                                                delta_value_cb,
+                                                ffi.new_handle(values),
+                                                self.client)
+        # Entries were added since ls, list again
+        if rv < 0:
+            raise VPPStatsIOError()
+        return values
+
     def get_counter(self, name):
         retries = 0
         while True:
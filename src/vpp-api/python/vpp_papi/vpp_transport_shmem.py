@@ -12,6 +12,7 @@ typedef void (*vac_callback_t)(unsigned char * data, int len);
 typedef void (*vac_error_callback_t)(void *, unsigned char *, int);
 int vac_connect(char * name, char * chroot_prefix, vac_callback_t cb,
     int rx_qlen);
+void vac_set_request_ring_size(int request_ring_size);
 int vac_disconnect(void);
 int vac_read(char **data, int *l, unsigned short timeout);
 int vac_write(char *data, int len);
@@ -73,10 +74,11 @@ class VppTransport(object):
         else:
             self.write = self._write_legacy_cffi
 
-    def connect(self, name, pfx, msg_handler, rx_qlen):
+    def connect(self, name, pfx, msg_handler, rx_qlen, request_ring_size=0):
         self.connected = True
         if not pfx:
             pfx = ffi.NULL
+        vpp_api.vac_set_request_ring_size(request_ring_size)
         return vpp_api.vac_connect(name, pfx, msg_handler, rx_qlen)
 
     def disconnect(self):
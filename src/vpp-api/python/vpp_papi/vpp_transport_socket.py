@@ -67,7 +67,7 @@ class VppTransport(object):
                     raise VppTransportSocketIOError(
                         2, 'Unknown response from select')
 
-    def connect(self, name, pfx, msg_handler, rx_qlen):
+    def connect(self, name, pfx, msg_handler, rx_qlen, request_ring_size=0):
 
         # Create a UDS socket
         self.socket = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET)
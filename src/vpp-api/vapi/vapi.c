@@ -87,6 +87,7 @@ struct vapi_ctx_s
   vapi_msg_id_t *vl_msg_id_to_vapi_msg_t;
   bool connected;
   bool handle_keepalives;
+  u32 request_ring_size;
   pthread_mutex_t requests_mutex;
 };
 
@@ -335,6 +336,7 @@ vapi_connect (vapi_ctx_t ctx, const char *name,
       return VAPI_EMAP_FAIL;
     }
   VAPI_DBG ("connect client `%s'", name);
+  vl_client_set_request_ring_size (ctx->request_ring_size);
   if (vl_client_connect ((char *) name, 0, response_queue_size) < 0)
     {
       vl_client_api_unmap ();
@@ -415,6 +417,17 @@ fail:
   return rv;
 }
 
+vapi_error_e
+vapi_set_request_ring_size (vapi_ctx_t ctx, int request_ring_size)
+{
+  if (request_ring_size < 0)
+    {
+      return VAPI_EINVAL;
+    }
+  ctx->request_ring_size = request_ring_size;
+  return VAPI_OK;
+}
+
 vapi_error_e
 vapi_disconnect (vapi_ctx_t ctx)
 {
@@ -437,6 +450,29 @@ vapi_get_fd (vapi_ctx_t ctx, int *fd)
   return VAPI_ENOTSUP;
 }
 
+/*
+ * Requests from the connecting thread go on its own request ring, when
+ * it has one, every other thread uses the shared vpp input queue.
+ */
+static int
+vapi_queue_add (vapi_ctx_t ctx, u8 ** elems, int n_elems)
+{
+  api_main_t *am = &api_main;
+  svm_queue_t *q = am->shmem_hdr->vl_input_queue;
+  int nowait = VAPI_MODE_BLOCKING == ctx->mode ? 0 : 1;
+
+  if (am->vl_request_queue
+      && pthread_equal (pthread_self (), am->vl_request_queue_thread))
+    return svm_queue_spsc_add_wait (am->vl_request_queue, elems, n_elems,
+				    nowait ? -1 :
+				    am->vl_request_queue_wakeup_fd,
+				    am->vl_request_queue_doorbell_fd);
+
+  if (1 == n_elems)
+    return svm_queue_add (q, elems[0], nowait);
+  return svm_queue_add2 (q, elems[0], elems[1], nowait);
+}
+
 vapi_error_e
 vapi_send (vapi_ctx_t ctx, void *msg)
 {
@@ -447,7 +483,7 @@ vapi_send (vapi_ctx_t ctx, void *msg)
       goto out;
     }
   int tmp;
-  svm_queue_t *q = api_main.shmem_hdr->vl_input_queue;
+  u8 *elems[1] = { (u8 *) & msg };
 #if VAPI_DEBUG
   unsigned msgid = be16toh (*(u16 *) msg);
   if (msgid <= ctx->vl_msg_id_max)
@@ -468,8 +504,7 @@ vapi_send (vapi_ctx_t ctx, void *msg)
       VAPI_DBG ("send msg@%p:%u[UNKNOWN]", msg, msgid);
     }
 #endif
-  tmp = svm_queue_add (q, (u8 *) & msg,
-		       VAPI_MODE_BLOCKING == ctx->mode ? 0 : 1);
+  tmp = vapi_queue_add (ctx, elems, 1);
   if (tmp < 0)
     {
       rv = VAPI_EAGAIN;
@@ -488,7 +523,7 @@ vapi_send2 (vapi_ctx_t ctx, void *msg1, void *msg2)
       rv = VAPI_EINVAL;
       goto out;
     }
-  svm_queue_t *q = api_main.shmem_hdr->vl_input_queue;
+  u8 *elems[2] = { (u8 *) & msg1, (u8 *) & msg2 };
 #if VAPI_DEBUG
   unsigned msgid1 = be16toh (*(u16 *) msg1);
   unsigned msgid2 = be16toh (*(u16 *) msg2);
@@ -512,8 +547,7 @@ vapi_send2 (vapi_ctx_t ctx, void *msg1, void *msg2)
     }
   VAPI_DBG ("send two: %u[%s], %u[%s]", msgid1, name1, msgid2, name2);
 #endif
-  int tmp = svm_queue_add2 (q, (u8 *) & msg1, (u8 *) & msg2,
-			    VAPI_MODE_BLOCKING == ctx->mode ? 0 : 1);
+  int tmp = vapi_queue_add (ctx, elems, 2);
   if (tmp < 0)
     {
       rv = VAPI_EAGAIN;
@@ -107,6 +107,20 @@ extern "C"
 			     int response_queue_size, vapi_mode_e mode,
 			     bool handle_keepalives);
 
+/**
+ * @brief set the size of the request ring used by the next vapi_connect
+ *
+ * @note with a non-zero size, requests are sent on the connecting thread's
+ * own ring instead of the queue shared with other clients
+ *
+ * @param ctx opaque vapi context
+ * @param request_ring_size ring size, 0 (the default) to use the shared queue
+ *
+ * @return VAPI_OK on success, other error code on error
+ */
+  vapi_error_e vapi_set_request_ring_size (vapi_ctx_t ctx,
+					   int request_ring_size);
+
 /**
  * @brief disconnect from vpp
  *
@@ -208,6 +208,18 @@ public:
                          VAPI_MODE_BLOCKING, handle_keepalives);
   }
 
+  /**
+   * @brief set the size of the request ring used by the next connect
+   *
+   * @param request_ring_size ring size, 0 to use the shared queue
+   *
+   * @return VAPI_OK on success, other error code on error
+   */
+  vapi_error_e set_request_ring_size (int request_ring_size)
+  {
+    return vapi_set_request_ring_size (vapi_ctx, request_ring_size);
+  }
+
   /**
    * @brief disconnect from vpp
    *
@@ -48,12 +48,54 @@ prom_string (char *s)
   return s;
 }
 
+/*
+ * When vpp keeps summed, single thread copies of the counter vectors
+ * (statseg { aggregate-counters on }), export those instead of the
+ * per-thread vectors they were built from.
+ */
+static u32 *
+prefer_aggregates (u32 * stats)
+{
+  uword *aggregated = hash_create_string (0, sizeof (uword));
+  size_t prefix_len = strlen (STAT_SEGMENT_AGGREGATE_PREFIX);
+  char **names = 0;
+  u32 *res = 0;
+  int i;
+
+  for (i = 0; i < vec_len (stats); i++)
+    {
+      char *name = stat_segment_index_to_name (stats[i]);
+      vec_add1 (names, name);
+      if (!strncmp (name, STAT_SEGMENT_AGGREGATE_PREFIX, prefix_len))
+	hash_set_mem (aggregated, name + prefix_len, 1);
+    }
+
+  for (i = 0; i < vec_len (stats); i++)
+    if (!hash_get_mem (aggregated, names[i]))
+      vec_add1 (res, stats[i]);
+
+  hash_free (aggregated);
+  for (i = 0; i < vec_len (names); i++)
+    free (names[i]);
+  vec_free (names);
+  vec_free (stats);
+  return res;
+}
+
+static int
+is_aggregate (const char *name)
+{
+  return !strncmp (name, STAT_SEGMENT_AGGREGATE_PREFIX,
+		   strlen (STAT_SEGMENT_AGGREGATE_PREFIX));
+}
+
 static void
 dump_metrics (FILE * stream, u8 ** patterns)
 {
   stat_segment_data_t *res;
   int i, j, k;
   static u32 *stats = 0;
+  char *name;
 
 retry:
   res = stat_segment_dump (stats);
@@ -61,12 +103,47 @@ retry:
     {				/* Memory layout has changed */
       if (stats)
 	vec_free (stats);
-      stats = stat_segment_ls (patterns);
+      stats = prefer_aggregates (stat_segment_ls (patterns));
       goto retry;
     }
 
   for (i = 0; i < vec_len (res); i++)
     {
+      if (is_aggregate (res[i].name))
+	{
+	  /* Summed over threads, export under the original name */
+	  name = prom_string (res[i].name +
+			      strlen (STAT_SEGMENT_AGGREGATE_PREFIX));
+	  switch (res[i].type)
+	    {
+	    case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+	      fformat (stream, "# TYPE %s counter\n", name);
+	      for (k = 0; k < vec_len (res[i].simple_counter_vec); k++)
+		for (j = 0; j < vec_len (res[i].simple_counter_vec[k]); j++)
+		  fformat (stream, "%s{interface=\"%d\"} %lld\n",
+			   name, j, res[i].simple_counter_vec[k][j]);
+	      break;
+
+	    case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+	      fformat (stream, "# TYPE %s_packets counter\n", name);
+	      fformat (stream, "# TYPE %s_bytes counter\n", name);
+	      for (k = 0; k < vec_len (res[i].combined_counter_vec); k++)
+		for (j = 0; j < vec_len (res[i].combined_counter_vec[k]); j++)
+		  {
+		    fformat (stream, "%s_packets{interface=\"%d\"} %lld\n",
+			     name, j,
+			     res[i].combined_counter_vec[k][j].packets);
+		    fformat (stream, "%s_bytes{interface=\"%d\"} %lld\n",
+			     name, j, res[i].combined_counter_vec[k][j].bytes);
+		  }
+	      break;
+
+	    default:
+	      ;
+	    }
+	  continue;
+	}
+
       switch (res[i].type)
 	{
 	case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
@@ -118,11 +195,171 @@ retry:
 }
 
 
+/*
+ * Delta mode: only the values which changed since the previous scrape,
+ * written straight to the stream as they are found.
+ */
+typedef struct
+{
+  FILE *stream;
+  const char *last_name;
+  char name[128];
+} delta_ctx_t;
+
+static void
+delta_metric (const stat_segment_delta_value_t * v, void *arg)
+{
+  delta_ctx_t *ctx = arg;
+  FILE *stream = ctx->stream;
+  char *name = ctx->name;
+
+  if (v->name != ctx->last_name)
+    {
+      const char *n = v->name;
+      if (is_aggregate (n))
+	n += strlen (STAT_SEGMENT_AGGREGATE_PREFIX);
+      strncpy (name, n, sizeof (ctx->name) - 1);
+      prom_string (name);
+      ctx->last_name = v->name;
+      if (v->type == STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED)
+	fprintf (stream, "# TYPE %s_packets counter\n"
+		 "# TYPE %s_bytes counter\n", name, name);
+      else
+	fprintf (stream, "# TYPE %s counter\n", name);
+    }
+
+  switch (v->type)
+    {
+    case STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE:
+      if (v->thread < 0)
+	fprintf (stream, "%s{interface=\"%u\"} %llu\n", name, v->index,
+		 (unsigned long long) v->simple_value);
+      else
+	fprintf (stream, "%s{thread=\"%d\",interface=\"%u\"} %llu\n",
+		 name, v->thread, v->index,
+		 (unsigned long long) v->simple_value);
+      break;
+
+    case STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED:
+      if (v->thread < 0)
+	fprintf (stream, "%s_packets{interface=\"%u\"} %llu\n"
+		 "%s_bytes{interface=\"%u\"} %llu\n",
+		 name, v->index,
+		 (unsigned long long) v->combined_value.packets,
+		 name, v->index,
+		 (unsigned long long) v->combined_value.bytes);
+      else
+	fprintf (stream, "%s_packets{thread=\"%d\",interface=\"%u\"} %llu\n"
+		 "%s_bytes{thread=\"%d\",interface=\"%u\"} %llu\n",
+		 name, v->thread, v->index,
+		 (unsigned long long) v->combined_value.packets,
+		 name, v->thread, v->index,
+		 (unsigned long long) v->combined_value.bytes);
+      break;
+
+    case STAT_DIR_TYPE_ERROR_INDEX:
+      fprintf (stream, "%s{thread=\"0\"} %llu\n", name,
+	       (unsigned long long) v->error_value);
+      break;
+
+    case STAT_DIR_TYPE_SCALAR_INDEX:
+      fprintf (stream, "%s %.2f\n", name, v->scalar_value);
+      break;
+
+    default:
+      ;
+    }
+}
+
+/*
+ * Each consumer gets its own shadow, or one scraper would be told only
+ * about what changed since another's scrape. A consumer is named by the
+ * "consumer" query parameter, by default its address. The least recently
+ * seen one is forgotten when there are too many, it then gets everything
+ * again on its next scrape.
+ */
+#define DELTA_MAX_CONSUMERS 64
+
+typedef struct
+{
+  u8 *key;
+  stat_segment_delta_t *delta;
+  u32 *stats;
+  u64 last_scrape;
+} delta_consumer_t;
+
+static delta_consumer_t *delta_consumers;
+static uword *delta_consumer_by_key;
+static u64 delta_n_scrapes;
+
+static void
+delta_consumer_free (delta_consumer_t * c)
+{
+  hash_unset_mem (delta_consumer_by_key, c->key);
+  vec_free (c->key);
+  stat_segment_delta_free (c->delta);
+  vec_free (c->stats);
+  pool_put (delta_consumers, c);
+}
+
+static delta_consumer_t *
+delta_consumer_get (const char *key)
+{
+  delta_consumer_t *c, *oldest = 0;
+  uword *p;
+
+  if (!delta_consumer_by_key)
+    delta_consumer_by_key = hash_create_string (0, sizeof (uword));
+
+  p = hash_get_mem (delta_consumer_by_key, key);
+  if (p)
+    {
+      c = pool_elt_at_index (delta_consumers, p[0]);
+      c->last_scrape = ++delta_n_scrapes;
+      return c;
+    }
+
+  if (pool_elts (delta_consumers) >= DELTA_MAX_CONSUMERS)
+    {
+      /* *INDENT-OFF* */
+      pool_foreach (c, delta_consumers,
+      ({
+	if (!oldest || c->last_scrape < oldest->last_scrape)
+	  oldest = c;
+      }));
+      /* *INDENT-ON* */
+      delta_consumer_free (oldest);
+    }
+
+  pool_get_zero (delta_consumers, c);
+  c->key = format (0, "%s%c", key, 0);
+  c->delta = stat_segment_delta_create ();
+  c->last_scrape = ++delta_n_scrapes;
+  hash_set_mem (delta_consumer_by_key, c->key, c - delta_consumers);
+  return c;
+}
+
+static void
+dump_metrics_delta (FILE * stream, u8 ** patterns, const char *consumer)
+{
+  delta_consumer_t *c = delta_consumer_get (consumer);
+  delta_ctx_t ctx = {.stream = stream };
+
+  while (stat_segment_dump_delta (c->stats, c->delta, delta_metric, &ctx) <
+	 0)
+    {				/* Entries added, list again */
+      vec_free (c->stats);
+      c->stats = prefer_aggregates (stat_segment_ls (patterns));
+    }
+}
+
 #define ROOTPAGE  "<html><head><title>Metrics exporter</title></head><body><ul><li><a href=\"/metrics\">metrics</a></li></ul></body></html>"
 #define NOT_FOUND_ERROR "<html><head><title>Document not found</title></head><body><h1>404 - Document not found</h1></body></html>"
 
+static int delta_mode;
+
 static void
-http_handler (FILE * stream, u8 ** patterns)
+http_handler (FILE * stream, u8 ** patterns, const char *address)
 {
   char status[80] = { 0 };
   if (fgets (status, sizeof (status) - 1, stream) == 0)
@@ -158,6 +395,18 @@ http_handler (FILE * stream, u8 ** patterns)
 	  break;
 	}
     }
+  /* /metrics?consumer=<name> keeps a delta consumer apart from others */
+  char *query = strchr (request_uri, '?');
+  const char *consumer = address;
+  if (query)
+    {
+      *query++ = 0;
+      if (strncmp (query, "consumer=", 9) == 0 && query[9])
+	{
+	  consumer = query + 9;
+	  query[strcspn (query, "&")] = 0;
+	}
+    }
   if (strcmp (request_uri, "/") == 0)
     {
       fprintf (stream, "HTTP/1.0 200 OK\r\nContent-Length: %lu\r\n\r\n",
@@ -174,7 +423,10 @@ http_handler (FILE * stream, u8 ** patterns)
       return;
     }
   fputs ("HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\n", stream);
-  dump_metrics (stream, patterns);
+  if (delta_mode)
+    dump_metrics_delta (stream, patterns, consumer);
+  else
+    dump_metrics (stream, patterns);
 }
 
 static int
@@ -249,6 +501,8 @@ main (int argc, char **argv)
     {
       if (unformat (a, "socket-name %s", &stat_segment_name))
 	;
+      else if (unformat (a, "delta"))
+	delta_mode = 1;
       else if (unformat (a, "%s", &pattern))
 	{
 	  vec_add1 (patterns, pattern);
@@ -256,7 +510,7 @@ main (int argc, char **argv)
       else
 	{
 	  fformat (stderr,
-		   "%s: usage [socket-name <name>] <patterns> ...\n",
+		   "%s: usage [socket-name <name>] [delta] <patterns> ...\n",
 		   argv[0]);
 	  exit (1);
 	}
@@ -265,7 +519,8 @@ main (int argc, char **argv)
   if (vec_len (patterns) == 0)
     {
       fformat (stderr,
-	       "%s: usage [socket-name <name>] <patterns> ...\n", argv[0]);
+	       "%s: usage [socket-name <name>] [delta] <patterns> ...\n",
+	       argv[0]);
       exit (1);
     }
 
@@ -290,18 +545,15 @@ main (int argc, char **argv)
 	  fprintf (stderr, "Accept failed: %s", strerror (errno));
 	  continue;
 	}
-      else
+      struct sockaddr_in6 clientaddr = { 0 };
+      char address[INET6_ADDRSTRLEN] = "";
+      socklen_t addrlen = sizeof (clientaddr);
+      getpeername (conn_sock, (struct sockaddr *) &clientaddr, &addrlen);
+      if (inet_ntop
+	  (AF_INET6, &clientaddr.sin6_addr, address, sizeof (address)))
 	{
-	  struct sockaddr_in6 clientaddr = { 0 };
-	  char address[INET6_ADDRSTRLEN];
-	  socklen_t addrlen;
-	  getpeername (conn_sock, (struct sockaddr *) &clientaddr, &addrlen);
-	  if (inet_ntop
-	      (AF_INET6, &clientaddr.sin6_addr, address, sizeof (address)))
-	    {
-	      fprintf (stderr, "Client address is [%s]:%d\n", address,
-		       ntohs (clientaddr.sin6_port));
-	    }
+	  fprintf (stderr, "Client address is [%s]:%d\n", address,
+		   ntohs (clientaddr.sin6_port));
 	}
 
       FILE *stream = fdopen (conn_sock, "r+");
@@ -311,8 +563,8 @@ main (int argc, char **argv)
 	  close (conn_sock);
 	  continue;
 	}
-      /* Single reader at the moment */
-      http_handler (stream, patterns);
+      /* One connection at a time, delta state is kept per consumer */
+      http_handler (stream, patterns, address);
       fclose (stream);
     }
 
@@ -39,11 +39,116 @@ void
 vlib_stat_segment_unlock (void)
 {
   stat_segment_main_t *sm = &stat_segment_main;
-  sm->shared_header->epoch++;
   sm->shared_header->in_progress = 0;
   clib_spinlock_unlock (sm->stat_segment_lockp);
 }
 
+/*
+ * Readers walk the segment without a lock, so vectors which move are
+ * kept around for a while before they are freed. Called on the stats heap.
+ */
+void
+vlib_stats_retire (void *v)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_retired_t *r;
+  void *oldheap;
+
+  if (!v)
+    return;
+
+  oldheap = clib_mem_set_heap (sm->heap);
+  vec_add2 (sm->retired, r, 1);
+  r->vector = v;
+  r->retired_at = unix_time_now ();
+  clib_mem_set_heap (oldheap);
+}
+
+/*
+ * Free what was retired long enough ago. The reclaim generation is odd
+ * while that happens, so a reader still copying from one of the vectors
+ * notices and reads again instead of using what it copied.
+ */
+static void
+stat_segment_reclaim (stat_segment_main_t * sm, f64 now)
+{
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+  void *oldheap;
+  int i, n_keep = 0, n_due = 0;
+
+  for (i = 0; i < vec_len (sm->retired); i++)
+    n_due += now - sm->retired[i].retired_at >= STAT_SEGMENT_RECLAIM_DELAY;
+  if (n_due == 0)
+    return;
+
+  oldheap = clib_mem_set_heap (sm->heap);
+  vlib_stat_segment_lock ();
+  shared_header->reclaim_gen++;
+  for (i = 0; i < vec_len (sm->retired); i++)
+    {
+      stat_segment_retired_t *r = vec_elt_at_index (sm->retired, i);
+      if (now - r->retired_at >= STAT_SEGMENT_RECLAIM_DELAY)
+	vec_free (r->vector);
+      else
+	sm->retired[n_keep++] = *r;
+    }
+  _vec_len (sm->retired) = n_keep;
+  shared_header->reclaim_gen++;
+  vlib_stat_segment_unlock ();
+  clib_mem_set_heap (oldheap);
+}
+
+/*
+ * Append an entry to the directory. Entries are never removed or
+ * reordered, so indices handed out by ls stay valid. The entry is fully
+ * written before it becomes visible, and epoch is bumped so readers know
+ * to list again. Called with the lock held, on the stats heap.
+ */
+static u32
+stat_segment_directory_add (stat_segment_directory_entry_t * e)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+  stat_segment_directory_entry_t *dv = sm->directory_vector;
+  u32 index = vec_len (dv);
+
+  if (_vec_resize_will_expand (dv, 1, (index + 1) * sizeof (dv[0]), 0, 0))
+    {
+      /* Moves to a new vector, not seen by readers until published */
+      vlib_stats_vec_validate (sm->directory_vector, index);
+      sm->directory_vector[index] = *e;
+    }
+  else
+    {
+      dv[index] = *e;
+      CLIB_MEMORY_STORE_BARRIER ();
+      _vec_len (dv) = index + 1;
+    }
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  shared_header->directory_offset =
+    stat_segment_offset (shared_header, sm->directory_vector);
+  shared_header->epoch++;
+  return index;
+}
+
+/*
+ * Publish a vector of names / counter vectors: the offset vector is
+ * written first, so a reader which sees the new vector also sees offsets
+ * for all of its elements.
+ */
+static void
+stat_segment_publish (stat_segment_directory_entry_t * ep, void *v,
+		      u64 * offset_vector)
+{
+  stat_segment_shared_header_t *shared_header =
+    stat_segment_main.shared_header;
+
+  ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
+  CLIB_MEMORY_STORE_BARRIER ();
+  ep->offset = stat_segment_offset (shared_header, v);
+}
+
 /*
  * Change heap to the stats shared memory segment
  */
@@ -114,27 +219,22 @@ vlib_stats_pop_heap (void *cm_arg, void *oldheap, stat_directory_type_t type)
     {				/* New */
       strncpy (e.name, stat_segment_name, 128 - 1);
       e.type = type;
-      vec_add1 (sm->directory_vector, e);
+      stat_segment_directory_add (&e);
     }
 
   stat_segment_directory_entry_t *ep = &sm->directory_vector[vector_index];
-  ep->offset = stat_segment_offset (shared_header, cm->counters);	/* Vector of threads of vectors of counters */
   u64 *offset_vector =
     ep->offset_vector ? stat_segment_pointer (shared_header,
 					      ep->offset_vector) : 0;
 
   /* Update the 2nd dimension offset vector */
   int i;
-  vec_validate (offset_vector, vec_len (cm->counters) - 1);
+  vlib_stats_vec_validate (offset_vector, vec_len (cm->counters) - 1);
   for (i = 0; i < vec_len (cm->counters); i++)
     offset_vector[i] = stat_segment_offset (shared_header, cm->counters[i]);
-  ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
-  sm->directory_vector[vector_index].offset =
-    stat_segment_offset (shared_header, cm->counters);
 
-  /* Reset the client hash table pointer, since it WILL change! */
-  shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
+  /* Vector of threads of vectors of counters */
+  stat_segment_publish (ep, cm->counters, offset_vector);
 
   vlib_stat_segment_unlock ();
   clib_mem_set_heap (oldheap);
@@ -157,11 +257,7 @@ vlib_stats_register_error_index (u8 * name, u64 * em_vec, u64 index)
   e.type = STAT_DIR_TYPE_ERROR_INDEX;
   e.offset = index;
   e.offset_vector = 0;
-  vec_add1 (sm->directory_vector, e);
-
-  /* Warn clients to refresh any pointers they might be holding */
-  shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
+  stat_segment_directory_add (&e);
 
   vlib_stat_segment_unlock ();
 }
@@ -176,16 +272,20 @@ stat_validate_counter_vector (stat_segment_directory_entry_t * ep, u32 max)
   int i;
   u64 *offset_vector = 0;
 
-  vec_validate_aligned (counters, tm->n_vlib_mains - 1,
-			CLIB_CACHE_LINE_BYTES);
+  if (ep->offset)
+    {
+      counters = stat_segment_pointer (shared_header, ep->offset);
+      offset_vector = stat_segment_pointer (shared_header, ep->offset_vector);
+    }
+
+  vlib_stats_vec_validate (counters, tm->n_vlib_mains - 1);
+  vlib_stats_vec_validate (offset_vector, tm->n_vlib_mains - 1);
   for (i = 0; i < tm->n_vlib_mains; i++)
     {
-      vec_validate_aligned (counters[i], max, CLIB_CACHE_LINE_BYTES);
-      vec_add1 (offset_vector,
-		stat_segment_offset (shared_header, counters[i]));
+      vlib_stats_vec_validate (counters[i], max);
+      offset_vector[i] = stat_segment_offset (shared_header, counters[i]);
     }
-  ep->offset = stat_segment_offset (shared_header, counters);
-  ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
+  stat_segment_publish (ep, counters, offset_vector);
 }
 
 void
@@ -201,8 +301,6 @@ vlib_stats_pop_heap2 (u64 * error_vector, u32 thread_index, void *oldheap)
   /* Reset the client hash table pointer, since it WILL change! */
   shared_header->error_offset =
     stat_segment_offset (shared_header, error_vector);
-  shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
 
   vlib_stat_segment_unlock ();
   clib_mem_set_heap (oldheap);
@@ -373,6 +471,33 @@ VLIB_CLI_COMMAND (show_stat_segment_command, static) =
 };
 /* *INDENT-ON* */
 
+/*
+ * Histogram bucket bounds: a single row holding the lower bound of each
+ * bucket, see vlib_node_histogram_bucket (). They never change, so they
+ * are published once.
+ */
+static void
+stat_publish_histogram_bounds (stat_segment_directory_entry_t * ep,
+			       u32 n_buckets)
+{
+  stat_segment_main_t *sm = &stat_segment_main;
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+  counter_t **counters = 0;
+  u64 *offset_vector = 0;
+  int b;
+
+  if (ep->offset)
+    return;
+
+  vlib_stats_vec_validate (counters, 0);
+  vlib_stats_vec_validate (offset_vector, 0);
+  vlib_stats_vec_validate (counters[0], n_buckets - 1);
+  for (b = 0; b < n_buckets; b++)
+    counters[0][b] = b ? 1ULL << (b - 1) : 0;
+  offset_vector[0] = stat_segment_offset (shared_header, counters[0]);
+  stat_segment_publish (ep, counters, offset_vector);
+}
+
 /*
  * Node performance counters:
  * total_calls [threads][node-index]
@@ -390,6 +515,7 @@ update_node_counters (stat_segment_main_t * sm)
   int i, j;
   stat_segment_shared_header_t *shared_header = sm->shared_header;
   static u32 no_max_nodes = 0;
+  static u32 no_max_histogram_nodes = 0;
 
   vlib_node_get_nodes (0 /* vm, for barrier sync */ ,
 		       (u32) ~ 0 /* all threads */ ,
@@ -416,47 +542,77 @@ update_node_counters (stat_segment_main_t * sm)
       stat_validate_counter_vector (&sm->directory_vector
 				    [STAT_COUNTER_NODE_SUSPENDS], l);
 
-      vec_validate (sm->nodes, l);
+      vlib_stats_vec_validate (sm->nodes, l);
       stat_segment_directory_entry_t *ep;
       ep = &sm->directory_vector[STAT_COUNTER_NODE_NAMES];
-      ep->offset = stat_segment_offset (shared_header, sm->nodes);
 
       int i;
       u64 *offset_vector =
 	ep->offset_vector ? stat_segment_pointer (shared_header,
 						  ep->offset_vector) : 0;
       /* Update names dictionary */
-      vec_validate (offset_vector, l);
+      vlib_stats_vec_validate (offset_vector, l);
       vlib_node_t **nodes = node_dups[0];
       for (i = 0; i < vec_len (nodes); i++)
 	{
 	  vlib_node_t *n = nodes[i];
 	  u8 *s = 0;
 	  s = format (s, "%v%c", n->name, 0);
-	  if (sm->nodes[n->index])
-	    vec_free (sm->nodes[n->index]);
+	  vlib_stats_retire (sm->nodes[n->index]);
 	  sm->nodes[n->index] = s;
 	  offset_vector[i] =
 	    sm->nodes[i] ? stat_segment_offset (shared_header,
 						sm->nodes[i]) : 0;
 
 	}
-      ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
+      stat_segment_publish (ep, sm->nodes, offset_vector);
 
       vlib_stat_segment_unlock ();
       clib_mem_set_heap (oldheap);
       no_max_nodes = l;
     }
 
+  /*
+   * Histograms are only exported once 'set runtime histogram on' has
+   * allocated them on some thread
+   */
+  for (j = 0; j < vec_len (stat_vms); j++)
+    if (stat_vms[j]->node_main.histograms)
+      break;
+
+  if (j < vec_len (stat_vms) && l > no_max_histogram_nodes)
+    {
+      void *oldheap = clib_mem_set_heap (sm->heap);
+      vlib_stat_segment_lock ();
+
+      /* histograms are indexed by node index * buckets + bucket */
+      stat_validate_counter_vector (&sm->directory_vector
+				    [STAT_COUNTER_NODE_CLOCKS_HISTOGRAM],
+				    l * VLIB_NODE_HISTOGRAM_CLOCK_BUCKETS);
+      stat_validate_counter_vector (&sm->directory_vector
+				    [STAT_COUNTER_NODE_VECTORS_HISTOGRAM],
+				    l * VLIB_NODE_HISTOGRAM_VECTOR_BUCKETS);
+      stat_publish_histogram_bounds (&sm->directory_vector
+				     [STAT_COUNTER_NODE_CLOCKS_HISTOGRAM_BOUNDS],
+				     VLIB_NODE_HISTOGRAM_CLOCK_BUCKETS);
+      stat_publish_histogram_bounds (&sm->directory_vector
+				     [STAT_COUNTER_NODE_VECTORS_HISTOGRAM_BOUNDS],
+				     VLIB_NODE_HISTOGRAM_VECTOR_BUCKETS);
+
+      vlib_stat_segment_unlock ();
+      clib_mem_set_heap (oldheap);
+      no_max_histogram_nodes = l;
+    }
+
   for (j = 0; j < vec_len (node_dups); j++)
     {
       vlib_node_t **nodes = node_dups[j];
-      u32 l = vec_len (nodes);
+      vlib_node_histogram_t *histograms;
+      counter_t **counters;
+      counter_t *c;
 
       for (i = 0; i < vec_len (nodes); i++)
 	{
-	  counter_t **counters;
-	  counter_t *c;
 	  vlib_node_t *n = nodes[i];
 
 	  counters =
@@ -488,9 +644,177 @@ update_node_counters (stat_segment_main_t * sm)
 	  c[n->index] =
 	    n->stats_total.suspends - n->stats_last_clear.suspends;
 	}
+
+      histograms = stat_vms[j]->node_main.histograms;
+      if (!histograms)
+	continue;
+
+      counters =
+	stat_segment_pointer (shared_header,
+			      sm->directory_vector
+			      [STAT_COUNTER_NODE_CLOCKS_HISTOGRAM].offset);
+      c = counters[j];
+      for (i = 0; i < vec_len (histograms) && i < no_max_histogram_nodes;
+	   i++)
+	clib_memcpy_fast (c + i * VLIB_NODE_HISTOGRAM_CLOCK_BUCKETS,
+			  histograms[i].clocks,
+			  sizeof (histograms[i].clocks));
+
+      counters =
+	stat_segment_pointer (shared_header,
+			      sm->directory_vector
+			      [STAT_COUNTER_NODE_VECTORS_HISTOGRAM].offset);
+      c = counters[j];
+      for (i = 0; i < vec_len (histograms) && i < no_max_histogram_nodes;
+	   i++)
+	clib_memcpy_fast (c + i * VLIB_NODE_HISTOGRAM_VECTOR_BUCKETS,
+			  histograms[i].vectors,
+			  sizeof (histograms[i].vectors));
     }
 }
 
+/*
+ * Summary entries: for each per-thread counter vector keep a single
+ * thread vector "/aggregate<name>" with the sum across threads, so
+ * scrapers read one vector instead of one per thread. The summary's
+ * offset vector carries a second slot, a bitmap of the counters which
+ * changed in the last collector pass (see stat_segment_dump_delta).
+ *
+ * Each pass re-sums every thread's vector, O(counters x threads): workers
+ * don't flag what they touched, so there is nothing cheaper to go by. The
+ * summaries are a snapshot up to update_interval old, not live counters.
+ */
+static u32
+stat_segment_aggregate_add (stat_segment_main_t * sm, u32 index)
+{
+  stat_segment_directory_entry_t e = { 0 };
+  char *name = sm->directory_vector[index].name;
+  void *oldheap;
+  u32 ai;
+
+  if (strlen (STAT_SEGMENT_AGGREGATE_PREFIX) + strlen (name) >=
+      sizeof (e.name))
+    return ~0;
+
+  e.type = sm->directory_vector[index].type;
+  strcpy (e.name, STAT_SEGMENT_AGGREGATE_PREFIX);
+  strcat (e.name, name);
+
+  oldheap = clib_mem_set_heap (sm->heap);
+  vlib_stat_segment_lock ();
+  ai = stat_segment_directory_add (&e);
+  vlib_stat_segment_unlock ();
+  clib_mem_set_heap (oldheap);
+
+  return ai;
+}
+
+static void
+stat_segment_aggregate_update (stat_segment_main_t * sm, u32 index, u32 ai)
+{
+  stat_segment_shared_header_t *shared_header = sm->shared_header;
+  stat_segment_directory_entry_t *ep, *aep;
+  counter_t **threads, **counters = 0, *c, *old;
+  u64 *offset_vector = 0, *changed = 0;
+  uword elt_bytes, n_words, n = 0, n_old;
+  void *oldheap;
+  int i, j;
+
+  ep = vec_elt_at_index (sm->directory_vector, index);
+  elt_bytes = ep->type == STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE ?
+    sizeof (counter_t) : sizeof (vlib_counter_t);
+  n_words = elt_bytes / sizeof (counter_t);
+
+  threads = stat_segment_pointer (shared_header, ep->offset);
+  for (i = 0; i < vec_len (threads); i++)
+    n = clib_max (n, vec_len (threads[i]));
+  if (n == 0)
+    return;
+
+  vec_validate (sm->aggregate_sums, n * n_words - 1);
+  clib_memset (sm->aggregate_sums, 0, n * elt_bytes);
+  for (i = 0; i < vec_len (threads); i++)
+    {
+      c = threads[i];
+      for (j = 0; j < vec_len (c) * n_words; j++)
+	sm->aggregate_sums[j] += c[j];
+    }
+
+  aep = vec_elt_at_index (sm->directory_vector, ai);
+  if (aep->offset)
+    {
+      counters = stat_segment_pointer (shared_header, aep->offset);
+      offset_vector = stat_segment_pointer (shared_header,
+					    aep->offset_vector);
+      changed = stat_segment_pointer (shared_header, offset_vector[1]);
+    }
+
+  oldheap = clib_mem_set_heap (sm->heap);
+  n_old = counters ? vec_len (counters[0]) : 0;
+  if (n_old < n)
+    {
+      vlib_stat_segment_lock ();
+      vlib_stats_vec_validate (counters, 0);
+      vlib_stats_vec_validate (offset_vector, 1);
+      counters[0] = vlib_stats_vec_validate_ (counters[0], n - 1, elt_bytes);
+      vlib_stats_vec_validate (changed, (n - 1) / BITS (u64));
+      offset_vector[0] = stat_segment_offset (shared_header, counters[0]);
+      offset_vector[1] = stat_segment_offset (shared_header, changed);
+      stat_segment_publish (aep, counters, offset_vector);
+      vlib_stat_segment_unlock ();
+    }
+
+  /* New counters count as changed */
+  old = counters[0];
+  clib_memset (changed, 0, vec_len (changed) * sizeof (changed[0]));
+  for (j = 0; j < n; j++)
+    if (j >= n_old || memcmp (old + j * n_words,
+			      sm->aggregate_sums + j * n_words, elt_bytes))
+      changed[j / BITS (u64)] |= 1ULL << (j % BITS (u64));
+
+  clib_memcpy_fast (counters[0], sm->aggregate_sums, n * elt_bytes);
+  clib_mem_set_heap (oldheap);
+}
+
+static void
+update_aggregates (stat_segment_main_t * sm)
+{
+  stat_segment_directory_entry_t *ep;
+  u32 i, ai;
+
+  /*
+   * Sequence count, odd while the summaries and change bitmaps are being
+   * rewritten, so delta readers can tell they saw one whole pass.
+   */
+  sm->directory_vector[STAT_COUNTER_AGGREGATE_SEQ].value += 1;
+  CLIB_MEMORY_STORE_BARRIER ();
+
+  /* Summary entries added here are appended, and skipped below */
+  for (i = 0; i < vec_len (sm->directory_vector); i++)
+    {
+      ep = vec_elt_at_index (sm->directory_vector, i);
+      if ((ep->type != STAT_DIR_TYPE_COUNTER_VECTOR_SIMPLE &&
+	   ep->type != STAT_DIR_TYPE_COUNTER_VECTOR_COMBINED) ||
+	  ep->offset == 0 || clib_bitmap_get (sm->aggregate_bitmap, i))
+	continue;
+
+      vec_validate_init_empty (sm->aggregate_by_index, i, ~0);
+      ai = sm->aggregate_by_index[i];
+      if (ai == ~0)
+	{
+	  ai = stat_segment_aggregate_add (sm, i);
+	  if (ai == ~0)
+	    continue;
+	  sm->aggregate_by_index[i] = ai;
+	  sm->aggregate_bitmap = clib_bitmap_set (sm->aggregate_bitmap, ai, 1);
+	}
+      stat_segment_aggregate_update (sm, i, ai);
+    }
+
+  CLIB_MEMORY_STORE_BARRIER ();
+  sm->directory_vector[STAT_COUNTER_AGGREGATE_SEQ].value += 1;
+}
+
 static void
 do_stat_segment_updates (stat_segment_main_t * sm)
 {
@@ -542,8 +866,13 @@ do_stat_segment_updates (stat_segment_main_t * sm)
   }));
   /* *INDENT-ON* */
 
+  if (sm->aggregate_counters_enabled)
+    update_aggregates (sm);
+
   /* Heartbeat, so clients detect we're still here */
   sm->directory_vector[STAT_COUNTER_HEARTBEAT].value++;
+
+  stat_segment_reclaim (sm, unix_time_now ());
 }
 
 /*
@@ -619,13 +948,10 @@ stat_segment_collector_process (vlib_main_t * vm, vlib_node_runtime_t * rt,
 {
   stat_segment_main_t *sm = &stat_segment_main;
 
-  /* Wait for Godot... */
-  f64 sleep_duration = 10;
-
   while (1)
     {
       do_stat_segment_updates (sm);
-      vlib_process_suspend (vm, sleep_duration);
+      vlib_process_suspend (vm, sm->update_interval);
     }
   return 0;			/* or not */
 }
@@ -666,11 +992,7 @@ stat_segment_register_gauge (u8 * name, stat_segment_update_fn update_fn,
   e.type = STAT_DIR_TYPE_SCALAR_INDEX;
 
   memcpy (e.name, name, vec_len (name));
-  index = vec_len (sm->directory_vector);
-  vec_add1 (sm->directory_vector, e);
-
-  shared_header->directory_offset =
-    stat_segment_offset (shared_header, sm->directory_vector);
+  index = stat_segment_directory_add (&e);
 
   vlib_stat_segment_unlock ();
   clib_mem_set_heap (oldheap);
@@ -691,6 +1013,7 @@ statseg_config (vlib_main_t * vm, unformat_input_t * input)
 
   /* set default socket file name when statseg config stanza is empty. */
   sm->socket_name = format (0, "%s", STAT_SEGMENT_SOCKET_FILE);
+  sm->update_interval = 10.0;
 
   while (unformat_check_input (input) != UNFORMAT_END_OF_INPUT)
     {
@@ -706,6 +1029,15 @@ statseg_config (vlib_main_t * vm, unformat_input_t * input)
 	sm->node_counters_enabled = 1;
       else if (unformat (input, "per-node-counters off"))
 	sm->node_counters_enabled = 0;
+      else if (unformat (input, "aggregate-counters on"))
+	sm->aggregate_counters_enabled = 1;
+      else if (unformat (input, "aggregate-counters off"))
+	sm->aggregate_counters_enabled = 0;
+      else if (unformat (input, "update-interval %f", &sm->update_interval))
+	{
+	  if (sm->update_interval <= 0.0)
+	    return clib_error_return (0, "update-interval must be positive");
+	}
       else
 	return clib_error_return (0, "unknown input `%U'",
 				  format_unformat_error, input);
@@ -722,7 +1054,7 @@ statseg_sw_interface_add_del (vnet_main_t * vnm, u32 sw_if_index, u32 is_add)
   void *oldheap = vlib_stats_push_heap ();
   vlib_stat_segment_lock ();
 
-  vec_validate (sm->interfaces, sw_if_index);
+  vlib_stats_vec_validate (sm->interfaces, sw_if_index);
   if (is_add)
     {
       vnet_sw_interface_t *si = vnet_get_sw_interface (vnm, sw_if_index);
@@ -738,31 +1070,31 @@ statseg_sw_interface_add_del (vnet_main_t * vnm, u32 sw_if_index, u32 is_add)
       if (si->type != VNET_SW_INTERFACE_TYPE_HARDWARE)
 	s = format (s, ".%d", si->sub.id);
       s = format (s, "%c", 0);
+      vlib_stats_retire (sm->interfaces[sw_if_index]);
       sm->interfaces[sw_if_index] = s;
     }
   else
     {
-      vec_free (sm->interfaces[sw_if_index]);
+      vlib_stats_retire (sm->interfaces[sw_if_index]);
       sm->interfaces[sw_if_index] = 0;
     }
 
   stat_segment_directory_entry_t *ep;
   ep = &sm->directory_vector[STAT_COUNTER_INTERFACE_NAMES];
-  ep->offset = stat_segment_offset (shared_header, sm->interfaces);
 
   int i;
   u64 *offset_vector =
     ep->offset_vector ? stat_segment_pointer (shared_header,
 					      ep->offset_vector) : 0;
 
-  vec_validate (offset_vector, vec_len (sm->interfaces) - 1);
+  vlib_stats_vec_validate (offset_vector, vec_len (sm->interfaces) - 1);
   for (i = 0; i < vec_len (sm->interfaces); i++)
     {
       offset_vector[i] =
 	sm->interfaces[i] ? stat_segment_offset (shared_header,
 						 sm->interfaces[i]) : 0;
     }
-  ep->offset_vector = stat_segment_offset (shared_header, offset_vector);
+  stat_segment_publish (ep, sm->interfaces, offset_vector);
 
   vlib_stat_segment_unlock ();
   clib_mem_set_heap (oldheap);
@@ -32,8 +32,13 @@ typedef enum
  STAT_COUNTER_NODE_VECTORS,
  STAT_COUNTER_NODE_CALLS,
  STAT_COUNTER_NODE_SUSPENDS,
+ STAT_COUNTER_NODE_CLOCKS_HISTOGRAM,
+ STAT_COUNTER_NODE_VECTORS_HISTOGRAM,
+ STAT_COUNTER_NODE_CLOCKS_HISTOGRAM_BOUNDS,
+ STAT_COUNTER_NODE_VECTORS_HISTOGRAM_BOUNDS,
  STAT_COUNTER_INTERFACE_NAMES,
  STAT_COUNTER_NODE_NAMES,
+ STAT_COUNTER_AGGREGATE_SEQ,
  STAT_COUNTERS
 } stat_segment_counter_t;
 
@@ -47,8 +52,13 @@ typedef enum
   _(NODE_VECTORS, COUNTER_VECTOR_SIMPLE, vectors, /sys/node)	\
   _(NODE_CALLS, COUNTER_VECTOR_SIMPLE, calls, /sys/node)	\
   _(NODE_SUSPENDS, COUNTER_VECTOR_SIMPLE, suspends, /sys/node)	\
+  _(NODE_CLOCKS_HISTOGRAM, COUNTER_VECTOR_SIMPLE, clocks_histogram, /sys/node) \
+  _(NODE_VECTORS_HISTOGRAM, COUNTER_VECTOR_SIMPLE, vectors_histogram, /sys/node) \
+  _(NODE_CLOCKS_HISTOGRAM_BOUNDS, COUNTER_VECTOR_SIMPLE, clocks_histogram_bounds, /sys/node) \
+  _(NODE_VECTORS_HISTOGRAM_BOUNDS, COUNTER_VECTOR_SIMPLE, vectors_histogram_bounds, /sys/node) \
   _(INTERFACE_NAMES, NAME_VECTOR, names, /if)                   \
-  _(NODE_NAMES, NAME_VECTOR, names, /sys/node)
+  _(NODE_NAMES, NAME_VECTOR, names, /sys/node)			\
+  _(AGGREGATE_SEQ, SCALAR_INDEX, aggregate_seq, /sys)
 
 typedef struct
 {
@@ -65,6 +75,13 @@ typedef struct
 /* Default stat segment 32m */
 #define STAT_SEGMENT_DEFAULT_SIZE	(32<<20)
 
+/*
+ * Vectors which move are freed no sooner than this (seconds) after.
+ * reclaim_gen is odd while they are being freed and changes each time, a
+ * reader which saw it change across a copy read it again.
+ */
+#define STAT_SEGMENT_RECLAIM_DELAY	20.0
+
 /*
  * Shared header first in the shared memory segment.
  */
@@ -75,6 +92,7 @@ typedef struct
   atomic_int_fast64_t directory_offset;
   atomic_int_fast64_t error_offset;
   atomic_int_fast64_t stats_offset;
+  atomic_int_fast64_t reclaim_gen;
 } stat_segment_shared_header_t;
 
 static inline uint64_t
@@ -97,11 +115,23 @@ typedef struct {
   u32 caller_index;
 } stat_segment_gauges_pool_t;
 
+typedef struct {
+  void *vector;
+  f64 retired_at;
+} stat_segment_retired_t;
+
 typedef struct
 {
   /* internal, does not point to shared memory */
   stat_segment_gauges_pool_t *gauges;
 
+  /* directory index to summary entry index, ~0 if none yet */
+  u32 *aggregate_by_index;
+  /* directory indices which are summary entries themselves */
+  uword *aggregate_bitmap;
+  /* scratch for summing the per-thread vectors */
+  counter_t *aggregate_sums;
+
   /* statistics segment */
   uword *directory_vector_by_name;
   stat_segment_directory_entry_t *directory_vector;
@@ -113,7 +143,10 @@ typedef struct
   u8 *socket_name;
   ssize_t memory_size;
   u8 node_counters_enabled;
+  u8 aggregate_counters_enabled;
+  f64 update_interval;
   void *heap;
+  stat_segment_retired_t *retired;	/* on the stats heap */
   stat_segment_shared_header_t *shared_header;	/* pointer to shared memory segment */
   int memfd;
 
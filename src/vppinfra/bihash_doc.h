@@ -154,6 +154,30 @@ void clib_bihash_prefetch_bucket (clib_bihash * h, u64 hash);
 */
 void clib_bihash_prefetch_data (clib_bihash * h, u64 hash);
 
+/** Prefetch all the (key,value) pairs in the page a hash code selects
+
+    @param h - the bi-hash table to search
+    @param hash - the hash code
+    @note assumes that the bucket has been prefetched, see
+     clib_bihash_prefetch_bucket
+*/
+void clib_bihash_prefetch_page (clib_bihash * h, u64 hash);
+
+/** Search a bi-hash table for a batch of keys
+
+    @param h - the bi-hash table to search
+    @param in_out_kvs - (key,value) pairs containing the search keys
+    @param hashes - the hash code of each key
+    @param found - set to 1 for each key found (with in_out_kvs set), else 0
+    @param n_keys - the number of keys
+    @returns the number of keys found
+    @note the bucket and page prefetches for later keys are pipelined with
+    the search for earlier keys, BIHASH_SEARCH_BATCH_STRIDE apart
+*/
+u32 clib_bihash_search_batch
+  (clib_bihash * h, clib_bihash_kv * in_out_kvs, u64 * hashes, u8 * found,
+   u32 n_keys);
+
 /** Search a bi-hash table
 
     @param h - the bi-hash table to search
@@ -402,6 +402,66 @@ static inline int BV (clib_bihash_search_inline_2)
 }
 
 
+static inline void BV (clib_bihash_prefetch_page)
+  (BVT (clib_bihash) * h, u64 hash)
+{
+  u32 bucket_index;
+  BVT (clib_bihash_value) * v;
+  BVT (clib_bihash_bucket) * b;
+
+  bucket_index = hash & (h->nbuckets - 1);
+  b = &h->buckets[bucket_index];
+
+  if (PREDICT_FALSE (BV (clib_bihash_bucket_is_empty) (b)))
+    return;
+
+  hash >>= h->log2_nbuckets;
+  v = BV (clib_bihash_get_value) (h, b->offset);
+
+  v += (b->linear_search == 0) ? hash & ((1 << b->log2_pages) - 1) : 0;
+
+  /* all of the (key,value) pairs the search may compare */
+  CLIB_PREFETCH (v, sizeof (*v), READ);
+}
+
+/*
+ * Distance, in keys, between the stages of the batch search. The bucket
+ * for key i + 2 * stride is prefetched, then the page for key i + stride,
+ * whilst key i is compared.
+ */
+#ifndef BIHASH_SEARCH_BATCH_STRIDE
+#define BIHASH_SEARCH_BATCH_STRIDE 4
+#endif
+
+static inline u32 BV (clib_bihash_search_batch)
+  (BVT (clib_bihash) * h,
+   BVT (clib_bihash_kv) * kvs, u64 * hashes, u8 * found, u32 n_keys)
+{
+  const u32 stride = BIHASH_SEARCH_BATCH_STRIDE;
+  u32 i, n_found = 0;
+
+  for (i = 0; i < clib_min (n_keys, 2 * stride); i++)
+    BV (clib_bihash_prefetch_bucket) (h, hashes[i]);
+  for (i = 0; i < clib_min (n_keys, stride); i++)
+    BV (clib_bihash_prefetch_page) (h, hashes[i]);
+
+  for (i = 0; i < n_keys; i++)
+    {
+      if (i + 2 * stride < n_keys)
+	BV (clib_bihash_prefetch_bucket) (h, hashes[i + 2 * stride]);
+      if (i + stride < n_keys)
+	BV (clib_bihash_prefetch_page) (h, hashes[i + stride]);
+
+      found[i] =
+	(0 == BV (clib_bihash_search_inline_with_hash) (h, hashes[i],
+							 &kvs[i]));
+      n_found += found[i];
+    }
+
+  return n_found;
+}
+
+
 #endif /* __included_bihash_template_h__ */
 
 /** @endcond */
@@ -124,6 +124,7 @@ _ (avx2,     7, ebx, 5)   \
 _ (avx512f,  7, ebx, 16)  \
 _ (x86_aes,  1, ecx, 25)  \
 _ (sha,      7, ebx, 29)  \
+_ (vaes,     7, ecx, 9)   \
 _ (invariant_tsc, 0x80000007, edx, 8)
 
 
@@ -227,7 +228,7 @@ static inline int clib_cpu_supports_ ## flag() { return 0; }
   static inline int
 clib_cpu_supports_aes ()
 {
-#if defined (__aarch64__)
+#if defined (__x86_64__)
   return clib_cpu_supports_x86_aes ();
 #elif defined (__aarch64__)
   return clib_cpu_supports_aarch64_aes ();
@@ -450,6 +450,128 @@ test_bihash (test_main_t * tm)
   return 0;
 }
 
+#define TEST_BIHASH_BATCH_SIZE 256
+
+static clib_error_t *
+test_bihash_batch (test_main_t * tm)
+{
+  BVT (clib_bihash_kv) kv, *kvs = 0;
+  BVT (clib_bihash) * h;
+  u64 *hashes = 0;
+  u8 *found = 0;
+  uword total_searches;
+  f64 before, scalar, batch;
+  int i, j, n;
+
+  h = &tm->hash;
+  BV (clib_bihash_init) (h, "test", tm->nbuckets, tm->hash_memory_size);
+
+  fformat (stdout, "Add %d items...\n", tm->nitems);
+
+  for (i = 0; i < tm->nitems; i++)
+    {
+      u64 rndkey;
+
+    again:
+      rndkey = random_u64 (&tm->seed);
+      if (hash_get (tm->key_hash, rndkey))
+	goto again;
+
+      hash_set (tm->key_hash, rndkey, i + 1);
+      vec_add1 (tm->keys, rndkey);
+
+      kv.key = rndkey;
+      kv.value = i + 1;
+      BV (clib_bihash_add_del) (h, &kv, 1 /* is_add */ );
+    }
+
+  vec_validate (kvs, TEST_BIHASH_BATCH_SIZE - 1);
+  vec_validate (hashes, TEST_BIHASH_BATCH_SIZE - 1);
+  vec_validate (found, TEST_BIHASH_BATCH_SIZE - 1);
+
+  fformat (stdout, "Search for items %d times, one at a time...\n",
+	   tm->search_iter);
+
+  before = clib_time_now (&tm->clib_time);
+
+  for (j = 0; j < tm->search_iter; j++)
+    {
+      for (i = 0; i < tm->nitems; i++)
+	{
+	  kv.key = tm->keys[i];
+	  if (BV (clib_bihash_search_inline) (h, &kv) < 0 ||
+	      kv.value != (u64) (i + 1))
+	    clib_warning ("[%d] search for key %lld failed", i, tm->keys[i]);
+	}
+    }
+
+  scalar = clib_time_now (&tm->clib_time) - before;
+
+  fformat (stdout, "Search for items %d times, %d at a time...\n",
+	   tm->search_iter, TEST_BIHASH_BATCH_SIZE);
+
+  before = clib_time_now (&tm->clib_time);
+
+  for (j = 0; j < tm->search_iter; j++)
+    {
+      for (i = 0; i < tm->nitems; i += n)
+	{
+	  int k;
+
+	  n = clib_min (TEST_BIHASH_BATCH_SIZE, tm->nitems - i);
+
+	  for (k = 0; k < n; k++)
+	    {
+	      kvs[k].key = tm->keys[i + k];
+	      hashes[k] = BV (clib_bihash_hash) (&kvs[k]);
+	    }
+
+	  if (BV (clib_bihash_search_batch) (h, kvs, hashes, found, n) != n)
+	    clib_warning ("[%d] batch search failed", i);
+
+	  for (k = 0; k < n; k++)
+	    if (!found[k] || kvs[k].value != (u64) (i + k + 1))
+	      clib_warning ("[%d] batch search for key %lld failed", i + k,
+			    tm->keys[i + k]);
+	}
+    }
+
+  batch = clib_time_now (&tm->clib_time) - before;
+  total_searches = (uword) tm->search_iter * (uword) tm->nitems;
+
+  fformat (stdout, "%lld searches: one at a time %.6f seconds, "
+	   "batched %.6f seconds\n", total_searches, scalar, batch);
+  if (scalar > 0 && batch > 0)
+    fformat (stdout, "%.f vs %.f searches per second\n",
+	     ((f64) total_searches) / scalar, ((f64) total_searches) / batch);
+
+  /* and misses, which must leave the keys untouched */
+  for (i = 0; i < TEST_BIHASH_BATCH_SIZE; i++)
+    {
+      do
+	kvs[i].key = random_u64 (&tm->seed);
+      while (hash_get (tm->key_hash, kvs[i].key));
+      kvs[i].value = ~0ULL;
+      hashes[i] = BV (clib_bihash_hash) (&kvs[i]);
+    }
+  if (BV (clib_bihash_search_batch) (h, kvs, hashes, found,
+				     TEST_BIHASH_BATCH_SIZE) != 0)
+    clib_warning ("batch search found missing keys");
+  for (i = 0; i < TEST_BIHASH_BATCH_SIZE; i++)
+    if (found[i] || kvs[i].value != ~0ULL)
+      clib_warning ("[%d] batch search for missing key %lld found",
+		    i, kvs[i].key);
+
+  fformat (stdout, "%U", BV (format_bihash), h, 0 /* very verbose */ );
+
+  vec_free (kvs);
+  vec_free (hashes);
+  vec_free (found);
+  BV (clib_bihash_free) (h);
+
+  return 0;
+}
+
 clib_error_t *
 test_bihash_main (test_main_t * tm)
 {
@@ -492,6 +614,8 @@ test_bihash_main (test_main_t * tm)
 	tm->verbose = 1;
       else if (unformat (i, "stale-overwrite"))
 	which = 3;
+      else if (unformat (i, "batch"))
+	which = 4;
       else
 	return clib_error_return (0, "unknown input '%U'",
 				  format_unformat_error, i);
@@ -521,6 +645,10 @@ test_bihash_main (test_main_t * tm)
       error = test_bihash_stale_overwrite (tm);
       break;
 
+    case 4:
+      error = test_bihash_batch (tm);
+      break;
+
     default:
       return clib_error_return (0, "no such test?");
     }
@@ -212,6 +212,24 @@ u32x8_gather (void *p0, void *p1, void *p2, void *p3, void *p4, void *p5,
 }
 
 
+/* gather u32 elements at base + index, in units of u32 */
+static_always_inline u32x8
+u32x8_gather_u32 (void *base, u32x8 index)
+{
+  return (u32x8) _mm256_i32gather_epi32 ((const int *) base,
+					 (__m256i) index, 4);
+}
+
+/* as above, lanes with a clear mask keep their value from src */
+static_always_inline u32x8
+u32x8_mask_gather_u32 (u32x8 src, void *base, u32x8 index, u32x8 mask)
+{
+  return (u32x8) _mm256_mask_i32gather_epi32 ((__m256i) src,
+					      (const int *) base,
+					      (__m256i) index,
+					      (__m256i) mask, 4);
+}
+
 static_always_inline void
 u64x4_scatter (u64x4 r, void *p0, void *p1, void *p2, void *p3)
 {
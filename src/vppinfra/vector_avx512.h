@@ -69,6 +69,21 @@ u16x32_msb_mask (u16x32 v)
   return (u32) _mm512_movepi16_mask ((__m512i) v);
 }
 
+/* gather u32 elements at base + index, in units of u32 */
+static_always_inline u32x16
+u32x16_gather_u32 (void *base, u32x16 index)
+{
+  return (u32x16) _mm512_i32gather_epi32 ((__m512i) index, base, 4);
+}
+
+/* as above, lanes with a clear mask bit keep their value from src */
+static_always_inline u32x16
+u32x16_mask_gather_u32 (u32x16 src, void *base, u32x16 index, u16 mask)
+{
+  return (u32x16) _mm512_mask_i32gather_epi32 ((__m512i) src, mask,
+					       (__m512i) index, base, 4);
+}
+
 #endif /* included_vector_avx512_h */
 /*
  * fd.io coding-style-patch-verification: ON
@@ -38,6 +38,8 @@ static char *app_name = NULL;
 static char *api_prefix = NULL;
 static const int max_outstanding_requests = 64;
 static const int response_queue_size = 32;
+/* small enough for pipelined requests to fill it */
+static const int request_ring_size = 4;
 
 /* centos has ancient check so we hack our way around here
  * to make it work somehow */
@@ -445,6 +447,30 @@ setup_nonblocking (void)
   ck_assert_int_eq (VAPI_OK, rv);
 }
 
+void
+setup_ring_blocking (void)
+{
+  vapi_error_e rv = vapi_ctx_alloc (&ctx);
+  ck_assert_int_eq (VAPI_OK, rv);
+  rv = vapi_set_request_ring_size (ctx, request_ring_size);
+  ck_assert_int_eq (VAPI_OK, rv);
+  rv = vapi_connect (ctx, app_name, api_prefix, max_outstanding_requests,
+		     response_queue_size, VAPI_MODE_BLOCKING, true);
+  ck_assert_int_eq (VAPI_OK, rv);
+}
+
+void
+setup_ring_nonblocking (void)
+{
+  vapi_error_e rv = vapi_ctx_alloc (&ctx);
+  ck_assert_int_eq (VAPI_OK, rv);
+  rv = vapi_set_request_ring_size (ctx, request_ring_size);
+  ck_assert_int_eq (VAPI_OK, rv);
+  rv = vapi_connect (ctx, app_name, api_prefix, max_outstanding_requests,
+		     response_queue_size, VAPI_MODE_NONBLOCKING, true);
+  ck_assert_int_eq (VAPI_OK, rv);
+}
+
 void
 teardown (void)
 {
@@ -957,6 +983,25 @@ test_suite (void)
   tcase_add_test (tc_nonblock, test_no_response_2);
   suite_add_tcase (s, tc_nonblock);
 
+  TCase *tc_ring_block = tcase_create ("Blocking API on a request ring");
+  tcase_set_timeout (tc_ring_block, 25);
+  tcase_add_checked_fixture (tc_ring_block, setup_ring_blocking, teardown);
+  tcase_add_test (tc_ring_block, test_show_version_1);
+  tcase_add_test (tc_ring_block, test_show_version_2);
+  tcase_add_test (tc_ring_block, test_loopbacks_1);
+  suite_add_tcase (s, tc_ring_block);
+
+  TCase *tc_ring_nonblock =
+    tcase_create ("Nonblocking API on a request ring");
+  tcase_set_timeout (tc_ring_nonblock, 25);
+  tcase_add_checked_fixture (tc_ring_nonblock, setup_ring_nonblocking,
+			     teardown);
+  tcase_add_test (tc_ring_nonblock, test_show_version_3);
+  tcase_add_test (tc_ring_nonblock, test_show_version_4);
+  tcase_add_test (tc_ring_nonblock, test_show_version_5);
+  tcase_add_test (tc_ring_nonblock, test_loopbacks_2);
+  suite_add_tcase (s, tc_ring_nonblock);
+
   TCase *tc_unsupported = tcase_create ("Unsupported message");
   tcase_add_checked_fixture (tc_unsupported, setup_blocking, teardown);
   tcase_add_test (tc_unsupported, test_unsupported);
@@ -4,6 +4,7 @@
 
 import unittest
 import random
+import re
 
 from scapy.packet import Raw
 from scapy.layers.l2 import Ether
@@ -1480,5 +1481,77 @@ class TestACLplugin(VppTestCase):
 
         self.logger.info("ACLP_TEST_FINISH_0315")
 
+
+class TestACLpluginBitvector(TestACLplugin):
+    """ ACL plugin Test Case, bit-vector lookup engine """
+
+    # acl-plugin startup config of the test case
+    acl_plugin_config = ["use", "bitvector", "lookup", "1"]
+    # does the classifier of test_0400 exceed bitvector max memory
+    bitvector_fallback = False
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestACLpluginBitvector, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["acl-plugin", "{"] + cls.acl_plugin_config +
+                               ["}"])
+
+    def test_0400_bitvector_engine(self):
+        """ match a large ACL with the bit-vector engine
+        """
+        self.logger.info("ACLP_TEST_START_0400")
+
+        # Add an ACL with one rule per port
+        n_rules = 500
+        rules = []
+        for i in range(n_rules):
+            rules.append(self.create_rule(self.IPV4, self.PERMIT, 1000 + i,
+                                          self.proto[self.IP][self.TCP]))
+        # deny ip any any in the end
+        rules.append(self.create_rule(self.IPV4, self.DENY, self.PORTS_ALL, 0))
+
+        # Apply rules
+        self.apply_rules(rules, b"permit ip4 tcp 1000-1499")
+
+        lookup_contexts = self.vapi.ppcli("show acl-plugin lookup context")
+        self.logger.info(lookup_contexts)
+        self.assertIn("engine: bitvector", lookup_contexts)
+        if self.bitvector_fallback:
+            self.assertIn("over bitvector max memory", lookup_contexts)
+            self.assertNotIn("bitvector ip4:", lookup_contexts)
+
+            # the note reports the failed build, not the engine setting
+            lc_index = int(re.search(r"index (\d+):.*over bitvector",
+                                     lookup_contexts).group(1))
+            self.vapi.cli("set acl-plugin lookup-context %d engine hash" %
+                          lc_index)
+            self.assertNotIn("over bitvector max memory",
+                             self.vapi.ppcli("show acl-plugin lookup context"))
+            self.vapi.cli("set acl-plugin lookup-context %d engine bitvector" %
+                          lc_index)
+            self.assertIn("over bitvector max memory",
+                          self.vapi.ppcli("show acl-plugin lookup context"))
+        else:
+            self.assertNotIn("over bitvector max memory", lookup_contexts)
+            self.assertIn("bitvector ip4: %d rules" % (n_rules + 1),
+                          lookup_contexts)
+
+        # Traffic should still pass
+        self.run_verify_test(self.IP, self.IPV4,
+                             self.proto[self.IP][self.TCP],
+                             1000 + n_rules // 2)
+
+        self.logger.info("ACLP_TEST_FINISH_0400")
+
+
+class TestACLpluginBitvectorFallback(TestACLpluginBitvector):
+    """ ACL plugin Test Case, bit-vector engine over its memory limit """
+
+    # the 500 rules of test_0400 need about 150k, the others fit
+    acl_plugin_config = TestACLpluginBitvector.acl_plugin_config + \
+        ["bitvector", "max", "memory", "64k"]
+    bitvector_fallback = True
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -408,3 +408,13 @@ class ACLPluginConnTestCase(VppTestCase):
     def test_3006_tcp_transient_teardown_conn_test(self):
         """ IPv6: transient TCP session (3WHS,ACK,FINACK), ref. on egress """
         self.run_tcp_transient_teardown_conn_test(AF_INET6, 1)
+
+
+class ACLPluginConnBitvectorTestCase(ACLPluginConnTestCase):
+    """ ACL plugin connection-oriented testcases, bit-vector engine """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(ACLPluginConnBitvectorTestCase, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["acl-plugin", "{", "use", "bitvector",
+                                "lookup", "1", "}"])
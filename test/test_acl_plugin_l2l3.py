@@ -844,5 +844,15 @@ class TestACLpluginL2L3(VppTestCase):
                                                       self.STATEFUL_ICMP)
 
 
+class TestACLpluginL2L3Bitvector(TestACLpluginL2L3):
+    """TestACLpluginL2L3 Test Case, bit-vector lookup engine"""
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestACLpluginL2L3Bitvector, cls).setUpConstants()
+        cls.vpp_cmdline.extend(["acl-plugin", "{", "use", "bitvector",
+                                "lookup", "1", "}"])
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -0,0 +1,79 @@
+#!/usr/bin/env python
+""" Binary API client transport tests """
+
+import os
+import time
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+@unittest.skipUnless(os.geteuid() == 0,
+                     "vpp takes the client's eventfds, which needs root")
+class TestAPIClientRequestRing(VppTestCase):
+    """ API client with a request ring of its own """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestAPIClientRequestRing, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestAPIClientRequestRing, cls).tearDownClass()
+
+    def test_request_ring_pipelined(self):
+        """ Pipelined requests on a full request ring """
+        n_pings = 1000
+        replies = []
+
+        def callback(msgname, msg):
+            replies.append(msg)
+
+        #
+        # reconnect the test's client, asynchronously and with a ring
+        # much smaller than the number of requests in flight, so that
+        # the client sleeps until vpp makes room
+        #
+        vpp = self.vapi.vpp
+        self.vapi.disconnect()
+        try:
+            vpp.connect("ring-client", self.shm_prefix, do_async=True,
+                        request_ring_size=8)
+            vpp.register_event_callback(callback)
+
+            for i in range(n_pings):
+                vpp.api.control_ping(context=i + 1)
+            vpp.api.cli_inband(cmd="show api clients",
+                               context=n_pings + 1)
+
+            deadline = time.time() + 10
+            while len(replies) < n_pings + 1 and time.time() < deadline:
+                time.sleep(0.1)
+            vpp.disconnect()
+        finally:
+            self.vapi.connect()
+
+        #
+        # every request is answered, in order
+        #
+        self.assertEqual(len(replies), n_pings + 1)
+        self.assertEqual([r.context for r in replies],
+                         list(range(1, n_pings + 2)))
+        self.assertEqual(type(replies[-1]).__name__, "cli_inband_reply")
+
+        #
+        # and came on the client's own ring
+        #
+        clients = replies[-1].reply
+        self.logger.info(clients)
+        self.assertIn("ring-client", clients)
+        self.assertIn("request ring", clients)
+
+        #
+        # the reconnected client is back on the shared queue
+        #
+        self.assertNotIn("request ring", self.vapi.cli("show api clients"))
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
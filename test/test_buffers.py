@@ -0,0 +1,30 @@
+#!/usr/bin/env python
+
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestBuffers(VppTestCase):
+    """ Buffer pool Test Cases """
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestBuffers, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestBuffers, cls).tearDownClass()
+
+    def test_buffer_numa(self):
+        """ rx queue pool selection and remote buffer counters """
+        reply = self.vapi.cli("test buffer numa")
+        self.logger.info(reply)
+        self.assertIn("OK", reply)
+
+        # the test thread's counters are cleared once it is done
+        self.assertNotIn("Remote Alloc", self.vapi.cli("show buffers"))
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
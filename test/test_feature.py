@@ -0,0 +1,20 @@
+#!/usr/bin/env python
+
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestFeature(VppTestCase):
+    """ Feature Arc Test Case """
+
+    def test_feature_start(self):
+        """ Feature arc start after enable and disable """
+        reply = self.vapi.cli("test feature start")
+
+        self.logger.info(reply)
+        self.assertNotIn("failed", reply)
+        self.assertIn("OK", reply)
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
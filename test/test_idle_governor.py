@@ -0,0 +1,41 @@
+#!/usr/bin/env python
+
+import unittest
+
+from framework import VppTestCase, VppTestRunner
+
+
+class TestIdleGovernor(VppTestCase):
+    """ Worker idle governor Test Cases """
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestIdleGovernor, cls).setUpConstants()
+        # long sleeps, so that a missed wake-up shows as a slow one
+        i = cls.vpp_cmdline.index("main-core")
+        cls.vpp_cmdline[i + 2:i + 2] = ["workers", "1",
+                                        "idle-max-sleep-usec", "1000000",
+                                        "idle-poll-loops", "16"]
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestIdleGovernor, cls).setUpClass()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestIdleGovernor, cls).tearDownClass()
+
+    def test_idle_wakeup(self):
+        """ sleeping workers are woken for barriers and interrupts """
+        reply = self.vapi.cli("test idle rounds 4")
+        self.logger.info(reply)
+        self.assertIn("OK", reply)
+
+        # and the worker did go to sleep in between
+        reply = self.vapi.cli("show runtime")
+        self.assertIn("sleeps", reply)
+        self.assertNotIn(" 0 sleeps", reply)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
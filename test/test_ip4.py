@@ -15,7 +15,7 @@ from framework import VppTestCase, VppTestRunner
 from util import ppp
 from vpp_ip_route import VppIpRoute, VppRoutePath, VppIpMRoute, \
     VppMRoutePath, MRouteItfFlags, MRouteEntryFlags, VppMplsIpBind, \
-    VppMplsTable, VppIpTable
+    VppMplsTable, VppIpTable, find_route
 from vpp_sub_interface import VppSubInterface, VppDot1QSubint, VppDot1ADSubint
 
 
@@ -1705,6 +1705,96 @@ class TestIPLPM(VppTestCase):
         rx = self.send_and_expect(self.pg0, p_24 * 65, self.pg1)
 
 
+class TestIPBulkRoutes(VppTestCase):
+    """ IPv4 bulk route add/del """
+
+    def setUp(self):
+        super(TestIPBulkRoutes, self).setUp()
+
+        self.create_pg_interfaces(range(2))
+
+        for i in self.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    def tearDown(self):
+        super(TestIPBulkRoutes, self).tearDown()
+        for i in self.pg_interfaces:
+            i.admin_down()
+            i.unconfig_ip4()
+
+    def bulk_route(self, is_add, dst, dst_len, nh, nh_sw_if_index=0xffffffff):
+        return {'is_add': is_add,
+                'is_drop': 0,
+                'dst_address_length': dst_len,
+                'dst_address': socket.inet_pton(socket.AF_INET, dst) +
+                b'\x00' * 12,
+                'next_hop_address': socket.inet_pton(socket.AF_INET, nh) +
+                b'\x00' * 12,
+                'next_hop_sw_if_index': nh_sw_if_index,
+                'next_hop_weight': 1,
+                'next_hop_preference': 0}
+
+    def bulk_routes(self, routes):
+        reply = self.vapi.papi.ip_add_del_route_bulk(table_id=0,
+                                                     next_hop_table_id=0,
+                                                     is_ipv6=0,
+                                                     is_multipath=0,
+                                                     n_routes=len(routes),
+                                                     routes=routes)
+        self.assertEqual(reply.retval, 0)
+        self.assertEqual(reply.n_done, len(routes))
+
+    def test_ip_bulk_routes(self):
+        """ IP bulk route add/del """
+
+        dsts = ["10.10.0.%d" % i for i in range(1, 65)]
+
+        #
+        # host routes recursive via 1.1.1.1, followed in the same
+        # request by the prefix through which it resolves
+        #
+        routes = [self.bulk_route(1, dst, 32, "1.1.1.1") for dst in dsts]
+        routes.append(self.bulk_route(1, "1.1.1.0", 24,
+                                      self.pg1.remote_ip4,
+                                      self.pg1.sw_if_index))
+        self.bulk_routes(routes)
+        self.logger.info(self.vapi.cli("show fib walk"))
+
+        for dst in dsts:
+            self.assertTrue(find_route(self, dst, 32))
+        self.assertTrue(find_route(self, "1.1.1.0", 24))
+
+        #
+        # the recursive routes forward through the prefix added after them
+        #
+        pkts = [(Ether(src=self.pg0.remote_mac,
+                       dst=self.pg0.local_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=dst) /
+                 UDP(sport=1234, dport=1234) /
+                 Raw(b'\xa5' * 100)) for dst in dsts]
+        rx = self.send_and_expect(self.pg0, pkts, self.pg1)
+        self.assertEqual(len(rx), len(dsts))
+        for p in rx:
+            self.assertEqual(p[Ether].dst, self.pg1.remote_mac)
+            self.assertIn(p[IP].dst, dsts)
+
+        #
+        # delete them all in one request, the resolving prefix first
+        #
+        routes = [self.bulk_route(0, "1.1.1.0", 24,
+                                  self.pg1.remote_ip4,
+                                  self.pg1.sw_if_index)]
+        routes += [self.bulk_route(0, dst, 32, "1.1.1.1") for dst in dsts]
+        self.bulk_routes(routes)
+
+        for dst in dsts:
+            self.assertFalse(find_route(self, dst, 32))
+        self.assertFalse(find_route(self, "1.1.1.0", 24))
+        self.send_and_assert_no_replies(self.pg0, pkts, "bulk deleted routes")
+
+
 class TestIPv4Frag(VppTestCase):
     """ IPv4 fragmentation """
 
@@ -82,6 +82,12 @@ class IpsecApiTestCase(VppTestCase):
         self.vapi.ipsec_select_backend(
             protocol=self.vpp_ah_protocol, index=0)
 
+    def test_inbound_protect_lookup(self):
+        """ inbound protect lookup follows SPD order """
+        reply = self.vapi.cli("test ipsec protect")
+        self.logger.info(reply)
+        self.assertIn("OK", reply)
+
 
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
@@ -1,11 +1,13 @@
 import socket
 import unittest
 from scapy.layers.ipsec import ESP
-from scapy.layers.inet import UDP
+from scapy.layers.inet import IP, ICMP, UDP
+from scapy.layers.l2 import Ether
 
 from framework import VppTestRunner
 from template_ipsec import IpsecTra46Tests, IpsecTun46Tests, TemplateIpsec, \
-    IpsecTcpTests, IpsecTun4Tests, IpsecTra4Tests, config_tra_params
+    IpsecTcpTests, IpsecTun4Tests, IpsecTra4Tests, config_tra_params, \
+    config_tun_params
 from vpp_ipsec import VppIpsecSpd, VppIpsecSpdEntry, VppIpsecSA,\
         VppIpsecSpdItfBinding
 from vpp_ip_route import VppIpRoute, VppRoutePath
@@ -235,6 +237,152 @@ class TestIpsecEsp2(TemplateIpsecEsp, IpsecTcpTests):
     pass
 
 
+class TestIpsecEspAsync(TemplateIpsecEsp, IpsecTra46Tests, IpsecTun46Tests):
+    """ Ipsec ESP - TUN & TRA tests with async crypto """
+    tra4_encrypt_node_name = "esp4-encrypt"
+    tra4_decrypt_node_name = "esp4-decrypt"
+    tra6_encrypt_node_name = "esp6-encrypt"
+    tra6_decrypt_node_name = "esp6-decrypt"
+    tun4_encrypt_node_name = "esp4-encrypt"
+    tun4_decrypt_node_name = "esp4-decrypt"
+    tun6_encrypt_node_name = "esp6-encrypt"
+    tun6_decrypt_node_name = "esp6-decrypt"
+
+    def setUp(self):
+        super(TestIpsecEspAsync, self).setUp()
+        self.vapi.cli("set crypto async on")
+
+    def tearDown(self):
+        if not self.vpp_dead:
+            self.vapi.cli("set crypto async off")
+        super(TestIpsecEspAsync, self).tearDown()
+
+
+class TestIpsecEspHandoff(TemplateIpsecEsp):
+    """ Ipsec ESP - SA owner worker and handoff """
+    n_workers = 2
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestIpsecEspHandoff, cls).setUpConstants()
+        i = cls.vpp_cmdline.index("main-core")
+        cls.vpp_cmdline[i + 2:i + 2] = ["workers", str(cls.n_workers)]
+
+    def setUp(self):
+        super(TestIpsecEspHandoff, self).setUp()
+        self.p = self.params[socket.AF_INET]
+        config_tun_params(self.p, self.encryption_type, self.tun_if)
+        self.icmp_seq = 0
+        self.esp_seq = 0
+
+    def set_owner(self, worker):
+        for sa_id in [self.p.scapy_tun_sa_id, self.p.vpp_tun_sa_id]:
+            reply = self.vapi.cli("set ipsec sa %d worker %d" %
+                                  (sa_id, worker))
+            self.assertNotIn("failed", reply)
+
+    def sa_packets(self, sa):
+        c = self.statistics.get_counter("/net/ipsec/sa")
+        return sum(t[sa.stat_index]['packets'] for t in c)
+
+    def send_and_expect_during(self, intf, pkts, output, during):
+        """ like send_and_expect, running during() while VPP sends """
+        intf.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        if during:
+            during()
+        return output.get_capture(len(pkts))
+
+    def send_tun44(self, count, during=None):
+        """ decrypt then encrypt a burst, checking nothing is reordered """
+        p = self.p
+        seqs = list(range(self.icmp_seq, self.icmp_seq + count))
+        self.icmp_seq += count
+
+        pkts = [(Ether(src=self.tun_if.remote_mac,
+                       dst=self.tun_if.local_mac) /
+                 p.scapy_tun_sa.encrypt(IP(src=p.remote_tun_if_host,
+                                           dst=self.pg1.remote_ip4) /
+                                        ICMP(seq=s) / self.payload))
+                for s in seqs]
+        rxs = self.send_and_expect_during(self.tun_if, pkts, self.pg1, during)
+        self.assertEqual([rx[ICMP].seq for rx in rxs], seqs)
+
+        pkts = [(Ether(src=self.pg1.remote_mac, dst=self.pg1.local_mac) /
+                 IP(src=self.pg1.remote_ip4, dst=p.remote_tun_if_host) /
+                 ICMP(seq=s) / self.payload) for s in seqs]
+        rxs = self.send_and_expect_during(self.pg1, pkts, self.tun_if, during)
+        for rx in rxs:
+            # sequence numbers are handed out in order by the one owner
+            self.assertEqual(rx[ESP].seq, self.esp_seq + 1)
+            self.esp_seq = rx[ESP].seq
+            p.vpp_tun_sa.decrypt(rx[IP])
+
+    def verify_counters(self):
+        p = self.p
+        self.assertEqual(self.sa_packets(p.tun_sa_in) +
+                         self.sa_packets(p.tun_sa_out), 2 * self.icmp_seq)
+        self.assert_packet_counter_equal(
+            '/err/esp4-decrypt/SA replayed packet', 0)
+        self.assert_packet_counter_equal(
+            '/err/esp4-decrypt-handoff/congestion drop', 0)
+        self.assert_packet_counter_equal(
+            '/err/esp4-encrypt-handoff/congestion drop', 0)
+
+    def test_handoff_owner(self):
+        """ ipsec 4o4 tunnel with the SAs owned by each worker """
+        for w in range(self.n_workers):
+            self.set_owner(w)
+            self.send_tun44(65)
+        self.verify_counters()
+
+    def test_handoff_owner_change(self):
+        """ ipsec 4o4 tunnel with the SA owner changed between bursts """
+        for i in range(8):
+            self.set_owner(i % self.n_workers)
+            self.send_tun44(257 if i % 3 == 0 else 17)
+        self.verify_counters()
+
+    def test_handoff_async_toggle(self):
+        """ ipsec 4o4 tunnel with async crypto toggled under traffic """
+        #
+        # whatever is in a worker's in-flight ring when async mode is
+        # turned off must leave before the frames that follow, and those
+        # submitted once it is turned on again must wait for it
+        #
+        modes = ["off", "on"]
+        self.async_toggles = 0
+
+        def toggle():
+            for i in range(4):
+                self.vapi.cli("set crypto async %s" %
+                              modes[self.async_toggles % 2])
+                self.async_toggles += 1
+
+        try:
+            self.vapi.cli("set crypto async on")
+            for i in range(6):
+                self.set_owner(i % self.n_workers)
+                self.send_tun44(257, during=toggle)
+        finally:
+            self.vapi.cli("set crypto async off")
+
+        self.verify_counters()
+        self.assert_packet_counter_equal(
+            '/err/esp4-decrypt/async crypto ring full (dropped)', 0)
+        self.assert_packet_counter_equal(
+            '/err/esp4-encrypt/async crypto ring full (packet dropped)', 0)
+
+    def test_handoff_owner_invalid(self):
+        """ an SA owner must be a worker """
+        reply = self.vapi.cli("set ipsec sa %d worker %d" %
+                              (self.p.scapy_tun_sa_id, self.n_workers))
+        self.assertIn("failed", reply)
+        self.send_tun44(9)
+        self.verify_counters()
+
+
 class TemplateIpsecEspUdp(TemplateIpsec):
     """
     UDP encapped ESP
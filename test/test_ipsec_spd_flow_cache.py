@@ -0,0 +1,117 @@
+import unittest
+
+from scapy.layers.inet import IP, UDP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
+
+from framework import VppTestCase, VppTestRunner
+from vpp_ipsec import VppIpsecSpd, VppIpsecSpdItfBinding, VppIpsecSpdEntry
+from vpp_papi import VppEnum
+
+
+class TestIpsecSpdFlowCache(VppTestCase):
+    """ IPsec outbound SPD flow cache """
+
+    max_entries = 4
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestIpsecSpdFlowCache, cls).setUpConstants()
+        # small enough for a handful of flows to fill the cache
+        cls.vpp_cmdline.extend(["ipsec", "{", "flow-cache-max-entries",
+                                str(cls.max_entries), "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestIpsecSpdFlowCache, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(TestIpsecSpdFlowCache, cls).tearDownClass()
+
+    def setUp(self):
+        super(TestIpsecSpdFlowCache, self).setUp()
+        self.spd = VppIpsecSpd(self, 1)
+        self.spd.add_vpp_config()
+        VppIpsecSpdItfBinding(self, self.spd, self.pg1).add_vpp_config()
+        self.bypass = VppIpsecSpdEntry(self, self.spd, 0,
+                                       "0.0.0.0", "255.255.255.255",
+                                       "0.0.0.0", "255.255.255.255",
+                                       0, priority=10)
+        self.bypass.add_vpp_config()
+        self.vapi.cli("clear ipsec counters")
+
+    def tearDown(self):
+        super(TestIpsecSpdFlowCache, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.ppcli("show ipsec"))
+
+    def get_flow_cache_counter(self, name):
+        c = self.statistics.get_counter("/net/ipsec/spd/flow-cache/" + name)
+        return sum(sum(t) for t in c)
+
+    def create_stream(self, sports):
+        return [(Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=sport, dport=4789) /
+                 Raw(b'\xa5' * 100)) for sport in sports]
+
+    def send_flows(self, sports, hits, misses, expect_rx=True):
+        """ send one packet of each flow and check the cache outcome """
+        hits += self.get_flow_cache_counter("hits")
+        misses += self.get_flow_cache_counter("misses")
+        pkts = self.create_stream(sports)
+        if expect_rx:
+            self.send_and_expect(self.pg0, pkts, self.pg1)
+        else:
+            self.send_and_assert_no_replies(self.pg0, pkts,
+                                            remark="discarded by the SPD")
+        self.assertEqual(self.get_flow_cache_counter("hits"), hits)
+        self.assertEqual(self.get_flow_cache_counter("misses"), misses)
+
+    def test_flow_cache_eviction(self):
+        """ a full flow cache is flushed to admit new flows """
+        old = range(1000, 1000 + self.max_entries)
+        new = range(2000, 2000 + self.max_entries)
+
+        self.send_flows(old, hits=0, misses=len(old))
+        self.send_flows(old, hits=len(old), misses=0)
+
+        # the cache is full: the first new flow flushes it
+        self.send_flows(new, hits=0, misses=len(new))
+        self.send_flows(new, hits=len(new), misses=0)
+
+        # and the old flows went with the flush
+        self.send_flows(old, hits=0, misses=len(old))
+
+    def test_flow_cache_spd_change(self):
+        """ flow cache entries are invalidated by an SPD change """
+        e = VppEnum.vl_api_ipsec_spd_action_t
+        flows = range(3000, 3002)
+
+        self.send_flows(flows, hits=0, misses=len(flows))
+        self.send_flows(flows, hits=len(flows), misses=0)
+
+        # a higher priority discard must win over the cached bypass
+        discard = VppIpsecSpdEntry(self, self.spd, 0,
+                                   "0.0.0.0", "255.255.255.255",
+                                   self.pg1.remote_ip4, self.pg1.remote_ip4,
+                                   0, priority=100,
+                                   policy=e.IPSEC_API_SPD_ACTION_DISCARD)
+        discard.add_vpp_config()
+        self.send_flows(flows, hits=0, misses=len(flows), expect_rx=False)
+        self.send_flows(flows, hits=len(flows), misses=0, expect_rx=False)
+
+        # and removing it brings the bypass back
+        discard.remove_vpp_config()
+        self.send_flows(flows, hits=0, misses=len(flows))
+        self.send_flows(flows, hits=len(flows), misses=0)
+
+
+if __name__ == '__main__':
+    unittest.main(testRunner=VppTestRunner)
@@ -28,7 +28,7 @@ from io import BytesIO
 from vpp_papi import VppEnum
 from scapy.all import bind_layers, Packet, ByteEnumField, ShortField, \
     IPField, IntField, LongField, XByteField, FlagsField, FieldLenField, \
-    PacketListField
+    PacketListField, ConditionalField
 
 
 # NAT HA protocol event data
@@ -67,6 +67,68 @@ class HANATStateSync(Packet):
                                    count_from=lambda pkt: pkt.count)]
 
 
+# NAT HA protocol compact event data, fields present if set in field_mask
+class CompactEvent(Packet):
+    name = "Compact event"
+    field_names = ["protocol", "flags", "in_addr", "out_addr", "in_port",
+                   "out_port", "eh_addr", "ehn_addr", "eh_port", "ehn_port",
+                   "fib_index", "total_pkts", "total_bytes"]
+    fields_desc = [ByteEnumField("event_type", None,
+                                 {1: "add", 2: "del", 3: "refresh"}),
+                   ShortField("field_mask", 0),
+                   ConditionalField(ByteEnumField("protocol", None,
+                                                  {0: "udp", 1: "tcp",
+                                                   2: "icmp"}),
+                                    lambda pkt: pkt.field_mask & 0x0001),
+                   ConditionalField(ShortField("flags", None),
+                                    lambda pkt: pkt.field_mask & 0x0002),
+                   ConditionalField(IPField("in_addr", None),
+                                    lambda pkt: pkt.field_mask & 0x0004),
+                   ConditionalField(IPField("out_addr", None),
+                                    lambda pkt: pkt.field_mask & 0x0008),
+                   ConditionalField(ShortField("in_port", None),
+                                    lambda pkt: pkt.field_mask & 0x0010),
+                   ConditionalField(ShortField("out_port", None),
+                                    lambda pkt: pkt.field_mask & 0x0020),
+                   ConditionalField(IPField("eh_addr", None),
+                                    lambda pkt: pkt.field_mask & 0x0040),
+                   ConditionalField(IPField("ehn_addr", None),
+                                    lambda pkt: pkt.field_mask & 0x0080),
+                   ConditionalField(ShortField("eh_port", None),
+                                    lambda pkt: pkt.field_mask & 0x0100),
+                   ConditionalField(ShortField("ehn_port", None),
+                                    lambda pkt: pkt.field_mask & 0x0200),
+                   ConditionalField(IntField("fib_index", None),
+                                    lambda pkt: pkt.field_mask & 0x0400),
+                   ConditionalField(IntField("total_pkts", None),
+                                    lambda pkt: pkt.field_mask & 0x0800),
+                   ConditionalField(LongField("total_bytes", None),
+                                    lambda pkt: pkt.field_mask & 0x1000)]
+
+    @classmethod
+    def create(cls, event_type, **fields):
+        """ Compact event carrying the fields given """
+        mask = 0
+        for f in fields:
+            mask |= 1 << cls.field_names.index(f)
+        return cls(event_type=event_type, field_mask=mask, **fields)
+
+    def extract_padding(self, s):
+        return "", s
+
+
+# NAT HA protocol header, version 2 with compact events
+class HANATStateSyncCompact(Packet):
+    name = "HA NAT state sync compact"
+    fields_desc = [XByteField("version", 2),
+                   FlagsField("flags", 0, 8, ['ACK']),
+                   FieldLenField("count", None, count_of="events"),
+                   IntField("sequence_number", 1),
+                   IntField("thread_index", 0),
+                   PacketListField("events", [], CompactEvent,
+                                   count_from=lambda pkt: pkt.count)]
+
+
 class MethodHolder(VppTestCase):
     """ NAT create capture and verify method holder """
 
@@ -3655,6 +3717,43 @@ class TestNAT44(MethodHolder):
             tcp = p[TCP]
             self.assertGreaterEqual(tcp.sport, 1025)
             self.assertLessEqual(tcp.sport, 1027)
+        self.assertEqual(len(set(p[TCP].sport for p in capture)), 3)
+
+    def test_port_alloc_unit(self):
+        """ NAT44 port allocator unit test """
+        error = self.vapi.cli("test nat port alloc")
+        if error:
+            self.logger.critical(error)
+        self.assertIn("unit test OK", error)
+
+    def test_user_address_pairing(self):
+        """ NAT44 keeps each user on one outside address """
+        for i in range(3, 7):
+            self.nat44_add_address("10.0.0.%d" % i)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+
+        # the destination port tells the user of each translated packet
+        pkts = []
+        for h, host in enumerate(self.pg0.remote_hosts):
+            for port in range(5):
+                p = (Ether(dst=self.pg0.local_mac, src=host.mac) /
+                     IP(src=host.ip4, dst=self.pg1.remote_ip4) /
+                     TCP(sport=2000 + port, dport=80 + h))
+                pkts.append(p)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+
+        addrs = {}
+        for p in capture:
+            addrs.setdefault(p[TCP].dport, set()).add(p[IP].src)
+        self.assertEqual(len(addrs), len(self.pg0.remote_hosts))
+        for dport, srcs in addrs.items():
+            self.assertEqual(len(srcs), 1,
+                             "user %d spread over %s" % (dport - 80, srcs))
 
     def test_ipfix_max_frags(self):
         """ IPFIX logging maximum fragments pending reassembly exceeded """
@@ -4173,6 +4272,325 @@ class TestNAT44(MethodHolder):
             self.vapi.cli("clear logging")
 
 
+class TestNAT44HA(MethodHolder):
+    """ NAT44 HA session synchronization test cases """
+
+    ha_counter_names = ["add-event-send", "del-event-send",
+                        "refresh-event-send", "add-event-recv",
+                        "ack-recv", "coalesced-event"]
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestNAT44HA, cls).setUpConstants()
+        # low enough for a short stream to recycle a user's sessions
+        cls.vpp_cmdline.extend(["nat", "{", "max", "translations", "per",
+                                "user", "2", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestNAT44HA, cls).setUpClass()
+        cls.vapi.cli("set log class nat level debug")
+        try:
+            cls.nat_addr = '10.0.0.3'
+            cls.nat_addr_n = socket.inet_pton(socket.AF_INET, cls.nat_addr)
+            cls.external_port = 20
+
+            cls.create_pg_interfaces(range(3))
+            for i in cls.pg_interfaces:
+                i.admin_up()
+                i.config_ip4()
+                i.resolve_arp()
+
+        except Exception:
+            super(TestNAT44HA, cls).tearDownClass()
+            raise
+
+    def tearDown(self):
+        super(TestNAT44HA, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.cli("show nat44 sessions detail"))
+            self.logger.info(self.vapi.cli("show nat ha"))
+            self.clear_nat44()
+            self.vapi.cli("clear logging")
+
+    def nat44_ha_config(self):
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+        self.vapi.nat_ha_set_listener(self.pg2.local_ip4, port=12345)
+
+    def ha_counters(self):
+        return dict((n, self.statistics.get_counter('/nat44/ha/' + n)[0][0])
+                    for n in self.ha_counter_names)
+
+    def assert_ha_counters(self, before, **deltas):
+        """ Check the HA counters moved by deltas, the others not at all """
+        after = self.ha_counters()
+        for n in self.ha_counter_names:
+            self.assertEqual(after[n] - before[n],
+                             deltas.get(n.replace('-', '_'), 0), n)
+
+    def create_stream_udp_in(self, ports):
+        return [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=port, dport=self.external_port))
+                for port in ports]
+
+    def ha_message_capture(self, version=1, timeout=1):
+        """ Capture a HA message sent to the failover """
+        p = self.pg2.get_capture(1, timeout=timeout)[0]
+        self.assert_packet_checksums_valid(p)
+        self.assertEqual(p[IP].src, self.pg2.local_ip4)
+        self.assertEqual(p[IP].dst, self.pg2.remote_ip4)
+        self.assertEqual(p[UDP].sport, 12345)
+        self.assertEqual(p[UDP].dport, 12346)
+        payload = scapy.compat.raw(p[UDP].payload)
+        if version == 2:
+            hanat = HANATStateSyncCompact(payload)
+        else:
+            hanat = HANATStateSync(payload)
+        self.assertEqual(hanat.version, version)
+        self.assertEqual(hanat.flags, 0)
+        return hanat
+
+    def ha_ack(self, seq):
+        ack = (Ether(dst=self.pg2.local_mac, src=self.pg2.remote_mac) /
+               IP(src=self.pg2.remote_ip4, dst=self.pg2.local_ip4) /
+               UDP(sport=12346, dport=12345) /
+               HANATStateSync(sequence_number=seq, flags='ACK'))
+        self.pg2.add_stream(ack)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+    @staticmethod
+    def ha_compact_decode(hanat):
+        """ Events of a compact message as the failover rebuilds them """
+        ctx = dict((f, 0) for f in CompactEvent.field_names)
+        for f in ["in_addr", "out_addr", "eh_addr", "ehn_addr"]:
+            ctx[f] = "0.0.0.0"
+        events = []
+        for e in hanat.events:
+            for i, f in enumerate(CompactEvent.field_names):
+                if e.field_mask & (1 << i):
+                    ctx[f] = getattr(e, f)
+            event = dict(ctx)
+            event["event_type"] = e.event_type
+            events.append(event)
+        return events
+
+    def test_ha_compact_send(self):
+        """ Send HA events in the compact encoding """
+        self.nat44_ha_config()
+        self.vapi.nat_ha_set_failover_v2(self.pg2.remote_ip4, port=12346,
+                                         compact=1)
+        failover = self.vapi.nat_ha_get_failover_v2()
+        self.assertEqual(failover.compact, 1)
+        # the original messages are unchanged, they read back the same
+        # failover and leave the encoding alone
+        failover = self.vapi.nat_ha_get_failover()
+        self.assertEqual(failover.port, 12346)
+        self.assertFalse(hasattr(failover, "compact"))
+        before = self.ha_counters()
+
+        pkts = [(Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 TCP(sport=1001, dport=self.external_port)),
+                (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1002, dport=self.external_port))]
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        sessions = {(IP_PROTOS.tcp, 1001, capture[0][TCP].sport),
+                    (IP_PROTOS.udp, 1002, capture[1][UDP].sport)}
+
+        self.vapi.nat_ha_flush()
+        hanat = self.ha_message_capture(version=2)
+        self.assertEqual(hanat.count, 2)
+        # 2 full events in version 1 would take 2 * 40 bytes
+        self.assertLess(len(scapy.compat.raw(hanat)), 12 + 2 * 40)
+
+        # what the second event shares with the first is left out
+        mask = hanat.events[1].field_mask
+        for f in ["in_addr", "out_addr", "eh_addr", "eh_port"]:
+            self.assertFalse(mask & (1 << CompactEvent.field_names.index(f)),
+                             f)
+
+        decoded = set()
+        for event in self.ha_compact_decode(hanat):
+            self.assertEqual(event["event_type"], 1)
+            self.assertEqual(event["in_addr"], self.pg0.remote_ip4)
+            self.assertEqual(event["out_addr"], self.nat_addr)
+            self.assertEqual(event["eh_addr"], self.pg1.remote_ip4)
+            self.assertEqual(event["eh_port"], self.external_port)
+            self.assertEqual(event["fib_index"], 0)
+            proto = IP_PROTOS.tcp if event["protocol"] == 1 else IP_PROTOS.udp
+            decoded.add((proto, event["in_port"], event["out_port"]))
+        self.assertEqual(decoded, sessions)
+        self.assert_ha_counters(before, add_event_send=2)
+
+        self.ha_ack(hanat.sequence_number)
+        self.assert_ha_counters(before, add_event_send=2, ack_recv=1)
+
+    def test_ha_compact_recv(self):
+        """ Receive HA events in the compact encoding """
+        self.nat44_ha_config()
+        before = self.ha_counters()
+        tcp_port_out = random.randint(1025, 65535)
+        udp_port_out = random.randint(1025, 65535)
+
+        # the second event only carries what differs from the first
+        p = (Ether(dst=self.pg2.local_mac, src=self.pg2.remote_mac) /
+             IP(src=self.pg2.remote_ip4, dst=self.pg2.local_ip4) /
+             UDP(sport=12346, dport=12345) /
+             HANATStateSyncCompact(sequence_number=1, events=[
+                 CompactEvent.create('add', protocol='tcp',
+                                     in_addr=self.pg0.remote_ip4,
+                                     out_addr=self.nat_addr,
+                                     in_port=1001, out_port=tcp_port_out,
+                                     eh_addr=self.pg1.remote_ip4,
+                                     eh_port=self.external_port),
+                 CompactEvent.create('add', protocol='udp', in_port=1002,
+                                     out_port=udp_port_out)]))
+        self.pg2.add_stream(p)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+
+        # receive ACK
+        p = self.pg2.get_capture(1)[0]
+        hanat = HANATStateSync(scapy.compat.raw(p[UDP].payload))
+        self.assertEqual(hanat.sequence_number, 1)
+        self.assertEqual(hanat.flags, 'ACK')
+        self.assert_ha_counters(before, add_event_recv=2)
+
+        users = self.vapi.nat44_user_dump()
+        self.assertEqual(len(users), 1)
+        self.assertEqual(users[0].ip_address, self.pg0.remote_ip4n)
+        sessions = self.vapi.nat44_user_session_dump(users[0].ip_address,
+                                                     users[0].vrf_id)
+        self.assertEqual(
+            set((s.protocol, s.inside_port, s.outside_port, s.ext_host_port,
+                 s.outside_ip_address) for s in sessions),
+            {(IP_PROTOS.tcp, 1001, tcp_port_out, self.external_port,
+              self.nat_addr_n),
+             (IP_PROTOS.udp, 1002, udp_port_out, self.external_port,
+              self.nat_addr_n)})
+
+    def test_ha_coalesce(self):
+        """ Coalesce the HA events waiting for a session """
+        self.nat44_ha_config()
+        self.vapi.nat_ha_set_failover(self.pg2.remote_ip4, port=12346)
+        before = self.ha_counters()
+
+        # the third and fourth sessions recycle the first two, whose add
+        # events are still waiting: each add and delete pair is dropped
+        in_ports = [1001, 1002, 1003, 1004]
+        pkts = self.create_stream_udp_in(in_ports)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        out_ports = dict(zip(in_ports, [p[UDP].sport for p in capture]))
+
+        self.vapi.nat_ha_flush()
+        hanat = self.ha_message_capture()
+        self.assertEqual(hanat.count, 2)
+        self.assertEqual([e.event_type for e in hanat.events], [1, 1])
+        self.assertEqual([(e.in_port, e.out_port) for e in hanat.events],
+                         [(1003, out_ports[1003]), (1004, out_ports[1004])])
+        self.assert_ha_counters(before, add_event_send=2, coalesced_event=4)
+        self.ha_ack(hanat.sequence_number)
+
+        # with no refresh interval every packet refreshes its session, the
+        # last refresh waiting replaces the earlier ones
+        self.vapi.nat_ha_set_failover(self.pg2.remote_ip4, port=12346,
+                                      refresh=0)
+        before = self.ha_counters()
+        pkts = [(Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                 IP(src=self.pg1.remote_ip4, dst=self.nat_addr) /
+                 UDP(sport=self.external_port, dport=out_ports[1004]))
+                for i in range(3)]
+        self.pg1.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg0.get_capture(len(pkts))
+
+        self.vapi.nat_ha_flush()
+        hanat = self.ha_message_capture()
+        self.assertEqual(hanat.count, 1)
+        event = hanat.events[0]
+        self.assertEqual(event.event_type, 3)
+        self.assertEqual(event.out_addr, self.nat_addr)
+        self.assertEqual(event.out_port, out_ports[1004])
+        self.assertEqual(event.total_pkts, 4)
+        self.assertGreater(event.total_bytes, 0)
+        self.assert_ha_counters(before, refresh_event_send=1,
+                                coalesced_event=2)
+        self.ha_ack(hanat.sequence_number)
+
+        # 1004 is used, then 1003, so the new 1005 session recycles 1004:
+        # its delete drops its waiting refresh
+        before = self.ha_counters()
+        pkts = self.create_stream_udp_in([1004, 1003, 1005])
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        out_ports[1005] = capture[2][UDP].sport
+
+        self.vapi.nat_ha_flush()
+        hanat = self.ha_message_capture()
+        self.assertEqual(hanat.count, 4)
+        self.assertEqual([e.event_type for e in hanat.events], [3, 2, 1, 3])
+        self.assertEqual([e.out_port for e in hanat.events],
+                         [out_ports[1003], out_ports[1004], out_ports[1005],
+                          out_ports[1005]])
+        self.assertEqual(hanat.events[0].total_pkts, 2)
+        self.assertEqual(hanat.events[2].in_port, 1005)
+        self.assert_ha_counters(before, add_event_send=1, del_event_send=1,
+                                refresh_event_send=2, coalesced_event=1)
+        self.ha_ack(hanat.sequence_number)
+
+    def test_ha_resync(self):
+        """ HA resync of the sessions present """
+        self.nat44_ha_config()
+
+        # sessions made before there is a failover to tell
+        in_ports = [1001, 1002]
+        pkts = self.create_stream_udp_in(in_ports)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+        out_ports = dict(zip(in_ports, [p[UDP].sport for p in capture]))
+
+        self.vapi.nat_ha_set_failover(self.pg2.remote_ip4, port=12346)
+        before = self.ha_counters()
+        self.pg_enable_capture(self.pg_interfaces)
+        self.vapi.nat_ha_resync(want_resync_event=1)
+
+        hanat = self.ha_message_capture(timeout=5)
+        self.assertEqual(hanat.count, 2)
+        self.assertEqual(
+            sorted((e.event_type, e.in_port, e.out_port)
+                   for e in hanat.events),
+            [(1, 1001, out_ports[1001]), (1, 1002, out_ports[1002])])
+        for event in hanat.events:
+            self.assertEqual(event.in_addr, self.pg0.remote_ip4)
+            self.assertEqual(event.out_addr, self.nat_addr)
+        self.assertIn("in progress", self.vapi.cli("show nat ha"))
+
+        # done once the failover has ACKed every resync message
+        self.ha_ack(hanat.sequence_number)
+        event = self.vapi.wait_for_event(5, "nat_ha_resync_completed_event")
+        self.assertEqual(event.missed_count, 0)
+        self.assertIn("completed (0 ACK missed)",
+                      self.vapi.cli("show nat ha"))
+        self.assert_ha_counters(before, add_event_send=2, ack_recv=1)
+
+
 class TestNAT44EndpointDependent(MethodHolder):
     """ Endpoint-Dependent mapping and filtering test cases """
 
@@ -6279,6 +6697,44 @@ class TestNAT44EndpointDependent(MethodHolder):
             nsessions = nsessions + user.nsessions
         self.assertLess(nsessions, 2 * max_sessions)
 
+    @unittest.skipUnless(running_extended_tests, "part of extended tests")
+    def test_session_timeout_no_traffic(self):
+        """ NAT44 sessions expire without traffic """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+        self.vapi.nat_set_timeouts(udp=5)
+
+        # more than one expiry run deletes, so the backlog is exercised
+        max_sessions = 1500
+        pkts = []
+        for i in range(0, max_sessions):
+            src = "10.10.%u.%u" % ((i & 0xFF00) >> 8, i & 0xFF)
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=src, dst=self.pg1.remote_ip4) /
+                 UDP(sport=1025, dport=53))
+            pkts.append(p)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        self.pg1.get_capture(max_sessions)
+
+        nsessions = 0
+        users = self.vapi.nat44_user_dump()
+        for user in users:
+            nsessions = nsessions + user.nsessions
+        self.assertEqual(nsessions, max_sessions)
+
+        # no packets from here on, only the timers can remove them
+        sleep(10)
+
+        nsessions = 0
+        users = self.vapi.nat44_user_dump()
+        for user in users:
+            nsessions = nsessions + user.nsessions
+        self.assertEqual(nsessions, 0)
+
     @unittest.skipUnless(running_extended_tests, "part of extended tests")
     def test_session_rst_timeout(self):
         """ NAT44 session RST timeouts """
@@ -6422,6 +6878,152 @@ class TestNAT44EndpointDependent(MethodHolder):
             self.vapi.cli("clear logging")
 
 
+class TestNAT44EndpointDependentRss(MethodHolder):
+    """ Endpoint-Dependent NAT with RSS-consistent port selection """
+
+    # the nat plugin's default Toeplitz key and redirection table size
+    rss_key = ("6d5a56da255b0ec24167253d43a38fb0d0ca2bcbae7b30b4"
+               "77cb2da38030f20c6a42b73bbeac01fa")
+    rss_reta_size = 128
+    n_workers = 2
+
+    @classmethod
+    def setUpConstants(cls):
+        super(TestNAT44EndpointDependentRss, cls).setUpConstants()
+        i = cls.vpp_cmdline.index("main-core")
+        cls.vpp_cmdline[i + 2:i + 2] = ["workers", str(cls.n_workers)]
+        cls.vpp_cmdline.extend(["nat", "{", "endpoint-dependent",
+                                "rss-consistent", "}"])
+
+    @classmethod
+    def setUpClass(cls):
+        super(TestNAT44EndpointDependentRss, cls).setUpClass()
+        cls.vapi.cli("set log class nat level debug")
+        try:
+            cls.nat_addr = '10.0.0.3'
+            cls.tcp_external_port = 80
+            cls.n_flows = 16
+
+            cls.create_pg_interfaces(range(2))
+            for i in cls.pg_interfaces:
+                i.admin_up()
+                i.config_ip4()
+                i.resolve_arp()
+
+        except Exception:
+            super(TestNAT44EndpointDependentRss, cls).tearDownClass()
+            raise
+
+    @classmethod
+    def toeplitz(cls, src, dst, sport, dport):
+        """ Toeplitz hash of an IPv4 TCP/UDP 4-tuple """
+        data = bytearray(socket.inet_pton(socket.AF_INET, src) +
+                         socket.inet_pton(socket.AF_INET, dst) +
+                         struct.pack("!HH", sport, dport))
+        key = int(cls.rss_key, 16)
+        key_bits = len(cls.rss_key) * 4
+        h = 0
+        for i, byte in enumerate(data):
+            for b in range(8):
+                if byte & (0x80 >> b):
+                    h ^= (key >> (key_bits - 32 - i * 8 - b)) & 0xffffffff
+        return h
+
+    def test_rss_hash(self):
+        """ NAT44 RSS Toeplitz hash known answers """
+        reply = self.vapi.cli("test nat44 rss hash")
+        self.logger.info(reply)
+        self.assertNotIn("failed", reply)
+        self.assertIn("OK", reply)
+
+        # the test's own hash, used below, gives the same answers
+        self.assertEqual(self.toeplitz("66.9.149.187", "161.142.100.80",
+                                       2794, 1766), 0x51ccc178)
+        self.assertEqual(self.toeplitz("199.92.111.2", "65.69.140.83",
+                                       14230, 4739), 0xc626b0ea)
+
+    def test_rss_consistent(self):
+        """ NAT44 RSS-consistent outside ports """
+        self.nat44_add_address(self.nat_addr)
+        self.vapi.nat44_interface_add_del_feature(self.pg0.sw_if_index)
+        self.vapi.nat44_interface_add_del_feature(self.pg1.sw_if_index,
+                                                  is_inside=0)
+
+        nat_config = self.vapi.nat_show_config()
+        self.assertEqual(1, nat_config.endpoint_dependent)
+
+        in2out_same = self.statistics.get_counter(
+            '/err/nat44-in2out-worker-handoff/same worker')
+        out2in_same = self.statistics.get_counter(
+            '/err/nat44-out2in-worker-handoff/same worker')
+
+        # in2out, from the first worker which owns the sessions
+        pkts = []
+        for i in range(self.n_flows):
+            l4 = TCP if i % 2 else UDP
+            p = (Ether(dst=self.pg0.local_mac, src=self.pg0.remote_mac) /
+                 IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+                 l4(sport=6000 + i, dport=self.tcp_external_port))
+            pkts.append(p)
+        self.pg0.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg1.get_capture(len(pkts))
+
+        port_per_thread = (0xffff - 1024) // self.n_workers
+        out_ports = {}
+        for p in capture:
+            l4 = p[TCP] if TCP in p else p[UDP]
+            self.assertEqual(p[IP].src, self.nat_addr)
+            self.assertEqual(p[IP].dst, self.pg1.remote_ip4)
+            self.assertEqual(l4.dport, self.tcp_external_port)
+            # from the first worker's slice of the ports
+            self.assertTrue(1024 < l4.sport <= 1024 + port_per_thread)
+            # and its replies hash to the first worker's rx queue
+            h = self.toeplitz(p[IP].dst, p[IP].src, l4.dport, l4.sport)
+            self.assertEqual((h & (self.rss_reta_size - 1)) %
+                             self.n_workers, 0)
+            out_ports[l4.sport] = l4.__class__
+        self.assertEqual(len(out_ports), self.n_flows)
+
+        # out2in
+        pkts = []
+        for port, l4 in out_ports.items():
+            p = (Ether(dst=self.pg1.local_mac, src=self.pg1.remote_mac) /
+                 IP(src=self.pg1.remote_ip4, dst=self.nat_addr) /
+                 l4(sport=self.tcp_external_port, dport=port))
+            pkts.append(p)
+        self.pg1.add_stream(pkts)
+        self.pg_enable_capture(self.pg_interfaces)
+        self.pg_start()
+        capture = self.pg0.get_capture(len(pkts))
+        in_ports = set()
+        for p in capture:
+            l4 = p[TCP] if TCP in p else p[UDP]
+            self.assertEqual(p[IP].dst, self.pg0.remote_ip4)
+            in_ports.add(l4.dport)
+        self.assertEqual(in_ports,
+                         set(range(6000, 6000 + self.n_flows)))
+
+        # no packet had to go through a frame queue
+        self.assertEqual(self.statistics.get_counter(
+            '/err/nat44-in2out-worker-handoff/same worker') - in2out_same,
+            self.n_flows)
+        self.assertEqual(self.statistics.get_counter(
+            '/err/nat44-out2in-worker-handoff/same worker') - out2in_same,
+            self.n_flows)
+
+    def tearDown(self):
+        super(TestNAT44EndpointDependentRss, self).tearDown()
+        if not self.vpp_dead:
+            self.logger.info(self.vapi.cli("show nat44 addresses"))
+            self.logger.info(self.vapi.cli("show nat44 interfaces"))
+            self.logger.info(self.vapi.cli("show nat44 sessions detail"))
+            self.logger.info(self.vapi.cli("show nat44 hash tables detail"))
+            self.clear_nat44()
+            self.vapi.cli("clear logging")
+
+
 class TestNAT44Out2InDPO(MethodHolder):
     """ NAT44 Test Cases using out2in DPO """
 
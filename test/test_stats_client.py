@@ -1,11 +1,18 @@
 #!/usr/bin/env python2.7
 
+import re
+import threading
 import unittest
 
 import psutil
 from vpp_papi.vpp_stats import VPPStats
 
+from scapy.layers.inet import IP, UDP
+from scapy.layers.l2 import Ether
+from scapy.packet import Raw
+
 from framework import VppTestCase, VppTestRunner
+from vpp_lo_interface import VppLoInterface
 
 
 class StatsClientTestCase(VppTestCase):
@@ -37,5 +44,267 @@ class StatsClientTestCase(VppTestCase):
                          "ending client side file descriptor count: %s" % (
                              initial_fds, ending_fds))
 
+    def test_dump_while_updating(self):
+        """Dump stats while counters and directory entries change"""
+
+        cls = self.__class__
+        stop = threading.Event()
+        dumps = []
+        errors = []
+        n_before = len(self.statistics.dump(
+            self.statistics.ls(["^/if/", "^/err/"])))
+
+        #
+        # a second client dumps the interface and error counters in a loop.
+        # The directory only grows and so do the interface counter vectors,
+        # whatever is added or removed meanwhile.
+        #
+        def reader():
+            stats = VPPStats(socketname=cls.stats_sock)
+            n_entries = 0
+            n_interfaces = 0
+            try:
+                while not stop.is_set():
+                    try:
+                        d = stats.dump(stats.ls(["^/if/", "^/err/"]))
+                        self.assertGreaterEqual(len(d), n_entries)
+                        self.assertGreaterEqual(len(d["/if/rx"][0]),
+                                                n_interfaces)
+                        n_entries = len(d)
+                        n_interfaces = len(d["/if/rx"][0])
+                        dumps.append(n_entries)
+                    except Exception as e:
+                        errors.append(e)
+                        return
+            finally:
+                stats.disconnect()
+
+        t = threading.Thread(target=reader)
+        t.start()
+        try:
+            #
+            # each loopback adds interface counters and, the first time
+            # its nodes are made, error counters to the directory.
+            # Deleting it clears its counters.
+            #
+            names = []
+            for i in range(3):
+                loops = [VppLoInterface(self) for j in range(20)]
+                for lo in loops:
+                    lo.admin_up()
+                    names.append(lo.name)
+                for lo in loops:
+                    lo.admin_down()
+                    lo.remove_vpp_config()
+        finally:
+            stop.set()
+            t.join()
+
+        self.assertEqual(errors, [])
+        self.assertGreater(len(dumps), 1)
+
+        #
+        # the last dump sees every interface created, and the directory
+        # entries of their output nodes
+        #
+        d = self.statistics.dump(self.statistics.ls(["^/if/", "^/err/"]))
+        self.assertGreater(len(d), n_before)
+        self.assertGreater(len(d["/if/rx"][0]),
+                           max(lo.sw_if_index for lo in loops))
+        for name in names:
+            self.assertIn("/err/%s-output/interface is down" % name, d)
+
+
+
+class StatsDeltaTestCase(VppTestCase):
+    """Test Stats Client delta dumps"""
+
+    @classmethod
+    def setUpConstants(cls):
+        super(StatsDeltaTestCase, cls).setUpConstants()
+        # a collector pass every 2s, long enough to act between two
+        i = cls.vpp_cmdline.index("statseg")
+        cls.vpp_cmdline[i + 2:i + 2] = ["aggregate-counters", "on",
+                                        "update-interval", "2"]
+
+    @classmethod
+    def setUpClass(cls):
+        super(StatsDeltaTestCase, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(StatsDeltaTestCase, cls).tearDownClass()
+
+    def send(self, n):
+        p = (Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+             IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+             UDP(sport=1234, dport=1234) /
+             Raw(b'\xa5' * 100))
+        self.send_and_expect(self.pg0, p * n, self.pg1)
+
+    def aggregate_seq(self):
+        return int(self.statistics.get_counter("^/sys/aggregate_seq$"))
+
+    def wait_for_collector_pass(self):
+        """ return just after a collector pass completed """
+        seq = self.aggregate_seq()
+        target = (seq | 1) + 1
+        for i in range(100):
+            seq = self.aggregate_seq()
+            if seq >= target and not seq & 1:
+                return seq
+            self.sleep(0.05)
+        self.fail("no collector pass completed")
+
+    def test_delta_per_thread(self):
+        """Delta dumps of per-thread counters, one shadow per consumer"""
+        stats = self.statistics
+        names = stats.ls(["^/if/rx$"])
+        delta = stats.delta_create()
+        other = stats.delta_create()
+
+        # the first dump reports everything, the next nothing
+        n = sum(len(t) for t in stats.get_counter("^/if/rx$"))
+        self.assertEqual(len(stats.dump_delta(names, delta)), n)
+        self.assertEqual(len(stats.dump_delta(names, other)), n)
+        self.assertEqual(stats.dump_delta(names, delta), [])
+
+        self.send(5)
+        rx = stats.get_counter("^/if/rx$")[0][self.pg0.sw_if_index]
+        r = stats.dump_delta(names, delta)
+        self.assertEqual(r, [("/if/rx", 0, self.pg0.sw_if_index, rx)])
+        self.assertEqual(stats.dump_delta(names, delta), [])
+
+        # the other consumer is told about the change all the same
+        self.assertEqual(stats.dump_delta(names, other), r)
+
+    def test_delta_aggregates(self):
+        """Delta dumps of summaries follow aggregate_seq and the bitmap"""
+        stats = self.statistics
+        self.wait_for_collector_pass()
+        names = stats.ls(["^/aggregate/if/rx$"])
+        self.assertEqual(len(names), 1)
+        delta = stats.delta_create()
+
+        #
+        # straight after a pass the dump reports every summary counter,
+        # and with no pass since, the next one nothing
+        #
+        self.wait_for_collector_pass()
+        self.assertGreater(len(stats.dump_delta(names, delta)),
+                           self.pg1.sw_if_index)
+        self.send(5)
+        self.assertEqual(stats.dump_delta(names, delta), [])
+
+        #
+        # after exactly one more pass only what its change bitmap flags
+        # is reported, summed across threads
+        #
+        self.wait_for_collector_pass()
+        rx = stats.get_counter("^/if/rx$")
+        total = {'packets': sum(t[self.pg0.sw_if_index]['packets']
+                                for t in rx),
+                 'bytes': sum(t[self.pg0.sw_if_index]['bytes']
+                              for t in rx)}
+        r = stats.dump_delta(names, delta)
+        self.assertEqual(r, [("/aggregate/if/rx", -1,
+                              self.pg0.sw_if_index, total)])
+        self.assertEqual(stats.dump_delta(names, delta), [])
+
+
+class StatsNodeHistogramTestCase(VppTestCase):
+    """Test node runtime histograms in the stats segment"""
+
+    @classmethod
+    def setUpConstants(cls):
+        super(StatsNodeHistogramTestCase, cls).setUpConstants()
+        i = cls.vpp_cmdline.index("statseg")
+        cls.vpp_cmdline[i + 2:i + 2] = ["update-interval", "1"]
+
+    @classmethod
+    def setUpClass(cls):
+        super(StatsNodeHistogramTestCase, cls).setUpClass()
+        cls.create_pg_interfaces(range(2))
+        for i in cls.pg_interfaces:
+            i.admin_up()
+            i.config_ip4()
+            i.resolve_arp()
+
+    @classmethod
+    def tearDownClass(cls):
+        super(StatsNodeHistogramTestCase, cls).tearDownClass()
+
+    def node_index(self, name):
+        r = self.vapi.cli("show node %s" % name)
+        return int(re.search(r"index (\d+)", r).group(1))
+
+    def test_histogram(self):
+        """set/show runtime histogram and their stats segment vectors"""
+        stats = self.statistics
+
+        #
+        # nothing is allocated until histograms are enabled
+        #
+        r = self.vapi.cli("show runtime histogram ip4-lookup")
+        self.assertIn("histograms not enabled", r)
+        self.sleep(2)
+        self.assertEqual(
+            stats.get_counter("^/sys/node/clocks_histogram$"), [])
+        self.assertEqual(
+            stats.get_counter("^/sys/node/vectors_histogram$"), [])
+        self.assertEqual(
+            stats.get_counter("^/sys/node/clocks_histogram_bounds$"), [])
+
+        self.vapi.cli("set runtime histogram on")
+        p = (Ether(src=self.pg0.remote_mac, dst=self.pg0.local_mac) /
+             IP(src=self.pg0.remote_ip4, dst=self.pg1.remote_ip4) /
+             UDP(sport=1234, dport=1234) /
+             Raw(b'\xa5' * 100))
+        self.send_and_expect(self.pg0, p * 10, self.pg1)
+
+        r = self.vapi.cli("show runtime histogram ip4-lookup verbose")
+        self.logger.info(r)
+        m = re.search(r"Thread 0 \S+: (\d+) calls", r)
+        self.assertIsNotNone(m)
+        calls = int(m.group(1))
+        self.assertGreater(calls, 0)
+
+        #
+        # after a collector pass the stats segment holds the same counts
+        # and the lower bound of each bucket
+        #
+        self.sleep(2)
+        n_nodes = len(stats.get_counter("^/sys/node/clocks$")[0])
+        clocks = stats.get_counter("^/sys/node/clocks_histogram$")
+        vectors = stats.get_counter("^/sys/node/vectors_histogram$")
+        self.assertGreaterEqual(len(clocks[0]), n_nodes * 32)
+        self.assertGreaterEqual(len(vectors[0]), n_nodes * 16)
+        self.assertEqual(
+            stats.get_counter("^/sys/node/clocks_histogram_bounds$"),
+            [[0] + [1 << b for b in range(31)]])
+        self.assertEqual(
+            stats.get_counter("^/sys/node/vectors_histogram_bounds$"),
+            [[0] + [1 << b for b in range(15)]])
+
+        i = self.node_index("ip4-lookup")
+        self.assertEqual(sum(vectors[0][i * 16:(i + 1) * 16]), calls)
+        self.assertEqual(sum(clocks[0][i * 32:(i + 1) * 32]), calls)
+
+        #
+        # clear runtime resets them, and off stops the recording
+        #
+        self.vapi.cli("clear runtime")
+        r = self.vapi.cli("show runtime histogram ip4-lookup")
+        self.assertNotIn("calls", r)
+        self.vapi.cli("set runtime histogram off")
+        r = self.vapi.cli("show runtime histogram ip4-lookup")
+        self.assertIn("histograms not enabled", r)
+
+
 if __name__ == '__main__':
     unittest.main(testRunner=VppTestRunner)
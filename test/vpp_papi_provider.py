@@ -156,6 +156,7 @@ defaultmapping = {
     'nat_det_add_del_map': {'is_add': 1, },
     'nat_ha_resync': {'want_resync_event': 1, },
     'nat_ha_set_failover': {'refresh': 10, },
+    'nat_ha_set_failover_v2': {'refresh': 10, },
     'nat_ha_set_listener': {'path_mtu': 512, },
     'nat_ipfix_enable_disable': {'domain_id': 1, 'src_port': 4739,
                                  'enable': 1, },
@@ -1310,6 +1311,20 @@ class VppPapiProvider(object):
                          'port': port,
                          'session_refresh_interval': refresh})
 
+    def nat_ha_set_failover_v2(self, addr, port, refresh=10, compact=0):
+        """Set HA failover (remote settings) with the event encoding
+
+        :param addr: failover IP4 address
+        :param port: failvoer UDP port number
+        :param refresh: number of seconds after which to send session refresh
+        :param compact: 1 to send events delta-encoded (Default value = 0)
+        """
+        return self.api(self.papi.nat_ha_set_failover_v2,
+                        {'ip_address': addr,
+                         'port': port,
+                         'session_refresh_interval': refresh,
+                         'compact': compact})
+
     def nat_ha_resync(self, want_resync_event=1):
         """Resync HA (resend existing sessions to new failover)
         :param want_resync_event: if non-zero resync completed event sent